@@ -31,6 +31,9 @@
 #include "DeviceUtils.h"
 #include "DeviceThreads.h"
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -51,7 +54,13 @@ ASIHub::ASIHub() :
       serialRepeatDuration_(0),
       serialRepeatPeriod_(500),
       serialOnlySendChanged_(true),
-      updatingSharedProperties_(false)
+      updatingSharedProperties_(false),
+      commandGeneration_(0),
+      statusPolling_(g_StatusPolling_Off),
+      statusCacheMaxAgeMs_(50),
+      multiAxisQueries_(true),
+      pollStop_(false),
+      statusPollingPeriodMs_(100)
 {
    CPropertyAction* pAct = new CPropertyAction(this, &ASIHub::OnPort);
    CreateProperty(MM::g_Keyword_Port, "Undefined", MM::String, false, pAct, true);
@@ -88,6 +97,35 @@ ASIHub::ASIHub() :
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_2);
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_3);
    AddAllowedValue(g_SerialTerminatorPropertyName, g_SerialTerminator_4);
+
+   // serve position and busy queries of peripherals from a cache filled with one multi-axis query per card
+   // "On demand" refreshes a card when a stale value is asked for, "Background" also refreshes periodically
+   pAct = new CPropertyAction (this, &ASIHub::OnStatusPolling);
+   CreateProperty(g_StatusPollingPropertyName, g_StatusPolling_Off, MM::String, false, pAct);
+   AddAllowedValue(g_StatusPollingPropertyName, g_StatusPolling_Off);
+   AddAllowedValue(g_StatusPollingPropertyName, g_StatusPolling_OnDemand);
+   AddAllowedValue(g_StatusPollingPropertyName, g_StatusPolling_Background);
+
+   pAct = new CPropertyAction (this, &ASIHub::OnStatusPollingPeriod);
+   CreateProperty(g_StatusPollingPeriodPropertyName, "100", MM::Integer, false, pAct);
+   SetPropertyLimits(g_StatusPollingPeriodPropertyName, 10, 10000);
+
+   // oldest cached value that will be returned to a peripheral
+   pAct = new CPropertyAction (this, &ASIHub::OnStatusCacheMaxAge);
+   CreateProperty(g_StatusCacheMaxAgePropertyName, "50", MM::Integer, false, pAct);
+   SetPropertyLimits(g_StatusCacheMaxAgePropertyName, 0, 10000);
+
+   // set to No automatically if the firmware doesn't reply to "W X Y" with one value per axis
+   pAct = new CPropertyAction (this, &ASIHub::OnMultiAxisQueries);
+   CreateProperty(g_MultiAxisQueriesPropertyName, g_YesState, MM::String, false, pAct);
+   AddAllowedValue(g_MultiAxisQueriesPropertyName, g_NoState);
+   AddAllowedValue(g_MultiAxisQueriesPropertyName, g_YesState);
+}
+
+int ASIHub::Shutdown()
+{
+   StopStatusPolling();
+   return ASIBase< ::HubBase, ASIHub >::Shutdown();
 }
 
 int ASIHub::ClearComPort(void)
@@ -100,9 +138,11 @@ int ASIHub::ClearComPort(void)
    */
 int ASIHub::QueryCommandUnterminatedResponse(const char *command, const long timeoutMs, unsigned long reply_length)
 {
+   MMThreadGuard g(threadLock_);
    RETURN_ON_MM_ERROR ( ClearComPort() );
    RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command, "\r") );
    serialCommand_ = command;
+   CommandSent(command);
    char rcvBuf[MM::MaxStrLength];
    memset(rcvBuf, 0, MM::MaxStrLength);
    unsigned long total_read = 0;
@@ -127,9 +167,11 @@ int ASIHub::QueryCommandUnterminatedResponse(const char *command, const long tim
 // Note that the property SerialResponse property will only show the first 1023 characters of the controller's reply.
 int ASIHub::QueryCommandLongReply(const char *command, const char *replyTerminator)
 {
+   MMThreadGuard g(threadLock_);
    RETURN_ON_MM_ERROR ( ClearComPort() );
    RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command, "\r") );
    serialCommand_ = command;
+   CommandSent(command);
    serialAnswer_ = "";  // NB this is global variable
    string lastLine = "";
    int lastErr = DEVICE_OK;
@@ -153,6 +195,7 @@ int ASIHub::QueryCommand(const char *command, const char *replyTerminator, const
    RETURN_ON_MM_ERROR ( ClearComPort() );
    RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command, "\r") );
    serialCommand_ = command;
+   CommandSent(command);
    if (delayMs >= 0)  CDeviceUtils::SleepMs(delayMs);
    RETURN_ON_MM_ERROR ( GetSerialAnswer(port_.c_str(), replyTerminator, serialAnswer_) );
    return DEVICE_OK;
@@ -495,6 +538,304 @@ int ASIHub::UpdateSharedProperties(string addressChar, string propName, string v
    return ret;
 }
 
+void ASIHub::RegisterPolledAxes(const string deviceLabel, const string addressChar,
+      const string axisLetters, bool pollStatus)
+{
+   MMThreadGuard g(threadLock_);
+   for (string::size_type i = 0; i < axisLetters.size(); ++i)
+   {
+      PolledAxis axis;
+      axis.deviceLabel = deviceLabel;
+      axis.addressChar = addressChar;
+      axis.pollStatus = pollStatus;
+      axis.position = 0.0;
+      axis.busy = false;
+      axis.positionRead.valid = false;
+      axis.positionRead.generation = 0;
+      axis.busyRead = axis.positionRead;
+      polledAxes_[axisLetters.substr(i, 1)] = axis;
+   }
+}
+
+void ASIHub::UnRegisterPolledAxes(const string deviceLabel)
+{
+   MMThreadGuard g(threadLock_);
+   for (map<string, PolledAxis>::iterator it = polledAxes_.begin(); it != polledAxes_.end(); )
+   {
+      if (it->second.deviceLabel == deviceLabel)
+         polledAxes_.erase(it++);
+      else
+         ++it;
+   }
+}
+
+int ASIHub::GetPolledPosition(const string axisLetter, double &pos)
+{
+   PolledAxis axis;
+   RETURN_ON_MM_ERROR ( GetFreshPolledAxis(axisLetter, false, axis) );
+   pos = axis.position;
+   return DEVICE_OK;
+}
+
+int ASIHub::GetPolledBusy(const string axisLetter, bool &busy)
+{
+   PolledAxis axis;
+   RETURN_ON_MM_ERROR ( GetFreshPolledAxis(axisLetter, true, axis) );
+   busy = axis.busy;
+   return DEVICE_OK;
+}
+
+int ASIHub::GetFreshPolledAxis(const string axisLetter, bool status, PolledAxis &axis)
+{
+   if (statusPolling_.compare(g_StatusPolling_Off) == 0)
+      return DEVICE_NOT_SUPPORTED;
+   MMThreadGuard g(threadLock_);
+   map<string, PolledAxis>::const_iterator it = polledAxes_.find(axisLetter);
+   if (it == polledAxes_.end() || (status && !it->second.pollStatus))
+      return DEVICE_NOT_SUPPORTED;
+   const PolledAxis &cached = it->second;
+   if (!IsFresh(status ? cached.busyRead : cached.positionRead))
+   {
+      // read the rest of the card too while we are at it, unless that takes a command per axis
+      if (multiAxisQueries_)
+         RETURN_ON_MM_ERROR ( RefreshPolledCard(cached.addressChar, !status, status) );
+      else
+         RETURN_ON_MM_ERROR ( RefreshPolledAxes(vector<string>(1, axisLetter), !status, status) );
+   }
+   axis = cached;
+   return DEVICE_OK;
+}
+
+bool ASIHub::IsFresh(const PolledValue &value)
+{
+   return value.valid && value.generation == commandGeneration_
+         && (GetCurrentMMTime() - value.time).getMsec() <= statusCacheMaxAgeMs_;
+}
+
+bool ASIHub::IsStatusQuery(const string &command)
+// true for commands that only read positions, status, or settings and so can't make cached values wrong
+{
+   // skip the card address if present ('1' to '9' or extended ASCII)
+   string::size_type start = 0;
+   while (start < command.size() && ((command[start] >= '1' && command[start] <= '9') || (command[start] & 0x80)))
+      ++start;
+   string word = command.substr(start, command.find(' ', start) - start);
+   transform(word.begin(), word.end(), word.begin(), ::toupper);
+   if (word == "W" || word == "WHERE" || word == "RS" || word == "RDSTAT")
+      return true;
+   return !command.empty() && command[command.size() - 1] == '?';
+}
+
+void ASIHub::CommandSent(const char *command)
+{
+   // called with threadLock_ held
+   if (!IsStatusQuery(command))
+      ++commandGeneration_;
+}
+
+int ASIHub::QueryStatusAnswer(const string &command, string &answer)
+// like QueryCommandVerify(command, ":A") but leaves serialAnswer_ alone, because the
+//   background poller may run between a peripheral's query and the parsing of its answer
+{
+   MMThreadGuard g(threadLock_);
+   RETURN_ON_MM_ERROR ( ClearComPort() );
+   RETURN_ON_MM_ERROR ( SendSerialCommand(port_.c_str(), command.c_str(), "\r") );
+   RETURN_ON_MM_ERROR ( GetSerialAnswer(port_.c_str(), g_SerialTerminatorDefault, answer) );
+   if (answer.compare(0, 2, ":A") != 0)
+      return ERR_UNRECOGNIZED_ANSWER;
+   return DEVICE_OK;
+}
+
+int ASIHub::QueryPolledPositions(const vector<string> &axes, vector<double> &positions)
+{
+   string answer;
+   positions.clear();
+   if (multiAxisQueries_ && axes.size() > 1)
+   {
+      // "W X Y Z" replies ":A 1.0 2.0 3.0"
+      ostringstream command; command.str("");
+      command << "W";
+      for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+         command << " " << axes[i];
+      int ret = QueryStatusAnswer(command.str(), answer);
+      if (ret != DEVICE_OK && ret != ERR_UNRECOGNIZED_ANSWER)
+         return ret;
+      vector<string> tokens;
+      CDeviceUtils::Tokenize(answer, tokens, " ");
+      if (ret == DEVICE_OK && tokens.size() == axes.size() + 1)
+      {
+         for (vector<string>::size_type i = 1; i < tokens.size(); ++i)
+            positions.push_back(atof(tokens[i].c_str()));
+         return DEVICE_OK;
+      }
+      LogMessage("Multi-axis W query not supported by firmware (reply \"" + answer + "\"), querying axes individually");
+      multiAxisQueries_ = false;
+   }
+   for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+   {
+      RETURN_ON_MM_ERROR ( QueryStatusAnswer("W " + axes[i], answer) );
+      if (answer.length() <= 2)
+         return ERR_UNRECOGNIZED_ANSWER;
+      positions.push_back(atof(answer.substr(2).c_str()));
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::QueryPolledBusy(const vector<string> &axes, vector<bool> &busy)
+{
+   string answer;
+   busy.clear();
+   if (multiAxisQueries_ && axes.size() > 1)
+   {
+      // "RS X? Y?" replies with an N or B for each axis
+      ostringstream command; command.str("");
+      command << "RS";
+      for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+         command << " " << axes[i] << "?";
+      int ret = QueryStatusAnswer(command.str(), answer);
+      if (ret != DEVICE_OK && ret != ERR_UNRECOGNIZED_ANSWER)
+         return ret;
+      string states;
+      if (ret == DEVICE_OK)
+      {
+         for (string::size_type i = 2; i < answer.size(); ++i)
+         {
+            if (answer[i] != ' ')
+               states.push_back(answer[i]);
+         }
+      }
+      if (states.size() == axes.size() && states.find_first_not_of("NB") == string::npos)
+      {
+         for (string::size_type i = 0; i < states.size(); ++i)
+            busy.push_back(states[i] == 'B');
+         return DEVICE_OK;
+      }
+      LogMessage("Multi-axis RS query not supported by firmware (reply \"" + answer + "\"), querying axes individually");
+      multiAxisQueries_ = false;
+   }
+   for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+   {
+      RETURN_ON_MM_ERROR ( QueryStatusAnswer("RS " + axes[i] + "?", answer) );
+      if (answer.length() <= 3)
+         return ERR_UNRECOGNIZED_ANSWER;
+      busy.push_back(answer[3] == 'B');
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::RefreshPolledAxes(const vector<string> &axes, bool positions, bool status)
+{
+   MMThreadGuard g(threadLock_);
+   vector<string> statusAxes;
+   for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+   {
+      if (polledAxes_[axes[i]].pollStatus)
+         statusAxes.push_back(axes[i]);
+   }
+
+   // age is counted from before the query so the cache never looks fresher than it is
+   PolledValue read;
+   read.valid = true;
+   read.generation = commandGeneration_;
+   if (positions && !axes.empty())
+   {
+      read.time = GetCurrentMMTime();
+      vector<double> values;
+      RETURN_ON_MM_ERROR ( QueryPolledPositions(axes, values) );
+      for (vector<string>::size_type i = 0; i < axes.size(); ++i)
+      {
+         PolledAxis &axis = polledAxes_[axes[i]];
+         axis.position = values[i];
+         axis.positionRead = read;
+      }
+   }
+   if (status && !statusAxes.empty())
+   {
+      read.time = GetCurrentMMTime();
+      vector<bool> values;
+      RETURN_ON_MM_ERROR ( QueryPolledBusy(statusAxes, values) );
+      for (vector<string>::size_type i = 0; i < statusAxes.size(); ++i)
+      {
+         PolledAxis &axis = polledAxes_[statusAxes[i]];
+         axis.busy = values[i];
+         axis.busyRead = read;
+      }
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::RefreshPolledCard(const string addressChar, bool positions, bool status)
+{
+   MMThreadGuard g(threadLock_);
+   vector<string> axes;
+   for (map<string, PolledAxis>::const_iterator it = polledAxes_.begin(); it != polledAxes_.end(); ++it)
+   {
+      if (it->second.addressChar == addressChar)
+         axes.push_back(it->first);
+   }
+   return RefreshPolledAxes(axes, positions, status);
+}
+
+int ASIHub::RefreshAllPolledCards()
+{
+   set<string> addresses;
+   {
+      MMThreadGuard g(threadLock_);
+      for (map<string, PolledAxis>::const_iterator it = polledAxes_.begin(); it != polledAxes_.end(); ++it)
+         addresses.insert(it->second.addressChar);
+   }
+   int ret = DEVICE_OK;
+   for (set<string>::const_iterator it = addresses.begin(); it != addresses.end(); ++it)
+   {
+      // release the serial port between cards so peripherals don't wait for a whole sweep
+      int ret_last = RefreshPolledCard(*it, true, true);
+      if (ret_last != DEVICE_OK)
+         ret = ret_last;
+   }
+   return ret;
+}
+
+void ASIHub::StartStatusPolling()
+{
+   if (statusPolling_.compare(g_StatusPolling_Background) != 0 || pollThread_.joinable())
+      return;
+   pollStop_ = false;
+   pollThread_ = std::thread(&ASIHub::StatusPollingThread, this);
+}
+
+void ASIHub::StopStatusPolling()
+{
+   if (!pollThread_.joinable())
+      return;
+   {
+      std::lock_guard<std::mutex> lock(pollMutex_);
+      pollStop_ = true;
+   }
+   pollCond_.notify_all();
+   pollThread_.join();
+}
+
+void ASIHub::StatusPollingThread()
+{
+   int lastErr = DEVICE_OK;
+   std::unique_lock<std::mutex> lock(pollMutex_);
+   while (!pollStop_)
+   {
+      const long periodMs = statusPollingPeriodMs_;
+      lock.unlock();
+      int ret = RefreshAllPolledCards();
+      if (ret != DEVICE_OK && ret != lastErr)  // only log when the error changes
+      {
+         ostringstream os; os.str("");
+         os << "Status polling failed with error " << ret;
+         LogMessage(os.str());
+      }
+      lastErr = ret;
+      lock.lock();
+      pollCond_.wait_for(lock, std::chrono::milliseconds(periodMs), [this] { return pollStop_; });
+   }
+}
+
 int ASIHub::OnPort(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
@@ -667,6 +1008,66 @@ int ASIHub::OnSerialCommandOnlySendChanged(MM::PropertyBase* pProp, MM::ActionTy
    return DEVICE_OK;
 }
 
+int ASIHub::OnStatusPolling(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(statusPolling_.c_str());
+   }
+   else if (eAct == MM::AfterSet) {
+      pProp->Get(statusPolling_);
+      if (statusPolling_.compare(g_StatusPolling_Background) != 0)
+         StopStatusPolling();
+      else if (initialized_)
+         StartStatusPolling();
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::OnStatusPollingPeriod(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(statusPollingPeriodMs_);
+   }
+   else if (eAct == MM::AfterSet) {
+      long tmp = 0;
+      pProp->Get(tmp);
+      {
+         std::lock_guard<std::mutex> lock(pollMutex_);
+         statusPollingPeriodMs_ = tmp;
+      }
+      pollCond_.notify_all();
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::OnStatusCacheMaxAge(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(statusCacheMaxAgeMs_);
+   }
+   else if (eAct == MM::AfterSet) {
+      pProp->Get(statusCacheMaxAgeMs_);
+   }
+   return DEVICE_OK;
+}
+
+int ASIHub::OnMultiAxisQueries(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(multiAxisQueries_ ? g_YesState : g_NoState);
+   }
+   else if (eAct == MM::AfterSet) {
+      string tmpstr;
+      pProp->Get(tmpstr);
+      MMThreadGuard g(threadLock_);
+      multiAxisQueries_ = (tmpstr.compare(g_YesState) == 0);
+   }
+   return DEVICE_OK;
+}
 string ASIHub::EscapeControlCharacters(const string v)
 // based on similar function in FreeSerialPort.cpp
 {
@@ -29,7 +29,12 @@
 #include "MMDevice.h"
 #include "DeviceBase.h"
 #include "DeviceThreads.h"
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////
 // *********** generic ASI comm class *************************
@@ -44,7 +49,9 @@ class ASIHub : public ASIBase<HubBase, ASIHub>
 {
 public:
 	ASIHub();
-	~ASIHub() { }
+	~ASIHub() { StopStatusPolling(); }
+
+   int Shutdown();
 
 	// Communication base functions
    int ClearComPort();
@@ -131,8 +138,23 @@ public:
 
    void UnRegisterPeripheral(const std::string deviceLabel) {
       deviceMap_.erase(deviceLabel);  // remove device from lookup table
+      UnRegisterPolledAxes(deviceLabel);
    }
 
+   // Batched status polling: peripherals register the axes whose position (and optionally
+   //   busy status, which needs RS <axis>? from firmware 2.7) they report, and then try
+   //   GetPolledPosition()/GetPolledBusy() before querying the controller themselves.
+   // The hub reads all registered axes of a card with one "W X Y ..." and one "RS X? Y? ..."
+   //   command, either on demand or from a background thread, and serves reads from the
+   //   cache while it is younger than StatusCacheMaxAge(ms).  Any command other than a
+   //   status query invalidates the cache, so reads after a move always see the move.
+   void RegisterPolledAxes(const std::string deviceLabel, const std::string addressChar,
+         const std::string axisLetters, bool pollStatus);
+   void UnRegisterPolledAxes(const std::string deviceLabel);
+   // position in controller units; DEVICE_NOT_SUPPORTED if polling is off or axis not registered
+   int GetPolledPosition(const std::string axisLetter, double &pos);
+   int GetPolledBusy(const std::string axisLetter, bool &busy);
+
    bool UpdatingSharedProperties() { return updatingSharedProperties_; }
 
    int UpdateSharedProperties(std::string addressChar, std::string propName, std::string value);
@@ -145,10 +167,18 @@ public:
    int OnSerialCommandRepeatDuration(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSerialCommandRepeatPeriod  (MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnSerialCommandOnlySendChanged(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnStatusPolling              (MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnStatusPollingPeriod        (MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnStatusCacheMaxAge          (MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnMultiAxisQueries           (MM::PropertyBase* pProp, MM::ActionType eAct);
 
 protected:
    std::string port_;         // port to use for communication
 
+   // starts the background poller if StatusPolling is set to Background, called once initialized
+   void StartStatusPolling();
+   void StopStatusPolling();
+
 private:
 	int ParseErrorReply() const;
 	static std::string EscapeControlCharacters(const std::string v);
@@ -156,6 +186,36 @@ private:
 	static std::vector<char> ConvertStringVector2CharVector(const std::vector<std::string> v);
 	static std::vector<int> ConvertStringVector2IntVector(const std::vector<std::string> v);
 
+   struct PolledValue
+   {
+      bool valid;               // false until read
+      MM::MMTime time;          // when read
+      unsigned long generation; // commandGeneration_ when read
+   };
+
+   struct PolledAxis
+   {
+      std::string deviceLabel;
+      std::string addressChar;
+      bool pollStatus;
+      double position;          // controller units, reply to W
+      bool busy;                // reply to RS <axis>?
+      PolledValue positionRead;
+      PolledValue busyRead;
+   };
+
+   static bool IsStatusQuery(const std::string &command);
+   void CommandSent(const char *command);
+   int QueryStatusAnswer(const std::string &command, std::string &answer);
+   int QueryPolledPositions(const std::vector<std::string> &axes, std::vector<double> &positions);
+   int QueryPolledBusy(const std::vector<std::string> &axes, std::vector<bool> &busy);
+   bool IsFresh(const PolledValue &value);
+   int RefreshPolledAxes(const std::vector<std::string> &axes, bool positions, bool status);
+   int RefreshPolledCard(const std::string addressChar, bool positions, bool status);
+   int RefreshAllPolledCards();
+   int GetFreshPolledAxis(const std::string axisLetter, bool status, PolledAxis &axis);
+   void StatusPollingThread();
+
    std::string serialAnswer_;      // the last answer received from any communication with the controller
    std::string manualSerialAnswer_; // last answer received when the SerialCommand property was used
    std::string serialCommand_;     // the last command sent, or can be set for calling commands without args
@@ -167,6 +227,20 @@ private:
    bool updatingSharedProperties_;
    std::map<std::string, std::string> deviceMap_;  // to implement properties shared between devices
         // key is the device name, value is the Tiger address (normally a single character, see note about addressChar_ in ASIPeripheralBase
+
+   // status polling state, protected by threadLock_ like the serial port
+   std::map<std::string, PolledAxis> polledAxes_;  // key is the axis letter
+   unsigned long commandGeneration_;  // incremented by every command that isn't a status query
+   std::string statusPolling_;
+   long statusCacheMaxAgeMs_;
+   bool multiAxisQueries_;    // cleared if the firmware doesn't answer "W X Y" with one value per axis
+
+   // background poller
+   std::thread pollThread_;
+   std::mutex pollMutex_;
+   std::condition_variable pollCond_;
+   bool pollStop_;
+   long statusPollingPeriodMs_;
 };
 
 
@@ -142,6 +142,14 @@ protected:
    bool refreshProps_;     // true when property values should be read anew from controller each time
    bool refreshOverride_;  // true when device wants to manually force refreshes temporarily
 
+   // lets the hub serve position (and if pollStatus then busy) queries for these axes from its status cache
+   void RegisterPolledAxes(const std::string &axisLetters, bool pollStatus)
+   {
+      char deviceLabel[MM::MaxStrLength];
+      this->GetLabel(deviceLabel);
+      hub_->RegisterPolledAxes(deviceLabel, addressChar_, axisLetters, pollStatus);
+   }
+
    // related to creating "extended" names containing address and axis letters
    static bool IsExtendedName(const char* name)
    {
@@ -80,6 +80,9 @@ int CPiezo::Initialize()
    unitMult_ = tmp/1000;
    command.str("");
 
+   // position can be read from the hub's cache if status polling is on
+   RegisterPolledAxes(axisLetter_, false);
+
    // set controller card to return positions with 2 decimal places (3 is max allowed currently, 2 gives 1nm resolution)
    command.str("");
    command << addressChar_ << "VB Z=2";
@@ -429,6 +432,11 @@ int CPiezo::Initialize()
 
 int CPiezo::GetPositionUm(double& pos)
 {
+   if (hub_->GetPolledPosition(axisLetter_, pos) == DEVICE_OK)
+   {
+      pos = pos/unitMult_;
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -446,10 +454,15 @@ int CPiezo::SetPositionUm(double pos)
 
 int CPiezo::GetPositionSteps(long& steps)
 {
+   double tmp;
+   if (hub_->GetPolledPosition(axisLetter_, tmp) == DEVICE_OK)
+   {
+      steps = (long)(tmp/unitMult_/stepSizeUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
-   double tmp;
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterPosition2(tmp) );
    steps = (long)(tmp/unitMult_/stepSizeUm_);
    return DEVICE_OK;
@@ -105,6 +105,9 @@ int CScanner::Initialize()
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":") );
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterEquals(unitMultY_) );
 
+   // position can be read from the hub's cache if status polling is on
+   RegisterPolledAxes(axisLetterX_ + axisLetterY_, false);
+
    // read the home position (used for beam shuttering)
    command.str(""); command << "HM " << axisLetterX_ << "?";
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":") );
@@ -728,7 +731,14 @@ int CScanner::SetPosition(double x, double y)
 int CScanner::GetPosition(double& x, double& y)
 {
 //   // read from card instead of using cached values directly, could be slight mismatch
-   // TODO implement as single serial command for speed (know that X axis always before Y on card)
+   // with status polling on the hub reads both axes with a single serial command
+   if (hub_->GetPolledPosition(axisLetterX_, x) == DEVICE_OK
+         && hub_->GetPolledPosition(axisLetterY_, y) == DEVICE_OK)
+   {
+      x = x/unitMultX_;
+      y = y/unitMultY_;
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetterX_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -182,6 +182,10 @@ const char* const g_SerialCommandOnlySendChangedPropertyName = "OnlySendSerialCo
 const char* const g_SerialCommandRepeatDurationPropertyName = "SerialCommandRepeatDuration(s)";
 const char* const g_SerialCommandRepeatPeriodPropertyName = "SerialCommandRepeatPeriod(ms)";
 const char* const g_SerialComPortPropertyName = "SerialComPort";
+const char* const g_StatusPollingPropertyName = "StatusPolling";
+const char* const g_StatusPollingPeriodPropertyName = "StatusPollingPeriod(ms)";
+const char* const g_StatusCacheMaxAgePropertyName = "StatusCacheMaxAge(ms)";
+const char* const g_MultiAxisQueriesPropertyName = "StatusMultiAxisQueries";
 
 // motorized stage property names (XY and Z)
 const char* const g_StepSizeXPropertyName = "StepSizeX(um)";
@@ -650,6 +654,10 @@ const char* const g_SerialTerminator_3 = "return only - \\r";
 const char* const g_SerialTerminator_3_Value = "\r";
 const char* const g_SerialTerminator_4 = "newline only - \\n";
 const char* const g_SerialTerminator_4_Value = "\\n";
+// status polling modes for hub
+const char* const g_StatusPolling_Off = "Off";
+const char* const g_StatusPolling_OnDemand = "On demand";
+const char* const g_StatusPolling_Background = "Background";
 // joystick codes
 const char* const g_JSCode_0 = "0 - none";
 const char* const g_JSCode_1 = "1 - factory default";
@@ -102,6 +102,7 @@ int CTigerCommHub::Initialize()
 
    // if we made it this far everything looks good
    initialized_ = true;
+   StartStatusPolling();
    return DEVICE_OK;
 }
 
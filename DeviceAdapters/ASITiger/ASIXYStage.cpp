@@ -91,6 +91,9 @@ int CXYStage::Initialize()
    RETURN_ON_MM_ERROR( hub_->ParseAnswerAfterEquals(tmp) );
    unitMultY_ = tmp/1000;
 
+   // position and status can be read from the hub's cache if status polling is on (RS <axis>? needs firmware 2.7)
+   RegisterPolledAxes(axisLetterX_ + axisLetterY_, FirmwareVersionAtLeast(2.7));
+
    // set controller card to return positions with 1 decimal places (3 is max allowed currently, 1 gives 10nm resolution)
    command.str("");
    command << addressChar_ << "VB Z=1";
@@ -495,10 +498,17 @@ int CXYStage::getMinMaxSpeed(string axisLetter, double& minSpeed, double& maxSpe
 
 int CXYStage::GetPositionSteps(long& x, long& y)
 {
+   double tmp, tmpY;
+   if (hub_->GetPolledPosition(axisLetterX_, tmp) == DEVICE_OK
+         && hub_->GetPolledPosition(axisLetterY_, tmpY) == DEVICE_OK)
+   {
+      x = (long)(tmp/unitMultX_/stepSizeXUm_);
+      y = (long)(tmpY/unitMultY_/stepSizeYUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetterX_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
-   double tmp;
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterPosition2(tmp) );
    x = (long)(tmp/unitMultX_/stepSizeXUm_);
    command.str("");
@@ -598,6 +608,12 @@ int CXYStage::Stop()
 
 bool CXYStage::Busy()
 {
+   bool busyX, busyY;
+   if (hub_->GetPolledBusy(axisLetterX_, busyX) == DEVICE_OK
+         && hub_->GetPolledBusy(axisLetterY_, busyY) == DEVICE_OK)
+   {
+      return busyX || busyY;
+   }
    ostringstream command; command.str("");
    if (FirmwareVersionAtLeast(2.7)) // can use more accurate RS <axis>?
    {
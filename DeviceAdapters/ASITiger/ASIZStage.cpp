@@ -80,6 +80,9 @@ int CZStage::Initialize()
    unitMult_ = tmp/1000;
    command.str("");
 
+   // position and status can be read from the hub's cache if status polling is on (RS <axis>? needs firmware 2.7)
+   RegisterPolledAxes(axisLetter_, FirmwareVersionAtLeast(2.7));
+
    // set controller card to return positions with 1 decimal places (3 is max allowed currently, 1 gives 10nm resolution)
    command.str("");
    command << addressChar_ << "VB Z=1";
@@ -411,6 +414,11 @@ int CZStage::Initialize()
 
 int CZStage::GetPositionUm(double& pos)
 {
+   if (hub_->GetPolledPosition(axisLetter_, pos) == DEVICE_OK)
+   {
+      pos = pos/unitMult_;
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
@@ -428,10 +436,15 @@ int CZStage::SetPositionUm(double pos)
 
 int CZStage::GetPositionSteps(long& steps)
 {
+   double tmp;
+   if (hub_->GetPolledPosition(axisLetter_, tmp) == DEVICE_OK)
+   {
+      steps = (long)(tmp/unitMult_/stepSizeUm_);
+      return DEVICE_OK;
+   }
    ostringstream command; command.str("");
    command << "W " << axisLetter_;
    RETURN_ON_MM_ERROR ( hub_->QueryCommandVerify(command.str(),":A") );
-   double tmp;
    RETURN_ON_MM_ERROR ( hub_->ParseAnswerAfterPosition2(tmp) );
    steps = (long)(tmp/unitMult_/stepSizeUm_);
    return DEVICE_OK;
@@ -494,6 +507,11 @@ bool CZStage::Busy()
    {
       return false;
    }
+   bool busy;
+   if (hub_->GetPolledBusy(axisLetter_, busy) == DEVICE_OK)
+   {
+      return busy;
+   }
    if (FirmwareVersionAtLeast(2.7)) // can use more accurate RS <axis>?
    {
       command << "RS " << axisLetter_ << "?";
@@ -7,6 +7,8 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <array>
+#include <deque>
 
 
 #define ERR_PORT_CHANGE_FORBIDDEN    21001 
@@ -111,8 +113,7 @@ public:
    int Home();
    void GetPositionXYSteps(long& x, long& y);
    void GetPositionZSteps(long& z);
-   void SetPositionXSteps(long x);
-   void SetPositionYSteps(long y);
+   void SetPositionXYSteps(long x, long y);
    void SetPositionZSteps(long z);
    void SetCmdNrReceived(uint8_t cmdNr, uint8_t status);
 
@@ -379,17 +380,50 @@ private:
 };
 
 
+/*
+ * Incremental parser for the fixed length status messages sent by the
+ * controller. Bytes can be fed in arbitrary chunks; the CRC is updated as
+ * bytes arrive. When a message fails the CRC check, the parser drops one
+ * byte and tries again, so that it resynchronizes with the message stream.
+ * Older firmware does not set the CRC byte (it is always 0). Which kind of
+ * firmware is sending is decided once a few consecutive messages with a
+ * valid CRC have been seen, or none has been found in a few messages' worth
+ * of data. Until then, only messages with a valid nonzero CRC are returned;
+ * other data is skipped without counting CRC errors.
+ */
 class SquidMessageParser {
 public:
-   SquidMessageParser(unsigned char* inputStream, long inputStreamLength);
+   enum CRCMode {
+      CRC_UNKNOWN,
+      CRC_CHECKED,
+      CRC_NOT_SET,
+   };
+
+   SquidMessageParser();
    ~SquidMessageParser() {};
-   int GetNextMessage(unsigned char* nextMessage, int& nextMessageLength);
+   void Append(const unsigned char* data, unsigned long length);
+   bool GetNextMessage(unsigned char* nextMessage);
+   CRCMode GetCRCMode() const { return crcMode_; }
+   unsigned long GetCRCErrorCount() const { return crcErrors_; }
    static const int messageMaxLength_ = 24;
 
 private:
-   unsigned char* inputStream_;
-   long inputStreamLength_;
-   long index_;
+   void CompleteMessage();
+   void Resync();
+
+   // Number of consecutive valid messages (or messages' worth of invalid
+   // data) needed to decide whether the firmware sets the CRC
+   static const int crcModeThreshold_ = 3;
+
+   unsigned char partial_[messageMaxLength_];
+   int partialLength_;
+   unsigned char crc_; // over the first messageMaxLength_ - 1 bytes of partial_
+   unsigned long long bytesReceived_;
+   std::deque<std::array<unsigned char, messageMaxLength_> > messages_;
+   CRCMode crcMode_;
+   int matchedCount_;
+   int unmatchedCount_;
+   unsigned long crcErrors_;
 };
 
 
@@ -405,15 +439,18 @@ public:
 private:
    void InterpretMessage(unsigned char* message);
    bool IsBigEndian(void);
-   static const int RCV_BUF_LENGTH = 48; // contains 2 messages.  If set to 24, we crash...
+   static const int RCV_BUF_LENGTH = 256;
    MM::Core& core_;
    SquidHub& hub_;
    bool debug_;
-   bool stop_;
-   long intervalUs_;
+   std::atomic_bool stop_;
+   // Upper bound on how long a read blocks; determines how quickly Stop() is
+   // honored
+   long readTimeoutMs_;
    std::thread* ourThread_;
    bool isBigEndian_;
    unsigned int counter_;
+   SquidMessageParser parser_;
    SquidMonitoringThread& operator=(SquidMonitoringThread& /*rhs*/) { assert(false); return *this; }
 };
 
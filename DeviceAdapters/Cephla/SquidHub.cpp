@@ -359,33 +359,16 @@ void SquidHub::GetPositionZSteps(long& z)
 }
 
 
-void SquidHub::SetPositionXSteps(long x)
+// X and Y arrive in the same status message; report them to the stage
+// with a single callback
+void SquidHub::SetPositionXYSteps(long x, long y)
 {
-   if (x_.load() != x)
-   {
-      xStageBusy_ = true;
-      x_.store(x);
-      if (xyStageDevice_ != 0)
-         xyStageDevice_->Callback(x, y_.load());
-   }
-   else {
-      xStageBusy_ = false;
-   }
-}
-
-
-void SquidHub::SetPositionYSteps(long y)
-{
-   if (y_.load() != y)
-   {
-      yStageBusy_ = true;
-      y_.store(y);
-      if (xyStageDevice_ != 0)
-         xyStageDevice_->Callback(x_.load(), y);
-   }
-   else {
-      yStageBusy_ = false;
-   }
+   bool xChanged = x_.exchange(x) != x;
+   bool yChanged = y_.exchange(y) != y;
+   xStageBusy_ = xChanged;
+   yStageBusy_ = yChanged;
+   if ((xChanged || yChanged) && xyStageDevice_ != 0)
+      xyStageDevice_->Callback(x, y);
 }
 
 
@@ -1,45 +1,113 @@
 #include "Squid.h"
+#include "crc8.h"
 #define SWAP_INT32(x) (((x) >> 24) | (((x) & 0x00FF0000) >> 8) | (((x) & 0x0000FF00) << 8) | ((x) << 24));
 
 
 /*
  * Utility class for SquidMonitoringThread
- * Takes an input stream and returns messages in the GetNextMessage method
+ * Collects bytes passed to Append and returns complete messages in the
+ * GetNextMessage method
  */
-SquidMessageParser::SquidMessageParser(unsigned char* inputStream, long inputStreamLength) :
-   index_(0)
+SquidMessageParser::SquidMessageParser() :
+   partialLength_(0),
+   crc_(0),
+   bytesReceived_(0),
+   crcMode_(CRC_UNKNOWN),
+   matchedCount_(0),
+   unmatchedCount_(0),
+   crcErrors_(0)
 {
-   inputStream_ = inputStream;
-   inputStreamLength_ = inputStreamLength;
+}
+
+void SquidMessageParser::Append(const unsigned char* data, unsigned long length)
+{
+   for (unsigned long i = 0; i < length; i++)
+   {
+      bytesReceived_++;
+      if (partialLength_ < messageMaxLength_ - 1)
+         crc_ = CRC_TABLE[crc_ ^ data[i]];
+      partial_[partialLength_++] = data[i];
+      if (partialLength_ == messageMaxLength_)
+         CompleteMessage();
+   }
 }
 
 /*
- * Provides the next message in the inputStream.
- * Returns 0 on success, -1 when no message was found
+ * Copies the oldest complete message into nextMessage (which must hold
+ * messageMaxLength_ bytes).
+ * Returns false when no complete message is available
  */
-int SquidMessageParser::GetNextMessage(unsigned char* nextMessage, int& nextMessageLength) {
+bool SquidMessageParser::GetNextMessage(unsigned char* nextMessage)
+{
+   if (messages_.empty())
+      return false;
+   memcpy(nextMessage, messages_.front().data(), messageMaxLength_);
+   messages_.pop_front();
+   return true;
+}
 
-   bool msgFound = false;
-   while (!msgFound)
+void SquidMessageParser::CompleteMessage()
+{
+   const unsigned char receivedCRC = partial_[messageMaxLength_ - 1];
+   bool accept;
+   if (crcMode_ == CRC_CHECKED)
+      accept = receivedCRC == crc_;
+   else if (crcMode_ == CRC_NOT_SET)
+      accept = true;
+   else
    {
-      nextMessageLength = 0;
-      while ((index_ < inputStreamLength_) && (nextMessageLength < messageMaxLength_)) {
-         nextMessage[nextMessageLength] = inputStream_[index_];
-         nextMessageLength++;
-         index_++;
-      }
-
-      if (nextMessageLength == messageMaxLength_)
+      // Both kinds of firmware can send a zero CRC byte, so only a nonzero
+      // match tells them apart
+      accept = receivedCRC == crc_ && receivedCRC != 0;
+      if (accept)
       {
-         msgFound = true;
-         return 0;
+         unmatchedCount_ = 0;
+         if (++matchedCount_ >= crcModeThreshold_)
+            crcMode_ = CRC_CHECKED;
       }
-      else //  index_ == inputStreamLength_
+      else
       {
-         return -1;
+         matchedCount_ = 0;
+         if (++unmatchedCount_ >= crcModeThreshold_ * messageMaxLength_)
+         {
+            // Nothing to synchronize on; assume, as was always done before
+            // the CRC was checked, that the stream started with a message
+            crcMode_ = CRC_NOT_SET;
+            const int misalignment = (int)(bytesReceived_ % messageMaxLength_);
+            if (misalignment != 0)
+            {
+               memmove(partial_, partial_ + messageMaxLength_ - misalignment, misalignment);
+               partialLength_ = misalignment;
+               crc_ = crc8ccitt(partial_, partialLength_);
+               return;
+            }
+            accept = true;
+         }
       }
    }
-   return -1; // should never be reached
+
+   if (!accept)
+   {
+      if (crcMode_ != CRC_UNKNOWN)
+         crcErrors_++;
+      Resync();
+      return;
+   }
+
+   std::array<unsigned char, messageMaxLength_> message;
+   memcpy(message.data(), partial_, messageMaxLength_);
+   messages_.push_back(message);
+   partialLength_ = 0;
+   crc_ = 0;
+}
+
+// Drops the first byte of a message that failed the CRC check, so that the
+// next byte is tried as the start of a message
+void SquidMessageParser::Resync()
+{
+   memmove(partial_, partial_ + 1, messageMaxLength_ - 1);
+   partialLength_ = messageMaxLength_ - 1;
+   crc_ = crc8ccitt(partial_, messageMaxLength_ - 1);
 }
 
 
@@ -48,7 +116,7 @@ SquidMonitoringThread::SquidMonitoringThread(MM::Core& core, SquidHub& hub, bool
    hub_(hub),
    debug_(debug),
    stop_(true),
-   intervalUs_(10000), // check every 10 ms for new messages, 
+   readTimeoutMs_(100),
    ourThread_(0),
    counter_(0)
 {
@@ -58,7 +126,11 @@ SquidMonitoringThread::SquidMonitoringThread(MM::Core& core, SquidHub& hub, bool
 SquidMonitoringThread::~SquidMonitoringThread()
 {
    stop_ = true;
-   ourThread_->join();
+   if (ourThread_ != 0)
+   {
+      ourThread_->join();
+      delete ourThread_;
+   }
    //hub_.LogMessage("Destructing MonitoringThread", true);
 }
 
@@ -71,7 +143,7 @@ SquidMonitoringThread::~SquidMonitoringThread()
 14 - 17 - uint32_t Theta position
 18 - Joystick Button
 19 - 22 - Reserved
-23 - CRC checksum(appears not to be set)
+23 - CRC checksum (not set by older firmware, see SquidMessageParser)
 */
 
 void SquidMonitoringThread::InterpretMessage(unsigned char* message)
@@ -94,14 +166,13 @@ void SquidMonitoringThread::InterpretMessage(unsigned char* message)
    {
       ux = SWAP_INT32(ux);
    }
-   hub_.SetPositionXSteps(ux);
    std::uint32_t uy;
    memcpy(&uy, &message[6], 4);
    if (!isBigEndian_)
    {
       uy = SWAP_INT32(uy);
    }
-   hub_.SetPositionYSteps(uy);
+   hub_.SetPositionXYSteps(ux, uy);
    std::uint32_t uz;
    memcpy(&uz, &message[10], 4);
    if (!isBigEndian_)
@@ -113,82 +184,51 @@ void SquidMonitoringThread::InterpretMessage(unsigned char* message)
 }
 
 
+/*
+ * Blocks until the controller sends data (or readTimeoutMs_ passes), so that
+ * status changes are seen as soon as they arrive rather than on the next
+ * polling interval.
+ */
 int SquidMonitoringThread::svc() {
 
-   //core_.LogMessage(&device_, "Starting MonitoringThread", true);
-
-   unsigned long dataLength;
-   unsigned long charsRead = 0;
-   unsigned long charsRemaining = 0;
    unsigned char rcvBuf[RCV_BUF_LENGTH];
-   memset(rcvBuf, 0, RCV_BUF_LENGTH);
+   unsigned char message[SquidMessageParser::messageMaxLength_];
+   SquidMessageParser::CRCMode crcMode = parser_.GetCRCMode();
+   unsigned long crcErrors = 0;
 
    while (!stop_)
    {
-      do {
-         if (charsRemaining > (RCV_BUF_LENGTH - SquidMessageParser::messageMaxLength_)) {
-            // for one reason or another, our buffer is overflowing.  Empty it out before we crash
-            charsRemaining = 0;
-         }
-         dataLength = RCV_BUF_LENGTH - charsRemaining;
-
-         // Do the scope monitoring stuff here
-         // MM::MMTime _start = core_.GetCurrentMMTime();
-
-         int ret = core_.ReadFromSerial(&hub_, hub_.port_.c_str(), rcvBuf + charsRemaining, dataLength, charsRead);
-
-         //std::ostringstream os;
-         //os << "Monitoring Thread read from Serial: ";
-         //for (int i = 0; i < charsRead; i++) {
-         //   os << std::hex << (unsigned int)rcvBuf[i] << " ";
-         //}
-         //core_.LogMessage(&hub_, os.str().c_str(), false);
-  
-         // MM::MMTime _end = core_.GetCurrentMMTime();
-         // std::ostringstream os;
-         // MM::MMTime t = _end-_start;
-         // os << "ReadFromSerial took: " << t.sec_ << " seconds and " << t.uSec_ / 1000.0 << " msec";
-         // core_.LogMessage(&device_, os.str().c_str(), true);
-
-         if (ret != DEVICE_OK) {
-            std::ostringstream oss;
-            oss << "Monitoring Thread: ERROR while reading from serial port, error code: " << ret;
-            core_.LogMessage(&hub_, oss.str().c_str(), false);
-         }
-         else if (charsRead > 0) {
-            SquidMessageParser parser(rcvBuf, charsRead + charsRemaining);
-            do {
-               unsigned char message[RCV_BUF_LENGTH];
-               int messageLength;
-               ret = parser.GetNextMessage(message, messageLength);
-               if (ret == 0) {
-                  // Report 
-                  // and do the real stuff
-                  InterpretMessage(message);
-               }
-               else {
-                  // no more messages, copy remaining (if any) back to beginning of buffer
-                  if (debug_ && messageLength > 0) {
-                     std::ostringstream oos;
-                     oos << "Monitoring Thread no message found!: ";
-                     for (int i = 0; i < messageLength; i++) {
-                        oos << std::hex << (unsigned int)message[i] << " ";
-                        rcvBuf[i] = message[i];
-                     }
-                     //core_.LogMessage(&hub_, os.str().c_str(), false);
-                  }
-                  memset(rcvBuf, 0, RCV_BUF_LENGTH);
-                  for (int i = 0; i < messageLength; i++) {
-                     rcvBuf[i] = message[i];
-                  }
-                  charsRemaining = messageLength;
-               }
-            } while (ret == 0);
-         }
-      } while ((charsRead != 0) && (!stop_));
-      CDeviceUtils::SleepMs(intervalUs_ / 1000);
+      unsigned long charsRead = 0;
+      int ret = core_.ReadFromSerialWithTimeout(&hub_, hub_.port_.c_str(),
+            rcvBuf, RCV_BUF_LENGTH, charsRead, readTimeoutMs_);
+      if (ret != DEVICE_OK) {
+         std::ostringstream oss;
+         oss << "Monitoring Thread: ERROR while reading from serial port, error code: " << ret;
+         core_.LogMessage(&hub_, oss.str().c_str(), false);
+         // Do not spin on a port that keeps failing
+         CDeviceUtils::SleepMs(readTimeoutMs_);
+         continue;
+      }
+
+      parser_.Append(rcvBuf, charsRead);
+      while (parser_.GetNextMessage(message))
+         InterpretMessage(message);
+
+      if (parser_.GetCRCMode() != crcMode) {
+         crcMode = parser_.GetCRCMode();
+         core_.LogMessage(&hub_, crcMode == SquidMessageParser::CRC_CHECKED ?
+               "Monitoring Thread: controller sets message CRC; checking CRC" :
+               "Monitoring Thread: controller does not set message CRC; not checking CRC",
+               false);
+      }
+      if (debug_ && parser_.GetCRCErrorCount() != crcErrors) {
+         crcErrors = parser_.GetCRCErrorCount();
+         std::ostringstream oss;
+         oss << "Monitoring Thread: CRC errors so far: " << crcErrors;
+         core_.LogMessage(&hub_, oss.str().c_str(), true);
+      }
    }
-    return 0;
+   return 0;
 }
 
 
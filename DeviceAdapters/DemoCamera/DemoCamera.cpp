@@ -229,7 +229,6 @@ CDemoCamera::CDemoCamera() :
 	cameraCCDYSize_(512),
    ccdT_ (0.0),
    triggerDevice_(""),
-   stopOnOverflow_(false),
 	dropPixels_(false),
    fastImage_(false),
    saturatePixels_(false),
@@ -244,12 +243,26 @@ CDemoCamera::CDemoCamera() :
    imgManpl_(0),
    pcf_(1.0),
    photonFlux_(50.0),
-   readNoise_(2.5)
+   readNoise_(2.5),
+   armedFrameCount_(1),
+   armedFrameRate_(0.0),
+   triggerAPIAcquisition_(false),
+   acquisitionAborted_(false)
 {
    memset(testProperty_,0,sizeof(testProperty_));
 
    // call the base class method to set-up default error codes/messages
    InitializeDefaultErrorMessages();
+   SetErrorText(ERR_TRIGGER_NOT_SOFTWARE, "Trigger is not on with software source");
+
+   TriggerState off;
+   off.mode = MM::TriggerModeOff;
+   off.source = MM::TriggerSourceInternal;
+   off.delayUs = 0.0;
+   off.activation = MM::TriggerActivationRisingEdge;
+   off.overlap = MM::TriggerOverlapOff;
+   triggers_[MM::TriggerSelectorAcquisitionStart] = off;
+   triggers_[MM::TriggerSelectorFrameStart] = off;
    readoutStartTime_ = GetCurrentMMTime();
    thd_ = new MySequenceThread(this);
 
@@ -1008,6 +1021,19 @@ int CDemoCamera::AddToExposureSequence(double exposureTime_ms)
    return DEVICE_OK;
 }
 
+/**
+ * Adds count exposures to the list of exposures used in sequences
+ */
+int CDemoCamera::AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count)
+{
+   if (!isSequenceable_) {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   exposureSequence_.insert(exposureSequence_.end(), exposureTimes_ms, exposureTimes_ms + count);
+   return DEVICE_OK;
+}
+
 int CDemoCamera::SendExposureSequence() const {
    if (!isSequenceable_) {
       return DEVICE_UNSUPPORTED_COMMAND;
@@ -1066,7 +1092,7 @@ int CDemoCamera::StopSequenceAcquisition()
 * A sequence acquisition should run on its own thread and transport new images
 * coming of the camera into the MMCore circular buffer.
 */
-int CDemoCamera::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
+int CDemoCamera::StartSequenceAcquisition(long numImages, double interval_ms, bool /*stopOnOverflow*/)
 {
    if (IsCapturing())
       return DEVICE_CAMERA_BUSY_ACQUIRING;
@@ -1074,10 +1100,11 @@ int CDemoCamera::StartSequenceAcquisition(long numImages, double interval_ms, bo
    int ret = GetCoreCallback()->PrepareForAcq(this);
    if (ret != DEVICE_OK)
       return ret;
+   // Left set by AcquisitionAbort() after the previous run
+   acquisitionAborted_ = false;
    sequenceStartTime_ = GetCurrentMMTime();
    imageCounter_ = 0;
    thd_->Start(numImages,interval_ms);
-   stopOnOverflow_ = stopOnOverflow;
    return DEVICE_OK;
 }
 
@@ -1112,18 +1139,8 @@ int CDemoCamera::InsertImage()
    unsigned int h = GetImageHeight();
    unsigned int b = GetImageBytesPerPixel();
 
-   int ret = GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_, md.Serialize().c_str());
-   if (!stopOnOverflow_ && ret == DEVICE_BUFFER_OVERFLOW)
-   {
-      // do not stop on overflow - just reset the buffer
-      GetCoreCallback()->ClearImageBuffer(this);
-      // don't process this same image again...
-      return GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_, md.Serialize().c_str(), false);
-   }
-   else
-   {
-      return ret;
-   }
+   // Overflow is handled by the Core's buffer overflow policy
+   return GetCoreCallback()->InsertImage(this, pI, w, h, b, nComponents_, md.Serialize().c_str());
 }
 
 /*
@@ -1133,7 +1150,55 @@ int CDemoCamera::InsertImage()
 int CDemoCamera::RunSequenceOnThread()
 {
    int ret=DEVICE_ERR;
+
+   if (triggerAPIAcquisition_)
+   {
+      if (thd_->GetImageCounter() == 0)
+      {
+         if (IsSoftwareTriggered(MM::TriggerSelectorAcquisitionStart))
+         {
+            if (!WaitForSoftwareTrigger(MM::TriggerSelectorAcquisitionStart))
+               return DEVICE_OK; // stopped while waiting
+            OnCameraEvent(MM::CameraEventAcquisitionTrigger);
+         }
+         OnCameraEvent(MM::CameraEventAcquisitionStart);
+      }
+
+      const TriggerState& frameTrigger = triggers_[MM::TriggerSelectorFrameStart];
+      if (IsSoftwareTriggered(MM::TriggerSelectorFrameStart))
+      {
+         if (!WaitForSoftwareTrigger(MM::TriggerSelectorFrameStart))
+            return DEVICE_OK; // stopped while waiting
+         OnCameraEvent(MM::CameraEventFrameTrigger);
+         if (frameTrigger.delayUs > 0.0)
+         {
+            MM::MMTime triggerTime = GetCurrentMMTime();
+            while ((GetCurrentMMTime() - triggerTime).getUsec() < frameTrigger.delayUs)
+            {
+               if (thd_->IsStopped() || acquisitionAborted_)
+                  return DEVICE_OK; // stopped while waiting
+               CDeviceUtils::SleepMs(1);
+            }
+         }
+      }
+      else if (armedFrameRate_ > 0.0)
+      {
+         // Free running at the armed frame rate
+         MM::MMTime frameTime = thd_->GetStartTime() +
+            MM::MMTime::fromMs(thd_->GetImageCounter() * 1000.0 / armedFrameRate_);
+         while (GetCurrentMMTime() < frameTime && !thd_->IsStopped())
+            CDeviceUtils::SleepMs(1);
+      }
+   }
+
+   // Frame events only for acquisitions started through the trigger API;
+   // ordinary sequences (live mode) do not pay for them
    MM::MMTime startTime = GetCurrentMMTime();
+   if (triggerAPIAcquisition_)
+   {
+      OnCameraEvent(MM::CameraEventFrameStart);
+      OnCameraEvent(MM::CameraEventExposureStart);
+   }
    
    // Trigger
    if (triggerDevice_.length() > 0) {
@@ -1154,18 +1219,49 @@ int CDemoCamera::RunSequenceOnThread()
    // Simulate exposure duration
    while ((GetCurrentMMTime() - startTime).getMsec() < exposure)
    {
+      if (acquisitionAborted_)
+         return DEVICE_OK; // drop the frame
       CDeviceUtils::SleepMs(1);
    }
 
+   if (triggerAPIAcquisition_)
+      OnCameraEvent(MM::CameraEventExposureEnd);
+
    ret = InsertImage();
 
    if (ret != DEVICE_OK)
    {
       return ret;
    }
+   if (triggerAPIAcquisition_)
+      OnCameraEvent(MM::CameraEventFrameEnd);
    return ret;
 };
 
+bool CDemoCamera::IsSoftwareTriggered(int triggerSelector) const
+{
+   std::map<int, TriggerState>::const_iterator it = triggers_.find(triggerSelector);
+   return it != triggers_.end() && it->second.mode == MM::TriggerModeOn &&
+      it->second.source == MM::TriggerSourceSoftware;
+}
+
+/*
+ * Blocks (on the sequence thread) until TriggerSoftware() is called for the
+ * given selector. Returns false if the acquisition was stopped meanwhile.
+ */
+bool CDemoCamera::WaitForSoftwareTrigger(int triggerSelector)
+{
+   std::unique_lock<std::mutex> lock(softwareTriggerMutex_);
+   while (pendingSoftwareTriggers_[triggerSelector] == 0)
+   {
+      if (thd_->IsStopped() || acquisitionAborted_)
+         return false;
+      softwareTriggerCv_.wait_for(lock, std::chrono::milliseconds(10));
+   }
+   --pendingSoftwareTriggers_[triggerSelector];
+   return true;
+}
+
 bool CDemoCamera::IsCapturing() {
    return !thd_->IsStopped();
 }
@@ -1177,6 +1273,11 @@ void CDemoCamera::OnThreadExiting() throw()
 {
    try
    {
+      if (triggerAPIAcquisition_)
+      {
+         OnCameraEvent(MM::CameraEventAcquisitionEnd);
+         triggerAPIAcquisition_ = false;
+      }
       LogMessage(g_Msg_SEQUENCE_ACQUISITION_THREAD_EXITING);
       GetCoreCallback()?GetCoreCallback()->AcqFinished(this,0):DEVICE_OK;
    }
@@ -1187,6 +1288,119 @@ void CDemoCamera::OnThreadExiting() throw()
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Trigger API
+// Simulates AcquisitionStart and FrameStart triggers, which can be driven by
+// the internal timer or by TriggerSoftware(). There is no TTL input, so
+// external sources are rejected.
+///////////////////////////////////////////////////////////////////////////////
+
+bool CDemoCamera::HasTrigger(int triggerSelector)
+{
+   return triggers_.find(triggerSelector) != triggers_.end();
+}
+
+int CDemoCamera::SetTriggerState(int triggerSelector, int triggerMode, int triggerSource,
+      double triggerDelayUs, int triggerActivation, int triggerOverlap)
+{
+   std::map<int, TriggerState>::iterator it = triggers_.find(triggerSelector);
+   if (it == triggers_.end())
+      return DEVICE_UNSUPPORTED_COMMAND;
+   if (IsCapturing())
+      return DEVICE_CAMERA_BUSY_ACQUIRING;
+   if (triggerMode != MM::TriggerModeOn && triggerMode != MM::TriggerModeOff)
+      return DEVICE_INVALID_INPUT_PARAM;
+   if (triggerSource != MM::TriggerSourceInternal && triggerSource != MM::TriggerSourceSoftware)
+      return DEVICE_UNSUPPORTED_COMMAND;
+   if (triggerDelayUs < 0.0)
+      return DEVICE_INVALID_INPUT_PARAM;
+
+   it->second.mode = triggerMode;
+   it->second.source = triggerSource;
+   it->second.delayUs = triggerDelayUs;
+   it->second.activation = triggerActivation;
+   it->second.overlap = triggerOverlap;
+   OnCameraTriggerChanged(triggerSelector, triggerMode, triggerSource);
+   return DEVICE_OK;
+}
+
+int CDemoCamera::GetTriggerState(int triggerSelector, int& triggerMode, int& triggerSource,
+      double& triggerDelayUs, int& triggerActivation, int& triggerOverlap)
+{
+   std::map<int, TriggerState>::const_iterator it = triggers_.find(triggerSelector);
+   if (it == triggers_.end())
+      return DEVICE_UNSUPPORTED_COMMAND;
+   triggerMode = it->second.mode;
+   triggerSource = it->second.source;
+   triggerDelayUs = it->second.delayUs;
+   triggerActivation = it->second.activation;
+   triggerOverlap = it->second.overlap;
+   return DEVICE_OK;
+}
+
+int CDemoCamera::TriggerSoftware(int triggerSelector)
+{
+   if (!HasTrigger(triggerSelector))
+      return DEVICE_UNSUPPORTED_COMMAND;
+   if (!IsSoftwareTriggered(triggerSelector))
+      return ERR_TRIGGER_NOT_SOFTWARE;
+   {
+      std::lock_guard<std::mutex> lock(softwareTriggerMutex_);
+      ++pendingSoftwareTriggers_[triggerSelector];
+   }
+   softwareTriggerCv_.notify_all();
+   return DEVICE_OK;
+}
+
+int CDemoCamera::AcquisitionArm(int frameCount, double acquisitionFrameRate, int burstFrameCount)
+{
+   if (IsCapturing())
+      return DEVICE_CAMERA_BUSY_ACQUIRING;
+   // No FrameBurstStart trigger is simulated, so bursts cannot be armed
+   if (frameCount == 0 || frameCount < -1 || acquisitionFrameRate < 0.0 || burstFrameCount != 0)
+      return DEVICE_INVALID_INPUT_PARAM;
+   armedFrameCount_ = frameCount;
+   armedFrameRate_ = acquisitionFrameRate;
+   return DEVICE_OK;
+}
+
+int CDemoCamera::AcquisitionStart()
+{
+   if (IsCapturing())
+      return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+   {
+      std::lock_guard<std::mutex> lock(softwareTriggerMutex_);
+      pendingSoftwareTriggers_.clear();
+   }
+   triggerAPIAcquisition_ = true;
+   long numImages = armedFrameCount_ < 0 ? LONG_MAX : armedFrameCount_;
+   double intervalMs = armedFrameRate_ > 0.0 ? 1000.0 / armedFrameRate_ : 0.0;
+   int ret = StartSequenceAcquisition(numImages, intervalMs, false);
+   if (ret != DEVICE_OK)
+      triggerAPIAcquisition_ = false;
+   return ret;
+}
+
+int CDemoCamera::AcquisitionStop()
+{
+   if (!IsCapturing())
+      return DEVICE_OK;
+   thd_->Stop();
+   softwareTriggerCv_.notify_all();
+   thd_->wait();
+   return DEVICE_OK;
+}
+
+int CDemoCamera::AcquisitionAbort()
+{
+   if (!IsCapturing())
+      return DEVICE_OK;
+   acquisitionAborted_ = true;
+   return AcquisitionStop();
+}
+
+
 MySequenceThread::MySequenceThread(CDemoCamera* pCam)
    :intervalMs_(default_intervalMS)
    ,numImages_(default_numImages)
@@ -3513,15 +3727,28 @@ int CDemoStage::ClearStageSequence()
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   positionSequence_.clear();
    return DEVICE_OK;
 }
 
-int CDemoStage::AddToStageSequence(double /* position */)
+int CDemoStage::AddToStageSequence(double position)
+{
+   return AddArrayToStageSequence(&position, 1);
+}
+
+int CDemoStage::AddArrayToStageSequence(const double* positions, unsigned long count)
 {
    if (!sequenceable_) {
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   long maxLength;
+   GetStageSequenceMaxLength(maxLength);
+   if (positionSequence_.size() + count > (unsigned long)maxLength) {
+      return DEVICE_SEQUENCE_TOO_LARGE;
+   }
+
+   positionSequence_.insert(positionSequence_.end(), positions, positions + count);
    return DEVICE_OK;
 }
 
@@ -4097,6 +4324,12 @@ int DemoDA::AddToDASequence(double voltage)
    return DEVICE_OK;
 }
 
+int DemoDA::AddArrayToDASequence(const double* voltages, unsigned long count)
+{
+   nascentSequence_.insert(nascentSequence_.end(), voltages, voltages + count);
+   return DEVICE_OK;
+}
+
 int DemoDA::OnTrigger(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
@@ -4728,28 +4961,26 @@ int TransposeProcessor::Process(unsigned char *pBuffer, unsigned int width, unsi
    if( width != height)
       return DEVICE_NOT_SUPPORTED; // problem with tranposing non-square images is that the image buffer
    // will need to be modified by the image processor.
-   if(busy_)
+   if(busy_.exchange(true))
       return DEVICE_ERR;
- 
-   busy_ = true;
 
    if( inPlace_)
    {
       if(  sizeof(unsigned char) == byteDepth)
       {
-         TransposeSquareInPlace( (unsigned char*)pBuffer, width);
+         ret = TransposeSquareInPlace( (unsigned char*)pBuffer, width);
       }
       else if( sizeof(unsigned short) == byteDepth)
       {
-         TransposeSquareInPlace( (unsigned short*)pBuffer, width);
+         ret = TransposeSquareInPlace( (unsigned short*)pBuffer, width);
       }
       else if( sizeof(unsigned long) == byteDepth)
       {
-         TransposeSquareInPlace( (unsigned long*)pBuffer, width);
+         ret = TransposeSquareInPlace( (unsigned long*)pBuffer, width);
       }
       else if( sizeof(unsigned long long) == byteDepth)
       {
-         TransposeSquareInPlace( (unsigned long long*)pBuffer, width);
+         ret = TransposeSquareInPlace( (unsigned long long*)pBuffer, width);
       }
       else 
       {
@@ -4814,12 +5045,11 @@ int ImageFlipY::OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eAct
 
 int ImageFlipY::Process(unsigned char *pBuffer, unsigned int width, unsigned int height, unsigned int byteDepth)
 {
-   if(busy_)
+   if(busy_.exchange(true))
       return DEVICE_ERR;
 
    int ret = DEVICE_OK;
  
-   busy_ = true;
    performanceTiming_ = MM::MMTime(0.);
    MM::MMTime  s0 = GetCurrentMMTime();
 
@@ -4885,12 +5115,11 @@ int ImageFlipX::OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eAct
 
 int ImageFlipX::Process(unsigned char *pBuffer, unsigned int width, unsigned int height, unsigned int byteDepth)
 {
-   if(busy_)
+   if(busy_.exchange(true))
       return DEVICE_ERR;
 
    int ret = DEVICE_OK;
  
-   busy_ = true;
    performanceTiming_ = MM::MMTime(0.);
    MM::MMTime  s0 = GetCurrentMMTime();
 
@@ -4951,12 +5180,11 @@ int MedianFilter::OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eA
 
 int MedianFilter::Process(unsigned char *pBuffer, unsigned int width, unsigned int height, unsigned int byteDepth)
 {
-   if(busy_)
+   if(busy_.exchange(true))
       return DEVICE_ERR;
 
    int ret = DEVICE_OK;
  
-   busy_ = true;
    performanceTiming_ = MM::MMTime(0.);
    MM::MMTime  s0 = GetCurrentMMTime();
 
@@ -32,11 +32,16 @@
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
+#include "ImageKernels.h"
 #include <string>
 #include <map>
+#include <vector>
 #include <algorithm>
 #include <stdint.h>
 #include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 //////////////////////////////////////////////////////////////////////////////
 // Error codes
@@ -47,8 +52,9 @@
 #define ERR_SEQUENCE_INACTIVE    105
 #define ERR_STAGE_MOVING         106
 #define HUB_NOT_AVAILABLE        107
+#define ERR_TRIGGER_NOT_SOFTWARE 108
 
-const char* NoHubError = "Parent Hub not defined.";
+const char* const NoHubError = "Parent Hub not defined.";
 
 // Defines which segments in a seven-segment display are lit up for each of
 // the numbers 0-9. Segments are:
@@ -167,10 +173,24 @@ public:
    int StopExposureSequence();
    int ClearExposureSequence();
    int AddToExposureSequence(double exposureTime_ms);
+   int AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count);
    int SendExposureSequence() const;
 
    unsigned  GetNumberOfComponents() const { return nComponents_;};
 
+   // Trigger API
+   bool IsTriggerAPIImplemented() { return true; }
+   bool HasTrigger(int triggerSelector);
+   int SetTriggerState(int triggerSelector, int triggerMode, int triggerSource,
+         double triggerDelayUs, int triggerActivation, int triggerOverlap);
+   int GetTriggerState(int triggerSelector, int& triggerMode, int& triggerSource,
+         double& triggerDelayUs, int& triggerActivation, int& triggerOverlap);
+   int TriggerSoftware(int triggerSelector);
+   int AcquisitionArm(int frameCount, double acquisitionFrameRate, int burstFrameCount);
+   int AcquisitionStart();
+   int AcquisitionStop();
+   int AcquisitionAbort();
+
    // action interface
    // ----------------
    int OnMaxExposure(MM::PropertyBase* pProp, MM::ActionType eAct);
@@ -222,6 +242,17 @@ private:
    void GenerateSyntheticImage(ImgBuffer& img, double exp);
    bool GenerateColorTestPattern(ImgBuffer& img);
    int ResizeImageBuffer();
+   bool WaitForSoftwareTrigger(int triggerSelector);
+   bool IsSoftwareTriggered(int triggerSelector) const;
+
+   struct TriggerState
+   {
+      int mode;
+      int source;
+      double delayUs;
+      int activation;
+      int overlap;
+   };
 
    static const double nominalPixelSizeUm_;
 
@@ -251,8 +282,6 @@ private:
    double ccdT_;
 	std::string triggerDevice_;
 
-   bool stopOnOverflow_;
-
 	bool dropPixels_;
    bool fastImage_;
 	bool saturatePixels_;
@@ -281,6 +310,17 @@ private:
    double pcf_;
    double photonFlux_;
    double readNoise_;
+
+   // Trigger API simulation: AcquisitionStart and FrameStart triggers, with
+   // internal or software source
+   std::map<int, TriggerState> triggers_;
+   int armedFrameCount_;
+   double armedFrameRate_;
+   bool triggerAPIAcquisition_;
+   std::atomic<bool> acquisitionAborted_;
+   std::mutex softwareTriggerMutex_;
+   std::condition_variable softwareTriggerCv_;
+   std::map<int, long> pendingSoftwareTriggers_;
 };
 
 class MySequenceThread : public MMDeviceThreadBase
@@ -509,7 +549,8 @@ public:
    int StartStageSequence();
    int StopStageSequence();
    int ClearStageSequence();
-   int AddToStageSequence(double /* position */);
+   int AddToStageSequence(double position);
+   int AddArrayToStageSequence(const double* positions, unsigned long count);
    int SendStageSequence();
 
 private:
@@ -521,6 +562,7 @@ private:
    double lowerLimit_;
    double upperLimit_;
    bool sequenceable_;
+   std::vector<double> positionSequence_;
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -689,6 +731,7 @@ public:
    int SendDASequence();
    int ClearDASequence();
    int AddToDASequence(double voltage);
+   int AddArrayToDASequence(const double* voltages, unsigned long count);
 
    int OnTrigger(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnVoltage(MM::PropertyBase* pProp, MM::ActionType eAct);
@@ -769,7 +812,8 @@ public:
 
    bool Busy(void) { return busy_;};
 
-    // really primative image transpose algorithm which will work fine for non-square images... 
+   // Cache-blocked transpose through a temporary image; the tile rows are
+   // transposed in parallel
    template <typename PixelType>
    int TransposeRectangleOutOfPlace(PixelType* pI, unsigned int width, unsigned int height)
    {
@@ -788,14 +832,14 @@ public:
       {
          PixelType* pTmpImage = (PixelType *) pTemp_;
          tempSize_ = tsize;
-         for( unsigned long ix = 0; ix < width; ++ix)
-         {
-            for( unsigned long iy = 0; iy < height; ++iy)
-            {
-               pTmpImage[iy + ix*width] = pI[ ix + iy*height];
-            }
-         }
-         memcpy( pI, pTmpImage, tsize);
+         const unsigned tile = ImageKernels::TransposeTileSize<PixelType>();
+         const unsigned tileRows = (height + tile - 1) / tile;
+         ret = ParallelFor(tileRows, 1, [&](unsigned begin, unsigned end) {
+            ImageKernels::TransposeBlocked(pI, pTmpImage, width, height,
+                  begin * tile, (std::min)(end * tile, height));
+         });
+         if (ret == DEVICE_OK)
+            memcpy( pI, pTmpImage, tsize);
       }
       else
       {
@@ -807,20 +851,14 @@ public:
 
    
    template <typename PixelType>
-   void TransposeSquareInPlace(PixelType* pI, unsigned int dim)
+   int TransposeSquareInPlace(PixelType* pI, unsigned int dim)
    { 
-      PixelType tmp;
-      for( unsigned long ix = 0; ix < dim; ++ix)
-      {
-         for( unsigned long iy = ix; iy < dim; ++iy)
-         {
-            tmp = pI[iy*dim + ix];
-            pI[iy*dim +ix] = pI[ix*dim + iy];
-            pI[ix*dim +iy] = tmp; 
-         }
-      }
-
-      return;
+      const unsigned tile = ImageKernels::TransposeTileSize<PixelType>();
+      const unsigned tileRows = (dim + tile - 1) / tile;
+      return ParallelFor(tileRows, 1, [&](unsigned begin, unsigned end) {
+         ImageKernels::TransposeSquareInPlaceBlocked(pI, dim,
+               begin * tile, (std::min)(end * tile, dim));
+      });
    }
 
    int Process(unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth);
@@ -833,7 +871,7 @@ private:
    bool inPlace_;
    void* pTemp_;
    unsigned long tempSize_;
-   bool busy_;
+   std::atomic<bool> busy_;
 };
 
 
@@ -858,18 +896,9 @@ public:
    template <typename PixelType>
    int Flip(PixelType* pI, unsigned int width, unsigned int height)
    {
-      PixelType tmp;
-      int ret = DEVICE_OK;
-      for( unsigned long iy = 0; iy < height; ++iy)
-      {
-         for( unsigned long ix = 0; ix <  (width>>1) ; ++ix)
-         {
-            tmp = pI[ ix + iy*width];
-            pI[ ix + iy*width] = pI[ width - 1 - ix + iy*width];
-            pI[ width -1 - ix + iy*width] = tmp;
-         }
-      }
-      return ret;
+      return ParallelFor(height, 64, [&](unsigned begin, unsigned end) {
+         ImageKernels::FlipRowsX(pI, width, begin, end);
+      });
    }
 
    int Process(unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth);
@@ -877,7 +906,7 @@ public:
    int OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
-   bool busy_;
+   std::atomic<bool> busy_;
    MM::MMTime performanceTiming_;
 };
 
@@ -902,18 +931,9 @@ public:
    template <typename PixelType>
    int Flip(PixelType* pI, unsigned int width, unsigned int height)
    {
-      PixelType tmp;
-      int ret = DEVICE_OK;
-      for( unsigned long ix = 0; ix < width ; ++ix)
-      {
-         for( unsigned long iy = 0; iy < (height>>1); ++iy)
-         {
-            tmp = pI[ ix + iy*width];
-            pI[ ix + iy*width] = pI[ ix + (height - 1 - iy)*width];
-            pI[ ix + (height - 1 - iy)*width] = tmp;
-         }
-      }
-      return ret;
+      return ParallelFor(height >> 1, 32, [&](unsigned begin, unsigned end) {
+         ImageKernels::FlipRowsY(pI, width, height, begin, end);
+      });
    }
 
 
@@ -924,7 +944,7 @@ public:
    int OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
-   bool busy_;
+   std::atomic<bool> busy_;
    MM::MMTime performanceTiming_;
 
 };
@@ -952,19 +972,11 @@ public:
    int Initialize();
    bool Busy(void) { return busy_;};
 
-   // NOTE: this utility MODIFIES the argument, make a copy yourself if you want the original data preserved
-   template <class U> U FindMedian(std::vector<U>& values ) {
-      std::sort(values.begin(), values.end());
-      return values[(values.size())>>1];
-   };
-
 
    template <typename PixelType>
    int Filter(PixelType* pI, unsigned int width, unsigned int height)
    {
       int ret = DEVICE_OK;
-      int x[9];
-      int y[9];
 
       const unsigned long thisSize = sizeof(*pI)*width*height;
       if( thisSize != sizeOfSmoothedIm_)
@@ -986,51 +998,17 @@ public:
 
       if(NULL != pSmooth)
       {
-      /*Apply 3x3 median filter to reduce shot noise*/
-      for (unsigned int i=0; i<width; i++) {
-         for (unsigned int j=0; j<height; j++) {
-            x[0]=i-1;
-            y[0]=(j-1);
-            x[1]=i;
-            y[1]=(j-1);
-            x[2]=i+1;
-            y[2]=(j-1);
-            x[3]=i-1;
-            y[3]=(j);
-            x[4]=i;
-            y[4]=(j);
-            x[5]=i+1;
-            y[5]=(j);
-            x[6]=i-1;
-            y[6]=(j+1);
-            x[7]=i;
-            y[7]=(j+1);
-            x[8]=i+1;
-            y[8]=(j+1);
-            // truncate the median filter window  -- duplicate edge points
-            // this could be more efficient, we could fill in the interior image [1,w0-1]x[1,h0-1] then explicitly fill in the edge pixels.
-            // also the temporary image could be as small as 2 rasters of the image
-            for(int ij =0; ij < 9; ++ij)
-            {
-               if( x[ij] < 0)
-                  x[ij] = 0;
-               else if( int(width-1) < x[ij])
-                  x[ij] = int(width-1);
-               if( y[ij] < 0)
-                  y[ij] = 0;
-               else if( int(height-1) < y[ij])
-                  y[ij] = (int)(height-1);
-            }
-            std::vector<PixelType> windo;
-            for(int ij = 0; ij < 9; ++ij)
-            {
-               windo.push_back(pI[ x[ij] + width*y[ij]]);
-            }
-            pSmooth[i + j*width] = FindMedian(windo);
-         }
-      }
-
-      memcpy( pI, pSmoothedIm_, thisSize);
+         /*Apply 3x3 median filter to reduce shot noise*/
+         // Edge pixels are duplicated to fill the window. Bands of rows are
+         // filtered in parallel, each with its own column buffers.
+         ret = ParallelFor(height, 32, [&](unsigned begin, unsigned end) {
+            std::vector<PixelType> scratch(3 * static_cast<size_t>(width));
+            ImageKernels::Median3x3Rows(pI, pSmooth, width, height,
+                  begin, end, scratch.data());
+         });
+
+         if (ret == DEVICE_OK)
+            memcpy( pI, pSmoothedIm_, thisSize);
       }
       else
          ret = DEVICE_ERR;
@@ -1044,7 +1022,7 @@ public:
    int OnPerformanceTiming(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
-   bool busy_;
+   std::atomic<bool> busy_;
    MM::MMTime performanceTiming_;
    void*  pSmoothedIm_;
    unsigned long sizeOfSmoothedIm_;
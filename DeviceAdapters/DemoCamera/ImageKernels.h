@@ -0,0 +1,316 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageKernels.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Pixel kernels for the demo image processors: cache-blocked
+//                transpose, flips and a 3x3 median filter, written to run
+//                on bands of rows in parallel.
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+// SSE2 is always available on x86-64; the 8- and 16-bit median kernels use
+// it directly
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEKERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ImageKernels {
+
+// Transposes the tile of src (row stride srcStride) with rows [y0, y1) and
+// columns [x0, x1) into dst (row stride dstStride).
+template <typename PixelType>
+void TransposeTile(const PixelType* src, std::size_t srcStride,
+      PixelType* dst, std::size_t dstStride,
+      unsigned x0, unsigned x1, unsigned y0, unsigned y1)
+{
+   for (unsigned y = y0; y < y1; ++y)
+   {
+      const PixelType* s = src + y * srcStride;
+      for (unsigned x = x0; x < x1; ++x)
+         dst[x * dstStride + y] = s[x];
+   }
+}
+
+// Tile edge, in pixels, such that a source and a destination tile fit in L1
+template <typename PixelType>
+unsigned TransposeTileSize()
+{
+   return sizeof(PixelType) <= 2 ? 64 : 32;
+}
+
+// Out-of-place transpose of a width x height image into a height x width
+// image, for the tile rows of the source that start in [rowBegin, rowEnd).
+template <typename PixelType>
+void TransposeBlocked(const PixelType* src, PixelType* dst,
+      unsigned width, unsigned height, unsigned rowBegin, unsigned rowEnd)
+{
+   const unsigned tile = TransposeTileSize<PixelType>();
+   for (unsigned y0 = rowBegin; y0 < rowEnd; y0 += tile)
+   {
+      const unsigned y1 = (std::min)(y0 + tile, height);
+      for (unsigned x0 = 0; x0 < width; x0 += tile)
+      {
+         const unsigned x1 = (std::min)(x0 + tile, width);
+         TransposeTile(src, width, dst, height, x0, x1, y0, y1);
+      }
+   }
+}
+
+// In-place transpose of a dim x dim image, for the tile rows starting in
+// [rowBegin, rowEnd) (multiples of the tile size). Each tile above the
+// diagonal is swapped with its mirror; diagonal tiles are transposed in
+// place.
+template <typename PixelType>
+void TransposeSquareInPlaceBlocked(PixelType* image, unsigned dim,
+      unsigned rowBegin, unsigned rowEnd)
+{
+   const unsigned tile = TransposeTileSize<PixelType>();
+   for (unsigned r0 = rowBegin; r0 < rowEnd; r0 += tile)
+   {
+      const unsigned r1 = (std::min)(r0 + tile, dim);
+      for (unsigned r = r0; r < r1; ++r)
+         for (unsigned c = r + 1; c < r1; ++c)
+            std::swap(image[r * dim + c], image[c * dim + r]);
+
+      for (unsigned c0 = r1; c0 < dim; c0 += tile)
+      {
+         const unsigned c1 = (std::min)(c0 + tile, dim);
+         for (unsigned r = r0; r < r1; ++r)
+            for (unsigned c = c0; c < c1; ++c)
+               std::swap(image[r * dim + c], image[c * dim + r]);
+      }
+   }
+}
+
+template <typename PixelType>
+void FlipRowsX(PixelType* image, unsigned width, unsigned rowBegin, unsigned rowEnd)
+{
+   for (unsigned y = rowBegin; y < rowEnd; ++y)
+   {
+      PixelType* row = image + static_cast<std::size_t>(y) * width;
+      std::reverse(row, row + width);
+   }
+}
+
+// Swaps row pairs (y, height - 1 - y) for y in [rowBegin, rowEnd), which
+// should lie in the top half of the image.
+template <typename PixelType>
+void FlipRowsY(PixelType* image, unsigned width, unsigned height,
+      unsigned rowBegin, unsigned rowEnd)
+{
+   for (unsigned y = rowBegin; y < rowEnd; ++y)
+   {
+      PixelType* top = image + static_cast<std::size_t>(y) * width;
+      PixelType* bottom = image + static_cast<std::size_t>(height - 1 - y) * width;
+      std::swap_ranges(top, top + width, bottom);
+   }
+}
+
+// Branch-free compare-exchange: afterwards a <= b
+template <typename T>
+inline void SortPair(T& a, T& b)
+{
+   const T lo = (std::min)(a, b);
+   b = (std::max)(a, b);
+   a = lo;
+}
+
+template <typename T>
+inline T Median3(T a, T b, T c)
+{
+   return (std::max)((std::min)(a, b), (std::min)((std::max)(a, b), c));
+}
+
+// Sorts each column (above[x], row[x], below[x]) of [begin, end) into
+// lo[x] <= mid[x] <= hi[x] with a 3-element sorting network
+template <typename T>
+void SortColumns(const T* above, const T* row, const T* below,
+      T* lo, T* mid, T* hi, unsigned begin, unsigned end)
+{
+   for (unsigned x = begin; x < end; ++x)
+   {
+      T a = above[x], b = row[x], c = below[x];
+      SortPair(a, b);
+      SortPair(b, c);
+      SortPair(a, b);
+      lo[x] = a;
+      mid[x] = b;
+      hi[x] = c;
+   }
+}
+
+// Median of the 9 values in the sorted columns x - 1, x and x + 1: the
+// median of (largest minimum, median of medians, smallest maximum). For x
+// in [begin, end), which must exclude the edge columns.
+template <typename T>
+void MedianOfSortedColumns(const T* lo, const T* mid, const T* hi, T* out,
+      unsigned begin, unsigned end)
+{
+   for (unsigned x = begin; x < end; ++x)
+   {
+      const T maxLo = (std::max)((std::max)(lo[x - 1], lo[x]), lo[x + 1]);
+      const T medMid = Median3(mid[x - 1], mid[x], mid[x + 1]);
+      const T minHi = (std::min)((std::min)(hi[x - 1], hi[x]), hi[x + 1]);
+      out[x] = Median3(maxLo, medMid, minHi);
+   }
+}
+
+#ifdef IMAGEKERNELS_SSE2
+// SSE2 has unsigned 8-bit min/max; unsigned 16-bit min/max are derived from
+// saturating subtraction.
+struct SimdU8
+{
+   static __m128i Min(__m128i a, __m128i b) { return _mm_min_epu8(a, b); }
+   static __m128i Max(__m128i a, __m128i b) { return _mm_max_epu8(a, b); }
+};
+
+struct SimdU16
+{
+   static __m128i Min(__m128i a, __m128i b) { return _mm_sub_epi16(a, _mm_subs_epu16(a, b)); }
+   static __m128i Max(__m128i a, __m128i b) { return _mm_add_epi16(b, _mm_subs_epu16(a, b)); }
+};
+
+template <typename Ops>
+inline __m128i Median3Simd(__m128i a, __m128i b, __m128i c)
+{
+   return Ops::Max(Ops::Min(a, b), Ops::Min(Ops::Max(a, b), c));
+}
+
+template <typename T, typename Ops>
+void SortColumnsSimd(const T* above, const T* row, const T* below,
+      T* lo, T* mid, T* hi, unsigned begin, unsigned end)
+{
+   const unsigned lanes = 16 / sizeof(T);
+   unsigned x = begin;
+   for (; x + lanes <= end; x += lanes)
+   {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+      __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x));
+      __m128i t = Ops::Min(a, b);
+      b = Ops::Max(a, b);
+      a = t;
+      t = Ops::Min(b, c);
+      c = Ops::Max(b, c);
+      b = t;
+      t = Ops::Min(a, b);
+      b = Ops::Max(a, b);
+      a = t;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(lo + x), a);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(mid + x), b);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(hi + x), c);
+   }
+   SortColumns<T>(above, row, below, lo, mid, hi, x, end);
+}
+
+template <typename T, typename Ops>
+void MedianOfSortedColumnsSimd(const T* lo, const T* mid, const T* hi, T* out,
+      unsigned begin, unsigned end)
+{
+   const unsigned lanes = 16 / sizeof(T);
+   unsigned x = begin;
+   for (; x + lanes <= end; x += lanes)
+   {
+      const __m128i l0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + x - 1));
+      const __m128i l1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + x));
+      const __m128i l2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo + x + 1));
+      const __m128i m0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x - 1));
+      const __m128i m1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x));
+      const __m128i m2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mid + x + 1));
+      const __m128i h0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + x - 1));
+      const __m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + x));
+      const __m128i h2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi + x + 1));
+      const __m128i maxLo = Ops::Max(Ops::Max(l0, l1), l2);
+      const __m128i medMid = Median3Simd<Ops>(m0, m1, m2);
+      const __m128i minHi = Ops::Min(Ops::Min(h0, h1), h2);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+            Median3Simd<Ops>(maxLo, medMid, minHi));
+   }
+   MedianOfSortedColumns<T>(lo, mid, hi, out, x, end);
+}
+
+inline void SortColumns(const unsigned char* above, const unsigned char* row,
+      const unsigned char* below, unsigned char* lo, unsigned char* mid,
+      unsigned char* hi, unsigned begin, unsigned end)
+{
+   SortColumnsSimd<unsigned char, SimdU8>(above, row, below, lo, mid, hi, begin, end);
+}
+
+inline void SortColumns(const unsigned short* above, const unsigned short* row,
+      const unsigned short* below, unsigned short* lo, unsigned short* mid,
+      unsigned short* hi, unsigned begin, unsigned end)
+{
+   SortColumnsSimd<unsigned short, SimdU16>(above, row, below, lo, mid, hi, begin, end);
+}
+
+inline void MedianOfSortedColumns(const unsigned char* lo, const unsigned char* mid,
+      const unsigned char* hi, unsigned char* out, unsigned begin, unsigned end)
+{
+   MedianOfSortedColumnsSimd<unsigned char, SimdU8>(lo, mid, hi, out, begin, end);
+}
+
+inline void MedianOfSortedColumns(const unsigned short* lo, const unsigned short* mid,
+      const unsigned short* hi, unsigned short* out, unsigned begin, unsigned end)
+{
+   MedianOfSortedColumnsSimd<unsigned short, SimdU16>(lo, mid, hi, out, begin, end);
+}
+#endif // IMAGEKERNELS_SSE2
+
+// 3x3 median of rows [rowBegin, rowEnd) of src into dst, with the image
+// edges replicated. Each column of the 3-row window is sorted once and
+// shared by the three windows that contain it. The scratch buffer must hold
+// 3 * width values.
+template <typename PixelType>
+void Median3x3Rows(const PixelType* src, PixelType* dst,
+      unsigned width, unsigned height, unsigned rowBegin, unsigned rowEnd,
+      PixelType* scratch)
+{
+   PixelType* lo = scratch;
+   PixelType* mid = scratch + width;
+   PixelType* hi = scratch + 2 * width;
+
+   for (unsigned y = rowBegin; y < rowEnd; ++y)
+   {
+      const PixelType* above = src + static_cast<std::size_t>(y > 0 ? y - 1 : 0) * width;
+      const PixelType* row = src + static_cast<std::size_t>(y) * width;
+      const PixelType* below = src + static_cast<std::size_t>(y + 1 < height ? y + 1 : y) * width;
+      PixelType* out = dst + static_cast<std::size_t>(y) * width;
+
+      SortColumns(above, row, below, lo, mid, hi, 0, width);
+      if (width > 2)
+         MedianOfSortedColumns(lo, mid, hi, out, 1, width - 1);
+
+      // Edge columns, with the outermost column counted twice
+      const unsigned r0 = width > 1 ? 1 : 0;
+      out[0] = Median3(
+            (std::max)(lo[0], lo[r0]),
+            Median3(mid[0], mid[0], mid[r0]),
+            (std::min)(hi[0], hi[r0]));
+      if (width > 1)
+      {
+         const unsigned e = width - 1;
+         out[e] = Median3(
+               (std::max)(lo[e - 1], lo[e]),
+               Median3(mid[e - 1], mid[e], mid[e]),
+               (std::min)(hi[e - 1], hi[e]));
+      }
+   }
+}
+
+} // namespace ImageKernels
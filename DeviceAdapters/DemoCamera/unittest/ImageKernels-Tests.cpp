@@ -0,0 +1,250 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageKernels-Tests.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Checks the demo image processor kernels against the simple
+//                implementations that they replaced
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include <gtest/gtest.h>
+
+#include "ImageKernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+// Widths around the SIMD block (16 bytes) and transpose tile (32 or 64
+// pixels) sizes, odd and even
+const unsigned sizes[] = { 1, 2, 3, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 130 };
+
+// Full-range values, or few distinct values so that the median sees ties
+template <typename PixelType>
+std::vector<PixelType> RandomImage(unsigned width, unsigned height, bool fewValues)
+{
+   std::mt19937_64 rng(width * 1000 + height);
+   std::vector<PixelType> image(static_cast<std::size_t>(width) * height);
+   for (PixelType& p : image)
+   {
+      const std::uint64_t r = rng();
+      p = fewValues ? static_cast<PixelType>(r % 4) : static_cast<PixelType>(r);
+   }
+   return image;
+}
+
+// The previous implementations, used as references
+
+template <typename PixelType>
+void TransposeReference(const PixelType* src, PixelType* dst,
+      unsigned width, unsigned height)
+{
+   for (unsigned long ix = 0; ix < width; ++ix)
+      for (unsigned long iy = 0; iy < height; ++iy)
+         dst[iy + ix * height] = src[ix + iy * width];
+}
+
+template <typename PixelType>
+void TransposeSquareInPlaceReference(PixelType* pI, unsigned dim)
+{
+   PixelType tmp;
+   for (unsigned long ix = 0; ix < dim; ++ix)
+   {
+      for (unsigned long iy = ix; iy < dim; ++iy)
+      {
+         tmp = pI[iy * dim + ix];
+         pI[iy * dim + ix] = pI[ix * dim + iy];
+         pI[ix * dim + iy] = tmp;
+      }
+   }
+}
+
+template <typename PixelType>
+void FlipXReference(PixelType* pI, unsigned width, unsigned height)
+{
+   PixelType tmp;
+   for (unsigned long iy = 0; iy < height; ++iy)
+   {
+      for (unsigned long ix = 0; ix < (width >> 1); ++ix)
+      {
+         tmp = pI[ix + iy * width];
+         pI[ix + iy * width] = pI[width - 1 - ix + iy * width];
+         pI[width - 1 - ix + iy * width] = tmp;
+      }
+   }
+}
+
+template <typename PixelType>
+void FlipYReference(PixelType* pI, unsigned width, unsigned height)
+{
+   PixelType tmp;
+   for (unsigned long ix = 0; ix < width; ++ix)
+   {
+      for (unsigned long iy = 0; iy < (height >> 1); ++iy)
+      {
+         tmp = pI[ix + iy * width];
+         pI[ix + iy * width] = pI[ix + (height - 1 - iy) * width];
+         pI[ix + (height - 1 - iy) * width] = tmp;
+      }
+   }
+}
+
+template <typename PixelType>
+void MedianReference(const PixelType* pI, PixelType* pSmooth,
+      unsigned width, unsigned height)
+{
+   int x[9];
+   int y[9];
+   for (unsigned int i = 0; i < width; i++)
+   {
+      for (unsigned int j = 0; j < height; j++)
+      {
+         for (int ij = 0; ij < 9; ++ij)
+         {
+            x[ij] = int(i) - 1 + ij % 3;
+            y[ij] = int(j) - 1 + ij / 3;
+            if (x[ij] < 0)
+               x[ij] = 0;
+            else if (int(width - 1) < x[ij])
+               x[ij] = int(width - 1);
+            if (y[ij] < 0)
+               y[ij] = 0;
+            else if (int(height - 1) < y[ij])
+               y[ij] = int(height - 1);
+         }
+         std::vector<PixelType> windo;
+         for (int ij = 0; ij < 9; ++ij)
+            windo.push_back(pI[x[ij] + width * y[ij]]);
+         std::sort(windo.begin(), windo.end());
+         pSmooth[i + j * width] = windo[windo.size() >> 1];
+      }
+   }
+}
+
+// The kernels run on bands of rows, as the processors split the image; the
+// band boundaries are multiples of step
+template <typename F>
+void InBands(unsigned rows, unsigned step, F f)
+{
+   const unsigned band = 3 * step;
+   for (unsigned begin = 0; begin < rows; begin += band)
+      f(begin, (std::min)(begin + band, rows));
+}
+
+template <typename PixelType>
+void CheckTranspose()
+{
+   const unsigned tile = ImageKernels::TransposeTileSize<PixelType>();
+   for (unsigned width : sizes)
+   {
+      for (unsigned height : sizes)
+      {
+         const std::vector<PixelType> src = RandomImage<PixelType>(width, height, false);
+         std::vector<PixelType> expected(src.size()), actual(src.size());
+         TransposeReference(src.data(), expected.data(), width, height);
+         InBands(height, tile, [&](unsigned begin, unsigned end) {
+            ImageKernels::TransposeBlocked(src.data(), actual.data(),
+                  width, height, begin, end);
+         });
+         ASSERT_EQ(expected, actual) << width << " x " << height;
+      }
+
+      std::vector<PixelType> expected = RandomImage<PixelType>(width, width, false);
+      std::vector<PixelType> actual = expected;
+      TransposeSquareInPlaceReference(expected.data(), width);
+      InBands(width, tile, [&](unsigned begin, unsigned end) {
+         ImageKernels::TransposeSquareInPlaceBlocked(actual.data(), width, begin, end);
+      });
+      ASSERT_EQ(expected, actual) << width << " x " << width << " in place";
+   }
+}
+
+template <typename PixelType>
+void CheckFlips()
+{
+   for (unsigned width : sizes)
+   {
+      for (unsigned height : sizes)
+      {
+         std::vector<PixelType> expected = RandomImage<PixelType>(width, height, false);
+         std::vector<PixelType> actual = expected;
+         FlipXReference(expected.data(), width, height);
+         InBands(height, 1, [&](unsigned begin, unsigned end) {
+            ImageKernels::FlipRowsX(actual.data(), width, begin, end);
+         });
+         ASSERT_EQ(expected, actual) << width << " x " << height << " flip X";
+
+         expected = RandomImage<PixelType>(width, height, false);
+         actual = expected;
+         FlipYReference(expected.data(), width, height);
+         InBands(height >> 1, 1, [&](unsigned begin, unsigned end) {
+            ImageKernels::FlipRowsY(actual.data(), width, height, begin, end);
+         });
+         ASSERT_EQ(expected, actual) << width << " x " << height << " flip Y";
+      }
+   }
+}
+
+template <typename PixelType>
+void CheckMedian()
+{
+   for (bool fewValues : { false, true })
+   {
+      for (unsigned width : sizes)
+      {
+         for (unsigned height : sizes)
+         {
+            const std::vector<PixelType> src =
+               RandomImage<PixelType>(width, height, fewValues);
+            std::vector<PixelType> expected(src.size()), actual(src.size());
+            MedianReference(src.data(), expected.data(), width, height);
+            std::vector<PixelType> scratch(3 * static_cast<std::size_t>(width));
+            InBands(height, 1, [&](unsigned begin, unsigned end) {
+               ImageKernels::Median3x3Rows(src.data(), actual.data(),
+                     width, height, begin, end, scratch.data());
+            });
+            ASSERT_EQ(expected, actual) << width << " x " << height <<
+               (fewValues ? " with ties" : "");
+         }
+      }
+   }
+}
+
+} // anonymous namespace
+
+
+TEST(ImageKernelsTest, TransposeMatchesReference8Bit) { CheckTranspose<std::uint8_t>(); }
+TEST(ImageKernelsTest, TransposeMatchesReference16Bit) { CheckTranspose<std::uint16_t>(); }
+TEST(ImageKernelsTest, TransposeMatchesReference32Bit) { CheckTranspose<std::uint32_t>(); }
+TEST(ImageKernelsTest, TransposeMatchesReference64Bit) { CheckTranspose<std::uint64_t>(); }
+
+TEST(ImageKernelsTest, FlipsMatchReference8Bit) { CheckFlips<std::uint8_t>(); }
+TEST(ImageKernelsTest, FlipsMatchReference16Bit) { CheckFlips<std::uint16_t>(); }
+TEST(ImageKernelsTest, FlipsMatchReference32Bit) { CheckFlips<std::uint32_t>(); }
+TEST(ImageKernelsTest, FlipsMatchReference64Bit) { CheckFlips<std::uint64_t>(); }
+
+TEST(ImageKernelsTest, MedianMatchesReference8Bit) { CheckMedian<std::uint8_t>(); }
+TEST(ImageKernelsTest, MedianMatchesReference16Bit) { CheckMedian<std::uint16_t>(); }
+TEST(ImageKernelsTest, MedianMatchesReference32Bit) { CheckMedian<std::uint32_t>(); }
+TEST(ImageKernelsTest, MedianMatchesReference64Bit) { CheckMedian<std::uint64_t>(); }
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
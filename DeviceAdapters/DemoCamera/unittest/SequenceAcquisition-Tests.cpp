@@ -0,0 +1,174 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          SequenceAcquisition-Tests.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Unit tests for the DemoCamera sequence acquisition
+//
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include <gtest/gtest.h>
+
+#include "DemoCamera.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+// Just enough of the Core for a camera to run sequence acquisitions; counts
+// the images inserted
+class FakeCore : public MM::Core
+{
+public:
+   FakeCore() : insertedImages(0) {}
+
+   std::atomic<int> insertedImages;
+
+   int LogMessage(const MM::Device*, const char*, bool) const { return DEVICE_OK; }
+   MM::Device* GetDevice(const MM::Device*, const char*) { return 0; }
+   MM::DeviceHandle GetDeviceHandle(const MM::Device*, const char*) { return 0; }
+   MM::Device* GetDeviceByHandle(const MM::Device*, MM::DeviceHandle) { return 0; }
+   int GetDeviceProperty(const char*, const char*, char*) { return DEVICE_ERR; }
+   int SetDeviceProperty(const char*, const char*, const char*) { return DEVICE_ERR; }
+   void GetLoadedDeviceOfType(const MM::Device*, MM::DeviceType, char* name, const unsigned int) { name[0] = '\0'; }
+
+   int SetSerialProperties(const char*, const char*, const char*, const char*, const char*, const char*, const char*) { return DEVICE_ERR; }
+   int SetSerialCommand(const MM::Device*, const char*, const char*, const char*) { return DEVICE_ERR; }
+   int GetSerialAnswer(const MM::Device*, const char*, unsigned long, char*, const char*) { return DEVICE_ERR; }
+   int WriteToSerial(const MM::Device*, const char*, const unsigned char*, unsigned long) { return DEVICE_ERR; }
+   int ReadFromSerial(const MM::Device*, const char*, unsigned char*, unsigned long, unsigned long&) { return DEVICE_ERR; }
+   int ReadFromSerialWithTimeout(const MM::Device*, const char*, unsigned char*, unsigned long, unsigned long&, long) { return DEVICE_ERR; }
+   int PurgeSerial(const MM::Device*, const char*) { return DEVICE_ERR; }
+   MM::PortType GetSerialPortType(const char*) const { return MM::InvalidPort; }
+
+   int OnPropertiesChanged(const MM::Device*) { return DEVICE_OK; }
+   int OnPropertyChanged(const MM::Device*, const char*, const char*) { return DEVICE_OK; }
+   int OnStagePositionChanged(const MM::Device*, double) { return DEVICE_OK; }
+   int OnXYStagePositionChanged(const MM::Device*, double, double) { return DEVICE_OK; }
+   int OnExposureChanged(const MM::Device*, double) { return DEVICE_OK; }
+   int OnSLMExposureChanged(const MM::Device*, double) { return DEVICE_OK; }
+   int OnMagnifierChanged(const MM::Device*) { return DEVICE_OK; }
+   int OnCameraTriggerChanged(const MM::Device*, int, int, int) { return DEVICE_OK; }
+   int OnCameraEvent(const MM::Device*, int) { return DEVICE_OK; }
+
+   unsigned long GetClockTicksUs(const MM::Device*) { return 0; }
+   MM::MMTime GetCurrentMMTime()
+   {
+      return MM::MMTime::fromUs(std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count());
+   }
+
+   int ParallelFor(const MM::Device*, MM::ParallelWork* work, unsigned long count, unsigned long)
+   {
+      work->Run(0, count);
+      return DEVICE_OK;
+   }
+   unsigned GetWorkerThreadCount(const MM::Device*) { return 1; }
+
+   int AcqFinished(const MM::Device*, int) { return DEVICE_OK; }
+   int PrepareForAcq(const MM::Device*) { return DEVICE_OK; }
+   int InsertImage(const MM::Device*, const ImgBuffer&) { return Inserted(); }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, unsigned, const char*, const bool) { return Inserted(); }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, const Metadata*, const bool) { return Inserted(); }
+   int InsertImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, const char*, const bool) { return Inserted(); }
+   void ClearImageBuffer(const MM::Device*) {}
+   bool InitializeImageBuffer(unsigned, unsigned, unsigned int, unsigned int, unsigned int) { return true; }
+   int InsertMultiChannel(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, unsigned, Metadata*) { return Inserted(); }
+   int InsertProcessedImage(const MM::Device*, const unsigned char*, unsigned, unsigned, unsigned, unsigned, const char*) { return Inserted(); }
+
+   const char* GetImage() { return 0; }
+   int GetImageDimensions(int&, int&, int&) { return DEVICE_ERR; }
+   int GetFocusPosition(double&) { return DEVICE_ERR; }
+   int SetFocusPosition(double) { return DEVICE_ERR; }
+   int MoveFocus(double) { return DEVICE_ERR; }
+   int SetXYPosition(double, double) { return DEVICE_ERR; }
+   int GetXYPosition(double&, double&) { return DEVICE_ERR; }
+   int MoveXYStage(double, double) { return DEVICE_ERR; }
+   int SetExposure(double) { return DEVICE_ERR; }
+   int GetExposure(double&) { return DEVICE_ERR; }
+   int SetConfig(const char*, const char*) { return DEVICE_ERR; }
+   int GetCurrentConfig(const char*, int, char*) { return DEVICE_ERR; }
+   int GetChannelConfig(char*, const unsigned int) { return DEVICE_ERR; }
+
+   MM::ImageProcessor* GetImageProcessor(const MM::Device*) { return 0; }
+   MM::AutoFocus* GetAutoFocus(const MM::Device*) { return 0; }
+   MM::Hub* GetParentHub(const MM::Device*) const { return 0; }
+   MM::State* GetStateDevice(const MM::Device*, const char*) { return 0; }
+   MM::SignalIO* GetSignalIODevice(const MM::Device*, const char*) { return 0; }
+
+   void NextPostedError(int&, char*, int, int&) {}
+   void PostError(const int, const char*) {}
+   void ClearPostedErrors() {}
+
+private:
+   int Inserted()
+   {
+      ++insertedImages;
+      return DEVICE_OK;
+   }
+};
+
+
+class DemoCameraSequenceTest : public ::testing::Test
+{
+protected:
+   FakeCore core_;
+   CDemoCamera camera_;
+
+   virtual void SetUp()
+   {
+      camera_.SetCallback(&core_);
+      ASSERT_EQ(DEVICE_OK, camera_.Initialize());
+      camera_.SetExposure(10.0);
+   }
+
+   virtual void TearDown()
+   {
+      camera_.StopSequenceAcquisition();
+      camera_.Shutdown();
+   }
+
+   void WaitUntilStopped()
+   {
+      while (camera_.IsCapturing())
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+};
+
+
+TEST_F(DemoCameraSequenceTest, SequenceAfterAbortInsertsImages)
+{
+   ASSERT_EQ(DEVICE_OK, camera_.AcquisitionArm(-1, 0.0, 0));
+   ASSERT_EQ(DEVICE_OK, camera_.AcquisitionStart());
+   std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   ASSERT_EQ(DEVICE_OK, camera_.AcquisitionAbort());
+   ASSERT_FALSE(camera_.IsCapturing());
+
+   core_.insertedImages = 0;
+   ASSERT_EQ(DEVICE_OK, camera_.StartSequenceAcquisition(3, 0.0, false));
+   WaitUntilStopped();
+   EXPECT_EQ(3, core_.insertedImages);
+}
+
+TEST_F(DemoCameraSequenceTest, BurstsCannotBeArmed)
+{
+   EXPECT_EQ(DEVICE_INVALID_INPUT_PARAM, camera_.AcquisitionArm(4, 0.0, 2));
+   EXPECT_EQ(DEVICE_OK, camera_.AcquisitionArm(4, 0.0, 0));
+}
+
+
+int main(int argc, char **argv)
+{
+   ::testing::InitGoogleTest(&argc, argv);
+   return RUN_ALL_TESTS();
+}
@@ -40,8 +40,14 @@ FakeCamera::FakeCamera() :
 	byteCount_(1),
 	type_(CV_8UC1),
 	emptyImg(1, 1, type_),
+	cacheSizeMB_(256),
+	prefetchDepth_(2),
+	overrides_(0),
 	exposure_(10)
 {
+	cache_.SetCapacity((size_t)cacheSizeMB_ * 1024 * 1024);
+	cache_.SetDecodeFlags(decodeFlags());
+
 	resetCurImg();
 
 	CreateProperty("Path mask", "", MM::String, false, new CPropertyAction(this, &FakeCamera::OnPath));
@@ -49,6 +55,13 @@ FakeCamera::FakeCamera() :
 
 	CreateProperty("FrameCount", "0", MM::Integer, false, new CPropertyAction(this, &FakeCamera::OnFrameCount));
 
+	CreateProperty("Image cache size (MB)", CDeviceUtils::ConvertToString(cacheSizeMB_), MM::Integer, false, new CPropertyAction(this, &FakeCamera::OnCacheSize));
+	SetPropertyLimits("Image cache size (MB)", 0, 65536);
+	CreateProperty("Prefetch depth", CDeviceUtils::ConvertToString(prefetchDepth_), MM::Integer, false, new CPropertyAction(this, &FakeCamera::OnPrefetchDepth));
+	SetPropertyLimits("Prefetch depth", 0, 16);
+	CreateProperty("Preload (directory or multipage file)", "", MM::String, false, new CPropertyAction(this, &FakeCamera::OnPreload));
+	CreateProperty("Image cache statistics", "", MM::String, true, new CPropertyAction(this, &FakeCamera::OnCacheStatistics));
+
 	CreateProperty(MM::g_Keyword_Name, cameraName, MM::String, true);
 
 	// Description
@@ -80,6 +93,7 @@ FakeCamera::FakeCamera() :
 
 	SetErrorText(ERR_INVALID_DEVICE_NAME, "Specified stage name is invalid");
 	SetErrorText(OUT_OF_RANGE, "Parameters out of range");
+	SetErrorText(ERR_PRELOAD_FAILED, "No readable images found at the preload path");
 
 	InitializeDefaultErrorMessages();
 }
@@ -374,6 +388,10 @@ int FakeCamera::OnPixelType(MM::PropertyBase * pProp, MM::ActionType eAct)
 		emptyImg = cv::Mat::zeros(1, 1, type_);
 		// emptyImg = 0;
 
+		cache_.SetDecodeFlags(decodeFlags());
+		if (!preloadPath_.empty())
+			cache_.Preload(preloadPath_);
+
 		resetCurImg();
 	}
 
@@ -397,6 +415,76 @@ int FakeCamera::OnFrameCount(MM::PropertyBase * pProp, MM::ActionType eAct)
 	return DEVICE_OK;
 }
 
+int FakeCamera::OnCacheSize(MM::PropertyBase * pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(cacheSizeMB_);
+	}
+	else if (eAct == MM::AfterSet)
+	{
+		pProp->Get(cacheSizeMB_);
+		cache_.SetCapacity((size_t)cacheSizeMB_ * 1024 * 1024);
+	}
+
+	return DEVICE_OK;
+}
+
+int FakeCamera::OnPrefetchDepth(MM::PropertyBase * pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(prefetchDepth_);
+	}
+	else if (eAct == MM::AfterSet)
+	{
+		pProp->Get(prefetchDepth_);
+	}
+
+	return DEVICE_OK;
+}
+
+int FakeCamera::OnPreload(MM::PropertyBase * pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(preloadPath_.c_str());
+	}
+	else if (eAct == MM::AfterSet)
+	{
+		std::string path;
+		pProp->Get(path);
+
+		cache_.ClearPreloaded();
+		preloadPath_ = "";
+
+		if (path.empty())
+			return DEVICE_OK;
+
+		size_t count = cache_.Preload(path);
+		if (count == 0)
+		{
+			pProp->Set("");
+			return ERR_PRELOAD_FAILED;
+		}
+
+		preloadPath_ = path;
+		LogMessage("Preloaded " + std::string(CDeviceUtils::ConvertToString((long)count)) + " images from '" + path + "'");
+	}
+
+	return DEVICE_OK;
+}
+
+int FakeCamera::OnCacheStatistics(MM::PropertyBase * pProp, MM::ActionType eAct)
+{
+	if (eAct == MM::BeforeGet)
+	{
+		pProp->Set(cache_.GetStatistics().c_str());
+	}
+
+	return DEVICE_OK;
+}
+
 std::string FakeCamera::parseUntil(const char*& it, const char delim) const throw (parse_error)
 {
 	std::ostringstream ret;
@@ -458,16 +546,19 @@ std::string FakeCamera::parsePlaceholder(const char*& it) const
 		if (name == "?")
 		{
 			double val;
-			if (GetCoreCallback()->GetFocusPosition(val) != 0)
+			if (!overriddenValue("?", val) && GetCoreCallback()->GetFocusPosition(val) != 0)
 				val = 0;
 
-			printNum(res, precSpec, val);
+			printNum(res, precSpec, trackValue("?", val));
 			return res.str();
 		}
 		
 		if (name == "$frame")
 		{
-			int val = frameCount_;
+			double frame;
+			if (!overriddenValue("$frame", frame))
+				frame = frameCount_;
+			int val = (int)trackValue("$frame", frame);
 
 			if (metadata.size() > 0)
 			{
@@ -535,9 +626,13 @@ std::string FakeCamera::parsePlaceholder(const char*& it) const
 		{
 			double x, y;
 
-			if (dev->GetType() == MM::XYStageDevice ? ((MM::XYStage*)dev)->GetPositionUm(x, y) : ((MM::Galvo*)dev)->GetPosition(x, y))
+			if (!(overriddenValue(name + "$x", x) && overriddenValue(name + "$y", y)) &&
+				(dev->GetType() == MM::XYStageDevice ? ((MM::XYStage*)dev)->GetPositionUm(x, y) : ((MM::Galvo*)dev)->GetPosition(x, y)))
 				x = y = 0;
 
+			x = trackValue(name + "$x", x);
+			y = trackValue(name + "$y", y);
+
 			if (metadata == "$x")
 				printNum(res, precSpec, x);
 			else if (metadata == "$y")
@@ -552,10 +647,10 @@ std::string FakeCamera::parsePlaceholder(const char*& it) const
 		case MM::StageDevice:
 		{
 			double pos;
-			if (((MM::Stage*)dev)->GetPositionUm(pos) != 0)
+			if (!overriddenValue(name, pos) && ((MM::Stage*)dev)->GetPositionUm(pos) != 0)
 				pos = 0;
 
-			printNum(res, precSpec, pos);
+			printNum(res, precSpec, trackValue(name, pos));
 		}
 		break;
 		case MM::SignalIODevice:
@@ -645,9 +740,88 @@ std::string FakeCamera::iif(bool test, std::string spec)
 std::string FakeCamera::parseMask(std::string mask) const throw(error_code)
 {
 	const char* it = mask.data();
+	parsedValues_.clear();
 	return parseUntil(it, '\0');
 }
 
+bool FakeCamera::overriddenValue(const std::string& key, double& val) const
+{
+	if (overrides_ == 0)
+		return false;
+
+	std::map<std::string, double>::const_iterator it = overrides_->find(key);
+	if (it == overrides_->end())
+		return false;
+
+	val = it->second;
+	return true;
+}
+
+double FakeCamera::trackValue(const std::string& key, double val) const
+{
+	parsedValues_[key] = val;
+	return val;
+}
+
+//predicts the next images by moving each position placeholder one or more
+//steps along its last observed increment (frame numbers always step by one),
+//and queues them for decoding in the background
+void FakeCamera::prefetchNeighbours(const std::string& path) const
+{
+	std::map<std::string, double> values = parsedValues_;
+	std::set<std::string> moved;
+
+	for (std::map<std::string, double>::const_iterator it = values.begin(); it != values.end(); ++it)
+	{
+		std::map<std::string, double>::const_iterator last = lastValues_.find(it->first);
+		if (last != lastValues_.end() && last->second != it->second)
+		{
+			steps_[it->first] = it->second - last->second;
+			moved.insert(it->first);
+		}
+	}
+	steps_["$frame"] = 1;
+	lastValues_ = values;
+
+	if (prefetchDepth_ <= 0)
+		return;
+
+	// Placeholders that moved on this frame are the most likely to move again
+	std::vector<std::string> likely, others;
+	std::map<std::string, double> probe = values;
+	overrides_ = &probe;
+
+	for (std::map<std::string, double>::const_iterator it = values.begin(); it != values.end(); ++it)
+	{
+		std::map<std::string, double>::const_iterator step = steps_.find(it->first);
+		if (step == steps_.end())
+			continue;
+
+		std::vector<std::string>& candidates = moved.count(it->first) > 0 ? likely : others;
+
+		// forward along the scan, then one step back for serpentine scans
+		for (long k = 1; k <= prefetchDepth_ + 1; ++k)
+		{
+			probe[it->first] = it->second + (k <= prefetchDepth_ ? k : -1) * step->second;
+			try
+			{
+				std::string candidate = parseMask(path_);
+				if (candidate != path)
+					candidates.push_back(candidate);
+			}
+			catch (...)
+			{
+			}
+		}
+		probe[it->first] = it->second;
+	}
+
+	overrides_ = 0;
+
+	likely.insert(likely.end(), others.begin(), others.end());
+	cache_.Prefetch(likely);
+}
+
 void FakeCamera::getImg() const
 {
 	std::string path = parseMask(path_);
@@ -655,7 +829,9 @@ void FakeCamera::getImg() const
 	if (path == curPath_)
 		return;
 
-	cv::Mat img = path == lastFailedPath_ ? lastFailedImg_ : cv::imread(path, cv::IMREAD_ANYDEPTH | (color_ ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE));
+	prefetchNeighbours(path);
+
+	cv::Mat img = path == lastFailedPath_ ? lastFailedImg_ : cache_.Load(path);
 
 	if (img.data == NULL)
 	{
@@ -747,6 +923,11 @@ void FakeCamera::initSize(bool loadImg) const
 	}
 }
 
+int FakeCamera::decodeFlags() const
+{
+	return cv::IMREAD_ANYDEPTH | (color_ ? cv::IMREAD_COLOR : cv::IMREAD_GRAYSCALE);
+}
+
 void FakeCamera::resetCurImg()
 {
 	initSize_ = false;
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <map>
+#include <set>
 #include <string>
 
 #include "DeviceBase.h"
@@ -38,8 +40,10 @@
 #define ERR_INVALID_DEVICE_NAME 10000
 #define OUT_OF_RANGE 10001
 #define CONTROLLER_ERROR 10002
+#define ERR_PRELOAD_FAILED 10003
 
 #include "error_code.h"
+#include "ImageCache.h"
 
 extern const char* cameraName;
 extern const char* label_CV_8U;
@@ -86,6 +90,10 @@ public:
 	int ResolvePath(MM::PropertyBase* pProp, MM::ActionType eAct);
 	int OnPixelType(MM::PropertyBase* pProp, MM::ActionType eAct);
 	int OnFrameCount(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnCacheSize(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnPrefetchDepth(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnPreload(MM::PropertyBase* pProp, MM::ActionType eAct);
+	int OnCacheStatistics(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 	std::string parseUntil(const char*& it, const char delim) const throw (parse_error);
 	std::string parsePlaceholder(const char*& it) const;
@@ -94,6 +102,7 @@ public:
 	static std::string iif(bool test, std::string spec);
 	std::string parseMask(std::string mask) const throw(error_code);
 	void getImg() const;
+	void prefetchNeighbours(const std::string& path) const;
 	void updateROI() const;
 
 	void initSize(bool loadImg = true) const;
@@ -127,6 +136,21 @@ private:
 	mutable std::string lastFailedPath_;
 
 	void resetCurImg();
+	int decodeFlags() const;
+
+	bool overriddenValue(const std::string& key, double& val) const;
+	double trackValue(const std::string& key, double val) const;
+
+	// Decoded images; prefetch predicts the next paths by stepping each
+	// position placeholder by its last observed increment
+	mutable ImageCache cache_;
+	long cacheSizeMB_;
+	long prefetchDepth_;
+	std::string preloadPath_;
+	mutable std::map<std::string, double> parsedValues_;
+	mutable std::map<std::string, double> lastValues_;
+	mutable std::map<std::string, double> steps_;
+	mutable const std::map<std::string, double>* overrides_;
 
 	double exposure_;
 };
@@ -0,0 +1,322 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageCache.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Bounded LRU cache of decoded images for the FakeCamera,
+//                with background prefetching and optional preloading
+//
+// LICENSE:       Licensed under the Apache License, Version 2.0 (the "License");
+//                you may not use this file except in compliance with the License.
+//                You may obtain a copy of the License at
+//
+//                http://www.apache.org/licenses/LICENSE-2.0
+//
+//                Unless required by applicable law or agreed to in writing, software
+//                distributed under the License is distributed on an "AS IS" BASIS,
+//                WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//                See the License for the specific language governing permissions and
+//                limitations under the License.
+
+#include "ImageCache.h"
+
+#include <cstdlib>
+#include <sstream>
+
+ImageCache::ImageCache() :
+	flags_(cv::IMREAD_ANYDEPTH | cv::IMREAD_GRAYSCALE),
+	generation_(0),
+	capacity_(0),
+	bytes_(0),
+	pinnedBytes_(0),
+	hits_(0),
+	misses_(0),
+	prefetched_(0),
+	stop_(false)
+{
+	thread_ = std::thread(&ImageCache::PrefetchLoop, this);
+}
+
+ImageCache::~ImageCache()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+		queue_.clear();
+	}
+	queueCv_.notify_all();
+	thread_.join();
+}
+
+void ImageCache::SetDecodeFlags(int flags)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (flags == flags_)
+		return;
+
+	flags_ = flags;
+	++generation_;
+	queue_.clear();
+	entries_.clear();
+	lru_.clear();
+	bytes_ = pinnedBytes_ = 0;
+}
+
+void ImageCache::SetCapacity(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = bytes;
+	if (capacity_ == 0)
+		queue_.clear();
+	EvictToCapacity();
+}
+
+cv::Mat ImageCache::Load(const std::string& path)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	while (inFlight_.count(path) > 0)
+		decodeDoneCv_.wait(lock);
+
+	std::map<std::string, Entry>::iterator it = entries_.find(path);
+	if (it != entries_.end())
+	{
+		++hits_;
+		if (!it->second.pinned)
+			lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+		return it->second.img;
+	}
+
+	++misses_;
+	return DecodeAndInsert(lock, path);
+}
+
+void ImageCache::Prefetch(const std::vector<std::string>& paths)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.clear();
+		if (capacity_ == 0)
+			return;
+
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			if (entries_.count(paths[i]) == 0 && inFlight_.count(paths[i]) == 0)
+				queue_.push_back(paths[i]);
+		}
+	}
+	queueCv_.notify_one();
+}
+
+size_t ImageCache::Preload(const std::string& path)
+{
+	int flags;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		flags = flags_;
+	}
+
+	std::vector<cv::String> files;
+	cv::glob(path, files, false);
+
+	Pages pages;
+	if (files.size() == 1 && files[0] == path)
+	{
+		// A single (possibly multipage) file
+		Decode(path + "#0", flags, pages);
+	}
+	else
+	{
+		for (size_t i = 0; i < files.size(); ++i)
+		{
+			cv::Mat img = cv::imread(files[i], flags);
+			if (img.data != NULL)
+				pages.push_back(std::make_pair(std::string(files[i]), img));
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (flags != flags_)
+		return 0;
+
+	for (size_t i = 0; i < pages.size(); ++i)
+		Insert(pages[i].first, pages[i].second, true);
+
+	return pages.size();
+}
+
+void ImageCache::ClearPreloaded()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (std::map<std::string, Entry>::iterator it = entries_.begin(); it != entries_.end(); )
+	{
+		if (it->second.pinned)
+			Erase(it++);
+		else
+			++it;
+	}
+}
+
+void ImageCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	++generation_;
+	queue_.clear();
+	lru_.clear();
+	for (std::map<std::string, Entry>::iterator it = entries_.begin(); it != entries_.end(); )
+	{
+		if (!it->second.pinned)
+			entries_.erase(it++);
+		else
+			++it;
+	}
+	bytes_ = 0;
+}
+
+std::string ImageCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::ostringstream os;
+	os << "hits=" << hits_ << " misses=" << misses_ << " prefetched=" << prefetched_ <<
+		" images=" << entries_.size() <<
+		" cachedMB=" << bytes_ / (1024 * 1024) <<
+		" preloadedMB=" << pinnedBytes_ / (1024 * 1024);
+	return os.str();
+}
+
+void ImageCache::Decode(const std::string& path, int flags, Pages& pages)
+{
+	size_t hashPos = path.find_last_of('#');
+	if (hashPos != std::string::npos && hashPos + 1 < path.size() &&
+		path.find_first_not_of("0123456789", hashPos + 1) == std::string::npos)
+	{
+		std::string file = path.substr(0, hashPos);
+#if CV_MAJOR_VERSION >= 3
+		std::vector<cv::Mat> mats;
+		if (cv::imreadmulti(file, mats, flags))
+		{
+			for (size_t i = 0; i < mats.size(); ++i)
+			{
+				std::ostringstream page;
+				page << file << '#' << i;
+				pages.push_back(std::make_pair(page.str(), mats[i]));
+			}
+			return;
+		}
+#else
+		// No multipage support; treat "#0" as the first (only) page
+		if (atoi(path.substr(hashPos + 1).c_str()) == 0)
+		{
+			cv::Mat img = cv::imread(file, flags);
+			if (img.data != NULL)
+			{
+				pages.push_back(std::make_pair(path, img));
+				return;
+			}
+		}
+#endif
+	}
+
+	cv::Mat img = cv::imread(path, flags);
+	if (img.data != NULL)
+		pages.push_back(std::make_pair(path, img));
+}
+
+size_t ImageCache::ByteSize(const cv::Mat& img)
+{
+	return img.total() * img.elemSize();
+}
+
+void ImageCache::Insert(const std::string& path, const cv::Mat& img, bool pinned)
+{
+	std::map<std::string, Entry>::iterator it = entries_.find(path);
+	if (it != entries_.end())
+	{
+		if (it->second.pinned || !pinned)
+			return;
+		Erase(it);
+	}
+
+	if (!pinned && ByteSize(img) > capacity_)
+		return;
+
+	Entry& entry = entries_[path];
+	entry.img = img;
+	entry.pinned = pinned;
+	if (pinned)
+	{
+		pinnedBytes_ += ByteSize(img);
+	}
+	else
+	{
+		entry.lruPos = lru_.insert(lru_.begin(), path);
+		bytes_ += ByteSize(img);
+		EvictToCapacity();
+	}
+}
+
+void ImageCache::Erase(std::map<std::string, Entry>::iterator it)
+{
+	if (it->second.pinned)
+	{
+		pinnedBytes_ -= ByteSize(it->second.img);
+	}
+	else
+	{
+		bytes_ -= ByteSize(it->second.img);
+		lru_.erase(it->second.lruPos);
+	}
+	entries_.erase(it);
+}
+
+void ImageCache::EvictToCapacity()
+{
+	while (bytes_ > capacity_ && !lru_.empty())
+		Erase(entries_.find(lru_.back()));
+}
+
+// Called with the lock held and path not in flight; the lock is released
+// while decoding.
+cv::Mat ImageCache::DecodeAndInsert(std::unique_lock<std::mutex>& lock, const std::string& path)
+{
+	int flags = flags_;
+	unsigned generation = generation_;
+	inFlight_.insert(path);
+	lock.unlock();
+
+	Pages pages;
+	Decode(path, flags, pages);
+
+	lock.lock();
+	inFlight_.erase(path);
+	decodeDoneCv_.notify_all();
+
+	cv::Mat result;
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		if (pages[i].first == path)
+			result = pages[i].second;
+		if (generation == generation_)
+			Insert(pages[i].first, pages[i].second, false);
+	}
+	return result;
+}
+
+void ImageCache::PrefetchLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;)
+	{
+		queueCv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+		if (stop_)
+			return;
+
+		std::string path = queue_.front();
+		queue_.pop_front();
+		if (entries_.count(path) > 0 || inFlight_.count(path) > 0)
+			continue;
+
+		if (!DecodeAndInsert(lock, path).empty())
+			++prefetched_;
+	}
+}
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          ImageCache.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     DeviceAdapters
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Bounded LRU cache of decoded images for the FakeCamera,
+//                with background prefetching and optional preloading
+//
+// LICENSE:       Licensed under the Apache License, Version 2.0 (the "License");
+//                you may not use this file except in compliance with the License.
+//                You may obtain a copy of the License at
+//
+//                http://www.apache.org/licenses/LICENSE-2.0
+//
+//                Unless required by applicable law or agreed to in writing, software
+//                distributed under the License is distributed on an "AS IS" BASIS,
+//                WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//                See the License for the specific language governing permissions and
+//                limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <opencv/cv.hpp>
+#else
+#include "opencv/highgui.h"
+#endif
+
+// Paths of the form "<file>#<n>" refer to page n of a multipage file.
+// Decoding one page of a multipage file decodes (and caches) all of its pages.
+class ImageCache
+{
+public:
+	ImageCache();
+	~ImageCache();
+
+	// Flags passed to cv::imread; changing them drops all cached images
+	void SetDecodeFlags(int flags);
+	void SetCapacity(size_t bytes);
+
+	// Returns the decoded image, from the cache if possible. Blocks while the
+	// same path is being decoded by the prefetch thread. Returns an empty
+	// cv::Mat if the file cannot be read.
+	cv::Mat Load(const std::string& path);
+
+	// Replaces the prefetch queue; paths are decoded in order in the background
+	void Prefetch(const std::vector<std::string>& paths);
+
+	// Decodes all pages of a multipage file, or all readable images in a
+	// directory, and pins them in memory until ClearPreloaded() is called.
+	// Returns the number of images loaded.
+	size_t Preload(const std::string& path);
+	void ClearPreloaded();
+
+	// Drops all unpinned images
+	void Clear();
+
+	std::string GetStatistics() const;
+
+private:
+	struct Entry
+	{
+		cv::Mat img;
+		bool pinned;
+		std::list<std::string>::iterator lruPos;
+	};
+
+	typedef std::vector<std::pair<std::string, cv::Mat> > Pages;
+
+	static void Decode(const std::string& path, int flags, Pages& pages);
+	static size_t ByteSize(const cv::Mat& img);
+
+	void Insert(const std::string& path, const cv::Mat& img, bool pinned);
+	void Erase(std::map<std::string, Entry>::iterator it);
+	void EvictToCapacity();
+	cv::Mat DecodeAndInsert(std::unique_lock<std::mutex>& lock, const std::string& path);
+	void PrefetchLoop();
+
+	mutable std::mutex mutex_;
+	std::condition_variable decodeDoneCv_;
+	std::condition_variable queueCv_;
+
+	std::map<std::string, Entry> entries_;
+	std::list<std::string> lru_; // unpinned entries, most recently used first
+	std::set<std::string> inFlight_;
+	std::deque<std::string> queue_;
+
+	int flags_;
+	unsigned generation_;
+	size_t capacity_;
+	size_t bytes_;
+	size_t pinnedBytes_;
+
+	unsigned long hits_;
+	unsigned long misses_;
+	unsigned long prefetched_;
+
+	bool stop_;
+	std::thread thread_;
+};
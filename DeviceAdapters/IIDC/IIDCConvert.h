@@ -18,36 +18,42 @@
 
 #pragma once
 
-#include <dc1394/dc1394.h>
-#ifdef _MSC_VER
-#undef restrict
-#endif
+#include "IIDCCamera.h"
+
+#include "PixelConvert.h"
+
+#include <cstddef>
+#include <cstdint>
 
 
 namespace IIDC {
 
+// Convert color formats to Micro-Manager's 32-bit RGB layout (B, G, R, 0).
+// Uses the same YUV arithmetic as dc1394_convert_to_RGB8(), but converts
+// straight to 32 bits using SIMD where available.
 inline void
-ConvertToRGB8(uint8_t* dst, const uint8_t* src, size_t width, size_t height,
+ConvertToRGB32(uint8_t* dst, const uint8_t* src, size_t width, size_t height,
       PixelFormat format)
 {
-   dc1394color_coding_t coding;
+   PixelConvert::SourceFormat srcFormat;
    switch (format)
    {
       case PixelFormatYUV444:
-         coding = DC1394_COLOR_CODING_YUV444;
+         srcFormat = PixelConvert::YUV444_UYV;
          break;
       case PixelFormatYUV422:
-         coding = DC1394_COLOR_CODING_YUV422;
+         srcFormat = PixelConvert::YUV422_UYVY;
          break;
       case PixelFormatYUV411:
-         coding = DC1394_COLOR_CODING_YUV411;
+         srcFormat = PixelConvert::YUV411_UYYVYY;
+         break;
+      case PixelFormatRGB8:
+         srcFormat = PixelConvert::RGB24;
          break;
       default:
          return;
    }
-   dc1394_convert_to_RGB8(const_cast<uint8_t*>(src), dst,
-         static_cast<uint32_t>(width), static_cast<uint32_t>(height),
-         DC1394_BYTE_ORDER_UYVY, coding, 8);
+   PixelConvert::ToBGRA32(dst, src, width * height, srcFormat);
 }
 
 } // namespace IIDC
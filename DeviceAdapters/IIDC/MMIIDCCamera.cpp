@@ -280,21 +280,6 @@ inline void RightShift16(uint16_t* dst, const uint16_t* src,
       dst[i] >>= shift;
 }
 
-
-/*
- * Convert to Micro-Manager's idiosyncratic RGB format
- */
-inline void BGR24ToRGB32(uint8_t* dst, const uint8_t* src, size_t count)
-{
-   for (size_t i = 0; i < count; ++i)
-   {
-      dst[4 * i + 0] = src[3 * i + 2];
-      dst[4 * i + 1] = src[3 * i + 1];
-      dst[4 * i + 2] = src[3 * i + 0];
-      dst[4 * i + 3] = 0;
-   }
-}
-
 } // anonymous namespace
 
 
@@ -1813,7 +1798,6 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
 
    size_t destBytesPerPixel;
    bool isRGB = false;
-   bool doConvertColor = false;
 
    switch (sourceFormat)
    {
@@ -1832,7 +1816,6 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
       case IIDC::PixelFormatYUV411:
          destBytesPerPixel = 4;
          isRGB = true;
-         doConvertColor = true;
          break;
 
       case IIDC::PixelFormatRGB8:
@@ -1850,9 +1833,8 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
    // Scoped array objects to manage memory for intermediate buffers. Not all
    // may be used depending on the code path. Any that are used persist until
    // the result callback returns.
-   boost::scoped_array<uint8_t> bufferConvertedToRGB;
-   boost::scoped_array<uint8_t> bufferAppliedSoftROI;
    boost::scoped_array<uint8_t> bufferConvertedTo32Bit;
+   boost::scoped_array<uint8_t> bufferAppliedSoftROI;
    boost::scoped_array<uint8_t> bufferByteSwapped;
    boost::scoped_array<uint8_t> bufferRightShifted;
 
@@ -1865,31 +1847,17 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
    uint8_t* destination = 0;
 
    /*
-    * Stage: Convert color (e.g. YUV) to RGB24
+    * Stage: Convert color (YUV or RGB24) to RGB32
     */
 
-   if (doConvertColor)
-   {
-      // Always place result in allocated buffer, since further processing
-      // (conversion to 32-bit format) is needed
-      uint8_t* dest = new uint8_t[sourceWidth * sourceHeight * 3];
-      bufferConvertedToRGB.reset(dest);
-      IIDC::ConvertToRGB8(dest, pixels,
-            sourceWidth, sourceHeight, sourceFormat);
-      pixels = dest;
-   }
+   bool doApplySoftROI = (destWidth != sourceWidth || destHeight != sourceHeight);
 
-   /*
-    * Stage: Apply soft ROI
-    */
-
-   if (destWidth != sourceWidth || destHeight != sourceHeight)
+   if (isRGB)
    {
-      size_t bpp = (isRGB ? 3 : destBytesPerPixel);
-      uint8_t* dest = new uint8_t[destWidth * destHeight * bpp];
-      // If grayscale, all following stages can be performed in-place, so we
-      // can write to the final result buffer
-      if (needOwnedCopy && !isRGB)
+      uint8_t* dest = new uint8_t[sourceWidth * sourceHeight * 4];
+      // All following stages can be performed in-place, so unless we need to
+      // crop we can write to the final result buffer
+      if (needOwnedCopy && !doApplySoftROI)
       {
          assert (destination == 0);
          destination = dest;
@@ -1897,24 +1865,24 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
       }
       else
       {
-         bufferAppliedSoftROI.reset(dest);
+         bufferConvertedTo32Bit.reset(dest);
       }
 
-      ApplySoftROI(dest, pixels, bpp,
-            sourceWidth, sourceHeight,
-            destLeft, destTop, destWidth, destHeight);
+      // libdc1394 sample order is R, G, B; Micro-Manager wants B, G, R, 0
+      IIDC::ConvertToRGB32(dest, pixels,
+            sourceWidth, sourceHeight, sourceFormat);
       pixels = dest;
    }
 
    /*
-    * Stage: Convert RGB24 to RGB32
+    * Stage: Apply soft ROI
     */
 
-   if (isRGB)
+   if (doApplySoftROI)
    {
-      uint8_t* dest = new uint8_t[destWidth * destHeight * 4];;
-      // All following stages can be performed in-place, so we can write to the
-      // final result buffer
+      uint8_t* dest = new uint8_t[destWidth * destHeight * destBytesPerPixel];
+      // All following stages can be performed in-place, so we can write to
+      // the final result buffer
       if (needOwnedCopy)
       {
          assert (destination == 0);
@@ -1923,13 +1891,12 @@ MMIIDCCamera::ProcessImage(const void* source, bool ownResultBuffer,
       }
       else
       {
-         bufferConvertedTo32Bit.reset(dest);
+         bufferAppliedSoftROI.reset(dest);
       }
 
-      // We seem to get BGR images out of libdc1394 (seen with iSight YUV
-      // formats on OS X; AVT YUV or RGB formats on OS X and Windows), so
-      // handle BGR-to-RGB at the same time.
-      BGR24ToRGB32(dest, pixels, destWidth * destHeight);
+      ApplySoftROI(dest, pixels, destBytesPerPixel,
+            sourceWidth, sourceHeight,
+            destLeft, destTop, destWidth, destHeight);
       pixels = dest;
    }
 
@@ -28,6 +28,15 @@
 #include "ModuleInterface.h"
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+
+namespace {
+const char* g_ModeSynchronous = "Synchronous";
+const char* g_ModePipelined = "Pipelined";
+const char* g_ModeParallel = "Parallel";
+const long g_MaxQueueDepth = 256;
+const long g_MaxWorkerThreads = 64;
+}
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -61,6 +70,36 @@ MODULE_API void DeleteDevice(MM::Device* pDevice)
 }
 
 
+ImageProcessorChain::ImageProcessorChain() :
+   nSlots_(10),
+   busy_(false),
+   mode_(Synchronous),
+   queueDepth_(16),
+   workerThreads_(2),
+   timings_(nSlots_),
+   accepting_(false),
+   stopping_(false),
+   inFlight_(0),
+   commitError_(DEVICE_OK),
+   nextSerial_(0),
+   nextCommit_(0)
+{
+   long cores = static_cast<long>(std::thread::hardware_concurrency());
+   if (cores > 0)
+      workerThreads_ = (std::min)(cores, g_MaxWorkerThreads);
+}
+
+ImageProcessorChain::~ImageProcessorChain()
+{
+   StopWorkers();
+}
+
+int ImageProcessorChain::Shutdown()
+{
+   StopWorkers();
+   return DEVICE_OK;
+}
+
 int ImageProcessorChain::Initialize()
 {
 
@@ -95,8 +134,30 @@ int ImageProcessorChain::Initialize()
       for (std::vector<std::string>::iterator iap = availableProcessors.begin();  iap != availableProcessors.end(); ++iap)
          AddAllowedValue(processorSlotName.str().c_str(), iap->c_str());
 
+      std::ostringstream timeName;
+      timeName << "ProcessorSlot" << ip << "-MeanTimeMs";
+      pAct = new CPropertyActionEx (this, &ImageProcessorChain::OnSlotTime, ip);
+      (void)CreateProperty(timeName.str().c_str(), "0", MM::Float, true, pAct);
    }
 
+   CPropertyAction* pActMode = new CPropertyAction (this, &ImageProcessorChain::OnMode);
+   CreateProperty("ProcessingMode", g_ModeSynchronous, MM::String, false, pActMode);
+   AddAllowedValue("ProcessingMode", g_ModeSynchronous);
+   AddAllowedValue("ProcessingMode", g_ModePipelined);
+   AddAllowedValue("ProcessingMode", g_ModeParallel);
+
+   std::ostringstream depth;
+   depth << queueDepth_;
+   pActMode = new CPropertyAction (this, &ImageProcessorChain::OnQueueDepth);
+   CreateProperty("QueueDepth", depth.str().c_str(), MM::Integer, false, pActMode);
+   SetPropertyLimits("QueueDepth", 1, g_MaxQueueDepth);
+
+   std::ostringstream threads;
+   threads << workerThreads_;
+   pActMode = new CPropertyAction (this, &ImageProcessorChain::OnWorkerThreads);
+   CreateProperty("WorkerThreads", threads.str().c_str(), MM::Integer, false, pActMode);
+   SetPropertyLimits("WorkerThreads", 1, g_MaxWorkerThreads);
+
    return DEVICE_OK;
 }
 
@@ -115,6 +176,10 @@ int ImageProcessorChain::OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAc
    {
       std::string name;
       pProp->Get(name);
+
+      // Processors must not change under the worker threads
+      StopWorkers();
+
       processorNames_[indexx] = name;
 
       for( int islot = 0; islot < this->nSlots_; ++islot)
@@ -129,44 +194,394 @@ int ImageProcessorChain::OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAc
                      processors_[islot] = (MM::ImageProcessor*) pDevice;
             }
       }
-      
+
+      {
+         std::lock_guard<std::mutex> lock(timingMutex_);
+         timings_[indexx] = SlotTiming();
+      }
+
+      if (mode_ != Synchronous)
+         StartWorkers();
+   }
+
+   return DEVICE_OK;
+}
+
+int ImageProcessorChain::OnSlotTime(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      std::lock_guard<std::mutex> lock(timingMutex_);
+      const SlotTiming& timing = timings_[indexx];
+      pProp->Set(timing.count > 0 ? timing.totalMs / timing.count : 0.0);
+   }
+   return DEVICE_OK;
+}
+
+int ImageProcessorChain::OnMode(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      switch (mode_)
+      {
+         case Synchronous: pProp->Set(g_ModeSynchronous); break;
+         case Pipelined: pProp->Set(g_ModePipelined); break;
+         case Parallel: pProp->Set(g_ModeParallel); break;
+      }
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string mode;
+      pProp->Get(mode);
+      StopWorkers();
+      if (mode == g_ModePipelined)
+         mode_ = Pipelined;
+      else if (mode == g_ModeParallel)
+         mode_ = Parallel;
+      else
+         mode_ = Synchronous;
+      if (mode_ != Synchronous)
+         StartWorkers();
+   }
+   return DEVICE_OK;
+}
+
+int ImageProcessorChain::OnQueueDepth(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(queueDepth_);
    }
+   else if (eAct == MM::AfterSet)
+   {
+      long depth;
+      pProp->Get(depth);
+      StopWorkers();
+      queueDepth_ = depth;
+      if (mode_ != Synchronous)
+         StartWorkers();
+   }
+   return DEVICE_OK;
+}
 
+int ImageProcessorChain::OnWorkerThreads(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(workerThreads_);
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      long threads;
+      pProp->Get(threads);
+      StopWorkers();
+      workerThreads_ = threads;
+      if (mode_ != Synchronous)
+         StartWorkers();
+   }
    return DEVICE_OK;
 }
 
 
+int ImageProcessorChain::RunSlot(int slot, unsigned char* pBuffer,
+      unsigned width, unsigned height, unsigned byteDepth)
+{
+   std::map< int, MM::ImageProcessor*>::const_iterator it = processors_.find(slot);
+   if (processors_.end() == it || NULL == it->second)
+      return DEVICE_OK;
+
+   MM::ImageProcessor* pP = it->second;
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   int ret;
+   try
+   {
+      ret = pP->Process(pBuffer, width, height, byteDepth);
+   }
+   catch(...)
+   {
+      ret = DEVICE_ERR;
+   }
+   double elapsedMs = std::chrono::duration<double, std::milli>(
+         std::chrono::steady_clock::now() - start).count();
+
+   if (ret != DEVICE_OK)
+   {
+      std::ostringstream m;
+      char name[MM::MaxStrLength];
+      pP->GetName(name);
+      m << "Error in processor " << name << " (error " << ret << ")";
+      LogMessage(m.str().c_str(), false);
+   }
+
+   std::lock_guard<std::mutex> lock(timingMutex_);
+   timings_[slot].totalMs += elapsedMs;
+   ++timings_[slot].count;
+   return ret;
+}
+
+
 int ImageProcessorChain::Process(unsigned char *pBuffer, unsigned int width, unsigned int height, unsigned int byteDepth)
 {
    int ret = DEVICE_OK;
    busy_ = true;
 
+   for( int islot = 0; islot < this->nSlots_; ++islot)
+   {
+      int slotRet = RunSlot(islot, pBuffer, width, height, byteDepth);
+      if (ret == DEVICE_OK)
+         ret = slotRet;
+   }
+
+   busy_ = false;
+
+   return ret;
+}
+
+
+bool ImageProcessorChain::IsProcessingAsynchronous()
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   return accepting_;
+}
+
+
+int ImageProcessorChain::ProcessAsync(const unsigned char* buffer, unsigned width,
+      unsigned height, unsigned byteDepth, unsigned nComponents,
+      const char* serializedMetadata)
+{
+   const size_t bytes = static_cast<size_t>(width) * height * byteDepth;
+
+   Frame* frame = NULL;
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (commitError_ != DEVICE_OK)
+      {
+         // As if this image had failed, so that stop-on-overflow works
+         int ret = commitError_;
+         commitError_ = DEVICE_OK;
+         return ret;
+      }
+      cond_.wait(lock, [&]{ return inFlight_ < queueDepth_ || !accepting_; });
+      if (accepting_)
+      {
+         ++inFlight_;
+         if (freeFrames_.empty())
+         {
+            framePool_.emplace_back(new Frame());
+            frame = framePool_.back().get();
+         }
+         else
+         {
+            frame = freeFrames_.back();
+            freeFrames_.pop_back();
+         }
+         frame->serial = nextSerial_++;
+      }
+   }
+
+   if (NULL == frame)
+   {
+      // Mode was changed after the Core checked; process on this thread
+      std::vector<unsigned char> copy(buffer, buffer + bytes);
+      int ret = Process(copy.data(), width, height, byteDepth);
+      if (ret != DEVICE_OK)
+         return ret;
+      return GetCoreCallback()->InsertProcessedImage(this, copy.data(), width,
+            height, byteDepth, nComponents, serializedMetadata);
+   }
+
+   frame->pixels.assign(buffer, buffer + bytes);
+   frame->width = width;
+   frame->height = height;
+   frame->byteDepth = byteDepth;
+   frame->nComponents = nComponents;
+   frame->metadata = serializedMetadata ? serializedMetadata : "";
+   frame->error = DEVICE_OK;
+
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (stageQueues_.empty())
+      finished_[frame->serial] = frame;
+   else
+      stageQueues_[0].push_back(frame);
+   cond_.notify_all();
+   return DEVICE_OK;
+}
 
+
+int ImageProcessorChain::FinishAsyncProcessing()
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   cond_.wait(lock, [&]{ return inFlight_ == 0; });
+   int ret = commitError_;
+   commitError_ = DEVICE_OK;
+   return ret;
+}
+
+
+void ImageProcessorChain::StartWorkers()
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   stageSlots_.clear();
    for( int islot = 0; islot < this->nSlots_; ++islot)
    {
-      if( processors_.end() != processors_.find(islot))
+      std::map< int, MM::ImageProcessor*>::const_iterator it = processors_.find(islot);
+      if (processors_.end() != it && NULL != it->second)
+         stageSlots_.push_back(islot);
+   }
+
+   stageQueues_.clear();
+   if (!stageSlots_.empty())
+      stageQueues_.resize(mode_ == Pipelined ? stageSlots_.size() : 1);
+
+   stopping_ = false;
+   nextSerial_ = 0;
+   nextCommit_ = 0;
+   commitError_ = DEVICE_OK;
+   accepting_ = true;
+
+   if (mode_ == Pipelined)
+   {
+      for (size_t stage = 0; stage < stageQueues_.size(); ++stage)
+         workers_.push_back(std::thread(&ImageProcessorChain::StageWorker, this, stage));
+   }
+   else if (!stageQueues_.empty())
+   {
+      for (long i = 0; i < workerThreads_; ++i)
+         workers_.push_back(std::thread(&ImageProcessorChain::ParallelWorker, this));
+   }
+   committer_ = std::thread(&ImageProcessorChain::CommitWorker, this);
+}
+
+
+void ImageProcessorChain::StopWorkers()
+{
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (!committer_.joinable())
+         return;
+      // Let the images in flight reach the Core before stopping
+      accepting_ = false;
+      cond_.notify_all();
+      cond_.wait(lock, [&]{ return inFlight_ == 0; });
+      stopping_ = true;
+      cond_.notify_all();
+   }
+
+   for (size_t i = 0; i < workers_.size(); ++i)
+      workers_[i].join();
+   workers_.clear();
+   committer_.join();
+}
+
+
+void ImageProcessorChain::StageWorker(size_t stage)
+{
+   const int slot = stageSlots_[stage];
+   for (;;)
+   {
+      Frame* frame;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         cond_.wait(lock, [&]{ return !stageQueues_[stage].empty() || stopping_; });
+         if (stageQueues_[stage].empty())
+            return;
+         frame = stageQueues_[stage].front();
+         stageQueues_[stage].pop_front();
+      }
+
+      // Later stages skip an image that an earlier one failed on
+      if (frame->error == DEVICE_OK)
+         frame->error = RunSlot(slot, frame->pixels.data(), frame->width,
+               frame->height, frame->byteDepth);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stage + 1 < stageQueues_.size())
+         stageQueues_[stage + 1].push_back(frame);
+      else
+         finished_[frame->serial] = frame;
+      cond_.notify_all();
+   }
+}
+
+
+void ImageProcessorChain::ParallelWorker()
+{
+   for (;;)
+   {
+      Frame* frame;
       {
+         std::unique_lock<std::mutex> lock(mutex_);
+         cond_.wait(lock, [&]{ return !stageQueues_[0].empty() || stopping_; });
+         if (stageQueues_[0].empty())
+            return;
+         frame = stageQueues_[0].front();
+         stageQueues_[0].pop_front();
+      }
+
+      for (size_t i = 0; i < stageSlots_.size() && frame->error == DEVICE_OK; ++i)
+         frame->error = RunSlot(stageSlots_[i], frame->pixels.data(),
+               frame->width, frame->height, frame->byteDepth);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_[frame->serial] = frame;
+      cond_.notify_all();
+   }
+}
 
-         MM::ImageProcessor* pP = processors_[islot];
-         if( NULL != pP)
+
+void ImageProcessorChain::CommitWorker()
+{
+   for (;;)
+   {
+      Frame* frame;
+      {
+         std::unique_lock<std::mutex> lock(mutex_);
+         cond_.wait(lock, [&]{ return finished_.count(nextCommit_) > 0 || stopping_; });
+         std::map<unsigned long long, Frame*>::iterator it = finished_.find(nextCommit_);
+         if (finished_.end() == it)
+            return;
+         frame = it->second;
+         finished_.erase(it);
+         ++nextCommit_;
+      }
+
+      // An image that a processor failed on is dropped, not committed as if
+      // it had been processed
+      int ret = frame->error;
+      if (ret != DEVICE_OK)
+      {
+         std::ostringstream m;
+         m << "Dropped image " << frame->serial << ", which failed processing (error " << ret << ")";
+         LogMessage(m.str().c_str(), false);
+      }
+      else
+      {
+         ret = GetCoreCallback()->InsertProcessedImage(this, frame->pixels.data(),
+               frame->width, frame->height, frame->byteDepth, frame->nComponents,
+               frame->metadata.c_str());
+         if (ret != DEVICE_OK)
          {
-            try
-            {
-               pP->Process(pBuffer, width, height,byteDepth);
-            }
-            catch(...)
-            {
-               std::ostringstream m;
-               char name[MM::MaxStrLength];
-               pP->GetName(name);
-               m << "Error in processor " << name;
-               LogMessage(m.str().c_str(), false);
-            }
+            std::ostringstream m;
+            m << "Failed to insert processed image " << frame->serial << " (error " << ret << ")";
+            LogMessage(m.str().c_str(), false);
          }
       }
+      if (ret != DEVICE_OK)
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         if (commitError_ == DEVICE_OK)
+            commitError_ = ret;
+      }
+
+      FinishFrame(frame);
    }
+}
 
-   busy_ = false;
 
-   return ret;
+void ImageProcessorChain::FinishFrame(Frame* frame)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   freeFrames_.push_back(frame);
+   --inFlight_;
+   cond_.notify_all();
 }
@@ -29,22 +29,42 @@
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
 #include "DeviceThreads.h"
-#include <string>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 
 
 //////////////////////////////////////////////////////////////////////////////
 // ImageProcessorChain class
 // run chain of image processors
+//
+// In Synchronous mode, the processors run in turn on the camera's thread, as
+// the image is inserted. The other modes take a copy of each image and
+// return immediately; the image is committed to the Core's buffer, in order,
+// once processing is done:
+// - Pipelined: one thread per occupied slot, so that successive images are
+//   processed by different slots at the same time.
+// - Parallel: a pool of threads each running the whole chain on a different
+//   image. The processors must then tolerate concurrent Process() calls.
+// At most QueueDepth images are in flight; further images block the camera
+// thread until one is committed. An image that a processor fails on is not
+// committed. That error, or an error committing an image, is returned to
+// the camera by its next ProcessAsync() call (which drops that image), or
+// from FinishAsyncProcessing() at the end of the acquisition.
 //////////////////////////////////////////////////////////////////////////////
 class ImageProcessorChain : public CImageProcessorBase<ImageProcessorChain>
 {
 public:
-   ImageProcessorChain () : nSlots_(10), busy_(false) {}
-   ~ImageProcessorChain () { }
+   ImageProcessorChain ();
+   ~ImageProcessorChain ();
 
-   int Shutdown() {return DEVICE_OK;}
+   int Shutdown();
    void GetName(char* name) const {strcpy(name,"ImageProcessorChain");}
 
    int Initialize();
@@ -52,17 +72,79 @@ public:
    bool Busy(void) { return busy_;};
 
    int Process(unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth);
+   bool IsProcessingAsynchronous();
+   int ProcessAsync(const unsigned char* buffer, unsigned width, unsigned height,
+         unsigned byteDepth, unsigned nComponents, const char* serializedMetadata);
+   int FinishAsyncProcessing();
 
    // action interface
    // ----------------
    int OnProcessor(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx);
+   int OnSlotTime(MM::PropertyBase* pProp, MM::ActionType eAct, long indexx);
+   int OnMode(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnQueueDepth(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnWorkerThreads(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
+   enum Mode { Synchronous, Pipelined, Parallel };
+
+   struct Frame
+   {
+      std::vector<unsigned char> pixels;
+      unsigned width;
+      unsigned height;
+      unsigned byteDepth;
+      unsigned nComponents;
+      std::string metadata;
+      unsigned long long serial;
+      int error; // First processor error, if any
+   };
+
+   struct SlotTiming
+   {
+      SlotTiming() : totalMs(0.0), count(0) {}
+      double totalMs;
+      unsigned long count;
+   };
+
+   int RunSlot(int slot, unsigned char* buffer, unsigned width,
+         unsigned height, unsigned byteDepth);
+   void StartWorkers();
+   void StopWorkers();
+   void StageWorker(size_t stage);
+   void ParallelWorker();
+   void CommitWorker();
+   void FinishFrame(Frame* frame);
+
    const int nSlots_;
    bool busy_;
    std::map< int, std::string> processorNames_;
    std::map< int, MM::ImageProcessor*> processors_;
 
+   Mode mode_;
+   long queueDepth_;
+   long workerThreads_;
+
+   std::mutex timingMutex_;
+   std::vector<SlotTiming> timings_;
+
+   // Asynchronous processing state, guarded by mutex_
+   std::mutex mutex_;
+   std::condition_variable cond_;
+   bool accepting_;
+   bool stopping_;
+   std::vector<int> stageSlots_; // Occupied slots, in order (Pipelined)
+   std::vector<std::deque<Frame*> > stageQueues_;
+   std::map<unsigned long long, Frame*> finished_;
+   std::vector<std::unique_ptr<Frame> > framePool_;
+   std::vector<Frame*> freeFrames_;
+   long inFlight_;
+   int commitError_; // First processing or commit error not yet returned
+   unsigned long long nextSerial_;
+   unsigned long long nextCommit_;
+   std::vector<std::thread> workers_;
+   std::thread committer_;
+
    ImageProcessorChain& operator=( const ImageProcessorChain& ){ 
       return *this;
    };
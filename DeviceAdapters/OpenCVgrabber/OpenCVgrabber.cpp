@@ -26,6 +26,7 @@
 //
 
 #include "OpenCVgrabber.h"
+#include <chrono>
 #include <cstdio>
 #include <string>
 #include <math.h>
@@ -39,11 +40,25 @@
 using namespace cv;
 using namespace std;
 
-CvCapture* capture_;
-IplImage* frame_; // do not modify, do not release!
-
 const double COpenCVgrabber::nominalPixelSizeUm_ = 1.0;
 
+// OpenCV 2.4 names the capture properties in its C API only
+#if CV_MAJOR_VERSION >= 3
+const int g_CapPropFrameWidth = cv::CAP_PROP_FRAME_WIDTH;
+const int g_CapPropFrameHeight = cv::CAP_PROP_FRAME_HEIGHT;
+const int g_CapPropExposure = cv::CAP_PROP_EXPOSURE;
+const int g_CapPropGain = cv::CAP_PROP_GAIN;
+#else
+const int g_CapPropFrameWidth = CV_CAP_PROP_FRAME_WIDTH;
+const int g_CapPropFrameHeight = CV_CAP_PROP_FRAME_HEIGHT;
+const int g_CapPropExposure = CV_CAP_PROP_EXPOSURE;
+const int g_CapPropGain = CV_CAP_PROP_GAIN;
+#endif
+
+// Frames retrieved for a sequence but not yet converted; when conversion
+// falls further behind, frames are skipped at the source
+const size_t g_MaxQueuedFrames = 4;
+
 
 // External names used used by the rest of the system
 // to load particular device from the "DemoCamera.dll" library
@@ -139,6 +154,14 @@ MODULE_API void DeleteDevice(MM::Device* pDevice)
 */
 COpenCVgrabber::COpenCVgrabber() :
    CCameraBase<COpenCVgrabber> (),
+   stopThreads_(false),
+   snapState_(SnapIdle),
+   snapRequest_(0),
+   sequenceActive_(false),
+   sequenceFinishing_(false),
+   sequenceToRetrieve_(0),
+   sequenceInFlight_(0),
+   sequenceDropped_(0),
    cameraID_(0),
    initialized_(false),
    readoutUs_(0.0),
@@ -153,8 +176,7 @@ COpenCVgrabber::COpenCVgrabber() :
    nComponents_(4),
    xFlip_(false),
    yFlip_(false),
-   triggerDevice_(""),
-   stopOnOverFlow_(false)
+   triggerDevice_("")
 {
    // call the base class method to set-up default error codes/messages
    InitializeDefaultErrorMessages();
@@ -188,9 +210,6 @@ COpenCVgrabber::COpenCVgrabber() :
    AddAllowedValue(cIDNameReally.c_str(), "2");
    AddAllowedValue(cIDNameReally.c_str(), "3");
 #endif
-
-   readoutStartTime_ = GetCurrentMMTime();
-   thd_ = new MySequenceThread(this);
 }
 
 /**
@@ -202,11 +221,7 @@ COpenCVgrabber::COpenCVgrabber() :
 */
 COpenCVgrabber::~COpenCVgrabber()
 {
-   if(capture_)
-   {
-	   cvReleaseCapture(&capture_);
-	}
-   delete thd_;
+   Shutdown();
 }
 
 /**
@@ -239,26 +254,25 @@ int COpenCVgrabber::Initialize()
 
    // start opencv capture_ from first device, 
    // we need to initialise hardware early on to discover properties
-   capture_ = cvCaptureFromCAM(cameraID_);
-
-   if (!capture_) // do we have a capture_ device?
+   if (!capture_.open(cameraID_)) // do we have a capture_ device?
    {
      return DEVICE_NOT_CONNECTED;
    }
    // ignore first frame to make it work with more cameras
-   cvQueryFrame(capture_);
-   frame_ = cvQueryFrame(capture_);
-   if (!frame_)
+   cv::Mat frame;
+   capture_.grab();
+   if (!capture_.read(frame) || frame.empty())
    {
+      capture_.release();
       return FAILED_TO_GET_IMAGE;
    }
 
 #ifdef __APPLE__
-   long w = frame_->width;
-   long h = frame_->height;
+   long w = frame.cols;
+   long h = frame.rows;
 #else
-   long w = (long) cvGetCaptureProperty(capture_, CV_CAP_PROP_FRAME_WIDTH);
-   long h = (long) cvGetCaptureProperty(capture_, CV_CAP_PROP_FRAME_HEIGHT);
+   long w = (long) capture_.get(g_CapPropFrameWidth);
+   long h = (long) capture_.get(g_CapPropFrameHeight);
 #endif
 
 
@@ -371,8 +385,11 @@ int COpenCVgrabber::Initialize()
    if (nRet != DEVICE_OK)
       return nRet;
 
-   // exposure
-   nRet = CreateProperty(MM::g_Keyword_Exposure,  "10"/*CDeviceUtils::ConvertToString(GetExposure())*/, MM::Float, false);
+   // exposure, from the driver if it reports one
+   double exposure = capture_.get(g_CapPropExposure);
+   if (exposure < 1)
+      exposure = 10;
+   nRet = CreateProperty(MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(exposure), MM::Float, false);
    assert(nRet == DEVICE_OK);
    SetPropertyLimits(MM::g_Keyword_Exposure, 0, 10000);
 
@@ -416,6 +433,8 @@ int COpenCVgrabber::Initialize()
 
    // initialize image buffer
    GenerateEmptyImage(img_);
+
+   StartCaptureThreads();
    return DEVICE_OK;
 
 
@@ -431,9 +450,9 @@ int COpenCVgrabber::Initialize()
 */
 int COpenCVgrabber::Shutdown()
 {
-	if(capture_){
-	   cvReleaseCapture(&capture_);
-	}
+   StopSequenceAcquisition();
+   StopCaptureThreads();
+   capture_.release();
 
    initialized_ = false;
    return DEVICE_OK;
@@ -450,33 +469,22 @@ int COpenCVgrabber::SnapImage()
    if (!initialized_)
       return CAMERA_NOT_INITIALIZED;
 
-   MM::MMTime startTime = GetCurrentMMTime();
-   double exp = GetExposure();
-   double expUs = exp * 1000.0;
-
-   cvGrabFrame(capture_);
-   
-   MM::MMTime s0(0,0);
-   MM::MMTime t2 = GetCurrentMMTime();
-   if( s0 < startTime )
-   {
-      // ensure wait time is non-negative
-      long naptime = (long)(0.5 + expUs - (double)(t2-startTime).getUsec());
-      if( naptime < 1)
-         naptime = 1;
-      // longest possible nap is about 38 minutes
-      CDeviceUtils::NapMicros((unsigned long) naptime);
-   }
-   else
-   {
-      std::cerr << "You are operating this device adapter without setting the core callback, timing functions aren't yet available" << std::endl;
-      // called without the core callback probably in off line test program
-      // need way to build the core in the test program
-
-   }   
-   readoutStartTime_ = GetCurrentMMTime();
-
-   return DEVICE_OK;
+   std::unique_lock<std::mutex> lock(mutex_);
+   snapFormat_ = CurrentFormat();
+   snapState_ = SnapRequested;
+   const unsigned long request = ++snapRequest_;
+   captureCond_.notify_all();
+
+   // The capture thread serves the request with the first frame it grabs
+   // after this point, so waiting for it covers the exposure
+   const std::chrono::milliseconds timeout((long) GetExposure() + 5000);
+   const bool served = stateCond_.wait_for(lock, timeout, [&] {
+      return snapRequest_ != request || snapState_ == SnapDone || snapState_ == SnapFailed;
+   });
+   const bool ok = served && snapRequest_ == request && snapState_ == SnapDone;
+   if (snapRequest_ == request)
+      snapState_ = SnapIdle;
+   return ok ? DEVICE_OK : FAILED_TO_GET_IMAGE;
 }
 
 
@@ -495,93 +503,55 @@ const unsigned char* COpenCVgrabber::GetImageBuffer()
    if (!initialized_)
       return NULL;
 
-   IplImage* temp; // used during conversion
+   // Converted by the convert thread before SnapImage() returned
    MMThreadGuard g(imgPixelsLock_);
-   MM::MMTime readoutTime(readoutUs_);
-   while (readoutTime > (GetCurrentMMTime() - readoutStartTime_))
-   {
-      CDeviceUtils::SleepMs(1);
-   }
+   return img_.GetPixels();
+}
 
-   cvRetrieveFrame(capture_); // throw away old image
-   temp = cvRetrieveFrame(capture_);
-   if(!temp) return 0;
-   //Mat temp_mat (temp);
+/**
+* Copies the ROI of a camera frame into dst as 8-bit gray or BGRA,
+* flipped as requested. The ROI is taken from the flipped frame, as it is
+* displayed. Returns false if the frame is not as large as the format needs.
+*/
+static bool ConvertFrame(const cv::Mat& frame, unsigned width, unsigned height,
+      unsigned bytesPerPixel, unsigned roiX, unsigned roiY, bool flipX, bool flipY,
+      unsigned char* dst, cv::Mat& scratch)
+{
+   if (frame.depth() != CV_8U || (bytesPerPixel != 1 && bytesPerPixel != 4) ||
+         roiX + width > (unsigned) frame.cols || roiY + height > (unsigned) frame.rows)
+      return false;
 
-   if(xFlip_ == true){ 
-      cvFlip(temp,NULL,1);
-   }
-   if(yFlip_ == true){
-      cvFlip(temp,NULL,0);
-   }
+   const int x = flipX ? frame.cols - roiX - width : roiX;
+   const int y = flipY ? frame.rows - roiY - height : roiY;
+   const cv::Mat src = frame(cv::Rect(x, y, width, height));
 
-   char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_PixelType, buf);
-   std::string pixelType(buf);
+   // Wraps dst, so that the conversion writes the image in place
+   cv::Mat out(height, width, bytesPerPixel == 4 ? CV_8UC4 : CV_8UC1, dst);
+   cv::Mat& converted = (flipX || flipY) ? scratch : out;
 
-   if (pixelType.compare(g_PixelType_32bitRGB) == 0)
+   int code = -1;
+   switch (frame.channels())
    {
-      /*
-      Mat rgba( img_.Width(), img_.Height(),CV_8UC4, Scalar(255,128,0,0) );
-      Mat rgb(img_.Width(), img_.Height(),CV_8UC3, Scalar(0,0,0));
-      Mat alpha(  img_.Width(), img_.Height(),CV_8UC1 ,Scalar(0));
-
-
-      int from_to[] = {0,0,  1,1,  2,2, 3,3};
-
-      Mat in[] = {rgb,alpha};
-
-      mixChannels( in, 2, &rgba, 1, from_to, 4);
-
-      IplImage ipl_img = rgba;
-      memcpy(img_.GetPixelsRW(),ipl_img.imageData,img_.Width() * img_.Height() * 4);
-      */
-
-      if(roiX_ == 0 && roiY_ == 0){
-         RGB3toRGB4(temp->imageData, (char *) img_.GetPixelsRW(), temp->width, temp->height);
-      } else {
-         cvSetImageROI(temp,cvRect(roiX_,roiY_,img_.Width(),img_.Height()));
-         IplImage *ROI = cvCreateImage(cvSize(img_.Width(),img_.Height()),
-            temp->depth,
-            temp->nChannels);
-
-
-         if(!ROI) return 0; //failed to create ROI image
-         cvCopy(temp,ROI,NULL);
-         cvResetImageROI(temp);
-         RGB3toRGB4(temp->imageData, (char *) img_.GetPixelsRW(), ROI->width, ROI->height);		
-         //cvCvtColor(&ROI,(CvArr *) temp->imageData,CV_RGB2RGBA);// possible alternative to the padding loop - if I can get it not to break!
-         cvReleaseImage(&ROI);
-      }
-
-   } else {
-      unsigned int srcOffset = 0;
-      for(int i=0; i < temp->width * temp->height; i++){
-         memcpy(img_.GetPixelsRW()+i, temp->imageData+srcOffset,1);
-         srcOffset += 3;
-      } 
+      case 1:
+         code = bytesPerPixel == 4 ? cv::COLOR_GRAY2BGRA : -1;
+         break;
+      case 3:
+         code = bytesPerPixel == 4 ? cv::COLOR_BGR2BGRA : cv::COLOR_BGR2GRAY;
+         break;
+      case 4:
+         code = bytesPerPixel == 4 ? -1 : cv::COLOR_BGRA2GRAY;
+         break;
+      default:
+         return false;
    }
+   if (code < 0)
+      src.copyTo(converted);
+   else
+      cv::cvtColor(src, converted, code);
 
-
-
-   unsigned char *pB = (unsigned char*)(img_.GetPixels());
-   return pB;
-}
-
-/**
-* Converts three-byte image to four bytes
-*/
-void COpenCVgrabber::RGB3toRGB4(const char* srcPixels, char* destPixels, int width, int height)
-{
-   // nasty padding loop
-   unsigned int srcOffset = 0;
-   unsigned int dstOffset = 0;
-   int totalSize = width * height;
-   for(int i=0; i < totalSize; i++){
-      memcpy(destPixels+dstOffset, srcPixels+srcOffset,3);
-      srcOffset += 3;
-      dstOffset += 4;
-   }
+   if (flipX || flipY)
+      cv::flip(converted, out, flipX && flipY ? -1 : (flipX ? 1 : 0));
+   return true;
 }
 
 
@@ -659,6 +629,7 @@ int COpenCVgrabber::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySiz
    else
    {
       // apply ROI
+      MMThreadGuard g(imgPixelsLock_);
       img_.Resize(xSize, ySize);
       roiX_ = x;
       roiY_ = y;
@@ -702,11 +673,8 @@ int COpenCVgrabber::ClearROI()
 */
 double COpenCVgrabber::GetExposure() const
 {
-	double exp = cvGetCaptureProperty(capture_,CV_CAP_PROP_EXPOSURE); // try to get the exposure from OpenCV - not all drivers allow this
-	if(exp >= 1)
-      return exp; // if it works, great, return it, otherwise...
-
-
+   // Initialized from the driver if it reports an exposure; not read back
+   // from it here, to keep the driver out of every snap
    char buf[MM::MaxStrLength];
    int ret = GetProperty(MM::g_Keyword_Exposure, buf);
    if (ret != DEVICE_OK)
@@ -722,7 +690,8 @@ double COpenCVgrabber::GetExposure() const
 void COpenCVgrabber::SetExposure(double exp)
 {
    SetProperty(MM::g_Keyword_Exposure, CDeviceUtils::ConvertToString(exp));
-   cvSetCaptureProperty(capture_,CV_CAP_PROP_EXPOSURE,(long)exp); 
+   std::lock_guard<std::mutex> captureLock(captureMutex_);
+   capture_.set(g_CapPropExposure, (long)exp);
    // there is no benefit from checking if this works (many capture_ drivers via opencv 
    // just don't allow this) - just carry on regardless.
 }
@@ -769,205 +738,84 @@ int COpenCVgrabber::StartSequenceAcquisition(double interval) {
    return StartSequenceAcquisition(LONG_MAX, interval, false);            
 }
 
-/**                                                                       
-* Stop and wait for the Sequence thread finished                                   
-*/                                                                        
-int COpenCVgrabber::StopSequenceAcquisition()                                     
-{                                                                         
-
-   if (!thd_->IsStopped()) {
-      thd_->Stop();                                                       
-      thd_->wait();                                                       
-   }                                                                      
-                                                                          
-   return DEVICE_OK;                                                      
-} 
-
 /**
-* Simple implementation of Sequence Acquisition
-* A sequence acquisition should run on its own thread and transport new images
-* coming from the camera into the MMCore circular buffer.
+* Stops the sequence and waits until the images already handed to the core
+* are in, and AcqFinished() has been sent.
 */
-int COpenCVgrabber::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
+int COpenCVgrabber::StopSequenceAcquisition()
 {
+   std::unique_lock<std::mutex> lock(mutex_);
+   if (!sequenceActive_)
+      return DEVICE_OK;
 
+   if (sequenceToRetrieve_ > 0)
+      LogMessage("SeqAcquisition interrupted by the user\n");
+   sequenceToRetrieve_ = 0;
+   DiscardSequenceFrames();
+   FinishSequence(lock);
+   stateCond_.wait(lock, [this] { return !sequenceActive_; });
+   return DEVICE_OK;
+}
+
+/**
+* Sequence acquisition runs on the capture threads, which never stop
+* grabbing: the capture thread retrieves each frame while the convert thread
+* converts the previous one and inserts it into the MMCore circular buffer.
+* The camera's own frame rate sets the pace; interval_ms is ignored. When
+* the circular buffer is full, the Core's overflow policy applies.
+*/
+int COpenCVgrabber::StartSequenceAcquisition(long numImages, double interval_ms, bool /*stopOnOverflow*/)
+{
    if (IsCapturing())
       return DEVICE_CAMERA_BUSY_ACQUIRING;
 
    int ret = GetCoreCallback()->PrepareForAcq(this);
    if (ret != DEVICE_OK)
       return ret;
+
+   std::lock_guard<std::mutex> lock(mutex_);
    sequenceStartTime_ = GetCurrentMMTime();
-   stopOnOverFlow_ = stopOnOverflow;
    imageCounter_ = 0;
-   thd_->Start(numImages,interval_ms);
+   sequenceFormat_ = CurrentFormat();
+   sequenceToRetrieve_ = numImages;
+   sequenceInFlight_ = 0;
+   sequenceDropped_ = 0;
+   sequenceActive_ = true;
+   captureCond_.notify_all();
    return DEVICE_OK;
 }
 
 /*
  * Inserts Image and MetaData into MMCore circular Buffer
+ * Called from the convert thread
  */
-int COpenCVgrabber::InsertImage()
+int COpenCVgrabber::InsertFrame(const unsigned char* pixels, const FrameFormat& format,
+      const MM::MMTime& timestamp)
 {
-   MM::MMTime timeStamp = this->GetCurrentMMTime();
    char label[MM::MaxStrLength];
    this->GetLabel(label);
  
    // Important:  metadata about the image are generated here:
    Metadata md;
    md.put(MM::g_Keyword_Metadata_CameraLabel, label);
-   md.put(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString((timeStamp - sequenceStartTime_).getMsec()));
+   md.put(MM::g_Keyword_Elapsed_Time_ms, CDeviceUtils::ConvertToString((timestamp - sequenceStartTime_).getMsec()));
    md.put(MM::g_Keyword_Metadata_ImageNumber, CDeviceUtils::ConvertToString(imageCounter_));
-   md.put(MM::g_Keyword_Metadata_ROI_X, CDeviceUtils::ConvertToString( (long) roiX_)); 
-   md.put(MM::g_Keyword_Metadata_ROI_Y, CDeviceUtils::ConvertToString( (long) roiY_)); 
+   md.put(MM::g_Keyword_Metadata_ROI_X, CDeviceUtils::ConvertToString( (long) format.roiX)); 
+   md.put(MM::g_Keyword_Metadata_ROI_Y, CDeviceUtils::ConvertToString( (long) format.roiY)); 
+   md.put(MM::g_Keyword_Binning, CDeviceUtils::ConvertToString(format.binning));
    
    imageCounter_++;
-   
-   char buf[MM::MaxStrLength];
-   GetProperty(MM::g_Keyword_Binning, buf);
-   md.put(MM::g_Keyword_Binning, buf);
-   
-   MMThreadGuard g(imgPixelsLock_);
-
-
-   const unsigned char* pI = GetImageBuffer();
-   unsigned int w = GetImageWidth();
-   unsigned int h = GetImageHeight();
-   unsigned int b = GetImageBytesPerPixel();
 
-   int ret = GetCoreCallback()->InsertImage(this, pI, w, h, b, md.Serialize().c_str());
-   if (!stopOnOverFlow_ && ret == DEVICE_BUFFER_OVERFLOW)
-   {
-      // do not stop on overflow - just reset the buffer
-      GetCoreCallback()->ClearImageBuffer(this);
-      // don't process this same image again...
-	  return GetCoreCallback()->InsertImage(this, pI, w, h, b, md.Serialize().c_str(), false);
-	  //return GetCoreCallback()->InsertImage(this, pI, w, h, b);
-   } else
-      return ret;
+   const unsigned w = format.width;
+   const unsigned h = format.height;
+   const unsigned b = format.bytesPerPixel;
+   // The Core's overflow policy decides what happens when the buffer is full
+   return GetCoreCallback()->InsertImage(this, pixels, w, h, b, md.Serialize().c_str());
 }
 
-/*
- * Do actual capturing
- * Called from inside the thread  
- */
-int COpenCVgrabber::ThreadRun (void)
-{
-   int ret=DEVICE_ERR;
-   
-   // Trigger
-   if (triggerDevice_.length() > 0) {
-      MM::Device* triggerDev = GetDevice(triggerDevice_.c_str());
-      if (triggerDev != 0) {
-      	//char label[256];
-      	//triggerDev->GetLabel(label);
-      	LogMessage("trigger requested");
-      	triggerDev->SetProperty("Trigger","+");
-      }
-   }
-      
-   ret = SnapImage();
-   if (ret != DEVICE_OK) return ret;
-
-   ret = InsertImage();
-   if (ret != DEVICE_OK) return ret;
-
-   return ret;
-};
-
 bool COpenCVgrabber::IsCapturing() {
-   return !thd_->IsStopped();
-}
-
-/*
- * called from the thread function before exit 
- */
-void COpenCVgrabber::OnThreadExiting() throw()
-{
-   try
-   {
-      LogMessage(g_Msg_SEQUENCE_ACQUISITION_THREAD_EXITING);
-      GetCoreCallback()?GetCoreCallback()->AcqFinished(this,0):DEVICE_OK;
-   }
-   catch(...)
-   {
-      LogMessage(g_Msg_EXCEPTION_IN_ON_THREAD_EXITING, false);
-   }
-}
-
-
-MySequenceThread::MySequenceThread(COpenCVgrabber* pCam)
-   :intervalMs_(default_intervalMS)
-   ,numImages_(default_numImages)
-   ,imageCounter_(0)
-   ,stop_(true)
-   ,suspend_(false)
-   ,camera_(pCam)
-   ,startTime_(0)
-   ,actualDuration_(0)
-   ,lastFrameTime_(0)
-{};
-
-MySequenceThread::~MySequenceThread() {};
-
-void MySequenceThread::Stop() {
-   MMThreadGuard(this->stopLock_);
-   stop_=true;
-}
-
-void MySequenceThread::Start(long numImages, double intervalMs)
-{
-   MMThreadGuard(this->stopLock_);
-   MMThreadGuard(this->suspendLock_);
-   numImages_=numImages;
-   intervalMs_=intervalMs;
-   imageCounter_=0;
-   stop_ = false;
-   suspend_=false;
-   activate();
-   actualDuration_ = MM::MMTime{};
-   startTime_= camera_->GetCurrentMMTime();
-   lastFrameTime_ = MM::MMTime{};
-}
-
-bool MySequenceThread::IsStopped(){
-   MMThreadGuard(this->stopLock_);
-   return stop_;
-}
-
-void MySequenceThread::Suspend() {
-   MMThreadGuard(this->suspendLock_);
-   suspend_ = true;
-}
-
-bool MySequenceThread::IsSuspended() {
-   MMThreadGuard(this->suspendLock_);
-   return suspend_;
-}
-
-void MySequenceThread::Resume() {
-   MMThreadGuard(this->suspendLock_);
-   suspend_ = false;
-}
-
-int MySequenceThread::svc(void) throw()
-{
-   int ret=DEVICE_ERR;
-   try 
-   {
-      do
-      {  
-         ret=camera_->ThreadRun();
-      } while (DEVICE_OK == ret && !IsStopped() && imageCounter_++ < numImages_-1);
-      if (IsStopped())
-         camera_->LogMessage("SeqAcquisition interrupted by the user\n");
-   }catch(...){
-      camera_->LogMessage(g_Msg_EXCEPTION_IN_THREAD, false);
-   }
-   stop_=true;
-   actualDuration_ = camera_->GetCurrentMMTime() - startTime_;
-   camera_->OnThreadExiting();
-   return ret;
+   std::lock_guard<std::mutex> lock(mutex_);
+   return sequenceActive_;
 }
 
 
@@ -1124,14 +972,18 @@ int COpenCVgrabber::OnGain(MM::PropertyBase* pProp, MM::ActionType eAct)
 
          long gain;
          pProp->Get(gain);
-		 cvSetCaptureProperty(capture_,CV_CAP_PROP_GAIN,gain);
+		 std::lock_guard<std::mutex> captureLock(captureMutex_);
+		 capture_.set(g_CapPropGain, gain);
 		 ret=DEVICE_OK;
       }break;
    case MM::BeforeGet:
       {
          
 		 double gain;
-		 gain = cvGetCaptureProperty(capture_,CV_CAP_PROP_GAIN);
+		 {
+			std::lock_guard<std::mutex> captureLock(captureMutex_);
+			gain = capture_.get(g_CapPropGain);
+		 }
 		 if(!gain) return DEVICE_ERR;
 		 ret=DEVICE_OK;
 			pProp->Set((double)gain);
@@ -1198,7 +1050,10 @@ int COpenCVgrabber::OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct)
          pProp->Get(binFactor);
 			if(binFactor > 0 && binFactor < 10)
 			{
-				img_.Resize(cameraCCDXSize_/binFactor, cameraCCDYSize_/binFactor);
+				{
+					MMThreadGuard g(imgPixelsLock_);
+					img_.Resize(cameraCCDXSize_/binFactor, cameraCCDYSize_/binFactor);
+				}
 				binSize_ = binFactor;
             std::ostringstream os;
             os << binSize_;
@@ -1240,6 +1095,7 @@ int COpenCVgrabber::OnPixelType(MM::PropertyBase* pProp, MM::ActionType eAct)
          string pixelType;
          pProp->Get(pixelType);
 
+         MMThreadGuard g(imgPixelsLock_);
          if (pixelType.compare(g_PixelType_8bit) == 0)
          {
             nComponents_ = 1;
@@ -1356,6 +1212,7 @@ int COpenCVgrabber::OnBitDepth(MM::PropertyBase* pProp, MM::ActionType eAct)
 				bytesPerPixel = 4;
 			}
 			
+			MMThreadGuard g(imgPixelsLock_);
 			img_.Resize(img_.Width(), img_.Height(), bytesPerPixel);
 
       } break;
@@ -1400,11 +1257,14 @@ int COpenCVgrabber::OnResolution(MM::PropertyBase* pProp, MM::ActionType eAct)
 		 long w = atoi(width.c_str());
 		 long h = atoi(height.c_str());
 
-		 cvSetCaptureProperty(capture_, CV_CAP_PROP_FRAME_WIDTH, (double) w);
-		 cvSetCaptureProperty(capture_, CV_CAP_PROP_FRAME_HEIGHT, (double) h);
+		 {
+			std::lock_guard<std::mutex> captureLock(captureMutex_);
+			capture_.set(g_CapPropFrameWidth, (double) w);
+			capture_.set(g_CapPropFrameHeight, (double) h);
 
-		 cameraCCDXSize_ = (long) cvGetCaptureProperty(capture_, CV_CAP_PROP_FRAME_WIDTH);
-		 cameraCCDYSize_ = (long) cvGetCaptureProperty(capture_, CV_CAP_PROP_FRAME_HEIGHT);
+			cameraCCDXSize_ = (long) capture_.get(g_CapPropFrameWidth);
+			cameraCCDYSize_ = (long) capture_.get(g_CapPropFrameHeight);
+		 }
 		 if(!(cameraCCDXSize_ > 0) || !(cameraCCDYSize_ > 0))
 			 return DEVICE_ERR;
 		 ret = ResizeImageBuffer();
@@ -1494,6 +1354,7 @@ int COpenCVgrabber::OnCameraCCDXSize(MM::PropertyBase* pProp , MM::ActionType eA
 		if( value != cameraCCDXSize_)
 		{
 			cameraCCDXSize_ = value;
+			MMThreadGuard g(imgPixelsLock_);
 			img_.Resize(cameraCCDXSize_/binSize_, cameraCCDYSize_/binSize_);
 		}
    }
@@ -1517,6 +1378,7 @@ int COpenCVgrabber::OnCameraCCDYSize(MM::PropertyBase* pProp, MM::ActionType eAc
 		if( value != cameraCCDYSize_)
 		{
 			cameraCCDYSize_ = value;
+			MMThreadGuard g(imgPixelsLock_);
 			img_.Resize(cameraCCDXSize_/binSize_, cameraCCDYSize_/binSize_);
 		}
    }
@@ -1571,6 +1433,7 @@ int COpenCVgrabber::ResizeImageBuffer()
       byteDepth = 4;
 	}
 	
+   MMThreadGuard g(imgPixelsLock_);
    img_.Resize(cameraCCDXSize_/binSize_, cameraCCDYSize_/binSize_, byteDepth);
    return DEVICE_OK;
 }
@@ -1583,3 +1446,252 @@ void COpenCVgrabber::GenerateEmptyImage(ImgBuffer& img)
    unsigned char* pBuf = const_cast<unsigned char*>(img.GetPixels());
    memset(pBuf, 0, img.Height()*img.Width()*img.Depth());
 }
+
+/**
+* Captures the settings that shape the images, for a snap or a sequence.
+* Called from the thread that sets the properties.
+*/
+COpenCVgrabber::FrameFormat COpenCVgrabber::CurrentFormat() const
+{
+   FrameFormat format;
+   format.width = img_.Width();
+   format.height = img_.Height();
+   format.bytesPerPixel = img_.Depth();
+   format.roiX = roiX_;
+   format.roiY = roiY_;
+   format.flipX = xFlip_;
+   format.flipY = yFlip_;
+   format.binning = binSize_;
+   return format;
+}
+
+void COpenCVgrabber::StartCaptureThreads()
+{
+   stopThreads_ = false;
+   captureThread_ = std::thread(&COpenCVgrabber::CaptureLoop, this);
+   convertThread_ = std::thread(&COpenCVgrabber::ConvertLoop, this);
+}
+
+void COpenCVgrabber::StopCaptureThreads()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopThreads_ = true;
+      if (snapState_ == SnapRequested || snapState_ == SnapGrabbing)
+         snapState_ = SnapFailed;
+   }
+   captureCond_.notify_all();
+   convertCond_.notify_all();
+   stateCond_.notify_all();
+   if (captureThread_.joinable())
+      captureThread_.join();
+   if (convertThread_.joinable())
+      convertThread_.join();
+   rawFrames_.clear();
+   spareFrames_.clear();
+}
+
+/**
+* Capture thread: grabs every frame the camera delivers, so that the
+* driver's queue never holds stale frames, and retrieves (decodes) only the
+* ones a snap or a sequence needs. grab() and retrieve() of one capture
+* cannot overlap, but both overlap the conversion of the previous frame.
+*/
+void COpenCVgrabber::CaptureLoop()
+{
+   cv::Mat frame;
+   std::unique_lock<std::mutex> lock(mutex_);
+   while (!stopThreads_)
+   {
+      // A snap is served by the first frame grabbed after it was requested
+      if (snapState_ == SnapRequested)
+         snapState_ = SnapGrabbing;
+      const unsigned long snapRequest = snapState_ == SnapGrabbing ? snapRequest_ : 0;
+      bool forSequence = sequenceToRetrieve_ > 0;
+      if (forSequence && rawFrames_.size() >= g_MaxQueuedFrames)
+      {
+         ++sequenceDropped_;
+         forSequence = false;
+      }
+      if (forSequence)
+      {
+         --sequenceToRetrieve_;
+         ++sequenceInFlight_;
+      }
+      const bool retrieve = snapRequest != 0 || forSequence;
+      if (retrieve && !spareFrames_.empty())
+      {
+         frame = spareFrames_.back();
+         spareFrames_.pop_back();
+      }
+      lock.unlock();
+
+      bool ok;
+      MM::MMTime timestamp;
+      {
+         std::lock_guard<std::mutex> captureLock(captureMutex_);
+         ok = capture_.grab();
+         timestamp = GetCurrentMMTime();
+         if (ok && retrieve)
+            ok = capture_.retrieve(frame) && !frame.empty();
+      }
+
+      lock.lock();
+      if (!ok)
+      {
+         if (snapRequest != 0 && snapRequest == snapRequest_ && snapState_ == SnapGrabbing)
+         {
+            snapState_ = SnapFailed;
+            stateCond_.notify_all();
+         }
+         if (forSequence)
+         {
+            LogMessage("Could not get an image from the camera, stopping the sequence");
+            --sequenceInFlight_;
+            sequenceToRetrieve_ = 0;
+            FinishSequence(lock);
+         }
+         // Do not spin on a camera that has gone away
+         captureCond_.wait_for(lock, std::chrono::milliseconds(100));
+         continue;
+      }
+      if (!retrieve)
+         continue;
+
+      RawFrame raw;
+      raw.pixels = frame;
+      raw.timestamp = timestamp;
+      raw.snapRequest = snapRequest;
+      raw.forSequence = forSequence;
+      rawFrames_.push_back(raw);
+      // The queued frame owns the pixels now; OpenCV 2.4 cannot move a Mat
+      frame.release();
+      convertCond_.notify_one();
+   }
+}
+
+/**
+* Convert thread: converts the retrieved frames, into img_ for a snap and
+* straight into the core's buffer for a sequence.
+*/
+void COpenCVgrabber::ConvertLoop()
+{
+   cv::Mat scratch;
+   std::unique_lock<std::mutex> lock(mutex_);
+   for (;;)
+   {
+      convertCond_.wait(lock, [this] { return stopThreads_ || !rawFrames_.empty(); });
+      if (stopThreads_)
+         return;
+      RawFrame raw = rawFrames_.front();
+      rawFrames_.pop_front();
+      const FrameFormat snapFormat = snapFormat_;
+      const FrameFormat sequenceFormat = sequenceFormat_;
+      lock.unlock();
+
+      bool snapped = false;
+      if (raw.snapRequest != 0)
+      {
+         MMThreadGuard g(imgPixelsLock_);
+         snapped = img_.Width() == snapFormat.width && img_.Height() == snapFormat.height &&
+            img_.Depth() == snapFormat.bytesPerPixel &&
+            ConvertFrame(raw.pixels, snapFormat.width, snapFormat.height,
+                  snapFormat.bytesPerPixel, snapFormat.roiX, snapFormat.roiY,
+                  snapFormat.flipX, snapFormat.flipY, img_.GetPixelsRW(), scratch);
+      }
+      int ret = DEVICE_OK;
+      if (raw.forSequence)
+      {
+         const FrameFormat& f = sequenceFormat;
+         sequenceImage_.resize((size_t) f.width * f.height * f.bytesPerPixel);
+         if (ConvertFrame(raw.pixels, f.width, f.height, f.bytesPerPixel,
+               f.roiX, f.roiY, f.flipX, f.flipY, &sequenceImage_[0], scratch))
+            ret = InsertFrame(&sequenceImage_[0], f, raw.timestamp);
+         else
+            ret = FAILED_TO_GET_IMAGE;
+      }
+
+      lock.lock();
+      spareFrames_.push_back(raw.pixels);
+      raw.pixels.release();
+      if (raw.snapRequest != 0 && raw.snapRequest == snapRequest_ && snapState_ == SnapGrabbing)
+      {
+         snapState_ = snapped ? SnapDone : SnapFailed;
+         stateCond_.notify_all();
+      }
+      if (raw.forSequence)
+      {
+         --sequenceInFlight_;
+         if (ret != DEVICE_OK && sequenceToRetrieve_ > 0)
+         {
+            std::ostringstream os;
+            os << "Stopping the sequence: could not insert image (error " << ret << ")";
+            LogMessage(os.str().c_str());
+            sequenceToRetrieve_ = 0;
+            DiscardSequenceFrames();
+         }
+         FinishSequence(lock);
+      }
+   }
+}
+
+/**
+* Drops the queued frames of a sequence that is stopping.
+* Called with mutex_ held.
+*/
+void COpenCVgrabber::DiscardSequenceFrames()
+{
+   for (std::deque<RawFrame>::iterator it = rawFrames_.begin(); it != rawFrames_.end(); )
+   {
+      if (!it->forSequence)
+      {
+         ++it;
+         continue;
+      }
+      --sequenceInFlight_;
+      if (it->snapRequest != 0)
+      {
+         it->forSequence = false;
+         ++it;
+      }
+      else
+      {
+         spareFrames_.push_back(it->pixels);
+         it = rawFrames_.erase(it);
+      }
+   }
+}
+
+/**
+* Sends AcqFinished() once the last frame of the sequence is in.
+* Called with mutex_ held, from whichever thread handled that frame.
+*/
+void COpenCVgrabber::FinishSequence(std::unique_lock<std::mutex>& lock)
+{
+   if (!sequenceActive_ || sequenceFinishing_ ||
+         sequenceToRetrieve_ > 0 || sequenceInFlight_ > 0)
+      return;
+
+   sequenceFinishing_ = true;
+   const long dropped = sequenceDropped_;
+   lock.unlock();
+   if (dropped > 0)
+   {
+      std::ostringstream os;
+      os << "Skipped " << dropped << " frames while conversion was behind";
+      LogMessage(os.str().c_str());
+   }
+   try
+   {
+      LogMessage(g_Msg_SEQUENCE_ACQUISITION_THREAD_EXITING);
+      GetCoreCallback()?GetCoreCallback()->AcqFinished(this,0):DEVICE_OK;
+   }
+   catch(...)
+   {
+      LogMessage(g_Msg_EXCEPTION_IN_ON_THREAD_EXITING, false);
+   }
+   lock.lock();
+   sequenceActive_ = false;
+   sequenceFinishing_ = false;
+   stateCond_.notify_all();
+}
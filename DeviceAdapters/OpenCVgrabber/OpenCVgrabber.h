@@ -37,15 +37,26 @@
 #ifdef WIN32
 #include "DeviceEnumerator.h"
 #endif
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <algorithm>
 
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable: 4267)
 #endif
-#include "opencv/highgui.h"
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#if CV_MAJOR_VERSION >= 3
+#include "opencv2/videoio/videoio.hpp"
+#else
+#include "opencv2/highgui/highgui.hpp"
+#endif
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -66,8 +77,6 @@
 // COpenCVgrabber class
 //////////////////////////////////////////////////////////////////////////////
 
-class MySequenceThread;
-
 class COpenCVgrabber : public CCameraBase<COpenCVgrabber>  
 {
 public:
@@ -104,10 +113,7 @@ public:
    int StartSequenceAcquisition(double interval);
    int StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow);
    int StopSequenceAcquisition();
-   int InsertImage();
-   int ThreadRun();
    bool IsCapturing();
-   void OnThreadExiting() throw(); 
    double GetNominalPixelSizeUm() const {return nominalPixelSizeUm_;}
    double GetPixelSizeUm() const {return nominalPixelSizeUm_ * GetBinning();}
    int GetBinning() const;
@@ -135,25 +141,81 @@ public:
    int OnFlipX(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnFlipY(MM::PropertyBase* pProp, MM::ActionType eAct);
 private:
+   // Shape of the images handed out, fixed for the duration of a snap or
+   // sequence so that the capture threads never read the properties
+   struct FrameFormat
+   {
+      unsigned width;
+      unsigned height;
+      unsigned bytesPerPixel;
+      unsigned roiX;
+      unsigned roiY;
+      bool flipX;
+      bool flipY;
+      long binning;
+   };
+
+   // A retrieved frame waiting for conversion
+   struct RawFrame
+   {
+      cv::Mat pixels;
+      MM::MMTime timestamp;
+      unsigned long snapRequest; // 0 if not for a snap
+      bool forSequence;
+   };
+
+   enum SnapState { SnapIdle, SnapRequested, SnapGrabbing, SnapDone, SnapFailed };
+
    int SetAllowedBinning();
 
    void GenerateEmptyImage(ImgBuffer& img);
 
-   void RGB3toRGB4(const char* srcPixels, char* destPixels, int width, int height);
-
    int ResizeImageBuffer();
 
-   static const double nominalPixelSizeUm_;
+   FrameFormat CurrentFormat() const;
+   void StartCaptureThreads();
+   void StopCaptureThreads();
+   void CaptureLoop();
+   void ConvertLoop();
+   int InsertFrame(const unsigned char* pixels, const FrameFormat& format,
+         const MM::MMTime& timestamp);
+   void DiscardSequenceFrames();
+   void FinishSequence(std::unique_lock<std::mutex>& lock);
 
+   static const double nominalPixelSizeUm_;
 
-   // CvCapture* capture_;
-   // IplImage* frame_; // do not modify, do not release!
+   // grab() and retrieve() run on the capture thread; everyone else must
+   // hold captureMutex_ to touch capture_
+   cv::VideoCapture capture_;
+   std::mutex captureMutex_;
+
+   std::thread captureThread_;
+   std::thread convertThread_;
+
+   // Guards the state shared between the capture, convert and calling
+   // threads below
+   std::mutex mutex_;
+   std::condition_variable captureCond_;
+   std::condition_variable convertCond_;
+   std::condition_variable stateCond_;
+   bool stopThreads_;
+   std::deque<RawFrame> rawFrames_;
+   std::vector<cv::Mat> spareFrames_;
+   SnapState snapState_;
+   unsigned long snapRequest_;
+   FrameFormat snapFormat_;
+   bool sequenceActive_;
+   bool sequenceFinishing_;
+   long sequenceToRetrieve_;
+   long sequenceInFlight_;
+   long sequenceDropped_;
+   FrameFormat sequenceFormat_;
+   std::vector<unsigned char> sequenceImage_;
 
    long int cameraID_;
    ImgBuffer img_;
    bool initialized_;
    double readoutUs_;
-   MM::MMTime readoutStartTime_;
    long scanMode_;
    int bitDepth_;
    unsigned roiX_;
@@ -167,53 +229,8 @@ private:
    bool xFlip_;
    bool yFlip_;
 	std::string triggerDevice_;
-   bool stopOnOverFlow_;
 
    MMThreadLock imgPixelsLock_;
-   
-
-   friend class MySequenceThread;
-   MySequenceThread * thd_;
 };
 
-class MySequenceThread : public MMDeviceThreadBase
-{
-   friend class COpenCVgrabber;
-   enum { default_numImages=1, default_intervalMS = 100 };
-   public:
-      MySequenceThread(COpenCVgrabber* pCam);
-      ~MySequenceThread();
-      void Stop()/* {MMThreadGuard(this->stopLock_); stop_ = true;} */;
-      void Start(long numImages, double intervalMs);
-      bool IsStopped();
-      void Suspend();
-      bool IsSuspended();
-      void Resume();
-      double GetIntervalMs(){return intervalMs_;}                               
-      void SetLength(long images) {numImages_ = images;}                        
-      long GetLength() const {return numImages_;}
-      long GetImageCounter(){return imageCounter_;}                             
-      MM::MMTime GetStartTime(){return startTime_;}                             
-      MM::MMTime GetActualDuration(){return actualDuration_;}
-
-   private:                                                                     
-      int svc(void) throw();
-
-      double intervalMs_;                                                       
-      long numImages_;                                                          
-      long imageCounter_;                                                       
-      bool stop_;                                                               
-      bool suspend_;                                                            
-      COpenCVgrabber* camera_;   
-      MM::MMTime startTime_;                                                    
-      MM::MMTime actualDuration_;                                               
-      MM::MMTime lastFrameTime_;                                                
-
-      MMThreadLock stopLock_;                                                   
-      MMThreadLock suspendLock_;                                                
-}; 
-
-
-
-
 #endif //_DEMOCAMERA_H_
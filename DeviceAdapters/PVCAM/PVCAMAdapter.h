@@ -637,6 +637,14 @@ public: // Other published methods
     */
     void  LogAdapterMessage(const std::string& message, bool debug = true) const throw();
 
+    /**
+    * Copies a large block of memory using the Core's worker threads.
+    * A single thread cannot saturate the memory bandwidth, which matters
+    * for fast cameras with large frames (e.g. Kinetix).
+    * @return DEVICE_OK, or an error code if the copy could not be run
+    */
+    int   ParallelMemCopy(void* dst, const void* src, size_t bytes) const;
+
 protected:
     /**
     * This method is called from the static PVCAM callback or polling thread.
@@ -50,6 +50,7 @@
 // System
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <set>
 #include <sstream>
@@ -3965,6 +3966,18 @@ void  Universal::LogAdapterMessage(const std::string& message, bool debug) const
     catch(...){}
 }
 
+int Universal::ParallelMemCopy(void* dst, const void* src, size_t bytes) const
+{
+    // Copy in 64 KiB blocks, at least 1 MiB per thread
+    const size_t blockBytes = 64 * 1024;
+    const unsigned long blocks = static_cast<unsigned long>((bytes + blockBytes - 1) / blockBytes);
+    return ParallelFor(blocks, 16, [=](unsigned long begin, unsigned long end) {
+        const size_t offset = begin * blockBytes;
+        const size_t size = (std::min)(end * blockBytes, bytes) - offset;
+        memcpy(static_cast<char*>(dst) + offset, static_cast<const char*>(src) + offset, size);
+    });
+}
+
 
 //=============================================================================
 //=================================================================== PROTECTED
@@ -1,43 +0,0 @@
-///////////////////////////////////////////////////////////////////////////////
-// FILE:          Semaphore.h
-// PROJECT:       Micro-Manager
-// SUBSYSTEM:     DeviceAdapters
-//-----------------------------------------------------------------------------
-// DESCRIPTION:   Synchronization primitive with counter.
-//
-// AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
-//                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
-//
-// COPYRIGHT:     Teledyne Digital Imaging US, Inc., 2021
-//
-// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
-//                License text is included with the source distribution.
-//
-//                This file is distributed in the hope that it will be useful,
-//                but WITHOUT ANY WARRANTY; without even the implied warranty
-//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
-//
-//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
-//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
-//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
-
-#pragma once
-
-#include <condition_variable>
-#include <cstddef>
-#include <mutex>
-
-class Semaphore final
-{
-public:
-    explicit Semaphore();
-    explicit Semaphore(size_t initCount);
-
-    void Wait(size_t count = 1);
-    void Release(size_t count = 1);
-
-private:
-    size_t count_{ 0 };
-    std::mutex mx_{};
-    std::condition_variable cv_{};
-};
@@ -2,8 +2,6 @@
 
 // Local
 #include "PVCAMAdapter.h"
-#include "TaskSet_CopyMemory.h"
-#include "ThreadPool.h"
 
 // System
 #include <algorithm>
@@ -93,9 +91,7 @@ private:
 };
 
 StreamWriter::StreamWriter(Universal* camera)
-    : camera_(camera),
-    threadPool_(std::make_shared<ThreadPool>()),
-    tasksMemCopy_(std::make_shared<TaskSet_CopyMemory>(threadPool_))
+    : camera_(camera)
 {
 }
 
@@ -261,7 +257,12 @@ int StreamWriter::WriteFrame(const void* pFrame, size_t frameNr)
     {
         // Standard memcpy is too slow for Kinetix, do parallel copy instead
         //memcpy(alignedBuffer_, pFrame, frameBytes_);
-        tasksMemCopy_->MemCopy(alignedBuffer_, pFrame, frameBytes_);
+        const int err = camera_->ParallelMemCopy(alignedBuffer_, pFrame, frameBytes_);
+        if (err != DEVICE_OK)
+        {
+            StopInternal();
+            return camera_->LogAdapterError(err, __LINE__, "Failed to copy frame");
+        }
         writeBuffer = alignedBuffer_;
     }
 
@@ -1,13 +1,10 @@
 #ifndef _STREAMWRITER_H_
 #define _STREAMWRITER_H_
 
-#include <memory>
 #include <mutex>
 #include <string>
 
 class StackFile;
-class TaskSet_CopyMemory;
-class ThreadPool;
 class Universal;
 
 class StreamWriter
@@ -97,10 +94,6 @@ private:
 private:
     const Universal* camera_;
 
-    // TODO: Get some shared pool from outside
-    const std::shared_ptr<ThreadPool> threadPool_;
-    const std::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
-
     // Optimized/non-buffered streaming requires all file writes to be aligned.
     // The O_DIRECT requires 512B alignment, the FILE_FLAG_NO_BUFFERING requires
     // "physical sector size" alignment. Since most common disk sector sizes are
@@ -10,6 +10,8 @@ const char* g_Keyword_Left = "Left";
 const char* g_Keyword_Exposure = "Exposure-ms";
 const char* g_Keyword_Binning = "Binning";
 const char* g_Method_Read = "read";
+const char* g_Method_Stream = "stream";
+const char* g_Method_StopStream = "stop_stream";
 
 /**
 * Performs exposure and grabs a single image.
@@ -21,17 +23,86 @@ const char* g_Method_Read = "read";
 int CPyCamera::ConnectMethods(const PyObj& methods)
 {
     _check_(PyCameraClass::ConnectMethods(methods));
-    read_ = methods.GetDictItem("read");
+    read_ = methods.GetDictItem(g_Method_Read);
+    stream_ = methods.GetDictItem(g_Method_Stream);
+    stopStream_ = methods.GetDictItem(g_Method_StopStream);
     return CheckError();
 }
 
+/**
+* Reads the image size from the Width and Height properties.
+* The values are kept in layout_, so that the image size does not have to be requested from Python for every frame.
+*/
+void CPyCamera::RefreshGeometry()
+{
+    PyLock lock; // make sure width and height are read without any other thread having access in between
+    layout_.width = GetLongProperty(g_Keyword_Width);
+    layout_.height = GetLongProperty(g_Keyword_Height);
+}
+
+/**
+* Determines the pixel layout of a frame from its buffer protocol information, and checks it against the current image size.
+* Only the width and height of 'layout' are used as input, the pixel format is filled in from the frame.
+* @return true if the frame has a supported format and the expected size
+*/
+bool CPyCamera::GetFrameLayout(const Py_buffer& frame, FrameLayout& layout)
+{
+    auto itemsize = frame.itemsize;
+    bool supported = itemsize == 1 || itemsize == 2 || itemsize == 4;
+    Py_ssize_t nw = 0, nh = 0;
+    layout.components = 1;
+    layout.channels = 1;
+    if (frame.ndim == 2)
+    {
+        nh = frame.shape[0];
+        nw = frame.shape[1];
+    }
+    else if (frame.ndim == 3 && itemsize == 1 && frame.shape[2] == 4) // (height, width, 4) RGBA
+    {
+        nh = frame.shape[0];
+        nw = frame.shape[1];
+        itemsize = 4;
+        layout.components = 4;
+    }
+    else if (frame.ndim == 3 && frame.shape[0] > 0) // (channels, height, width)
+    {
+        layout.channels = static_cast<unsigned>(frame.shape[0]);
+        nh = frame.shape[1];
+        nw = frame.shape[2];
+    }
+    else
+        supported = false;
+
+    if (!supported)
+    {
+        this->LogMessage(
+            "Error, 'image' should be a c-contiguous array of 8, 16 or 32 bit integers, with shape (height, width), (height, width, 4) for 8-bit RGBA, or (channels, height, width)");
+        return false;
+    }
+    if (nw != layout.width || nh != layout.height)
+    {
+        auto msg = "Error, 'image' dimensions should be (" + std::to_string(layout.width) + ", " + std::to_string(layout.height) +
+            ") pixels, but were found to be (" + std::to_string(nw) + ", " + std::to_string(nh) + ") pixels";
+        this->LogMessage(msg.c_str());
+        return false;
+    }
+    layout.bytesPerPixel = static_cast<unsigned>(itemsize);
+    return true;
+}
+
 int CPyCamera::SnapImage()
 {
+    if (!PyCameraClass::IsCapturing()) // during a sequence, the geometry was read in StartSequenceAcquisition
+        RefreshGeometry();
     auto frame = read_.Call();
     ReleaseBuffer();
+    PyLock lock;
     if (PyObject_GetBuffer(frame, &lastFrame_, PyBUF_C_CONTIGUOUS) == -1)
         this->LogMessage("Error, 'image' property should return a numpy array");
-    return CheckError();
+    else if (!GetFrameLayout(lastFrame_, layout_))
+        ReleaseBuffer();
+    _check_(CheckError());
+    return lastFrame_.buf ? DEVICE_OK : DEVICE_INCOMPATIBLE_IMAGE;
 }
 
 int CPyCamera::Shutdown()
@@ -54,39 +125,29 @@ int CPyCamera::Shutdown()
 */
 const unsigned char* CPyCamera::GetImageBuffer()
 {
-    PyLock lock;
-    if (CheckError() != DEVICE_OK)
-        return nullptr;
-
-    if (lastFrame_.buf == nullptr || lastFrame_.ndim != 2 || lastFrame_.itemsize != 2) {
-        this->LogMessage(
-            "Error, 'image' property should be a 2-dimensional numpy array that is c-contiguous in memory and contains 16 bit  unsigned integers");
-        return nullptr;
-    }
+    return GetImageBuffer(0);
+}
 
-    // check if the array has the correct size
-    auto w = GetImageWidth();
-    auto h = GetImageHeight();
-    auto nw = lastFrame_.shape[1];
-    auto nh = lastFrame_.shape[0];
-    if (nw != w || nh != h)
-    {
-        auto msg = "Error, 'image' dimensions should be (" + std::to_string(w) + ", " + std::to_string(h) +
-            ") pixels, but were found to be (" + std::to_string(nw) + ", " + std::to_string(nh) + ") pixels";
-        this->LogMessage(msg.c_str());
+/**
+* Returns the pixel data of one channel. The frame was checked in SnapImage, so no Python calls are needed here.
+*/
+const unsigned char* CPyCamera::GetImageBuffer(unsigned channel)
+{
+    if (CheckError() != DEVICE_OK || lastFrame_.buf == nullptr || channel >= layout_.channels)
         return nullptr;
-    }
 
-    return static_cast<const unsigned char*>(lastFrame_.buf);
+    size_t planeSize = size_t(layout_.width) * layout_.height * layout_.bytesPerPixel;
+    return static_cast<const unsigned char*>(lastFrame_.buf) + channel * planeSize;
 }
 
 /**
 * Returns image buffer X-size in pixels.
 * Required by the MM::Camera API.
+* While streaming, the size that was read when the acquisition started is returned.
 */
 unsigned CPyCamera::GetImageWidth() const
 {
-    return GetLongProperty(g_Keyword_Width);
+    return streaming_ ? layout_.width : GetLongProperty(g_Keyword_Width);
 }
 
 /**
@@ -95,25 +156,36 @@ unsigned CPyCamera::GetImageWidth() const
 */
 unsigned CPyCamera::GetImageHeight() const
 {
-    return GetLongProperty(g_Keyword_Height);
+    return streaming_ ? layout_.height : GetLongProperty(g_Keyword_Height);
 }
 
 /**
 * Returns image buffer pixel depth in bytes.
 * Required by the MM::Camera API.
+* The pixel format follows the most recent frame, and is 16 bit until the first frame is acquired.
 */
 unsigned CPyCamera::GetImageBytesPerPixel() const
 {
-    return (GetBitDepth() + 7) / 8;
+    return layout_.bytesPerPixel;
 }
 
 /**
-* Returns the bit depth (dynamic range) of the pixel. Fixed at 16 bit per pixel
+* Returns the bit depth (dynamic range) of the pixel: the full width of the pixel type, or 8 bit per component for RGBA.
 * Required by the MM::Camera API.
 */
 unsigned CPyCamera::GetBitDepth() const
 {
-    return 16;
+    return 8 * layout_.bytesPerPixel / layout_.components;
+}
+
+unsigned CPyCamera::GetNumberOfComponents() const
+{
+    return layout_.components;
+}
+
+unsigned CPyCamera::GetNumberOfChannels() const
+{
+    return layout_.channels;
 }
 
 /**
@@ -229,24 +301,146 @@ int CPyCamera::IsExposureSequenceable(bool& isSequenceable) const
 // overriding default implementation which is broken (does not check for nullptr return from buffer)
 int CPyCamera::InsertImage()
 {
-    char label[MM::MaxStrLength];
-    this->GetLabel(label);
-    Metadata md;
-    md.put(MM::g_Keyword_Metadata_CameraLabel, label);
     auto buffer = GetImageBuffer();
     if (!buffer)
         return DEVICE_ERR;
+    return InsertFrame(buffer, layout_);
+}
+
+/**
+* Passes a frame to the core, one image per channel.
+* Overflow is handled by the core's buffer overflow policy.
+* Does not need the GIL, as long as the caller keeps the buffer that holds the pixels alive.
+*/
+int CPyCamera::InsertFrame(const unsigned char* pixels, const FrameLayout& layout)
+{
+    char label[MM::MaxStrLength];
+    this->GetLabel(label);
+    size_t planeSize = size_t(layout.width) * layout.height * layout.bytesPerPixel;
+    for (unsigned channel = 0; channel < layout.channels; channel++)
+    {
+        Metadata md;
+        md.put(MM::g_Keyword_Metadata_CameraLabel, label);
+        if (layout.channels > 1)
+            md.put(MM::g_Keyword_CameraChannelIndex, std::to_string(channel));
+        auto serialized = md.Serialize();
+        auto buffer = pixels + channel * planeSize;
+
+        int ret = GetCoreCallback()->InsertImage(this, buffer, layout.width, layout.height, layout.bytesPerPixel,
+                                                 layout.components, serialized.c_str());
+        if (ret != DEVICE_OK)
+            return ret;
+    }
+    return DEVICE_OK;
+}
+
+/**
+* Starts a sequence acquisition.
+* If the Python object has a stream() method, frames are taken from the iterator it returns, on a dedicated thread.
+* Otherwise, the default implementation is used, which calls read() repeatedly.
+* When streaming, the frame rate is determined by the Python code, and interval_ms is ignored.
+*/
+int CPyCamera::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
+{
+    if (IsCapturing())
+        return DEVICE_CAMERA_BUSY_ACQUIRING;
+
+    RefreshGeometry();
+    if (!stream_)
+        return PyCameraClass::StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow);
+
+    _check_(GetCoreCallback()->PrepareForAcq(this));
+    PyObj frames;
+    {
+        PyLock lock;
+        auto source = stream_.Call();
+        if (source)
+            frames = PyObj(PyObject_GetIter(source));
+    }
+    if (!frames)
+        return CheckError() != DEVICE_OK ? ERR_PYTHON_EXCEPTION : DEVICE_ERR;
+
+    if (streamThread_.joinable()) // previous stream ended by itself
+        streamThread_.join();
+    stopStreaming_ = false;
+    streaming_ = true;
+    streamThread_ = std::thread(&CPyCamera::StreamFrames, this, std::move(frames), numImages);
+    return DEVICE_OK;
+}
 
-    int ret = GetCoreCallback()->InsertImage(this, buffer, GetImageWidth(),
-                                             GetImageHeight(), GetImageBytesPerPixel(),
-                                             md.Serialize().c_str());
-    if (!isStopOnOverflow() && ret == DEVICE_BUFFER_OVERFLOW)
+/**
+* Body of the streaming thread.
+* The GIL is only held to fetch the next frame from the iterator and to acquire or release its buffer.
+* While the core copies the pixels, the buffer view keeps the frame alive and Python code can run on other threads.
+*/
+void CPyCamera::StreamFrames(PyObj frames, long numImages)
+{
+    int ret = DEVICE_OK;
+    for (long i = 0; i < numImages && !stopStreaming_; i++)
     {
-        // do not stop on overflow - just reset the buffer
-        GetCoreCallback()->ClearImageBuffer(this);
-        return GetCoreCallback()->InsertImage(this, buffer, GetImageWidth(),
-                                              GetImageHeight(), GetImageBytesPerPixel(),
-                                              md.Serialize().c_str());
+        Py_buffer frame;
+        {
+            PyLock lock;
+            auto item = PyObj(PyIter_Next(frames)); // nullptr when the iterator is exhausted, or on an exception
+            if (!item)
+                break;
+            if (PyObject_GetBuffer(item, &frame, PyBUF_C_CONTIGUOUS) == -1)
+            {
+                this->LogMessage("Error, 'stream' should produce numpy arrays");
+                ret = ERR_PYTHON_EXCEPTION;
+                break;
+            }
+        }
+
+        // The core sized its buffer from the format of the last snapped frame, so all streamed frames should have that format
+        FrameLayout layout = layout_;
+        if (!GetFrameLayout(frame, layout))
+            ret = DEVICE_INCOMPATIBLE_IMAGE;
+        else if (layout != layout_)
+        {
+            this->LogMessage("Error, the pixel format of the streamed frames should be the same as that of the last snapped image");
+            ret = DEVICE_INCOMPATIBLE_IMAGE;
+        }
+        else
+            ret = InsertFrame(static_cast<const unsigned char*>(frame.buf), layout);
+
+        {
+            PyLock lock;
+            PyBuffer_Release(&frame);
+        }
+        if (ret != DEVICE_OK)
+            break;
     }
-    return ret;
+    frames.Clear();
+    if (CheckError() != DEVICE_OK && ret == DEVICE_OK)
+        ret = ERR_PYTHON_EXCEPTION;
+    streaming_ = false;
+    GetCoreCallback()->AcqFinished(this, ret);
+}
+
+/**
+* Stops the streaming thread and waits for it to finish.
+* The optional stop_stream() method is called so that an iterator that is waiting for a frame can return.
+*/
+void CPyCamera::StopStream()
+{
+    if (!streamThread_.joinable())
+        return;
+    stopStreaming_ = true;
+    if (streaming_ && stopStream_)
+        stopStream_.Call();
+    streamThread_.join();
+}
+
+int CPyCamera::StopSequenceAcquisition()
+{
+    if (!stream_)
+        return PyCameraClass::StopSequenceAcquisition();
+    StopStream();
+    return CheckError();
+}
+
+bool CPyCamera::IsCapturing()
+{
+    return streaming_ || PyCameraClass::IsCapturing();
 }
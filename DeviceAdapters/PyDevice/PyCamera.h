@@ -3,21 +3,58 @@
 #include "buffer.h"
 
 using PyCameraClass = CPyDeviceTemplate<CCameraBase<std::monostate>>;
+
+/**
+ * Pixel layout of a frame, as found from the buffer protocol information of the array returned by Python.
+ * Supported are 2-D arrays (height, width) of 8, 16 or 32 bit pixels, 3-D arrays (height, width, 4) of 8-bit RGBA pixels,
+ * and 3-D arrays (channels, height, width) holding one image per channel.
+*/
+struct FrameLayout {
+    unsigned width = 0;
+    unsigned height = 0;
+    unsigned bytesPerPixel = 2;
+    unsigned components = 1;
+    unsigned channels = 1;
+
+    bool operator==(const FrameLayout& other) const
+    {
+        return width == other.width && height == other.height && bytesPerPixel == other.bytesPerPixel &&
+            components == other.components && channels == other.channels;
+    }
+    bool operator!=(const FrameLayout& other) const { return !(*this == other); }
+};
+
 class CPyCamera : public PyCameraClass {
     Py_buffer lastFrame_;
     PyObj read_; // the read() method of the camera object
-    
+    PyObj stream_; // optional stream() method, returns an iterator that produces frames
+    PyObj stopStream_; // optional stop_stream() method, called to make a blocked stream() iterator return
+
+    // Width and height from the properties, read once per snap or sequence so that no Python calls are needed per frame.
+    // Together with the pixel format of the last frame, this determines the image size reported to the core.
+    FrameLayout layout_;
+    std::thread streamThread_;
+    std::atomic<bool> streaming_{false};
+    std::atomic<bool> stopStreaming_{false};
+
 public:
     CPyCamera(const string& id) : PyCameraClass(id)
     {
         lastFrame_.obj = nullptr;
         lastFrame_.buf = nullptr;
     }
+    ~CPyCamera()
+    {
+        StopStream();
+    }
     const unsigned char* GetImageBuffer() override;
+    const unsigned char* GetImageBuffer(unsigned channel) override;
     unsigned GetImageWidth() const override;
     unsigned GetImageHeight() const override;
     unsigned GetImageBytesPerPixel() const override;
     unsigned GetBitDepth() const override;
+    unsigned GetNumberOfComponents() const override;
+    unsigned GetNumberOfChannels() const override;
     long GetImageBufferSize() const override;
     int SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize) override;
     int GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize) override;
@@ -30,9 +67,18 @@ public:
     int SnapImage() override;
     int Shutdown() override;
     int InsertImage() override;
+    using PyCameraClass::StartSequenceAcquisition;
+    int StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow) override;
+    int StopSequenceAcquisition() override;
+    bool IsCapturing() override;
     int ConnectMethods(const PyObj& methods) override;
 
 private:
+    void RefreshGeometry();
+    bool GetFrameLayout(const Py_buffer& frame, FrameLayout& layout);
+    int InsertFrame(const unsigned char* pixels, const FrameLayout& layout);
+    void StreamFrames(PyObj frames, long numImages);
+    void StopStream();
     void ReleaseBuffer()
     {
         PyLock lock;
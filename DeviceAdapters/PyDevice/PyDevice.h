@@ -108,38 +108,7 @@ public:
      * The Python class may perform hardware initialization in its __init__ function. After creating the Python object and initializing it, the function 'InitializeDevice' is called, which may be overridden e.g. to check if all required properties are present on the Python object (see PyCamera for an example).
      * @return MM error code 
     */
-    int Initialize() override
-    {
-        if (!initialized_)
-        {
-            auto deviceInfo = CPyHub::GetDeviceInfo(id_);
-            if (!deviceInfo)
-            {
-                string deviceType, deviceName;
-                CPyHub::SplitId(id_, deviceType, deviceName);
-                auto altId = CPyHub::ComposeId("Device",deviceName);
-                deviceInfo = CPyHub::GetDeviceInfo(altId);
-                if (!deviceInfo) {
-                    this->SetErrorText(
-                        ERR_PYTHON_RUNTIME_NOT_FOUND,
-                        ("Could not find the Python device id " + id_ +
-                            ". It may be that the Python script or the device object within it was renamed.").c_str());
-                    return ERR_PYTHON_RUNTIME_NOT_FOUND;
-                } else
-                {
-                    auto msg = "Did not recognize device type " + deviceType;
-                    this->CreateProperty("WARNING", msg.c_str(), MM::String, true, nullptr, false);
-                }
-            }
-            auto [properties, methods] = EnumerateProperties(deviceInfo, [this]() { return this->CheckError(); });
-            _check_(CheckError());
-            _check_(CreateProperties(properties));
-            _check_(ConnectMethods(methods));
-            _check_(this->UpdateStatus()); // load value of all properties from the Python object
-            initialized_ = true;
-        }
-        return DEVICE_OK;
-    }
+    int Initialize() override;
 
     long GetLongProperty(const char* property) const
     {
@@ -259,3 +228,38 @@ private:
     // Pointer to the current (only) active Hub, or nullptr if no Hub is active.
     static CPyHub* g_the_hub;
 };
+
+// Defined here because it needs the complete CPyHub class
+template <class BaseType>
+int CPyDeviceTemplate<BaseType>::Initialize()
+{
+    if (!initialized_)
+    {
+        auto deviceInfo = CPyHub::GetDeviceInfo(id_);
+        if (!deviceInfo)
+        {
+            string deviceType, deviceName;
+            CPyHub::SplitId(id_, deviceType, deviceName);
+            auto altId = CPyHub::ComposeId("Device",deviceName);
+            deviceInfo = CPyHub::GetDeviceInfo(altId);
+            if (!deviceInfo) {
+                this->SetErrorText(
+                    ERR_PYTHON_RUNTIME_NOT_FOUND,
+                    ("Could not find the Python device id " + id_ +
+                        ". It may be that the Python script or the device object within it was renamed.").c_str());
+                return ERR_PYTHON_RUNTIME_NOT_FOUND;
+            } else
+            {
+                auto msg = "Did not recognize device type " + deviceType;
+                this->CreateProperty("WARNING", msg.c_str(), MM::String, true, nullptr, false);
+            }
+        }
+        auto [properties, methods] = EnumerateProperties(deviceInfo, [this]() { return this->CheckError(); });
+        _check_(CheckError());
+        _check_(CreateProperties(properties));
+        _check_(ConnectMethods(methods));
+        _check_(this->UpdateStatus()); // load value of all properties from the Python object
+        initialized_ = true;
+    }
+    return DEVICE_OK;
+}
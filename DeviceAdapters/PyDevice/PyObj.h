@@ -48,7 +48,7 @@ public:
     }
 
     explicit PyObj(PyObject* obj);
-    PyObj(const PyObj& other) : p_(other ? other : nullptr) {
+    PyObj(const PyObj& other) : p_(other.p_) {
         if (p_) {
             PyLock lock;
             Py_INCREF(p_);
@@ -83,42 +83,6 @@ public:
     // note: if an error occurred during these functions, it will be logged in the g_errorMessage (also see CheckErrors) check for python 
     // note: the current thread must hold the GIL (see PyLock)
     template <class T> T as() const;
-    template <> long as<long>() const {
-        PyLock lock;
-        auto retval = PyLong_AsLong(*this);
-        if (retval == -1) // may be an error
-            ReportError();
-        return retval;
-    }
-    template <> bool as<bool>() const {
-        return p_ == Py_True;
-    }
-    template <> double as<double>() const {
-        if (p_ == Py_None)
-            return NAN;
-        PyLock lock;
-        auto retval = PyFloat_AsDouble(*this);
-        if (retval == -1.0) // may be an error
-            ReportError();
-        return retval;
-    }
-    template <> string as<string>() const {
-        PyLock lock;
-        if (auto as_str = PyObj(PyObject_Str(*this))) { // convert any object to a Python string by calling the str() function
-            if (auto as_bytes = PyObj(PyUnicode_AsUTF8String(as_str))) {
-                if (auto string_bytes = PyBytes_AsString(as_bytes)) {
-                    auto retval = string(string_bytes); // copies the string (before releasing lock)
-                    return retval;
-                }
-                else
-                    ReportError();
-            }
-        }
-        return string();
-    }
-    template <> PyObj as<PyObj>() const {
-        return *this;
-    }
     template <typename... Arguments> PyObj CallMember(const char* function, Arguments... arguments) const noexcept {
         PyLock lock;
         return Get(function).Call(arguments...);
@@ -238,3 +202,42 @@ public:
     }
 };
 
+// Conversions to primitive types. These are defined outside the class,
+// because explicit specializations in class scope are not accepted by all
+// compilers.
+template <> inline long PyObj::as<long>() const {
+    PyLock lock;
+    auto retval = PyLong_AsLong(*this);
+    if (retval == -1) // may be an error
+        ReportError();
+    return retval;
+}
+template <> inline bool PyObj::as<bool>() const {
+    return p_ == Py_True;
+}
+template <> inline double PyObj::as<double>() const {
+    if (p_ == Py_None)
+        return NAN;
+    PyLock lock;
+    auto retval = PyFloat_AsDouble(*this);
+    if (retval == -1.0) // may be an error
+        ReportError();
+    return retval;
+}
+template <> inline string PyObj::as<string>() const {
+    PyLock lock;
+    if (auto as_str = PyObj(PyObject_Str(*this))) { // convert any object to a Python string by calling the str() function
+        if (auto as_bytes = PyObj(PyUnicode_AsUTF8String(as_str))) {
+            if (auto string_bytes = PyBytes_AsString(as_bytes)) {
+                auto retval = string(string_bytes); // copies the string (before releasing lock)
+                return retval;
+            }
+            else
+                ReportError();
+        }
+    }
+    return string();
+}
+template <> inline PyObj PyObj::as<PyObj>() const {
+    return *this;
+}
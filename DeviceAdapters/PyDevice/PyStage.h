@@ -114,6 +114,10 @@ public:
         return DEVICE_UNSUPPORTED_COMMAND;
     }
 
+    int AddArrayToXYStageSequence(const double* /*positionsX*/, const double* /*positionsY*/, unsigned long /*count*/) override {
+        return DEVICE_UNSUPPORTED_COMMAND;
+    }
+
     int SendXYStageSequence() override {
         return DEVICE_UNSUPPORTED_COMMAND;
     }
@@ -0,0 +1,102 @@
+import array
+import queue
+import threading
+import time
+
+
+# Note: this example does not need numpy. Frames are passed to Micro-Manager through the buffer protocol.
+
+class StreamingCamera:
+    """Demo camera that produces frames on its own acquisition thread, as a frame grabber would.
+    During a sequence acquisition, PyDevice takes the frames from the iterator returned by `stream`."""
+
+    def __init__(self, left=0, top=0, width=100, height=100):
+        self._left = left
+        self._top = top
+        self._width = width
+        self._height = height
+        self._exposure_ms = 10.0
+        self._frame_count = 0
+        self._queue = queue.Queue()
+        self._stopped = threading.Event()
+
+    def _frame(self):
+        self._frame_count += 1
+        pixels = array.array('H', [self._frame_count % 65536]) * (self._width * self._height)
+        return memoryview(pixels).cast('B').cast('H', [self._height, self._width])
+
+    def read(self):
+        time.sleep(0.001 * self._exposure_ms)
+        return self._frame()
+
+    def stream(self):
+        def acquire():
+            while not self._stopped.is_set():
+                time.sleep(0.001 * self._exposure_ms)
+                self._queue.put(self._frame())
+
+        self._queue = queue.Queue()
+        self._stopped.clear()
+        threading.Thread(target=acquire, daemon=True).start()
+        return iter(self._queue.get, None)
+
+    def stop_stream(self):
+        self._stopped.set()
+        self._queue.put(None)  # wakes up the iterator if it is waiting for a frame
+
+    def busy(self):
+        return False
+
+    @property
+    def left(self) -> int:
+        return self._left
+
+    @left.setter
+    def left(self, value: int):
+        self._left = value
+
+    @property
+    def top(self) -> int:
+        return self._top
+
+    @top.setter
+    def top(self, value: int):
+        self._top = value
+
+    @property
+    def width(self) -> int:
+        return self._width
+
+    @width.setter
+    def width(self, value: int):
+        self._width = value
+
+    @property
+    def height(self) -> int:
+        return self._height
+
+    @height.setter
+    def height(self, value: int):
+        self._height = value
+
+    @property
+    def exposure_ms(self) -> float:
+        return self._exposure_ms
+
+    @exposure_ms.setter
+    def exposure_ms(self, value):
+        self._exposure_ms = float(value)
+
+
+devices = {'cam': StreamingCamera()}
+
+if __name__ == "__main__":
+    import sys
+    import os
+
+    sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    from bootstrap import PyDevice
+
+    device = PyDevice(devices['cam'])
+    print(device)
+    assert device.device_type == 'Camera'
@@ -8,8 +8,13 @@
 #include <functional>
 #include <filesystem>
 #include <regex>
+#include <variant>
+#include <thread>
+#include <atomic>
 
+#ifdef _MSC_VER
 #pragma warning(disable: 5040) // disable warning we get because we are using C++17 for compilation.
+#endif
 #include <DeviceBase.h> // all MM includes
 namespace fs = std::filesystem;
 using std::string;
@@ -37,11 +42,11 @@ inline bool FileExists(const fs::path& path) noexcept {
 #define ERR_PYTHON_EXCEPTION 105
 #define _check_(expression) if (auto result=(expression); result != DEVICE_OK) return result
 
-#include <windows.h>
-
+#ifdef _WIN32
 // note: we are not actually using python39.dll, only linking against its import library
 // when executing, the delay load mechanism loads the correct dll (e.g. python311.dll)
 //
 #pragma comment(lib, "python39")
 #pragma comment(lib, "delayimp")
 #pragma comment(lib, "user32")
+#endif
@@ -1,9 +1,14 @@
 #include "pch.h"
 
+#ifdef _WIN32
 HMODULE pythonDll = nullptr; // handle to loaded python3xx.dll
+const std::regex filenamePattern(R"(python3[0-9]+\.dll)", std::regex_constants::icase);
+#else
+#include <dlfcn.h>
+void* pythonLib = nullptr; // handle to the libpython3.x.so that the adapter is linked against
+#endif
 PyThreadState* g_threadState = nullptr; // pointer to the thread state
 
-const std::regex filenamePattern(R"(python3[0-9]+\.dll)", std::regex_constants::icase);
 std::regex key_value(R"(home\s*=\s*(.+?)\s*$)");
 
 PyObject* Py_None = nullptr;
@@ -37,6 +42,7 @@ fs::path TryParsePyvenv(const fs::path& venv) noexcept
     return {}; // pyvenv.cfg did not contain a 'home', we cannot use it
 }
 
+#ifdef _WIN32
 // Hook for the delay-loading the python dll. Instead of loading the dll, we return a handle to the pre-loaded dll
 // which may be different from python39.dll (e.g. python311.dll)
 FARPROC WINAPI delayHook(unsigned dliNotify, PDelayLoadInfo pdli) {
@@ -46,6 +52,7 @@ FARPROC WINAPI delayHook(unsigned dliNotify, PDelayLoadInfo pdli) {
 }
 
 ExternC const PfnDliHook __pfnDliNotifyHook2 = delayHook;
+#endif
 
 
 /**
@@ -94,6 +101,7 @@ fs::path SetupPaths(fs::path& venv, bool search)
 
     venv.clear(); // we could not locate a virtual environment
 
+#ifdef _WIN32
     // option 3: check the PYTHONHOME environmental variable
     // in this case, there is no virtual environment
     if (auto pythonHomeVariable = _wgetenv(L"PYTHONHOME"))
@@ -113,12 +121,14 @@ fs::path SetupPaths(fs::path& venv, bool search)
         FreeLibrary(handle);
         return pythonHome;
     }
+#endif
 
     return {};
 }
 
 
 
+#ifdef _WIN32
 /**
  * \brief Locates and loads the python3xx.dll runtime library
  * \param venv location of the virtual environment to use. When 'search' = true, 'venv' may be updated to the location the virtual environment was found.
@@ -185,4 +195,59 @@ fs::path InitializePython(fs::path& venv, bool search) noexcept
 
     return dllPath;
 }
+#else
+/**
+ * \brief Prepares the libpython3.x runtime library that the adapter is linked against, and starts the interpreter
+ *
+ * On Linux, the Python version is fixed at build time. The virtual environment (located as on Windows, see SetupPaths)
+ * only determines which site-packages are used. If no virtual environment is found while searching, the system
+ * installation is used.
+ *
+ * \returns The path of the Python shared library, or an empty path if it could not be set up
+ */
+fs::path InitializePython(fs::path& venv, bool search) noexcept
+{
+    Dl_info info;
+    if (!dladdr(reinterpret_cast<void*>(&Py_IsInitialized), &info) || !info.dli_fname)
+        return {};
+
+    // The core loads this adapter with local symbol visibility, so that libpython is not visible to extension
+    // modules such as numpy, which expect the Python API to be available globally. Reopen it as global.
+    if (!pythonLib)
+        pythonLib = dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD | RTLD_GLOBAL);
+    if (!pythonLib)
+        return {};
+
+    Py_None = reinterpret_cast<PyObject*>(dlsym(pythonLib, "_Py_NoneStruct"));
+    Py_True = reinterpret_cast<PyObject*>(dlsym(pythonLib, "_Py_TrueStruct"));
+    Py_False = reinterpret_cast<PyObject*>(dlsym(pythonLib, "_Py_FalseStruct"));
+    if (Py_None == nullptr || Py_False == nullptr || Py_True == nullptr)
+        return {};
+
+    try {
+        if (SetupPaths(venv, search).empty() && !search)
+            return {}; // the specified folder is not a virtual environment
+    }
+    catch (const fs::filesystem_error&)
+    {
+        return {};
+    }
+
+    if (!Py_IsInitialized()) {
+        if (!venv.empty())
+        {
+            // Python keeps a pointer to the program name
+            static std::wstring program;
+            program = (venv / "bin" / "python").wstring();
+            Py_SetProgramName(program.c_str());
+        }
+        Py_InitializeEx(0);
+
+        // enable multi-threading
+        if (!g_threadState)
+            g_threadState = PyEval_SaveThread();
+    }
 
+    return info.dli_fname;
+}
+#endif
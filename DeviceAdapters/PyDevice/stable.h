@@ -1,6 +1,11 @@
 #pragma once
 #include <cstdint>
 #include <filesystem>
+#ifndef _WIN32
+// The declarations in this file are written for the Windows import library.
+// Elsewhere, the symbols are resolved from libpython by the dynamic linker.
+#define __declspec(x)
+#endif
 namespace fs = std::filesystem;
 fs::path InitializePython(fs::path& venv, bool search) noexcept;
 
@@ -36,3 +36,20 @@ def test_microscope():
     mmc.loadSystemConfiguration("microscope.cfg")
     mmc.snapImage()
     frame = mmc.getImage()
+
+
+def test_streaming_camera():
+    mmc = pymmcore.CMMCore()
+    mmc.setDeviceAdapterSearchPaths([mm_dir])
+    mmc.loadSystemConfiguration("streaming_camera.cfg")
+    mmc.setProperty("cam", "Exposure-ms", 1.0)
+    mmc.snapImage()
+    mmc.startSequenceAcquisition(10, 0.0, True)
+    while mmc.isSequenceRunning():
+        pass
+    assert mmc.getRemainingImageCount() == 10
+    mmc.startContinuousSequenceAcquisition(0.0)
+    while mmc.getRemainingImageCount() < 20:
+        pass
+    mmc.stopSequenceAcquisition()
+    assert not mmc.isSequenceRunning()
@@ -27,11 +27,15 @@
 
 #include <boost/asio.hpp>
 #include <boost/asio/serial_port.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <exception>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -60,6 +64,10 @@ public:
       active_(true),
       io_service_(ioService),
       serialPortImplementation_(ioService, nativeHandle),
+      charTimer_(ioService),
+      writeInProgress_(false),
+      writeGeneration_(0),
+      pendingWrites_(0),
       pSerialPortAdapter_(pPort),
       device_(deviceName),
       shutDownInProgress_(false)
@@ -79,6 +87,10 @@ public:
       active_(true),
       io_service_(ioService),
       serialPortImplementation_(ioService, deviceName),
+      charTimer_(ioService),
+      writeInProgress_(false),
+      writeGeneration_(0),
+      pendingWrites_(0),
       pSerialPortAdapter_(pPort),
       device_(deviceName),
       shutDownInProgress_(false)
@@ -249,15 +261,27 @@ public:
 
    }
 
-   void WriteOneCharacterAsynchronously(const char ch)
+   void WriteCharactersAsynchronously(const char* pmsg, size_t len)
    {
-      io_service_.post(boost::bind(&AsioClient::DoWriteCh, this, ch));
+      PendingWrite msg;
+      msg.data.assign(pmsg, pmsg + len);
+      msg.offset = 0;
+      msg.charInterval = std::chrono::steady_clock::duration::zero();
+      PostWrite(msg);
    }
 
-   void WriteCharactersAsynchronously(const char* pmsg, size_t len)
+   // Write the characters one at a time, each followed by a pause of
+   // charIntervalMs. The characters are timed on the io_service thread
+   // against a single schedule, so that rounding and write overhead do not
+   // accumulate over the message.
+   void WriteCharactersPaced(const char* pmsg, size_t len, double charIntervalMs)
    {
-      std::vector<char> msg(pmsg, pmsg + len);
-      io_service_.post(boost::bind(&AsioClient::DoWriteMsg, this, msg));
+      PendingWrite msg;
+      msg.data.assign(pmsg, pmsg + len);
+      msg.offset = 0;
+      msg.charInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(charIntervalMs));
+      PostWrite(msg);
    }
 
 
@@ -309,10 +333,14 @@ public:
       }
 
       // clear write buffer
+      size_t purged;
       {
          MMThreadGuard g(writeBufferLock_);
+         purged = write_msgs_.size();
          write_msgs_.clear(); // buffered write data
+         ++writeGeneration_; // completions of the purged writes are ignored
       }
+      WritesFinished(purged);
    }
 
 
@@ -330,6 +358,39 @@ public:
       return retval;
    }
 
+   // Wait until at least one character is available, or the timeout expires.
+   // Returns true if data is available.
+   bool WaitForData(long timeoutMs)
+   {
+      return WaitForDataUntil(std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(timeoutMs));
+   }
+
+   bool WaitForDataUntil(std::chrono::steady_clock::time_point deadline)
+   {
+      std::unique_lock<std::mutex> lock(dataArrivedMutex_);
+      while (!HasData())
+      {
+         if (dataArrivedCv_.wait_until(lock, deadline) == std::cv_status::timeout)
+            return HasData();
+      }
+      return true;
+   }
+
+   // Wait until all queued writes have been transmitted (including the
+   // pauses of paced writes), or the deadline passes. Returns true if nothing
+   // is left to write.
+   bool WaitForWritesUntil(std::chrono::steady_clock::time_point deadline)
+   {
+      std::unique_lock<std::mutex> lock(writesFinishedMutex_);
+      while (pendingWrites_ > 0)
+      {
+         if (writesFinishedCv_.wait_until(lock, deadline) == std::cv_status::timeout)
+            return pendingWrites_ == 0;
+      }
+      return true;
+   }
+
    void ShutDownInProgress(const bool v){ shutDownInProgress_ = v;};
 
 
@@ -340,6 +401,22 @@ private:
    void LogMessage(const char* msg, bool debug) const
    { pSerialPortAdapter_->LogMessage(msg, debug); }
 
+   bool HasData()
+   {
+      MMThreadGuard g(readBufferLock_);
+      return !data_read_.empty();
+   }
+
+   void NotifyDataArrived()
+   {
+      // Taking the mutex ensures a waiter cannot miss the notification
+      // between checking for data and starting to wait
+      {
+         std::lock_guard<std::mutex> lock(dataArrivedMutex_);
+      }
+      dataArrivedCv_.notify_all();
+   }
+
    static const int max_read_length = 512; // maximum amount of data to read in one operation
    void ReadStart()
    { // Start an asynchronous read and call ReadComplete when it completes or fails
@@ -369,7 +446,7 @@ private:
                data_read_.push_back(read_msg_[ib]);
             }
          }
-         CDeviceUtils::SleepMs(1);
+         NotifyDataArrived();
          ReadStart(); // start waiting for another asynchronous read again
       }
       else
@@ -385,39 +462,84 @@ private:
 
 
    // for asynchronous write operations:
-   void DoWriteMsg(const std::vector<char>& msg)
+   struct PendingWrite
+   {
+      std::vector<char> data;
+      size_t offset; // characters written so far
+      std::chrono::steady_clock::duration charInterval; // zero to write all at once
+   };
+
+   void PostWrite(const PendingWrite& msg)
+   {
+      {
+         std::lock_guard<std::mutex> lock(writesFinishedMutex_);
+         ++pendingWrites_;
+      }
+      io_service_.post(boost::bind(&AsioClient::DoWriteMsg, this, msg));
+   }
+
+   void WritesFinished(size_t count)
+   {
+      std::lock_guard<std::mutex> lock(writesFinishedMutex_);
+      pendingWrites_ -= count;
+      if (pendingWrites_ == 0)
+         writesFinishedCv_.notify_all();
+   }
+
+   void DoWriteMsg(const PendingWrite& msg)
    { // callback to handle write call from outside this class
       MMThreadGuard writeBufferGuard(writeBufferLock_);
-      bool write_in_progress = !write_msgs_.empty(); // is there anything currently being written?
       write_msgs_.push_back(msg); // store in write buffer
 
-      if (!write_in_progress) // if nothing is currently being written, then start
+      if (!writeInProgress_) // if nothing is currently being written, then start
          WriteStart();
    }
 
-   void DoWriteCh(const char ch)
-   {
-      std::vector<char> msg(1, ch);
-      DoWriteMsg(msg);
-   }
-
    // Must be called with writeBufferLock_ acquired!
    void WriteStart()
    { // Start an asynchronous write and call WriteComplete when it completes or fails
+      PendingWrite& msg = write_msgs_.front();
+      size_t count = msg.data.size() - msg.offset;
+      if (msg.charInterval > std::chrono::steady_clock::duration::zero())
+      {
+         if (msg.offset == 0)
+            nextCharTime_ = std::chrono::steady_clock::now();
+         count = 1;
+      }
+      writeInProgress_ = true;
       boost::asio::async_write(serialPortImplementation_,
-         boost::asio::buffer(&write_msgs_.front()[0], write_msgs_.front().size()),
+         boost::asio::buffer(&msg.data[msg.offset], count),
          boost::bind(&AsioClient::WriteComplete,
          this,
-         boost::asio::placeholders::error));
+         boost::asio::placeholders::error,
+         boost::asio::placeholders::bytes_transferred,
+         writeGeneration_));
    }
 
-   void WriteComplete(const boost::system::error_code& error)
+   void WriteComplete(const boost::system::error_code& error, size_t bytes_transferred,
+         unsigned long generation)
    { // the asynchronous read operation has now completed or failed and returned an error
       if (!error)
       { // write completed, so send next write data
          MMThreadGuard writeBufferGuard(writeBufferLock_);
-         if (0 < write_msgs_.size()) // Should always be true, unless purged
+         writeInProgress_ = false;
+         if (generation == writeGeneration_) // otherwise, the data was purged
+         {
+            PendingWrite& msg = write_msgs_.front();
+            msg.offset += bytes_transferred;
+            if (msg.charInterval > std::chrono::steady_clock::duration::zero())
+            {
+               // Pause until the next character is due
+               nextCharTime_ += msg.charInterval;
+               writeInProgress_ = true;
+               charTimer_.expires_at(nextCharTime_);
+               charTimer_.async_wait(boost::bind(&AsioClient::CharIntervalElapsed,
+                  this, boost::asio::placeholders::error, generation));
+               return;
+            }
             write_msgs_.pop_front(); // remove the completed data
+            WritesFinished(1);
+         }
          if (!write_msgs_.empty()) // if there is anthing left to be written
             WriteStart(); // then start sending the next item in the buffer
       }
@@ -428,6 +550,22 @@ private:
       }
    }
 
+   void CharIntervalElapsed(const boost::system::error_code& error, unsigned long generation)
+   {
+      if (error) // the port is being closed
+         return;
+      MMThreadGuard writeBufferGuard(writeBufferLock_);
+      writeInProgress_ = false;
+      if (generation == writeGeneration_ &&
+            write_msgs_.front().offset == write_msgs_.front().data.size())
+      {
+         write_msgs_.pop_front();
+         WritesFinished(1);
+      }
+      if (!write_msgs_.empty())
+         WriteStart();
+   }
+
 
 
    void DoClose(const boost::system::error_code& error)
@@ -461,7 +599,14 @@ private:
    boost::asio::io_service& io_service_; // the main IO service that runs this connection
    boost::asio::serial_port serialPortImplementation_; // the serial port this instance is connected to
    char read_msg_[max_read_length]; // data read from the socket
-   std::deque< std::vector<char> > write_msgs_; // buffered write data
+   std::deque<PendingWrite> write_msgs_; // buffered write data
+   boost::asio::steady_timer charTimer_; // paces the characters of paced writes
+   std::chrono::steady_clock::time_point nextCharTime_;
+   bool writeInProgress_; // an asynchronous write or character pause is pending
+   unsigned long writeGeneration_; // incremented by Purge()
+   std::mutex writesFinishedMutex_;
+   std::condition_variable writesFinishedCv_;
+   size_t pendingWrites_; // posted writes that have not been finished or purged
    std::deque<char> data_read_;
    SerialPort* pSerialPortAdapter_;
    std::string device_;
@@ -469,5 +614,7 @@ private:
    MMThreadLock readBufferLock_;
    MMThreadLock writeBufferLock_;
    MMThreadLock implementationLock_;
+   std::mutex dataArrivedMutex_;
+   std::condition_variable dataArrivedCv_;
    bool shutDownInProgress_;
 };
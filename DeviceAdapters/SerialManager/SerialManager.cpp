@@ -44,13 +44,19 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/thread.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 
 SerialManager g_serialManager;
 
 std::vector<std::string> g_BlockListedPorts;
+
+// Earliest time at which a recently closed port may be opened again (see
+// SerialPort::Shutdown())
+std::map<std::string, std::chrono::steady_clock::time_point> g_PortReopenTimes;
 std::vector<std::string> g_PortList;
 time_t g_PortListLastUpdated = 0;
 
@@ -89,6 +95,15 @@ const char* g_Parity_Even = "Even";
 const char* g_Parity_Mark = "Mark";
 const char* g_Parity_Space = "Space";
 
+enum AnswerStatistic
+{
+   AnswerStatisticCount,
+   AnswerStatisticTimeouts,
+   AnswerStatisticLastMs,
+   AnswerStatisticMeanMs,
+   AnswerStatisticMaxMs,
+};
+
 
 /*
  * Tests whether given serial port can be used by opening it
@@ -367,7 +382,13 @@ SerialPort::SerialPort(const char* portName) :
    pService_(0),
    pPort_(0),
    pThread_(0),
-   verbose_(true)
+   verbose_(true),
+   awaitingAnswer_(false),
+   answerCount_(0),
+   answerTimeoutCount_(0),
+   lastAnswerMs_(0.0),
+   totalAnswerMs_(0.0),
+   maxAnswerMs_(0.0)
 #ifdef WIN32
    ,
    dtrEnable_(false),
@@ -479,6 +500,20 @@ SerialPort::SerialPort(const char* portName) :
    (void)CreateProperty("Verbose", (verbose_?"1":"0"), MM::Integer, false, pActTD, true);
    AddAllowedValue("Verbose", "0");
    AddAllowedValue("Verbose", "1");
+
+   // answer latency statistics: time from the last write to the complete
+   // answer (or from the start of GetAnswer, if nothing was written since
+   // the previous answer)
+   CPropertyActionEx* pActEx = new CPropertyActionEx(this, &SerialPort::OnAnswerStatistic, AnswerStatisticCount);
+   (void)CreateIntegerProperty("AnswerLatency-Count", 0, true, pActEx);
+   pActEx = new CPropertyActionEx(this, &SerialPort::OnAnswerStatistic, AnswerStatisticTimeouts);
+   (void)CreateIntegerProperty("AnswerLatency-Timeouts", 0, true, pActEx);
+   pActEx = new CPropertyActionEx(this, &SerialPort::OnAnswerStatistic, AnswerStatisticLastMs);
+   (void)CreateFloatProperty("AnswerLatency-LastMs", 0.0, true, pActEx);
+   pActEx = new CPropertyActionEx(this, &SerialPort::OnAnswerStatistic, AnswerStatisticMeanMs);
+   (void)CreateFloatProperty("AnswerLatency-MeanMs", 0.0, true, pActEx);
+   pActEx = new CPropertyActionEx(this, &SerialPort::OnAnswerStatistic, AnswerStatisticMaxMs);
+   (void)CreateFloatProperty("AnswerLatency-MaxMs", 0.0, true, pActEx);
 }
 
 SerialPort::~SerialPort()
@@ -522,6 +557,24 @@ int SerialPort::Initialize()
    ret = GetCurrentPropertyData(MM::g_Keyword_Handshaking, handshake);
    assert(ret == DEVICE_OK);
 
+   std::map<std::string, std::chrono::steady_clock::time_point>::iterator reopen =
+      g_PortReopenTimes.find(portName_);
+   if (reopen != g_PortReopenTimes.end())
+   {
+      std::this_thread::sleep_until(reopen->second);
+      g_PortReopenTimes.erase(reopen);
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(statsMutex_);
+      answerCount_ = 0;
+      answerTimeoutCount_ = 0;
+      lastAnswerMs_ = 0.0;
+      totalAnswerMs_ = 0.0;
+      maxAnswerMs_ = 0.0;
+   }
+   awaitingAnswer_ = false;
+
    pService_ = new boost::asio::io_service();
 
    try
@@ -689,20 +742,18 @@ int SerialPort::Shutdown()
    if (!initialized_)
       return DEVICE_OK;
 
+   std::chrono::steady_clock::time_point closeTime = std::chrono::steady_clock::now();
    if( 0 != pPort_)
    {
       pPort_->ShutDownInProgress(true);
-      CDeviceUtils::SleepMs(100);
+      // Let queued writes go out, but do not wait for them indefinitely
+      pPort_->WaitForWritesUntil(closeTime + std::chrono::milliseconds(100));
+      closeTime = std::chrono::steady_clock::now();
       pPort_->Close();
    }
 
    if( 0 != pThread_)
    {
-      // Theoretically we shouldn't need to sleep here, but skipping this
-      // exacerbates the gh-1254 problem described below. 40 ms was sufficient
-      // in testing; 30 ms was only partially effective; using 80 ms to be safe.
-      CDeviceUtils::SleepMs(80);
-
       // Joining the async thread ensures that all asio resources are closed.
 	  // This may last several seconds!
       if (!pThread_->timed_join(boost::posix_time::millisec(10000) )) {
@@ -715,11 +766,11 @@ int SerialPort::Shutdown()
          // closed. But immediately reopening the port can cause sporadic
          // failures under some conditions (Windows, FTDI USB-serial).
          // See issue gh-1254.
-         // In my testing, a 40 ms sleep slightly decreased the chance of
-         // failure, and 50 ms eliminated it. Using 100 ms to add a safety
-         // margin. (If the sleep before the join is skipped, even 100 ms here
-         // was not enough to eliminate failure.)
-         CDeviceUtils::SleepMs(100);
+         // In testing, this took a pause of 80 ms between closing and
+         // joining, plus 100 ms after joining. Only reopening needs the
+         // pause, so instead of sleeping here, Initialize() waits until
+         // 180 ms after the close.
+         g_PortReopenTimes[portName_] = closeTime + std::chrono::milliseconds(180);
       }
    }
    initialized_ = false;
@@ -759,14 +810,13 @@ int SerialPort::SetCommand(const char* command, const char* term)
    if (transmitCharWaitMs_ < 0.001)
    {
       pPort_->WriteCharactersAsynchronously(sendText.c_str(), sendText.length());
+      WriteQueued();
    }
    else
    {
-      for (std::string::iterator jj = sendText.begin(); jj != sendText.end(); ++jj)
-      {
-         pPort_->WriteOneCharacterAsynchronously(*jj);
-         CDeviceUtils::SleepMs(static_cast<long>(0.5 + transmitCharWaitMs_));
-      }
+      int ret = WritePaced(sendText.c_str(), sendText.length());
+      if (ret != DEVICE_OK)
+         return ret;
    }
 
    LogAsciiCommunication("SetCommand", false, sendText);
@@ -789,63 +839,68 @@ int SerialPort::GetAnswer(char* answer, unsigned bufLen, const char* term)
    memset(answer,0,bufLen);
    char theData = 0;
 
-   MM::MMTime startTime = GetCurrentMMTime();
-   MM::MMTime answerTimeout(answerTimeoutMs_ * 1000.0);
-   MM::MMTime nonTerminatedAnswerTimeout(5.0 * 1000.0); // For bug-compatibility
-   while ((GetCurrentMMTime() - startTime)  < answerTimeout)
-   {
-      bool anyRead =  pPort_->ReadOneCharacter(theData);
-      if (anyRead)
+   const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+   const std::chrono::steady_clock::time_point latencyStart =
+      awaitingAnswer_ ? lastWriteTime_ : startTime;
+   const std::chrono::steady_clock::time_point deadline = startTime +
+      std::chrono::microseconds(static_cast<long long>(answerTimeoutMs_ * 1000.0));
+   const bool hasTerm = term && term[0];
+   const std::size_t termLen = hasTerm ? strlen(term) : 0;
+
+   // XXX Shouldn't it be an error to not have a terminator?
+   // TODO Make it a precondition check (immediate error) once we've made
+   // sure that no device adapter calls us without a terminator. For now,
+   // keep the behavior for the sake of bug-compatibility: return whatever
+   // arrived after 5 s.
+   const std::chrono::steady_clock::time_point nonTerminatedDeadline =
+      startTime + std::chrono::seconds(5);
+
+   for (;;)
+   {
+      while (pPort_->ReadOneCharacter(theData))
       {
          if (bufLen <= answerOffset)
          {
-            answer[answerOffset] = '\0';
+            answer[bufLen - 1] = '\0';
             LogMessage("BUFFER_OVERRUN error occured!");
             return ERR_BUFFER_OVERRUN;
          }
          answer[answerOffset++] = theData;
-      }
-      else
-      {
-         //Yield to other threads:
-         CDeviceUtils::SleepMs(1);
-      }
 
-      // look for the terminator, if any
-      if (term && term[0])
-      {
-         // check for terminating sequence
-         char* termPos = strstr(answer, term);
-         if (termPos != 0) // found the terminator
+         // check for terminating sequence; stop reading there, so that any
+         // following data is left for the next call
+         if (hasTerm && answerOffset >= termLen &&
+               memcmp(answer + answerOffset - termLen, term, termLen) == 0)
          {
             LogAsciiCommunication("GetAnswer", true, answer);
 
             // erase the terminator from the answer:
-            *termPos = '\0';
+            answer[answerOffset - termLen] = '\0';
 
+            RecordAnswer(latencyStart, false);
             return DEVICE_OK;
          }
       }
-      else
-      {
-         // XXX Shouldn't it be an error to not have a terminator?
-         // TODO Make it a precondition check (immediate error) once we've made
-         // sure that no device adapter calls us without a terminator. For now,
-         // keep the behavior for the sake of bug-compatibility.
 
-         MM::MMTime elapsed = GetCurrentMMTime() - startTime;
-         if (elapsed > nonTerminatedAnswerTimeout)
-         {
-            LogAsciiCommunication("GetAnswer", true, answer);
-            long millisecs = static_cast<long>(elapsed.getMsec());
-            LogMessage(("GetAnswer without terminator returning after " +
-                     boost::lexical_cast<std::string>(millisecs) +
-                     "msec").c_str(), true);
-            return DEVICE_OK;
-         }
+      const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if (now >= deadline)
+         break;
+      if (!hasTerm && now >= nonTerminatedDeadline)
+      {
+         LogAsciiCommunication("GetAnswer", true, answer);
+         long millisecs = static_cast<long>(
+               std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count());
+         LogMessage(("GetAnswer without terminator returning after " +
+                  boost::lexical_cast<std::string>(millisecs) +
+                  "msec").c_str(), true);
+         RecordAnswer(latencyStart, false);
+         return DEVICE_OK;
       }
+
+      pPort_->WaitForDataUntil(hasTerm ? deadline : (std::min)(deadline, nonTerminatedDeadline));
    }
 
+   RecordAnswer(latencyStart, true);
    LogMessage("TERM_TIMEOUT error occured!");
    return ERR_TERM_TIMEOUT;
 }
@@ -863,14 +918,13 @@ int SerialPort::Write(const unsigned char* buf, unsigned long bufLen)
    if (transmitCharWaitMs_ < 0.001)
    {
       pPort_->WriteCharactersAsynchronously(reinterpret_cast<const char*>(buf), bufLen);
+      WriteQueued();
    }
    else
    {
-      for (size_t i = 0; i < bufLen; ++i)
-      {
-         pPort_->WriteOneCharacterAsynchronously(buf[i]);
-         CDeviceUtils::SleepMs(static_cast<long>(0.5 + transmitCharWaitMs_));
-      }
+      int ret = WritePaced(reinterpret_cast<const char*>(buf), bufLen);
+      if (ret != DEVICE_OK)
+         return ret;
    }
 
    if (verbose_)
@@ -929,6 +983,66 @@ int SerialPort::Read(unsigned char* buf, unsigned long bufLen, unsigned long& ch
    return r;
 }
 
+/**
+ * Blocks until data arrives (or timeoutMs passes) and then reads it, so that
+ * callers need not poll Read().
+ */
+int SerialPort::ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs)
+{
+   if (!initialized_)
+      return ERR_PORT_NOTINITIALIZED;
+
+   pPort_->WaitForData(timeoutMs);
+   return Read(buf, bufLen, charsRead);
+}
+
+/**
+ * Writes the characters DelayBetweenCharsMs apart, and returns once the last
+ * character and the pause after it are done, as devices that need the delay
+ * expect the next command to be paced as well.
+ */
+int SerialPort::WritePaced(const char* buf, std::size_t len)
+{
+   const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+   pPort_->WriteCharactersPaced(buf, len, transmitCharWaitMs_);
+   WriteQueued();
+
+   // Allow for handshaking holding up the transmission as long as the answer
+   // timeout
+   const std::chrono::steady_clock::time_point deadline = start +
+      std::chrono::microseconds(static_cast<long long>(
+               1000.0 * (len * transmitCharWaitMs_ + answerTimeoutMs_)));
+   if (!pPort_->WaitForWritesUntil(deadline))
+   {
+      LogMessage("Timed out waiting for paced characters to be transmitted");
+      return ERR_TRANSMIT_FAILED;
+   }
+   return DEVICE_OK;
+}
+
+void SerialPort::WriteQueued()
+{
+   lastWriteTime_ = std::chrono::steady_clock::now();
+   awaitingAnswer_ = true;
+}
+
+void SerialPort::RecordAnswer(std::chrono::steady_clock::time_point start, bool timedOut)
+{
+   awaitingAnswer_ = false;
+   const double ms = std::chrono::duration<double, std::milli>(
+         std::chrono::steady_clock::now() - start).count();
+   std::lock_guard<std::mutex> lock(statsMutex_);
+   if (timedOut)
+   {
+      ++answerTimeoutCount_;
+      return;
+   }
+   ++answerCount_;
+   lastAnswerMs_ = ms;
+   totalAnswerMs_ += ms;
+   maxAnswerMs_ = (std::max)(maxAnswerMs_, ms);
+}
+
 int SerialPort::Purge()
 {
    if (!initialized_)
@@ -1094,6 +1208,35 @@ int SerialPort::OnVerbose(MM::PropertyBase* pProp, MM::ActionType eAct)
 }
 
 
+int SerialPort::OnAnswerStatistic(MM::PropertyBase* pProp, MM::ActionType eAct, long statistic)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      std::lock_guard<std::mutex> lock(statsMutex_);
+      switch (statistic)
+      {
+         case AnswerStatisticCount:
+            pProp->Set(answerCount_);
+            break;
+         case AnswerStatisticTimeouts:
+            pProp->Set(answerTimeoutCount_);
+            break;
+         case AnswerStatisticLastMs:
+            pProp->Set(lastAnswerMs_);
+            break;
+         case AnswerStatisticMeanMs:
+            pProp->Set(answerCount_ > 0 ? totalAnswerMs_ / answerCount_ : 0.0);
+            break;
+         case AnswerStatisticMaxMs:
+            pProp->Set(maxAnswerMs_);
+            break;
+      }
+   }
+
+   return DEVICE_OK;
+}
+
+
 int SerialPort::OnDelayBetweenCharsMs(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
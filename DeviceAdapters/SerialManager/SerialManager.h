@@ -41,8 +41,10 @@
 #include <boost/asio/serial_port.hpp>
 #include <boost/thread.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -88,6 +90,7 @@ public:
    int GetAnswer(char* answer, unsigned bufLength, const char* term);
    int Write(const unsigned char* buf, unsigned long bufLen);
    int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
+   int ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs);
    MM::PortType GetPortType() const {return MM::SerialPort;}
    int Purge();
 
@@ -113,6 +116,7 @@ public:
    int OnTimeout(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnDelayBetweenCharsMs(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnVerbose(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnAnswerStatistic(MM::PropertyBase* pProp, MM::ActionType eAct, long statistic);
 
    void AddReference() {refCount_++;}
    void RemoveReference() {refCount_--;}
@@ -147,6 +151,19 @@ private:
    boost::thread* pThread_;
    bool verbose_; // if false, turn off LogBinaryMessage even in Debug Log
 
+   // Time of the last write that has not been answered yet, for the answer
+   // latency statistics
+   std::chrono::steady_clock::time_point lastWriteTime_;
+   bool awaitingAnswer_;
+
+   // Answer latency statistics, published as read-only properties
+   std::mutex statsMutex_;
+   long answerCount_;
+   long answerTimeoutCount_;
+   double lastAnswerMs_;
+   double totalAnswerMs_;
+   double maxAnswerMs_;
+
 
 #ifdef _WIN32
    bool dtrEnable_; // currently only used on Windows
@@ -155,6 +172,9 @@ private:
    int OnDTR(MM::PropertyBase* pProp, MM::ActionType eAct);
    int OnFastUSB2Serial(MM::PropertyBase* pProp, MM::ActionType eAct);
 #endif
+   int WritePaced(const char* buf, std::size_t len);
+   void WriteQueued();
+   void RecordAnswer(std::chrono::steady_clock::time_point start, bool timedOut);
    void LogAsciiCommunication(const char* prefix, bool isInput, const std::string& content);
    void LogBinaryCommunication(const char* prefix, bool isInput, const unsigned char* content, std::size_t length);
 };
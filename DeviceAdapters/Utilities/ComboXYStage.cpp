@@ -82,6 +82,7 @@ int ComboXYStage::Initialize()
    for (int i = 0; i < 2; ++i)
    {
       usedStages_.push_back(g_Undefined);
+      stageHandles_.push_back(0);
       stageScalings_.push_back(1.0);
       stageTranslations_.push_back(0.0);
    }
@@ -132,6 +133,7 @@ int ComboXYStage::Shutdown()
       return DEVICE_OK;
 
    usedStages_.clear();
+   stageHandles_.clear();
    stageScalings_.clear();
    stageTranslations_.clear();
 
@@ -139,14 +141,19 @@ int ComboXYStage::Shutdown()
 }
 
 
+MM::Stage* ComboXYStage::GetPhysicalStage(unsigned xy) const
+{
+   if (usedStages_[xy] == g_Undefined)
+      return 0;
+   return static_cast<MM::Stage*>(GetDevice(usedStages_[xy].c_str(), stageHandles_[xy]));
+}
+
+
 bool ComboXYStage::Busy()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -163,12 +170,9 @@ int ComboXYStage::Stop()
    // axes.
    int ret = DEVICE_OK;
 
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -183,12 +187,9 @@ int ComboXYStage::Stop()
 
 int ComboXYStage::Home()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -208,7 +209,7 @@ int ComboXYStage::SetPositionSteps(long x, long y)
    {
       const long posSteps = (i == 0) ? x : y;
 
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -232,7 +233,7 @@ int ComboXYStage::GetPositionSteps(long& x, long& y)
       const double& simulatedStepSizeUm = (i == 0) ?
          simulatedXStepSizeUm_ : simulatedYStepSizeUm_;
 
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
       {
          // We can't make this an error because stage position is frequently
@@ -264,7 +265,7 @@ int ComboXYStage::GetLimitsUm(double& xMin, double& xMax, double& yMin, double&
 
       // If client code cares about stage limits, it is probably dangerous to
       // give it fake values.
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
 
@@ -303,7 +304,7 @@ int ComboXYStage::IsXYStageSequenceable(bool& isSequenceable) const
 {
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
 
@@ -328,7 +329,7 @@ int ComboXYStage::GetXYStageSequenceMaxLength(long& nrEvents) const
    long minNrEvents = LONG_MAX;
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
 
@@ -351,7 +352,7 @@ int ComboXYStage::StartXYStageSequence()
    int err;
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
       {
          err = ERR_NO_PHYSICAL_STAGE;
@@ -368,7 +369,7 @@ int ComboXYStage::StartXYStageSequence()
 error:
    while (startedStages > 0)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[--startedStages].c_str());
+      MM::Stage* stage = GetPhysicalStage(--startedStages);
       stage->StopStageSequence();
    }
    return err;
@@ -380,7 +381,7 @@ int ComboXYStage::StopXYStageSequence()
    int lastErr = DEVICE_OK;
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -398,7 +399,7 @@ int ComboXYStage::ClearXYStageSequence()
    int lastErr = DEVICE_OK;
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -414,13 +415,13 @@ int ComboXYStage::AddToXYStageSequence(double positionX, double positionY)
 {
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
    }
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       const double& logicalPos = (i == 0) ? positionX : positionY;
       double physicalPos = stageScalings_[i] * logicalPos + stageTranslations_[i];
       int err = stage->AddToStageSequence(physicalPos);
@@ -435,13 +436,13 @@ int ComboXYStage::SendXYStageSequence()
 {
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          return ERR_NO_PHYSICAL_STAGE;
    }
    for (int i = 0; i < 2; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       int err = stage->SendStageSequence();
       if (err != DEVICE_OK)
          return err;
@@ -461,6 +462,7 @@ int ComboXYStage::OnPhysicalStage(MM::PropertyBase* pProp, MM::ActionType eAct,
       std::string stageLabel;
       pProp->Get(stageLabel);
 
+      stageHandles_[xy] = 0;
       if (stageLabel == g_Undefined)
       {
          usedStages_[xy] = g_Undefined;
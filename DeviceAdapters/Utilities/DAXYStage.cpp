@@ -38,6 +38,8 @@ extern const char* g_DeviceNameDAXYStage;
 DAXYStage::DAXYStage() :
    DADeviceNameX_(""),
    DADeviceNameY_(""),
+   daHandleX_(0),
+   daHandleY_(0),
    initialized_(false),
    minDAVoltX_(0.0),
    maxDAVoltX_(10.0),
@@ -133,11 +135,11 @@ int DAXYStage::Initialize()
    tmp << DADeviceNameX_;
    LogMessage(tmp.str().c_str());
 
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
    if (da_x != 0)
       da_x->GetLimits(minDAVoltX_, maxDAVoltX_);
 
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_y != 0)
       da_y->GetLimits(minDAVoltY_, maxDAVoltY_);
 
@@ -193,8 +195,8 @@ int DAXYStage::Shutdown()
 
 bool DAXYStage::Busy()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if ((da_x != 0) && (da_y != 0))
       return da_x->Busy() || da_y->Busy();
@@ -222,8 +224,8 @@ int DAXYStage::Stop()
  */
 int DAXYStage::SetPositionSteps(long stepsX, long stepsY)
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
@@ -249,8 +251,8 @@ int DAXYStage::SetPositionSteps(long stepsX, long stepsY)
 
 int DAXYStage::GetPositionSteps(long& stepsX, long& stepsY)
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
@@ -283,8 +285,8 @@ int DAXYStage::SetRelativePositionSteps(long x, long y)
 
 int DAXYStage::SetPositionUm(double x, double y)
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
@@ -309,8 +311,8 @@ int DAXYStage::SetPositionUm(double x, double y)
 
 int DAXYStage::GetPositionUm(double& x, double& y)
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
@@ -339,8 +341,8 @@ int DAXYStage::GetPositionUm(double& x, double& y)
  */
 int DAXYStage::SetOrigin()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
 
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
@@ -378,8 +380,8 @@ int DAXYStage::GetStepLimits(long& /*xMin*/, long& /*xMax*/, long& /*yMin*/, lon
 
 int DAXYStage::IsXYStageSequenceable(bool& isSequenceable) const
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -392,8 +394,8 @@ int DAXYStage::IsXYStageSequenceable(bool& isSequenceable) const
 
 int DAXYStage::GetXYStageSequenceMaxLength(long& nrEvents) const
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -408,8 +410,8 @@ return ret;
 
 int DAXYStage::StartXYStageSequence()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -422,8 +424,8 @@ int DAXYStage::StartXYStageSequence()
 
 int DAXYStage::StopXYStageSequence()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -436,8 +438,8 @@ int DAXYStage::StopXYStageSequence()
 
 int DAXYStage::ClearXYStageSequence()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -450,8 +452,8 @@ int DAXYStage::ClearXYStageSequence()
 
 int DAXYStage::AddToXYStageSequence(double positionX, double positionY)
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -482,8 +484,8 @@ int DAXYStage::AddToXYStageSequence(double positionX, double positionY)
 
 int DAXYStage::SendXYStageSequence()
 {
-   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str());
-   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str());
+   MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceNameX_.c_str(), daHandleX_);
+   MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceNameY_.c_str(), daHandleY_);
    if (da_x == 0 || da_y == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -520,6 +522,7 @@ int DAXYStage::OnDADeviceX(MM::PropertyBase* pProp, MM::ActionType eAct)
       MM::SignalIO* da_x = (MM::SignalIO*)GetDevice(DADeviceName.c_str());
       if (da_x != 0) {
          DADeviceNameX_ = DADeviceName;
+         daHandleX_ = 0;
       }
       else
          return ERR_INVALID_DEVICE_NAME;
@@ -545,6 +548,7 @@ int DAXYStage::OnDADeviceY(MM::PropertyBase* pProp, MM::ActionType eAct)
       MM::SignalIO* da_y = (MM::SignalIO*)GetDevice(DADeviceName.c_str());
       if (da_y != 0) {
          DADeviceNameY_ = DADeviceName;
+         daHandleY_ = 0;
       }
       else
          return ERR_INVALID_DEVICE_NAME;
@@ -39,6 +39,7 @@ extern const char* g_PropertyMaxUm;
 
 DAZStage::DAZStage() :
    DADeviceName_(""),
+   daHandle_(0),
    initialized_(false),
    minDAVolt_(0.0),
    maxDAVolt_(10.0),
@@ -137,7 +138,7 @@ int DAZStage::Initialize()
    tmp << DADeviceName_;
    LogMessage(tmp.str().c_str());
 
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da != 0)
       da->GetLimits(minDAVolt_, maxDAVolt_);
 
@@ -158,7 +159,7 @@ int DAZStage::Shutdown()
 
 bool DAZStage::Busy()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da != 0)
       return da->Busy();
 
@@ -171,7 +172,7 @@ bool DAZStage::Busy()
  */
 int DAZStage::SetPositionUm(double pos)
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -188,7 +189,7 @@ int DAZStage::SetPositionUm(double pos)
  */
 int DAZStage::GetPositionUm(double& pos)
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -212,7 +213,7 @@ int DAZStage::GetPositionUm(double& pos)
  */
 int DAZStage::SetPositionSteps(long steps)
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -230,7 +231,7 @@ int DAZStage::SetPositionSteps(long steps)
 
 int DAZStage::GetPositionSteps(long& steps)
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -249,7 +250,7 @@ int DAZStage::GetPositionSteps(long& steps)
  */
 int DAZStage::SetOrigin()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    /*
@@ -277,7 +278,7 @@ int DAZStage::GetLimits(double& min, double& max)
 
 int DAZStage::IsStageSequenceable(bool& isSequenceable) const
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->IsDASequenceable(isSequenceable);
@@ -285,7 +286,7 @@ int DAZStage::IsStageSequenceable(bool& isSequenceable) const
 
 int DAZStage::GetStageSequenceMaxLength(long& nrEvents) const
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->GetDASequenceMaxLength(nrEvents);
@@ -293,7 +294,7 @@ int DAZStage::GetStageSequenceMaxLength(long& nrEvents) const
 
 int DAZStage::StartStageSequence()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->StartDASequence();
@@ -301,7 +302,7 @@ int DAZStage::StartStageSequence()
 
 int DAZStage::StopStageSequence()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->StopDASequence();
@@ -309,7 +310,7 @@ int DAZStage::StopStageSequence()
 
 int DAZStage::ClearStageSequence()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->ClearDASequence();
@@ -317,7 +318,7 @@ int DAZStage::ClearStageSequence()
 
 int DAZStage::AddToStageSequence(double pos)
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
 
@@ -333,7 +334,7 @@ int DAZStage::AddToStageSequence(double pos)
 
 int DAZStage::SendStageSequence()
 {
-   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str());
+   MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName_.c_str(), daHandle_);
    if (da == 0)
       return ERR_NO_DA_DEVICE;
    return da->SendDASequence();
@@ -356,6 +357,7 @@ int DAZStage::OnDADevice(MM::PropertyBase* pProp, MM::ActionType eAct)
       MM::SignalIO* da = (MM::SignalIO*)GetDevice(DADeviceName.c_str());
       if (da != 0) {
          DADeviceName_ = DADeviceName;
+         daHandle_ = 0;
       }
       else
          return ERR_INVALID_DEVICE_NAME;
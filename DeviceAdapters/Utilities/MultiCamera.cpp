@@ -58,6 +58,8 @@ MultiCamera::MultiCamera() :
 
    for (int i = 0; i < MAX_NUMBER_PHYSICAL_CAMERAS; i++) {
       usedCameras_.push_back(g_Undefined);
+      cameraHandles_.push_back(0);
+      skewMs_[i] = 0.0;
    }
 }
 
@@ -113,6 +115,13 @@ int MultiCamera::Initialize()
       os << "Physical Camera " << i + 1;
       CreateProperty(os.str().c_str(), availableCameras_[0].c_str(), MM::String, false, pAct, false);
       SetAllowedValues(os.str().c_str(), availableCameras_);
+
+      // Read-only: how much later than the first camera this one finished
+      // its last snap (or started its last sequence acquisition)
+      pAct = new CPropertyActionEx(this, &MultiCamera::OnSkew, i);
+      std::ostringstream skewName;
+      skewName << "Physical Camera " << i + 1 << " Skew (ms)";
+      CreateProperty(skewName.str().c_str(), "0.0", MM::Float, true, pAct, false);
    }
 
    CPropertyAction* pAct = new CPropertyAction(this, &MultiCamera::OnBinning);
@@ -136,20 +145,64 @@ int MultiCamera::SnapImage()
    if (!ImageSizesAreEqual())
       return ERR_NO_EQUAL_SIZE;
 
-   CameraSnapThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
+   // Snap all cameras concurrently, so that the snap takes as long as the
+   // slowest camera rather than the sum of all of them
+   CameraTriggerThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
+   return TriggerAll(t);
+}
+
+/**
+ * Starts the given (pre-configured) threads for all cameras in use, waits
+ * for all of them to return, and records the per-camera skew.
+ * Returns the first error encountered, if any.
+ */
+int MultiCamera::TriggerAll(CameraTriggerThread* threads)
+{
+   // Cameras that cannot be found are not triggered, and their threads'
+   // (unset) times are not used for the skew
+   std::vector<bool> triggered(usedCameras_.size(), false);
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
-         t[i].SetCamera(camera);
-         t[i].Start();
+         threads[i].SetCamera(camera);
+         threads[i].Start();
+         triggered[i] = true;
       }
    }
-   // I think that the CameraSnapThread destructor waits until the SnapImage function is done
-   // So, we are likely to be waiting here until all cameras are done snapping
 
-   return DEVICE_OK;
+   bool haveEarliest = false;
+   std::chrono::steady_clock::time_point earliest;
+   int ret = DEVICE_OK;
+   for (unsigned int i = 0; i < usedCameras_.size(); i++)
+   {
+      if (!triggered[i])
+         continue;
+      threads[i].Wait();
+      if (threads[i].GetReturnCode() != DEVICE_OK)
+      {
+         if (ret == DEVICE_OK)
+            ret = threads[i].GetReturnCode();
+         continue;
+      }
+      if (!haveEarliest || threads[i].GetEndTime() < earliest)
+      {
+         earliest = threads[i].GetEndTime();
+         haveEarliest = true;
+      }
+   }
+
+   for (unsigned int i = 0; i < usedCameras_.size(); i++)
+   {
+      skewMs_[i] = 0.0;
+      if (triggered[i] && haveEarliest && threads[i].GetReturnCode() == DEVICE_OK)
+      {
+         skewMs_[i] = std::chrono::duration<double, std::milli>(
+               threads[i].GetEndTime() - earliest).count();
+      }
+   }
+   return ret;
 }
 
 /**
@@ -167,50 +220,59 @@ const unsigned char* MultiCamera::GetImageBuffer(unsigned channelNr)
 {
    // We have a vector of physicalCameras, and a vector of Strings listing the cameras
    // we actually use.  
-   int j = -1;
+   int ch = Logical2Physical(channelNr);
+   if (ch < 0)
+      return 0;
+   MM::Camera* camera = GetPhysicalCamera(ch);
+   if (camera == 0)
+      return 0;
+
    unsigned height = GetImageHeight();
    unsigned width = GetImageWidth();
+   unsigned thisHeight = camera->GetImageHeight();
+   unsigned thisWidth = camera->GetImageWidth();
+
+   // Hand out the physical camera's own buffer whenever the geometry matches,
+   // so that the core copies straight from it
+   if (height == thisHeight && width == thisWidth)
+      return camera->GetImageBuffer();
+
+   // Smaller camera: pad into a buffer of our own.  Each physical camera has
+   // its own buffer so that pointers returned for other channels stay valid.
+   // SnapImage() refuses cameras of different sizes, so this is only reached
+   // if a size changed since the snap.  Cameras with different pixel depths
+   // cannot be combined at all (GetImageBytesPerPixel() returns 0); give no
+   // image rather than copying rows of the wrong length.
    unsigned pixDepth = GetImageBytesPerPixel();
-   for (unsigned int i = 0; i < usedCameras_.size(); i++)
+   if (pixDepth == 0 || thisWidth > width || thisHeight > height)
+      return 0;
+   ImgBuffer& img = img_[ch];
+   img.Resize(width, height, pixDepth);
+   img.ResetPixels();
+   const unsigned char* pixels = camera->GetImageBuffer();
+   if (pixels == 0)
+      return 0;
+   if (width == thisWidth)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
-      if (usedCameras_[i] != g_Undefined)
-         j++;
-      if (j == (int)channelNr)
+      memcpy(img.GetPixelsRW(), pixels, thisHeight * thisWidth * pixDepth);
+   }
+   else
+   {
+      // we need to copy line by line
+      const unsigned lineBytes = width * pixDepth;
+      const unsigned thisLineBytes = thisWidth * pixDepth;
+      for (unsigned k = 0; k < thisHeight; k++)
       {
-         unsigned thisHeight = camera->GetImageHeight();
-         unsigned thisWidth = camera->GetImageWidth();
-         if (height == thisHeight && width == thisWidth)
-            return camera->GetImageBuffer();
-         else
-         {
-            img_.Resize(width, height, pixDepth);
-            img_.ResetPixels();
-            if (width == thisWidth)
-            {
-               memcpy(img_.GetPixelsRW(), camera->GetImageBuffer(), thisHeight * thisWidth * pixDepth);
-            }
-            else
-            {
-               // we need to copy line by line
-               const unsigned char* pixels = camera->GetImageBuffer();
-               for (unsigned k = 0; k < thisHeight; k++)
-               {
-                  memcpy(img_.GetPixelsRW() + k * width, pixels + k * thisWidth, thisWidth);
-               }
-            }
-            return img_.GetPixels();
-         }
+         memcpy(img.GetPixelsRW() + k * lineBytes, pixels + k * thisLineBytes, thisLineBytes);
       }
    }
-   return 0;
+   return img.GetPixels();
 }
 
 bool MultiCamera::IsCapturing()
 {
-   std::vector<std::string>::iterator iter;
-   for (iter = usedCameras_.begin(); iter != usedCameras_.end(); iter++) {
-      MM::Camera* camera = (MM::Camera*)GetDevice((*iter).c_str());
+   for (unsigned int i = 0; i < usedCameras_.size(); i++) {
+      MM::Camera* camera = GetPhysicalCamera(i);
       if ((camera != 0) && camera->IsCapturing())
          return true;
    }
@@ -230,7 +292,7 @@ unsigned MultiCamera::GetImageWidth() const
    unsigned int j = 0;
    while (j < usedCameras_.size())
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[j].c_str());
+      MM::Camera* camera = GetPhysicalCamera(j);
       if (camera != 0) {
          unsigned tmp = camera->GetImageWidth();
          if (tmp > width)
@@ -251,7 +313,7 @@ unsigned MultiCamera::GetImageHeight() const
    unsigned int j = 0;
    while (j < usedCameras_.size())
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[j].c_str());
+      MM::Camera* camera = GetPhysicalCamera(j);
       if (camera != 0)
       {
          unsigned tmp = camera->GetImageHeight();
@@ -274,7 +336,7 @@ bool MultiCamera::ImageSizesAreEqual() {
    unsigned height = 0;
    unsigned width = 0;
    for (unsigned int i = 0; i < usedCameras_.size(); i++) {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          height = camera->GetImageHeight();
@@ -283,7 +345,7 @@ bool MultiCamera::ImageSizesAreEqual() {
    }
 
    for (unsigned int i = 0; i < usedCameras_.size(); i++) {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          if (height != camera->GetImageHeight())
@@ -297,13 +359,13 @@ bool MultiCamera::ImageSizesAreEqual() {
 
 unsigned MultiCamera::GetImageBytesPerPixel() const
 {
-   MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+   MM::Camera* camera0 = GetPhysicalCamera(0);
    if (camera0 != 0)
    {
       unsigned bytes = camera0->GetImageBytesPerPixel();
       for (unsigned int i = 1; i < usedCameras_.size(); i++)
       {
-         MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+         MM::Camera* camera = GetPhysicalCamera(i);
          if (camera != 0)
             if (bytes != camera->GetImageBytesPerPixel())
                return 0;
@@ -316,13 +378,13 @@ unsigned MultiCamera::GetImageBytesPerPixel() const
 unsigned MultiCamera::GetBitDepth() const
 {
    // Return the maximum bit depth found in all channels.
-   MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+   MM::Camera* camera0 = GetPhysicalCamera(0);
    if (camera0 != 0)
    {
       unsigned bitDepth = 0;
       for (unsigned int i = 0; i < usedCameras_.size(); i++)
       {
-         MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+         MM::Camera* camera = GetPhysicalCamera(i);
          if (camera != 0)
          {
             unsigned nextBitDepth = camera->GetBitDepth();
@@ -343,7 +405,7 @@ long MultiCamera::GetImageBufferSize() const
    int unsigned counter = 0;
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          counter++;
@@ -358,13 +420,13 @@ long MultiCamera::GetImageBufferSize() const
 
 double MultiCamera::GetExposure() const
 {
-   MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+   MM::Camera* camera0 = GetPhysicalCamera(0);
    if (camera0 != 0)
    {
       double exposure = camera0->GetExposure();
       for (unsigned int i = 1; i < usedCameras_.size(); i++)
       {
-         MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+         MM::Camera* camera = GetPhysicalCamera(i);
          if (camera != 0)
             if (exposure != camera->GetExposure())
                return 0;
@@ -380,7 +442,7 @@ void MultiCamera::SetExposure(double exp)
    {
       for (unsigned int i = 0; i < usedCameras_.size(); i++)
       {
-         MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+         MM::Camera* camera = GetPhysicalCamera(i);
          if (camera != 0)
             camera->SetExposure(exp);
       }
@@ -391,7 +453,7 @@ int MultiCamera::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize)
 {
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       // TODO: deal with case when CCD size are not identical
       if (camera != 0)
       {
@@ -405,7 +467,7 @@ int MultiCamera::SetROI(unsigned x, unsigned y, unsigned xSize, unsigned ySize)
 
 int MultiCamera::GetROI(unsigned& x, unsigned& y, unsigned& xSize, unsigned& ySize)
 {
-   MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+   MM::Camera* camera0 = GetPhysicalCamera(0);
    // TODO: check if ROI is same on all cameras
    if (camera0 != 0)
    {
@@ -421,7 +483,7 @@ int MultiCamera::ClearROI()
 {
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          int ret = camera->ClearROI();
@@ -440,7 +502,7 @@ int MultiCamera::PrepareSequenceAcqusition()
 
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          int ret = camera->PrepareSequenceAcqusition();
@@ -460,9 +522,10 @@ int MultiCamera::StartSequenceAcquisition(double interval)
    if (!ImageSizesAreEqual())
       return ERR_NO_EQUAL_SIZE;
 
+   CameraTriggerThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          std::ostringstream os;
@@ -471,13 +534,14 @@ int MultiCamera::StartSequenceAcquisition(double interval)
             usedCameras_[i].c_str());
          camera->AddTag(MM::g_Keyword_CameraChannelIndex, usedCameras_[i].c_str(),
             os.str().c_str());
-
-         int ret = camera->StartSequenceAcquisition(interval);
-         if (ret != DEVICE_OK)
-            return ret;
       }
+      t[i].SetContinuousSequence(interval);
    }
-   return DEVICE_OK;
+
+   int ret = TriggerAll(t);
+   if (ret != DEVICE_OK)
+      StopSequenceAcquisition();
+   return ret;
 }
 
 int MultiCamera::StartSequenceAcquisition(long numImages, double interval_ms, bool stopOnOverflow)
@@ -485,24 +549,21 @@ int MultiCamera::StartSequenceAcquisition(long numImages, double interval_ms, bo
    if (nrCamerasInUse_ < 1)
       return ERR_NO_PHYSICAL_CAMERA;
 
+   CameraTriggerThread t[MAX_NUMBER_PHYSICAL_CAMERAS];
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
-   {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
-      if (camera != 0)
-      {
-         int ret = camera->StartSequenceAcquisition(numImages, interval_ms, stopOnOverflow);
-         if (ret != DEVICE_OK)
-            return ret;
-      }
-   }
-   return DEVICE_OK;
+      t[i].SetSequence(numImages, interval_ms, stopOnOverflow);
+
+   int ret = TriggerAll(t);
+   if (ret != DEVICE_OK)
+      StopSequenceAcquisition();
+   return ret;
 }
 
 int MultiCamera::StopSequenceAcquisition()
 {
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          int ret = camera->StopSequenceAcquisition();
@@ -523,13 +584,13 @@ int MultiCamera::StopSequenceAcquisition()
 
 int MultiCamera::GetBinning() const
 {
-   MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+   MM::Camera* camera0 = GetPhysicalCamera(0);
    int binning = 0;
    if (camera0 != 0)
       binning = camera0->GetBinning();
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          if (binning != camera->GetBinning())
@@ -543,7 +604,7 @@ int MultiCamera::SetBinning(int bS)
 {
    for (unsigned int i = 0; i < usedCameras_.size(); i++)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          int ret = camera->SetBinning(bS);
@@ -596,6 +657,14 @@ int MultiCamera::Logical2Physical(int logical)
 }
 
 
+MM::Camera* MultiCamera::GetPhysicalCamera(unsigned int i) const
+{
+   if (usedCameras_[i] == g_Undefined)
+      return 0;
+   return (MM::Camera*)GetDevice(usedCameras_[i].c_str(), cameraHandles_[i]);
+}
+
+
 int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct, long i)
 {
    if (eAct == MM::BeforeGet)
@@ -605,7 +674,7 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
 
    else if (eAct == MM::AfterSet)
    {
-      MM::Camera* camera = (MM::Camera*)GetDevice(usedCameras_[i].c_str());
+      MM::Camera* camera = GetPhysicalCamera(i);
       if (camera != 0)
       {
          camera->RemoveTag(MM::g_Keyword_CameraChannelName);
@@ -615,6 +684,7 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
       std::string cameraName;
       pProp->Get(cameraName);
 
+      cameraHandles_[i] = 0;
       if (cameraName == g_Undefined) {
          usedCameras_[i] = g_Undefined;
       }
@@ -640,7 +710,7 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
       }
 
       // TODO: Set allowed binning values correctly
-      MM::Camera* camera0 = (MM::Camera*)GetDevice(usedCameras_[0].c_str());
+      MM::Camera* camera0 = GetPhysicalCamera(0);
       if (camera0 != 0)
       {
          ClearAllowedValues(MM::g_Keyword_Binning);
@@ -657,6 +727,15 @@ int MultiCamera::OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct,
    return DEVICE_OK;
 }
 
+int MultiCamera::OnSkew(MM::PropertyBase* pProp, MM::ActionType eAct, long i)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(skewMs_[i]);
+   }
+   return DEVICE_OK;
+}
+
 int MultiCamera::OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
@@ -57,6 +57,7 @@ MultiShutter::MultiShutter() :
 
    for (int i = 0; i < nrPhysicalShutters_; i++) {
       usedShutters_.push_back(g_Undefined);
+      shutterHandles_.push_back(0);
    }
 }
 
@@ -129,9 +130,8 @@ bool MultiShutter::Busy()
 {
    MMThreadGuard g(physicalShutterLock_);
 
-   std::vector<std::string>::iterator iter;
-   for (iter = usedShutters_.begin(); iter != usedShutters_.end(); iter++) {
-      MM::Shutter* shutter = (MM::Shutter*)GetDevice((*iter).c_str());
+   for (size_t i = 0; i < usedShutters_.size(); i++) {
+      MM::Shutter* shutter = GetPhysicalShutter(i);
       if ((shutter != 0) && shutter->Busy())
          return true;
    }
@@ -146,9 +146,8 @@ int MultiShutter::SetOpen(bool open)
 {
    MMThreadGuard g(physicalShutterLock_);
 
-   std::vector<std::string>::iterator iter;
-   for (iter = usedShutters_.begin(); iter != usedShutters_.end(); iter++) {
-      MM::Shutter* shutter = (MM::Shutter*)GetDevice((*iter).c_str());
+   for (size_t i = 0; i < usedShutters_.size(); i++) {
+      MM::Shutter* shutter = GetPhysicalShutter(i);
       if (shutter != 0) {
          int ret = shutter->SetOpen(open);
          if (ret != DEVICE_OK)
@@ -168,6 +167,13 @@ int MultiShutter::GetOpen(bool& open)
    return DEVICE_OK;
 }
 
+MM::Shutter* MultiShutter::GetPhysicalShutter(size_t i)
+{
+   if (usedShutters_[i] == g_Undefined)
+      return 0;
+   return (MM::Shutter*)GetDevice(usedShutters_[i].c_str(), shutterHandles_[i]);
+}
+
 ///////////////////////////////////////
 // Action Interface
 //////////////////////////////////////
@@ -183,6 +189,7 @@ int MultiShutter::OnPhysicalShutter(MM::PropertyBase* pProp, MM::ActionType eAct
    {
       std::string shutterName;
       pProp->Get(shutterName);
+      shutterHandles_[i] = 0;
       if (shutterName == g_Undefined) {
          usedShutters_[i] = g_Undefined;
       }
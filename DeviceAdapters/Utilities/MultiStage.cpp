@@ -34,6 +34,7 @@
 
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
+#include <future>
 
 extern const char* g_DeviceNameMultiStage;
 extern const char* g_Undefined;
@@ -43,6 +44,7 @@ extern const char* g_SyncNow;
 MultiStage::MultiStage() :
    nrPhysicalStages_(2),
    simulatedStepSizeUm_(0.1),
+   concurrentMoves_(false),
    initialized_(false)
 {
    InitializeDefaultErrorMessages();
@@ -92,6 +94,7 @@ int MultiStage::Initialize()
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
       usedStages_.push_back(g_Undefined);
+      stageHandles_.push_back(0);
       stageScalings_.push_back(1.0);
       stageTranslations_.push_back(0.0);
    }
@@ -136,6 +139,11 @@ int MultiStage::Initialize()
    AddAllowedValue("BringPositionsIntoSync", "");
    AddAllowedValue("BringPositionsIntoSync", g_SyncNow);
 
+   CreateStringProperty("ConcurrentMoves", concurrentMoves_ ? "Yes" : "No", false,
+      new CPropertyAction(this, &MultiStage::OnConcurrentMoves));
+   AddAllowedValue("ConcurrentMoves", "No");
+   AddAllowedValue("ConcurrentMoves", "Yes");
+
    initialized_ = true;
    return DEVICE_OK;
 }
@@ -147,6 +155,7 @@ int MultiStage::Shutdown()
       return DEVICE_OK;
 
    usedStages_.clear();
+   stageHandles_.clear();
    stageScalings_.clear();
    stageTranslations_.clear();
 
@@ -156,12 +165,9 @@ int MultiStage::Shutdown()
 
 bool MultiStage::Busy()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -178,12 +184,9 @@ int MultiStage::Stop()
    // stages.
    int ret = DEVICE_OK;
 
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -198,12 +201,9 @@ int MultiStage::Stop()
 
 int MultiStage::Home()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -215,37 +215,81 @@ int MultiStage::Home()
 }
 
 
-int MultiStage::SetPositionUm(double pos)
+MM::Stage* MultiStage::GetPhysicalStage(unsigned i) const
 {
+   if (usedStages_[i] == g_Undefined)
+      return 0;
+   return static_cast<MM::Stage*>(GetDevice(usedStages_[i].c_str(), stageHandles_[i]));
+}
+
+
+int MultiStage::MovePhysicalStages(const std::vector<double>& physical, bool relative)
+{
+   // Resolve every stage before starting any move, so that the moves are
+   // issued back to back. The Core then waits for all of them via Busy().
+   std::vector<MM::Stage*> stages;
+   std::vector<double> targets;
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
+      stages.push_back(stage);
+      targets.push_back(physical[i]);
+   }
 
-      double physicalPos = stageScalings_[i] * pos + stageTranslations_[i];
-      int err = stage->SetPositionUm(physicalPos);
-      if (err != DEVICE_OK)
-         return err;
+   if (!concurrentMoves_ || stages.size() < 2)
+   {
+      for (size_t j = 0; j < stages.size(); ++j)
+      {
+         int err = relative ? stages[j]->SetRelativePositionUm(targets[j]) :
+            stages[j]->SetPositionUm(targets[j]);
+         if (err != DEVICE_OK)
+            return err;
+      }
+      return DEVICE_OK;
    }
-   return DEVICE_OK;
+
+   // Stages whose adapters block until the move is complete would otherwise
+   // add up their move times. Start all but the first on their own threads,
+   // so that the total is that of the slowest stage.
+   std::vector< std::future<int> > moves;
+   for (size_t j = 1; j < stages.size(); ++j)
+   {
+      MM::Stage* stage = stages[j];
+      double target = targets[j];
+      moves.push_back(std::async(std::launch::async, [stage, target, relative]() {
+         return relative ? stage->SetRelativePositionUm(target) :
+            stage->SetPositionUm(target);
+      }));
+   }
+   int ret = relative ? stages[0]->SetRelativePositionUm(targets[0]) :
+      stages[0]->SetPositionUm(targets[0]);
+   for (size_t j = 0; j < moves.size(); ++j)
+   {
+      int err = moves[j].get();
+      if (ret == DEVICE_OK)
+         ret = err;
+   }
+   return ret;
 }
 
 
-int MultiStage::SetRelativePositionUm(double d)
+int MultiStage::SetPositionUm(double pos)
 {
+   std::vector<double> physicalPos(nrPhysicalStages_);
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
-   {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
-      if (!stage)
-         continue;
+      physicalPos[i] = stageScalings_[i] * pos + stageTranslations_[i];
+   return MovePhysicalStages(physicalPos, false);
+}
 
-      double physicalRelPos = stageScalings_[i] * d;
-      int err = stage->SetRelativePositionUm(physicalRelPos);
-      if (err != DEVICE_OK)
-         return err;
-   }
-   return DEVICE_OK;
+
+int MultiStage::SetRelativePositionUm(double d)
+{
+   std::vector<double> physicalRelPos(nrPhysicalStages_);
+   for (unsigned i = 0; i < nrPhysicalStages_; ++i)
+      physicalRelPos[i] = stageScalings_[i] * d;
+   return MovePhysicalStages(physicalRelPos, true);
 }
 
 
@@ -255,7 +299,7 @@ int MultiStage::GetPositionUm(double& pos)
    // readout. For now, it is the first physical stage assigned.
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -301,7 +345,7 @@ int MultiStage::GetLimits(double& lower, double& upper)
    bool hasStage = false;
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -345,12 +389,9 @@ bool MultiStage::IsContinuousFocusDrive() const
 int MultiStage::IsStageSequenceable(bool& isSequenceable) const
 {
    bool hasStage = false;
-   for (std::vector<std::string>::const_iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -380,12 +421,9 @@ int MultiStage::GetStageSequenceMaxLength(long& nrEvents) const
 {
    long minNrEvents = LONG_MAX;
    bool hasStage = false;
-   for (std::vector<std::string>::const_iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -413,12 +451,9 @@ int MultiStage::StartStageSequence()
    std::vector<MM::Stage*> startedStages;
 
    int err;
-   for (std::vector<std::string>::const_iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -443,12 +478,9 @@ error:
 int MultiStage::StopStageSequence()
 {
    int lastErr = DEVICE_OK;
-   for (std::vector<std::string>::const_iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -464,12 +496,9 @@ int MultiStage::StopStageSequence()
 int MultiStage::ClearStageSequence()
 {
    int lastErr = DEVICE_OK;
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -485,7 +514,7 @@ int MultiStage::AddToStageSequence(double pos)
 {
    for (unsigned i = 0; i < nrPhysicalStages_; ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice(usedStages_[i].c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -500,12 +529,9 @@ int MultiStage::AddToStageSequence(double pos)
 
 int MultiStage::SendStageSequence()
 {
-   for (std::vector<std::string>::iterator it = usedStages_.begin(),
-      end = usedStages_.end();
-      it != end;
-      ++it)
+   for (unsigned i = 0; i < usedStages_.size(); ++i)
    {
-      MM::Stage* stage = (MM::Stage*)GetDevice((*it).c_str());
+      MM::Stage* stage = GetPhysicalStage(i);
       if (!stage)
          continue;
 
@@ -558,6 +584,7 @@ int MultiStage::OnPhysicalStage(MM::PropertyBase* pProp, MM::ActionType eAct, lo
       std::string stageLabel;
       pProp->Get(stageLabel);
 
+      stageHandles_[i] = 0;
       if (stageLabel == g_Undefined)
       {
          usedStages_[i] = g_Undefined;
@@ -610,6 +637,22 @@ int MultiStage::OnTranslationUm(MM::PropertyBase* pProp, MM::ActionType eAct, lo
 }
 
 
+int MultiStage::OnConcurrentMoves(MM::PropertyBase* pProp, MM::ActionType eAct)
+{
+   if (eAct == MM::BeforeGet)
+   {
+      pProp->Set(concurrentMoves_ ? "Yes" : "No");
+   }
+   else if (eAct == MM::AfterSet)
+   {
+      std::string s;
+      pProp->Get(s);
+      concurrentMoves_ = (s == "Yes");
+   }
+   return DEVICE_OK;
+}
+
+
 int MultiStage::OnBringIntoSync(MM::PropertyBase* pProp, MM::ActionType eAct)
 {
    if (eAct == MM::BeforeGet)
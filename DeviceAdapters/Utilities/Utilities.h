@@ -27,6 +27,7 @@
 #include "MMDevice.h"
 #include "DeviceBase.h"
 #include "ImgBuffer.h"
+#include <chrono>
 #include <string>
 #include <map>
 #include <vector>
@@ -98,8 +99,11 @@ public:
    int OnState(MM::PropertyBase* pProp, MM::ActionType eAct);
 
 private:
+   MM::Shutter* GetPhysicalShutter(size_t i);
+
    std::vector<std::string> availableShutters_;
    std::vector<std::string> usedShutters_;
+   std::vector<MM::DeviceHandle> shutterHandles_;
    long nrPhysicalShutters_;
    bool open_;
    bool initialized_;
@@ -112,27 +116,77 @@ private:
 };
 
 /**
- * CameraSnapThread: helper thread for MultiCamera
+ * CameraTriggerThread: helper thread for MultiCamera
+ *
+ * Runs SnapImage() or StartSequenceAcquisition() on a single physical camera,
+ * so that all physical cameras can be triggered concurrently.  Records the
+ * return code and the time at which the call was issued and returned.
  */
-class CameraSnapThread : public MMDeviceThreadBase
+class CameraTriggerThread : public MMDeviceThreadBase
 {
    public:
-      CameraSnapThread() :
+      CameraTriggerThread() :
          camera_(0),
-         started_(false)
+         started_(false),
+         sequence_(false),
+         continuous_(false),
+         numImages_(0),
+         interval_(0.0),
+         stopOnOverflow_(false),
+         ret_(DEVICE_OK)
       {}
 
-      ~CameraSnapThread() { if (started_) wait(); }
+      ~CameraTriggerThread() { Wait(); }
 
       void SetCamera(MM::Camera* camera) { camera_ = camera; }
 
-      int svc() { camera_->SnapImage(); return 0; }
+      void SetContinuousSequence(double interval_ms)
+      {
+         sequence_ = true;
+         continuous_ = true;
+         interval_ = interval_ms;
+      }
+
+      void SetSequence(long numImages, double interval_ms, bool stopOnOverflow)
+      {
+         sequence_ = true;
+         continuous_ = false;
+         numImages_ = numImages;
+         interval_ = interval_ms;
+         stopOnOverflow_ = stopOnOverflow;
+      }
+
+      int svc()
+      {
+         startTime_ = std::chrono::steady_clock::now();
+         if (!sequence_)
+            ret_ = camera_->SnapImage();
+         else if (continuous_)
+            ret_ = camera_->StartSequenceAcquisition(interval_);
+         else
+            ret_ = camera_->StartSequenceAcquisition(numImages_, interval_, stopOnOverflow_);
+         endTime_ = std::chrono::steady_clock::now();
+         return 0;
+      }
 
       void Start() { activate(); started_ = true; }
+      void Wait() { if (started_) { wait(); started_ = false; } }
+
+      int GetReturnCode() const { return ret_; }
+      std::chrono::steady_clock::time_point GetStartTime() const { return startTime_; }
+      std::chrono::steady_clock::time_point GetEndTime() const { return endTime_; }
 
    private:
       MM::Camera* camera_;
       bool started_;
+      bool sequence_;
+      bool continuous_;
+      long numImages_;
+      double interval_;
+      bool stopOnOverflow_;
+      int ret_;
+      std::chrono::steady_clock::time_point startTime_;
+      std::chrono::steady_clock::time_point endTime_;
 };
 
 /*
@@ -178,19 +232,27 @@ public:
    // ---------------
    int OnPhysicalCamera(MM::PropertyBase* pProp, MM::ActionType eAct, long nr);
    int OnBinning(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnSkew(MM::PropertyBase* pProp, MM::ActionType eAct, long nr);
 
 private:
    int Logical2Physical(int logical);
+   MM::Camera* GetPhysicalCamera(unsigned int i) const;
    bool ImageSizesAreEqual();
+   int TriggerAll(CameraTriggerThread* threads);
    unsigned char* imageBuffer_;
 
    std::vector<std::string> availableCameras_;
    std::vector<std::string> usedCameras_;
+   mutable std::vector<MM::DeviceHandle> cameraHandles_;
    std::vector<int> cameraWidths_;
    std::vector<int> cameraHeights_;
    unsigned int nrCamerasInUse_;
    bool initialized_;
-   ImgBuffer img_;
+   // Padded copies, per physical camera, for cameras smaller than the largest
+   ImgBuffer img_[MAX_NUMBER_PHYSICAL_CAMERAS];
+   // Per physical camera, time (ms) by which the last snap (or sequence
+   // start) lagged behind the earliest camera
+   double skewMs_[MAX_NUMBER_PHYSICAL_CAMERAS];
 };
 
 
@@ -238,15 +300,21 @@ private:
    int OnScaling(MM::PropertyBase* pProp, MM::ActionType eAct, long nr);
    int OnTranslationUm(MM::PropertyBase* pProp, MM::ActionType eAct, long nr);
    int OnBringIntoSync(MM::PropertyBase* pProp, MM::ActionType eAct);
+   int OnConcurrentMoves(MM::PropertyBase* pProp, MM::ActionType eAct);
+
+   MM::Stage* GetPhysicalStage(unsigned i) const;
+   int MovePhysicalStages(const std::vector<double>& physical, bool relative);
 
 private:
    unsigned nrPhysicalStages_; // constant while initialized
    double simulatedStepSizeUm_;
+   bool concurrentMoves_;
    bool initialized_;
 
    // The following vectors should always have nrPhysicalStages_ elements while
    // initialized
    std::vector<std::string> usedStages_;
+   mutable std::vector<MM::DeviceHandle> stageHandles_;
    std::vector<double> stageScalings_;
    std::vector<double> stageTranslations_;
 };
@@ -298,6 +366,8 @@ private:
    int OnScaling(MM::PropertyBase* pProp, MM::ActionType eAct, long xy);
    int OnTranslationUm(MM::PropertyBase* pProp, MM::ActionType eAct, long xy);
 
+   MM::Stage* GetPhysicalStage(unsigned xy) const;
+
 private:
    double simulatedXStepSizeUm_;
    double simulatedYStepSizeUm_;
@@ -306,6 +376,7 @@ private:
    // The following vectors should always have 2 elements (0 = X, 1 = Y) while
    // initialized.
    std::vector<std::string> usedStages_;
+   mutable std::vector<MM::DeviceHandle> stageHandles_;
    std::vector<double> stageScalings_;
    std::vector<double> stageTranslations_;
 };
@@ -493,6 +564,7 @@ public:
 private:
    std::vector<std::string> availableDAs_;
    std::string DADeviceName_;
+   mutable MM::DeviceHandle daHandle_;
    bool initialized_;
    double minDAVolt_;
    double maxDAVolt_;
@@ -571,6 +643,8 @@ private:
    std::vector<std::string> availableDAs_;
    std::string DADeviceNameX_;
    std::string DADeviceNameY_;
+   mutable MM::DeviceHandle daHandleX_;
+   mutable MM::DeviceHandle daHandleY_;
    bool initialized_;
    double minDAVoltX_;
    double maxDAVoltX_;
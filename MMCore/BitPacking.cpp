@@ -0,0 +1,251 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Packing of 10-, 12-, and 14-bit pixels stored in 16 bits,
+//                with an SSSE3 implementation selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "BitPacking.h"
+
+#include "../MMDevice/CpuFeatures.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BITPACKING_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define BITPACKING_TARGET_SSSE3
+#else
+#define BITPACKING_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#endif
+
+namespace mm {
+namespace BitPacking {
+
+namespace {
+
+/*
+ * Scalar implementation: 4 pixels (bits / 2 bytes) at a time through a
+ * 64-bit accumulator.
+ */
+
+void ScalarPack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bits)
+{
+   const std::uint64_t mask = (1u << bits) - 1;
+   for (std::size_t i = 0; i < pixelCount; i += 4)
+   {
+      const std::size_t n = pixelCount - i < 4 ? pixelCount - i : 4;
+      std::uint64_t acc = 0;
+      for (std::size_t k = 0; k < n; ++k, src += 2)
+      {
+         std::uint16_t v;
+         std::memcpy(&v, src, 2);
+         acc |= (v & mask) << (k * bits);
+      }
+      const std::size_t bytes = (n * bits + 7) / 8;
+      for (std::size_t b = 0; b < bytes; ++b)
+         *dst++ = static_cast<unsigned char>(acc >> (8 * b));
+   }
+}
+
+void ScalarUnpack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bits)
+{
+   const std::uint64_t mask = (1u << bits) - 1;
+   for (std::size_t i = 0; i < pixelCount; i += 4)
+   {
+      const std::size_t n = pixelCount - i < 4 ? pixelCount - i : 4;
+      const std::size_t bytes = (n * bits + 7) / 8;
+      std::uint64_t acc = 0;
+      for (std::size_t b = 0; b < bytes; ++b)
+         acc |= static_cast<std::uint64_t>(*src++) << (8 * b);
+      for (std::size_t k = 0; k < n; ++k, dst += 2)
+      {
+         const std::uint16_t v = static_cast<std::uint16_t>((acc >> (k * bits)) & mask);
+         std::memcpy(dst, &v, 2);
+      }
+   }
+}
+
+#ifdef BITPACKING_X86
+
+/*
+ * SSSE3 implementation: 8 pixels per iteration. Pairs of 16-bit lanes are
+ * merged into 32-bit lanes, and those into two 64-bit lanes of 4 pixels
+ * each; a byte shuffle then moves the bits / 2 significant bytes of each
+ * 64-bit lane together. Unpacking is the reverse.
+ *
+ * Each iteration loads and stores a full 16 bytes, of which only bits bytes
+ * are packed data, so the loops stop while at least 16 pixels (16 * 10 / 8
+ * >= 16 bytes) remain and leave the rest to the scalar code.
+ */
+
+// Returns the number of pixels packed
+BITPACKING_TARGET_SSSE3
+std::size_t SSSE3Pack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bits)
+{
+   const int n = static_cast<int>(bits / 2); // Bytes per 4 pixels
+   char order[16];
+   for (int j = 0; j < 16; ++j)
+      order[j] = static_cast<char>(j < n ? j : (j < 2 * n ? 8 + j - n : -1));
+   const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(order));
+   const __m128i mask = _mm_set1_epi16(static_cast<short>((1u << bits) - 1));
+   const __m128i low16 = _mm_set1_epi32(0xffff);
+   const __m128i low32 = _mm_set_epi32(0, -1, 0, -1);
+   const __m128i shift1 = _mm_cvtsi32_si128(static_cast<int>(bits));
+   const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 * bits));
+
+   std::size_t i = 0;
+   for (; i + 16 <= pixelCount; i += 8, src += 16, dst += 2 * n)
+   {
+      __m128i v = _mm_and_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), mask);
+      v = _mm_or_si128(_mm_and_si128(v, low16),
+            _mm_sll_epi32(_mm_srli_epi32(v, 16), shift1));
+      v = _mm_or_si128(_mm_and_si128(v, low32),
+            _mm_sll_epi64(_mm_srli_epi64(v, 32), shift2));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+            _mm_shuffle_epi8(v, shuffle));
+   }
+   return i;
+}
+
+// Returns the number of pixels unpacked
+BITPACKING_TARGET_SSSE3
+std::size_t SSSE3Unpack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bits)
+{
+   const int n = static_cast<int>(bits / 2);
+   char order[16];
+   for (int j = 0; j < 16; ++j)
+      order[j] = static_cast<char>(j < n ? j :
+            (j >= 8 && j < 8 + n ? n + j - 8 : -1));
+   const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(order));
+   const __m128i mask1 = _mm_set1_epi32(static_cast<int>((1u << bits) - 1));
+   const __m128i mask2 = _mm_set1_epi64x(
+         static_cast<long long>((1ull << (2 * bits)) - 1));
+   const __m128i shift1 = _mm_cvtsi32_si128(static_cast<int>(bits));
+   const __m128i shift2 = _mm_cvtsi32_si128(static_cast<int>(2 * bits));
+
+   std::size_t i = 0;
+   for (; i + 16 <= pixelCount; i += 8, src += 2 * n, dst += 16)
+   {
+      __m128i v = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), shuffle);
+      v = _mm_or_si128(_mm_and_si128(v, mask2),
+            _mm_slli_epi64(_mm_srl_epi64(v, shift2), 32));
+      v = _mm_or_si128(_mm_and_si128(v, mask1),
+            _mm_slli_epi32(_mm_srl_epi32(v, shift1), 16));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+   }
+   return i;
+}
+
+#endif // BITPACKING_X86
+
+Implementation DetectBestImplementation()
+{
+#ifdef BITPACKING_X86
+   if (CpuFeatures::HasSSSE3())
+      return ImplementationSSSE3;
+#endif
+   return ImplementationScalar;
+}
+
+#ifdef BITPACKING_X86
+Implementation Resolve(Implementation impl)
+{
+   if (impl == ImplementationAuto)
+      return GetBestImplementation();
+   if (!IsImplementationAvailable(impl))
+      return ImplementationScalar;
+   return impl;
+}
+#endif
+
+} // anonymous namespace
+
+
+bool IsImplementationAvailable(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto:
+      case ImplementationScalar:
+         return true;
+#ifdef BITPACKING_X86
+      case ImplementationSSSE3:
+         return GetBestImplementation() == ImplementationSSSE3;
+#endif
+      default:
+         return false;
+   }
+}
+
+
+Implementation GetBestImplementation()
+{
+   static const Implementation best = DetectBestImplementation();
+   return best;
+}
+
+
+bool IsPackable(unsigned bitDepth)
+{
+   return bitDepth == 10 || bitDepth == 12 || bitDepth == 14;
+}
+
+
+std::size_t PackedSize(std::size_t pixelCount, unsigned bitDepth)
+{
+   return (pixelCount * bitDepth + 7) / 8;
+}
+
+
+void Pack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bitDepth, Implementation impl)
+{
+   std::size_t done = 0;
+#ifdef BITPACKING_X86
+   if (Resolve(impl) == ImplementationSSSE3)
+      done = SSSE3Pack(dst, src, pixelCount, bitDepth);
+#else
+   (void)impl;
+#endif
+   // Remaining pixels (a multiple of 8 pixels is a whole number of bytes)
+   ScalarPack(dst + PackedSize(done, bitDepth), src + 2 * done,
+         pixelCount - done, bitDepth);
+}
+
+
+void Unpack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bitDepth, Implementation impl)
+{
+   std::size_t done = 0;
+#ifdef BITPACKING_X86
+   if (Resolve(impl) == ImplementationSSSE3)
+      done = SSSE3Unpack(dst, src, pixelCount, bitDepth);
+#else
+   (void)impl;
+#endif
+   ScalarUnpack(dst + 2 * done, src + PackedSize(done, bitDepth),
+         pixelCount - done, bitDepth);
+}
+
+} // namespace BitPacking
+} // namespace mm
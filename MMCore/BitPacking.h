@@ -0,0 +1,58 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Packing of 10-, 12-, and 14-bit pixels stored in 16 bits,
+//                with an SSSE3 implementation selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+
+namespace mm {
+namespace BitPacking {
+
+// The packed format is a little-endian bit stream: pixel i occupies bits
+// [i * bits, (i + 1) * bits), so that 4 pixels take bits / 2 bytes (for
+// example, 12-bit pixels 0x0ABC, 0x0DEF are packed as BC FA DE).
+
+enum Implementation
+{
+   ImplementationAuto, // Fastest one available on this CPU
+   ImplementationScalar,
+   ImplementationSSSE3,
+};
+
+bool IsImplementationAvailable(Implementation impl);
+Implementation GetBestImplementation();
+
+// True for the bit depths supported here (10, 12, 14)
+bool IsPackable(unsigned bitDepth);
+
+// Number of bytes occupied by pixelCount packed pixels
+std::size_t PackedSize(std::size_t pixelCount, unsigned bitDepth);
+
+// Packs pixelCount native-endian 16-bit pixels from src. Bits above
+// bitDepth are discarded. Source and destination must not overlap, and need
+// not be aligned.
+void Pack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bitDepth,
+      Implementation impl = ImplementationAuto);
+
+// Reverses Pack(), writing pixelCount 16-bit pixels to dst
+void Unpack(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, unsigned bitDepth,
+      Implementation impl = ImplementationAuto);
+
+} // namespace BitPacking
+} // namespace mm
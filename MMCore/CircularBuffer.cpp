@@ -26,7 +26,11 @@
 #include "CircularBuffer.h"
 #include "CoreUtils.h"
 
+#include "BitPacking.h"
+#include "ImageSlab.h"
+#include "SharedFrameRing.h"
 #include "TaskSet_CopyMemory.h"
+#include "TaskSet_PixelStatistics.h"
 
 #include "../MMDevice/DeviceUtils.h"
 
@@ -34,7 +38,9 @@
 #include <cstdio>
 #include <ctime>
 #include <memory>
+#include <new>
 #include <string>
+#include <thread>
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4290) // 'C++ exception specification ignored'
@@ -53,24 +59,99 @@ const long adjustThreshold = LONG_MAX / 2;
 // division by zero can be added.
 const unsigned long maxCBSize = 10000000;
 
-CircularBuffer::CircularBuffer(unsigned int memorySizeMB) :
+// How long Initialize() waits for pinned images to be released before
+// giving up on re-slicing
+const int pinReleaseWaitMs = 100;
+
+// Channel images start on cache line boundaries
+const std::size_t imageAlignment = 64;
+
+CircularBuffer::CircularBuffer(unsigned int memorySizeMB, bool hugePages, bool prefault,
+      std::shared_ptr<ThreadPool> pool) :
    width_(0), 
    height_(0), 
    pixDepth_(0), 
+   bitDepth_(0),
+   packedStorage_(false),
+   packedBits_(0),
    imageCounter_(0), 
    insertIndex_(0), 
    saveIndex_(0), 
    memorySizeMB_(memorySizeMB), 
+   hugePages_(hugePages),
+   prefault_(prefault),
+   numChannels_(0),
    overflow_(false),
-   threadPool_(std::make_shared<ThreadPool>()),
-   tasksMemCopy_(std::make_shared<TaskSet_CopyMemory>(threadPool_))
+   channelStride_(0),
+   frameCount_(0),
+   pinnedCount_(0),
+   overflowPolicy_(OverflowStop),
+   stats_(),
+   pendingGap_(0),
+   threadPool_(pool ? pool : std::make_shared<ThreadPool>()),
+   tasksMemCopy_(std::make_shared<TaskSet_CopyMemory>(threadPool_)),
+   imageStatistics_(false),
+   histogramBins_(0),
+   tasksStatistics_(std::make_shared<TaskSet_PixelStatistics>(threadPool_))
 {
+   // Mapping is cheap, so do it now to let prefaulting start early; if it
+   // fails, Initialize() tries again and reports the failure.
+   try
+   {
+      slab_.reset(new mm::ImageSlab(memorySizeMB_ * bytesInMB, hugePages_, prefault_));
+   }
+   catch (const std::bad_alloc&)
+   {
+   }
 }
 
 CircularBuffer::~CircularBuffer() {}
 
-bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int h, unsigned int pixDepth)
+bool CircularBuffer::UsesHugePages() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return slab_ && slab_->GetPageKind() != mm::ImageSlab::NormalPages;
+}
+
+bool CircularBuffer::IsPrefaulted() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return slab_ && prefault_ && slab_->IsPrefaulted();
+}
+
+// Caller holds g_bufferLock
+unsigned CircularBuffer::PackedBitsFor(unsigned pixDepth, unsigned bitDepth) const
+{
+   if (bitDepth == 0)
+      bitDepth = bitDepth_;
+   return packedStorage_ && pixDepth == 2 &&
+      mm::BitPacking::IsPackable(bitDepth) ? bitDepth : 0;
+}
+
+// Caller holds g_bufferLock
+bool CircularBuffer::NeedsReslice(unsigned channels, unsigned w, unsigned h,
+      unsigned pixDepth, unsigned packedBits) const
+{
+   return frameCount_ == 0 || w != width_ || h != height_ ||
+      pixDepth != pixDepth_ || channels != numChannels_ ||
+      packedBits != packedBits_;
+}
+
+bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int h, unsigned int pixDepth, unsigned bitDepth)
 {
+   // Pinned images prevent re-slicing; give short-lived pins (such as those
+   // of the preview stream) a moment to be released
+   for (int i = 0; i < pinReleaseWaitMs; ++i)
+   {
+      {
+         MMThreadGuard guard(g_bufferLock);
+         if (pinnedCount_ == 0 ||
+               !NeedsReslice(channels, w, h, pixDepth, PackedBitsFor(pixDepth, bitDepth)))
+            break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+
    MMThreadGuard guard(g_bufferLock);
    imageNumbers_.clear();
    startTime_ = std::chrono::steady_clock::now();
@@ -81,28 +162,43 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
       if (w == 0 || h==0 || pixDepth == 0 || channels == 0)
          return false; // does not make sense
 
-      if (w == width_ && height_ == h && pixDepth_ == pixDepth && channels == numChannels_)
-         if (frameArray_.size() > 0)
-            return true; // nothing to change
+      if (bitDepth > 0)
+         bitDepth_ = bitDepth;
+      unsigned packedBits = PackedBitsFor(pixDepth, bitDepth_);
+
+      if (!NeedsReslice(channels, w, h, pixDepth, packedBits))
+         return true; // nothing to change
+
+      if (pinnedCount_ > 0)
+         return false; // pinned images must stay allocated
+      readScratch_.clear();
 
       width_ = w;
       height_ = h;
       pixDepth_ = pixDepth;
       numChannels_ = channels;
+      packedBits_ = packedBits;
 
       insertIndex_ = 0;
       saveIndex_ = 0;
       overflow_ = false;
 
-      // calculate the size of the entire buffer array once all images get allocated
-      // the actual size at the time of the creation is going to be less, because
-      // images are not allocated until pixels become available
-      unsigned long frameSizeBytes = width_ * height_ * pixDepth_ * numChannels_;
-      unsigned long cbSize = (unsigned long) ((memorySizeMB_ * bytesInMB) / frameSizeBytes);
+      if (!slab_)
+         slab_.reset(new mm::ImageSlab(memorySizeMB_ * bytesInMB, hugePages_, prefault_));
+
+      // Re-slice the slab for the new geometry; no pixel memory is allocated
+      // or touched here
+      std::size_t channelSize = packedBits_ > 0 ?
+         mm::BitPacking::PackedSize((std::size_t)width_ * height_, packedBits_) :
+         (std::size_t)width_ * height_ * pixDepth_;
+      channelStride_ = (channelSize + imageAlignment - 1) / imageAlignment * imageAlignment;
+      unsigned long cbSize = (unsigned long) (slab_->Size() / (channelStride_ * numChannels_));
 
       if (cbSize == 0) 
       {
-         frameArray_.resize(0);
+         frameCount_ = 0;
+         pinCounts_.clear();
+         gapBefore_.clear();
          return false; // memory footprint too small
       }
 
@@ -110,23 +206,19 @@ bool CircularBuffer::Initialize(unsigned channels, unsigned int w, unsigned int
       if (cbSize > maxCBSize)
          cbSize = maxCBSize; 
 
-      // TODO: verify if we have enough RAM to satisfy this request
-
-      for (unsigned long i=0; i<frameArray_.size(); i++)
-         frameArray_[i].Clear();
-
-      // allocate buffers  - could conceivably throw an out-of-memory exception
-      frameArray_.resize(cbSize);
-      for (unsigned long i=0; i<frameArray_.size(); i++)
-      {
-         frameArray_[i].Resize(w, h, pixDepth);
-         frameArray_[i].Preallocate(numChannels_);
-      }
+      pinCounts_.assign(cbSize, 0);
+      if (frameArray_.size() < cbSize)
+         frameArray_.resize(cbSize);
+      frameCount_ = cbSize;
+      gapBefore_.assign(cbSize, 0);
+      pendingGap_ = 0;
    }
 
    catch( ... /* std::bad_alloc& ex */)
    {
-      frameArray_.resize(0);
+      frameCount_ = 0;
+      pinCounts_.clear();
+      gapBefore_.clear();
       ret = false;
    }
    return ret;
@@ -140,18 +232,169 @@ void CircularBuffer::Clear()
    overflow_ = false;
    startTime_ = std::chrono::steady_clock::now();
    imageNumbers_.clear();
+   stats_ = Statistics();
+   gapBefore_.assign(gapBefore_.size(), 0);
+   pendingGap_ = 0;
+   lastImageStatistics_.clear();
+}
+
+void CircularBuffer::DiscardAllUnread()
+{
+   MMThreadGuard guard(g_bufferLock);
+   if (frameCount_ > 0 && insertIndex_ > saveIndex_)
+      DiscardUnread(insertIndex_ - saveIndex_);
+}
+
+void CircularBuffer::SetOverflowPolicy(OverflowPolicy policy)
+{
+   MMThreadGuard guard(g_bufferLock);
+   overflowPolicy_ = policy;
+}
+
+CircularBuffer::OverflowPolicy CircularBuffer::GetOverflowPolicy() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return overflowPolicy_;
+}
+
+CircularBuffer::Statistics CircularBuffer::GetStatistics() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return stats_;
+}
+
+// Discards the oldest count unread frames, carrying their gaps forward to the
+// next frame the reader will see. Caller holds g_bufferLock.
+void CircularBuffer::DiscardUnread(long count)
+{
+   for (long i = 0; i < count; ++i)
+   {
+      long slot = saveIndex_ % frameCount_;
+      unsigned long carry = gapBefore_[slot] + 1;
+      gapBefore_[slot] = 0;
+      ++saveIndex_;
+      if (saveIndex_ < insertIndex_)
+         gapBefore_[saveIndex_ % frameCount_] += carry;
+      else
+         pendingGap_ += carry;
+   }
+   stats_.droppedImages += count;
+}
+
+// Caller holds g_bufferLock
+void CircularBuffer::CountReadGap(long slot)
+{
+   if (gapBefore_[slot] > 0)
+   {
+      ++stats_.imageNumberGaps;
+      gapBefore_[slot] = 0;
+   }
+}
+
+void CircularBuffer::SetPackedStorage(bool enable)
+{
+   MMThreadGuard guard(g_bufferLock);
+   packedStorage_ = enable;
+}
+
+bool CircularBuffer::IsPackedStorageEnabled() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return packedStorage_;
+}
+
+unsigned CircularBuffer::GetPackedBitDepth() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return packedBits_;
+}
+
+// Caller holds g_bufferLock
+CircularBuffer::ReadScratch& CircularBuffer::ThreadReadScratch() const
+{
+   std::unique_ptr<ReadScratch>& scratch = readScratch_[std::this_thread::get_id()];
+   if (!scratch)
+      scratch.reset(new ReadScratch());
+   return *scratch;
+}
+
+// Returns img, or if images are packed, img unpacked into scratch. Caller
+// holds g_bufferLock, so the slot cannot be rewritten while unpacking.
+const mm::ImgBuffer* CircularBuffer::Unpacked(const mm::ImgBuffer* img,
+      mm::ImgBuffer& scratch) const
+{
+   if (!img || packedBits_ == 0)
+      return img;
+   scratch.Resize(img->Width(), img->Height(), 2);
+   mm::BitPacking::Unpack(const_cast<unsigned char*>(scratch.GetPixels()),
+         img->GetPixels(), (std::size_t)img->Width() * img->Height(), packedBits_);
+   scratch.SetMetadata(img->GetMetadata());
+   return &scratch;
+}
+
+// Like Unpacked(), but with a scratch image that lives until the slot is
+// unpinned. Caller holds g_bufferLock.
+const mm::ImgBuffer* CircularBuffer::UnpackedPinned(const mm::ImgBuffer* img,
+      unsigned long slot, unsigned channel)
+{
+   if (packedBits_ == 0)
+      return img;
+   std::unique_ptr<mm::ImgBuffer>& scratch = pinScratch_[std::make_pair(slot, channel)];
+   if (scratch) // Already pinned, and a pinned image does not change
+      return scratch.get();
+   scratch.reset(new mm::ImgBuffer(0, 0, 0));
+   return Unpacked(img, *scratch);
+}
+
+void CircularBuffer::SetThreadPool(std::shared_ptr<ThreadPool> pool)
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   if (!pool || pool == threadPool_)
+      return;
+   threadPool_ = pool;
+   tasksMemCopy_ = std::make_shared<TaskSet_CopyMemory>(threadPool_);
+   tasksStatistics_ = std::make_shared<TaskSet_PixelStatistics>(threadPool_);
+}
+
+void CircularBuffer::SetImageStatistics(bool enable, unsigned histogramBins)
+{
+   MMThreadGuard guard(g_bufferLock);
+   imageStatistics_ = enable;
+   histogramBins_ = histogramBins;
+}
+
+bool CircularBuffer::IsImageStatisticsEnabled() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return imageStatistics_;
+}
+
+bool CircularBuffer::GetLastImageStatistics(unsigned channel,
+      mm::PixelStatistics::Result& result) const
+{
+   MMThreadGuard guard(g_bufferLock);
+   if (channel >= lastImageStatistics_.size())
+      return false;
+   result = lastImageStatistics_[channel];
+   return true;
+}
+
+void CircularBuffer::SetSharedFrameRing(std::shared_ptr<mm::SharedFrameRing> ring)
+{
+   MMThreadGuard insertGuard(g_insertLock);
+   sharedFrameRing_ = ring;
 }
 
 unsigned long CircularBuffer::GetSize() const
 {
    MMThreadGuard guard(g_bufferLock);
-   return (unsigned long)frameArray_.size();
+   return frameCount_;
 }
 
 unsigned long CircularBuffer::GetFreeSize() const
 {
    MMThreadGuard guard(g_bufferLock);
-   long freeSize = (long)frameArray_.size() - (insertIndex_ - saveIndex_);
+   long freeSize = (long)frameCount_ - (insertIndex_ - saveIndex_);
    if (freeSize < 0)
       return 0;
    else
@@ -164,6 +407,34 @@ unsigned long CircularBuffer::GetRemainingImageCount() const
    return (unsigned long)(insertIndex_ - saveIndex_);
 }
 
+long CircularBuffer::GetImageCounter() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return imageCounter_;
+}
+
+long CircularBuffer::GetNextImageCounter() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return imageCounter_ - (insertIndex_ - saveIndex_);
+}
+
+static void PutStatisticsTags(Metadata& md, const mm::PixelStatistics::Result& stats)
+{
+   md.PutImageTag(MM::g_Keyword_Metadata_StatisticsMin, stats.minimum);
+   md.PutImageTag(MM::g_Keyword_Metadata_StatisticsMax, stats.maximum);
+   md.PutImageTag(MM::g_Keyword_Metadata_StatisticsMean, stats.mean);
+   md.PutImageTag(MM::g_Keyword_Metadata_StatisticsStdDev, stats.standardDeviation);
+   md.PutImageTag(MM::g_Keyword_Metadata_StatisticsSaturated, stats.saturatedCount);
+   if (!stats.histogram.empty())
+   {
+      MetadataArrayTag histogram(MM::g_Keyword_Metadata_StatisticsHistogram, "_", true);
+      for (unsigned long long count : stats.histogram)
+         histogram.AddValue(std::to_string(count).c_str());
+      md.SetTag(histogram);
+   }
+}
+
 static std::string FormatLocalTime(std::chrono::time_point<std::chrono::system_clock> tp) {
    using namespace std::chrono;
    auto us = duration_cast<microseconds>(tp.time_since_epoch());
@@ -224,6 +495,10 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
  
     mm::ImgBuffer* pImg;
     unsigned long singleChannelSize = (unsigned long)width * height * byteDepth;
+    std::string droppedImages;
+    unsigned packedBits;
+    bool statistics;
+    unsigned bitDepth, histogramBins;
  
     {
        MMThreadGuard guard(g_bufferLock);
@@ -231,23 +506,63 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
        // check image dimensions
        if (width != width_ || height != height_ || byteDepth != pixDepth_)
           throw CMMError("Incompatible image dimensions in the circular buffer", MMERR_CircularBufferIncompatibleImage);
+       if (numChannels > numChannels_)
+          throw CMMError("Incompatible number of channels in the circular buffer", MMERR_CircularBufferIncompatibleImage);
  
-       bool overflowed = (insertIndex_ - saveIndex_) >= static_cast<long>(frameArray_.size());
-       if (overflowed) {
-          overflow_ = true;
-          return false;
+       bool full = (insertIndex_ - saveIndex_) >= static_cast<long>(frameCount_);
+       bool pinned = !full && pinnedCount_ > 0 && pinCounts_[insertIndex_ % frameCount_] > 0;
+       if (full || pinned)
+       {
+          ++stats_.overflows;
+          if (frameCount_ == 0 || overflowPolicy_ == OverflowStop)
+          {
+             overflow_ = true;
+             ++stats_.droppedImages;
+             return false;
+          }
+
+          // The slot to be written is pinned, or the oldest frame is
+          // pinned and would be overwritten: the new frame must go
+          bool dropNewest = overflowPolicy_ == OverflowDropNewest ||
+             (pinnedCount_ > 0 && pinCounts_[insertIndex_ % frameCount_] > 0);
+          if (dropNewest)
+          {
+             ++stats_.droppedImages;
+             ++pendingGap_;
+             // Consume the image numbers, so that the gap is visible
+             if (pMd)
+             {
+                Metadata md(*pMd);
+                if (md.HasTag(MM::g_Keyword_Metadata_CameraLabel))
+                   imageNumbers_[md.GetSingleTag(MM::g_Keyword_Metadata_CameraLabel).GetValue()] += numChannels;
+             }
+             return true;
+          }
+          else if (overflowPolicy_ == OverflowClear)
+             DiscardUnread(insertIndex_ - saveIndex_);
+          else // OverflowOverwriteOldest
+             DiscardUnread(1);
        }
+
+       droppedImages = std::to_string(stats_.droppedImages);
+       packedBits = packedBits_;
+       statistics = imageStatistics_ &&
+          mm::PixelStatistics::IsSupported(byteDepth, nComponents);
+       bitDepth = bitDepth_;
+       histogramBins = histogramBins_;
     }
+
+    std::vector<mm::PixelStatistics::Result> frameStatistics;
  
     for (unsigned i=0; i<numChannels; i++)
     {
        Metadata md;
        {
           MMThreadGuard guard(g_bufferLock);
-          // we assume that all buffers are pre-allocated
-          pImg = frameArray_[insertIndex_ % frameArray_.size()].FindImage(i);
-          if (!pImg)
-             return false;
+          unsigned long slot = insertIndex_ % frameCount_;
+          unsigned char* pixels = slab_->Data() +
+             ((std::size_t)slot * numChannels_ + i) * channelStride_;
+          pImg = frameArray_[slot].AttachImage(i, pixels, width, height, byteDepth);
  
           if (pMd)
           {
@@ -282,6 +597,7 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
       auto now = std::chrono::system_clock::now();
       md.PutImageTag(MM::g_Keyword_Metadata_TimeInCore, FormatLocalTime(now));
 
+      md.PutImageTag(MM::g_Keyword_Metadata_DroppedImages, droppedImages);
       md.PutImageTag(MM::g_Keyword_Metadata_Width, width);
       md.PutImageTag(MM::g_Keyword_Metadata_Height, height);
       if (byteDepth == 1)
@@ -300,22 +616,42 @@ bool CircularBuffer::InsertMultiChannel(const unsigned char* pixArray, unsigned
       else
          md.PutImageTag(MM::g_Keyword_PixelType, MM::g_Keyword_PixelType_Unknown);
 
+      if (statistics)
+      {
+         frameStatistics.push_back(tasksStatistics_->Compute(
+                  pixArray + i * singleChannelSize, (std::size_t)width * height,
+                  byteDepth, nComponents, bitDepth, histogramBins));
+         PutStatisticsTags(md, frameStatistics.back());
+      }
+
       pImg->SetMetadata(md);
       //pImg->SetPixels(pixArray + i * singleChannelSize);
       // TODO: In MMCore the ImgBuffer::GetPixels() returns const pointer.
       //       It would be better to have something like ImgBuffer::GetPixelsRW() in MMDevice.
       //       Or even better - pass tasksMemCopy_ to ImgBuffer constructor
       //       and utilize parallel copy also in single snap acquisitions.
-      tasksMemCopy_->MemCopy((void*)pImg->GetPixels(),
-            pixArray + i * singleChannelSize, singleChannelSize);
+      if (packedBits > 0)
+         mm::BitPacking::Pack(const_cast<unsigned char*>(pImg->GetPixels()),
+               pixArray + i * singleChannelSize, (std::size_t)width * height, packedBits);
+      else
+         tasksMemCopy_->MemCopy((void*)pImg->GetPixels(),
+               pixArray + i * singleChannelSize, singleChannelSize);
+
+      if (sharedFrameRing_)
+         sharedFrameRing_->Publish(pixArray + i * singleChannelSize,
+               width, height, byteDepth, nComponents, i, md.Serialize());
    }
 
    {
       MMThreadGuard guard(g_bufferLock);
 
+      gapBefore_[insertIndex_ % frameCount_] = pendingGap_;
+      pendingGap_ = 0;
+      lastImageStatistics_.swap(frameStatistics);
+      ++stats_.insertedImages;
       imageCounter_++;
       insertIndex_++;
-      if ((insertIndex_ - (long)frameArray_.size()) > adjustThreshold && (saveIndex_- (long)frameArray_.size()) > adjustThreshold)
+      if ((insertIndex_ - (long)frameCount_) > adjustThreshold && (saveIndex_- (long)frameCount_) > adjustThreshold)
       {
          // adjust buffer indices to avoid overflowing integer size
          insertIndex_ -= adjustThreshold;
@@ -356,10 +692,13 @@ const mm::ImgBuffer* CircularBuffer::GetNthFromTopImageBuffer(long n,
 
    long targetIndex = insertIndex_ - n - 1L;
    while (targetIndex < 0)
-      targetIndex += (long) frameArray_.size();
-   targetIndex %= frameArray_.size();
+      targetIndex += (long) frameCount_;
+   targetIndex %= frameCount_;
 
-   return frameArray_[targetIndex].FindImage(channel);
+   const mm::ImgBuffer* img = frameArray_[targetIndex].FindImage(channel);
+   if (!img || packedBits_ == 0)
+      return img;
+   return Unpacked(img, ThreadReadScratch().top);
 }
 
 const unsigned char* CircularBuffer::GetNextImage()
@@ -378,7 +717,82 @@ const mm::ImgBuffer* CircularBuffer::GetNextImageBuffer(unsigned channel)
    if (availableImages < 1)
       return 0;
 
-   long targetIndex = saveIndex_ % frameArray_.size();
+   long targetIndex = saveIndex_ % frameCount_;
    ++saveIndex_;
-   return frameArray_[targetIndex].FindImage(channel);
+   CountReadGap(targetIndex);
+   const mm::ImgBuffer* img = frameArray_[targetIndex].FindImage(channel);
+   if (!img || packedBits_ == 0)
+      return img;
+   return Unpacked(img, ThreadReadScratch().next);
+}
+
+const mm::ImgBuffer* CircularBuffer::PinNextImageBuffer(unsigned channel,
+      unsigned long& slot)
+{
+   MMThreadGuard guard(g_bufferLock);
+
+   long availableImages = insertIndex_ - saveIndex_;
+   if (availableImages < 1)
+      return 0;
+
+   long targetIndex = saveIndex_ % frameCount_;
+   const mm::ImgBuffer* img = frameArray_[targetIndex].FindImage(channel);
+   if (!img)
+      return 0;
+   ++saveIndex_;
+   CountReadGap(targetIndex);
+   slot = targetIndex;
+   ++pinCounts_[slot];
+   ++pinnedCount_;
+   return UnpackedPinned(img, slot, channel);
+}
+
+const mm::ImgBuffer* CircularBuffer::PinTopImageBuffer(unsigned channel,
+      unsigned long& slot)
+{
+   MMThreadGuard guard(g_bufferLock);
+
+   if (insertIndex_ - saveIndex_ < 1)
+      return 0;
+
+   long targetIndex = (insertIndex_ - 1) % frameCount_;
+   const mm::ImgBuffer* img = frameArray_[targetIndex].FindImage(channel);
+   if (!img)
+      return 0;
+   slot = targetIndex;
+   ++pinCounts_[slot];
+   ++pinnedCount_;
+   return UnpackedPinned(img, slot, channel);
+}
+
+const mm::ImgBuffer* CircularBuffer::GetPinnedImageBuffer(unsigned long slot,
+      unsigned channel)
+{
+   MMThreadGuard guard(g_bufferLock);
+   if (slot >= pinCounts_.size() || pinCounts_[slot] == 0 ||
+         channel >= numChannels_)
+      return 0;
+   const mm::ImgBuffer* img = frameArray_[slot].FindImage(channel);
+   if (!img)
+      return 0;
+   return UnpackedPinned(img, slot, channel);
+}
+
+void CircularBuffer::UnpinImageBuffer(unsigned long slot)
+{
+   MMThreadGuard guard(g_bufferLock);
+   if (slot < pinCounts_.size() && pinCounts_[slot] > 0)
+   {
+      --pinCounts_[slot];
+      --pinnedCount_;
+      if (pinCounts_[slot] == 0 && !pinScratch_.empty())
+         pinScratch_.erase(pinScratch_.lower_bound(std::make_pair(slot, 0u)),
+               pinScratch_.upper_bound(std::make_pair(slot, ~0u)));
+   }
+}
+
+unsigned long CircularBuffer::GetPinnedImageCount() const
+{
+   MMThreadGuard guard(g_bufferLock);
+   return pinnedCount_;
 }
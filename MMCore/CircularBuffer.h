@@ -27,12 +27,17 @@
 #include "Error.h"
 #include "ErrorCodes.h"
 #include "FrameBuffer.h"
+#include "PixelStatistics.h"
 
 #include "../MMDevice/DeviceThreads.h"
 #include "../MMDevice/MMDevice.h"
 
 #include <chrono>
+#include <cstddef>
+#include <map>
 #include <memory>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #ifdef _MSC_VER
@@ -48,19 +53,59 @@
 
 class ThreadPool;
 class TaskSet_CopyMemory;
+class TaskSet_PixelStatistics;
+
+namespace mm {
+   class ImageSlab;
+   class SharedFrameRing;
+} // namespace mm
 
 class CircularBuffer
 {
 public:
-   CircularBuffer(unsigned int memorySizeMB);
+   // What InsertImage() does with a frame when the buffer is full, or the
+   // slot to be written is pinned
+   enum OverflowPolicy
+   {
+      OverflowStop,            // Reject the frame (insertion fails)
+      OverflowClear,           // Discard all unread frames
+      OverflowOverwriteOldest, // Discard the oldest unread frame
+      OverflowDropNewest,      // Discard the incoming frame
+   };
+
+   // Counts since the last Clear(), in frames (not channel images)
+   struct Statistics
+   {
+      unsigned long long insertedImages;
+      unsigned long long droppedImages; // Discarded by the overflow policy
+      unsigned long long overflows; // Inserts that found the buffer full
+      unsigned long long imageNumberGaps; // Gaps seen by GetNext/PinNext
+   };
+
+   // The images are stored in a single memory region of memorySizeMB, whose
+   // pages are backed by physical memory on first use (or in the background,
+   // with prefault). See mm::ImageSlab. Images are copied (and their statistics computed) on
+   // the threads of pool; without one, the buffer creates its own.
+   CircularBuffer(unsigned int memorySizeMB, bool hugePages = false,
+         bool prefault = false,
+         std::shared_ptr<ThreadPool> pool = std::shared_ptr<ThreadPool>());
    ~CircularBuffer();
 
    unsigned GetMemorySizeMB() const { return memorySizeMB_; }
+   bool UsesHugePages() const;
+   bool IsPrefaulted() const;
 
-   bool Initialize(unsigned channels, unsigned int xSize, unsigned int ySize, unsigned int pixDepth);
+   // bitDepth is the number of significant bits per pixel (as reported by
+   // the camera); 0 keeps the value last given
+   bool Initialize(unsigned channels, unsigned int xSize, unsigned int ySize, unsigned int pixDepth, unsigned bitDepth = 0);
    unsigned long GetSize() const;
    unsigned long GetFreeSize() const;
    unsigned long GetRemainingImageCount() const;
+   // Number of frames inserted since construction (not reset by Clear())
+   long GetImageCounter() const;
+   // GetImageCounter() as it was before the next unread frame was inserted;
+   // equal to GetImageCounter() if all frames have been read
+   long GetNextImageCounter() const;
 
    unsigned int Width() const {MMThreadGuard guard(g_bufferLock); return width_;}
    unsigned int Height() const {MMThreadGuard guard(g_bufferLock); return height_;}
@@ -77,9 +122,59 @@ public:
    const mm::ImgBuffer* GetNthFromTopImageBuffer(long n, unsigned channel) const;
    const mm::ImgBuffer* GetNextImageBuffer(unsigned channel);
    void Clear(); 
+   // Discards all unread frames, counted as dropped, as an overflow under
+   // OverflowClear does; unlike Clear(), keeps the statistics
+   void DiscardAllUnread();
+
+   // Pinned images are neither overwritten (the buffer overflows instead)
+   // nor deallocated (Initialize() fails if it would have to reallocate)
+   // until unpinned. Pins are counted, and slot identifies the image for
+   // UnpinImageBuffer().
+   const mm::ImgBuffer* PinNextImageBuffer(unsigned channel, unsigned long& slot);
+   const mm::ImgBuffer* PinTopImageBuffer(unsigned channel, unsigned long& slot);
+   // Another channel of a pinned frame, valid until the slot is unpinned;
+   // null if the slot is not pinned or has no such channel
+   const mm::ImgBuffer* GetPinnedImageBuffer(unsigned long slot, unsigned channel);
+   void UnpinImageBuffer(unsigned long slot);
+   unsigned long GetPinnedImageCount() const;
 
    bool Overflow() {MMThreadGuard guard(g_bufferLock); return overflow_;}
 
+   // With packed storage, 16-bit images of 10, 12, or 14 significant bits
+   // are stored bit-packed (see mm::BitPacking), so that more of them fit.
+   // Bits above the bit depth are discarded. Readers always see 16-bit
+   // images: these are unpacked into scratch images, one for the top image
+   // and one for the next image per reading thread (each valid until the
+   // thread's next call of the same kind), and one per pinned image (valid
+   // until unpinned). Takes effect at the next Initialize().
+   void SetPackedStorage(bool enable);
+   bool IsPackedStorageEnabled() const;
+   // The bit depth of the stored images if they are packed, otherwise 0
+   unsigned GetPackedBitDepth() const;
+
+   // The default is OverflowStop; with the other policies insertion does not
+   // fail because of overflow and Overflow() stays false.
+   void SetOverflowPolicy(OverflowPolicy policy);
+   OverflowPolicy GetOverflowPolicy() const;
+   Statistics GetStatistics() const;
+
+   // With image statistics, the pixel statistics of each image inserted
+   // (see mm::PixelStatistics) are computed, using the bit depth given to
+   // Initialize(), and attached to its metadata. Images of unsupported pixel
+   // types get no statistics. histogramBins must be a power of 2, or 0.
+   void SetImageStatistics(bool enable, unsigned histogramBins);
+   bool IsImageStatisticsEnabled() const;
+   // Statistics of the given channel of the last frame inserted since
+   // Clear(); false if it has none
+   bool GetLastImageStatistics(unsigned channel, mm::PixelStatistics::Result& result) const;
+
+   // Switches to another thread pool, once no insertion is in progress
+   void SetThreadPool(std::shared_ptr<ThreadPool> pool);
+
+   // Frames inserted while a ring is set are also exported to it (null to
+   // stop exporting)
+   void SetSharedFrameRing(std::shared_ptr<mm::SharedFrameRing> ring);
+
    mutable MMThreadLock g_bufferLock;
    mutable MMThreadLock g_insertLock;
 
@@ -87,23 +182,73 @@ private:
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
+   unsigned bitDepth_;
+   bool packedStorage_;
+   unsigned packedBits_; // Nonzero if the slab holds packed images
    long imageCounter_;
    std::chrono::time_point<std::chrono::steady_clock> startTime_;
    std::map<std::string, long> imageNumbers_;
 
    // Invariants:
    // 0 <= saveIndex_ <= insertIndex_
-   // insertIndex_ - saveIndex_ <= frameArray_.size()
+   // insertIndex_ - saveIndex_ <= frameCount_
    long insertIndex_;
    long saveIndex_;
 
    unsigned long memorySizeMB_;
+   bool hugePages_;
+   bool prefault_;
    unsigned int numChannels_;
    bool overflow_;
+
+   // Frame i, channel c is at offset (i * numChannels_ + c) * channelStride_
+   // in the slab. Only the first frameCount_ elements of frameArray_ are in
+   // use; the vector is not shrunk when the geometry changes, and its images
+   // are pointed at the slab when first written.
+   std::unique_ptr<mm::ImageSlab> slab_;
+   std::size_t channelStride_;
+   unsigned long frameCount_;
    std::vector<mm::FrameBuffer> frameArray_;
+   std::vector<unsigned> pinCounts_; // Per frame in use
+   unsigned long pinnedCount_;
+
+   OverflowPolicy overflowPolicy_;
+   Statistics stats_;
+   // Frames discarded just before the frame in each slot, counted as a gap
+   // when the frame is read; pendingGap_ is for the next frame inserted
+   std::vector<unsigned long> gapBefore_;
+   unsigned long pendingGap_;
+
+   void DiscardUnread(long count);
+   void CountReadGap(long slot);
+   bool NeedsReslice(unsigned channels, unsigned w, unsigned h, unsigned pixDepth, unsigned packedBits) const;
+   unsigned PackedBitsFor(unsigned pixDepth, unsigned bitDepth) const;
 
+   // Scratch images for unpacked reads; see SetPackedStorage()
+   struct ReadScratch
+   {
+      ReadScratch() : top(0, 0, 0), next(0, 0, 0) {}
+      mm::ImgBuffer top;
+      mm::ImgBuffer next;
+   };
+   // Per reading thread, so that concurrent readers do not overwrite each
+   // other's images once g_bufferLock is released
+   mutable std::map<std::thread::id, std::unique_ptr<ReadScratch>> readScratch_;
+   std::map<std::pair<unsigned long, unsigned>, std::unique_ptr<mm::ImgBuffer>> pinScratch_;
+
+   ReadScratch& ThreadReadScratch() const;
+   const mm::ImgBuffer* Unpacked(const mm::ImgBuffer* img, mm::ImgBuffer& scratch) const;
+   const mm::ImgBuffer* UnpackedPinned(const mm::ImgBuffer* img, unsigned long slot, unsigned channel);
+
+   // Guarded by g_insertLock
    std::shared_ptr<ThreadPool> threadPool_;
    std::shared_ptr<TaskSet_CopyMemory> tasksMemCopy_;
+
+   bool imageStatistics_;
+   unsigned histogramBins_;
+   std::vector<mm::PixelStatistics::Result> lastImageStatistics_; // Per channel
+   std::shared_ptr<TaskSet_PixelStatistics> tasksStatistics_;
+   std::shared_ptr<mm::SharedFrameRing> sharedFrameRing_; // Guarded by g_insertLock
 };
 
 #if defined(__GNUC__) && !defined(__clang__)
@@ -31,6 +31,7 @@
 #include "CircularBuffer.h"
 #include "CoreCallback.h"
 #include "DeviceManager.h"
+#include "ThreadPool.h"
 
 #include <cassert>
 #include <chrono>
@@ -93,6 +94,44 @@ CoreCallback::GetDevice(const MM::Device* caller, const char* label)
 }
 
 
+MM::DeviceHandle
+CoreCallback::GetDeviceHandle(const MM::Device* caller, const char* label)
+{
+   if (!caller || !label)
+      return 0;
+
+   try
+   {
+      std::shared_ptr<DeviceInstance> device =
+         core_->deviceManager_->GetDevice(label);
+      if (device->GetRawPtr() == caller)
+         return 0;
+      return core_->deviceManager_->GetDeviceHandle(device);
+   }
+   catch (const CMMError&)
+   {
+      return 0;
+   }
+}
+
+
+MM::Device*
+CoreCallback::GetDeviceByHandle(const MM::Device* caller, MM::DeviceHandle handle)
+{
+   if (!caller || handle == 0)
+      return 0;
+
+   std::shared_ptr<DeviceInstance> device =
+      core_->deviceManager_->GetDeviceByHandle(handle);
+   if (!device)
+      return 0;
+   MM::Device* pDevice = device->GetRawPtr();
+   if (pDevice == caller)
+      return 0;
+   return pDevice;
+}
+
+
 MM::PortType
 CoreCallback::GetSerialPortType(const char* portName) const
 {
@@ -225,6 +264,23 @@ CoreCallback::AddCameraMetadata(const MM::Device* caller, const Metadata* pMd)
    std::string label = camera->GetLabel();
    newMD.put(MM::g_Keyword_Metadata_CameraLabel, label);
 
+   {
+      // Attach (and consume) the exposure times reported for this frame
+      std::lock_guard<std::mutex> lock(cameraEventTimesMutex_);
+      std::map<std::string, CameraEventTimes>::iterator it =
+         cameraEventTimes_.find(label);
+      if (it != cameraEventTimes_.end())
+      {
+         if (it->second.hasExposureStart)
+            newMD.put(MM::g_Keyword_Metadata_ExposureStartTime,
+                  CDeviceUtils::ConvertToString(it->second.exposureStartUs));
+         if (it->second.hasExposureEnd)
+            newMD.put(MM::g_Keyword_Metadata_ExposureEndTime,
+                  CDeviceUtils::ConvertToString(it->second.exposureEndUs));
+         it->second = CameraEventTimes();
+      }
+   }
+
    std::string serializedMD;
    try
    {
@@ -260,6 +316,9 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
          MM::ImageProcessor* ip = GetImageProcessor(caller);
          if( NULL != ip)
          {
+            if (ip->IsProcessingAsynchronous())
+               return ip->ProcessAsync(buf, width, height, byteDepth, 1,
+                     md.Serialize().c_str());
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
@@ -292,6 +351,9 @@ int CoreCallback::InsertImage(const MM::Device* caller, const unsigned char* buf
          MM::ImageProcessor* ip = GetImageProcessor(caller);
          if( NULL != ip)
          {
+            if (ip->IsProcessingAsynchronous())
+               return ip->ProcessAsync(buf, width, height, byteDepth,
+                     nComponents, md.Serialize().c_str());
             ip->Process(const_cast<unsigned char*>(buf), width, height, byteDepth);
          }
       }
@@ -311,7 +373,8 @@ int CoreCallback::InsertImage(const MM::Device* caller, const ImgBuffer & imgBuf
    Metadata md = imgBuf.GetMetadata();
    unsigned char* p = const_cast<unsigned char*>(imgBuf.GetPixels());
    MM::ImageProcessor* ip = GetImageProcessor(caller);
-   if( NULL != ip)
+   // An asynchronous processor gets the image in the call below
+   if( NULL != ip && !ip->IsProcessingAsynchronous())
    {
       ip->Process(p, imgBuf.Width(), imgBuf.Height(), imgBuf.Depth());
    }
@@ -320,9 +383,33 @@ int CoreCallback::InsertImage(const MM::Device* caller, const ImgBuffer & imgBuf
       imgBuf.Height(), imgBuf.Depth(), &md);
 }
 
+int CoreCallback::InsertProcessedImage(const MM::Device* /*caller*/, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata)
+{
+   try
+   {
+      Metadata md;
+      md.Restore(serializedMetadata);
+      if (core_->cbuf_->InsertImage(buf, width, height, byteDepth, nComponents, &md))
+         return DEVICE_OK;
+      else
+         return DEVICE_BUFFER_OVERFLOW;
+   }
+   catch (CMMError& /*e*/)
+   {
+      return DEVICE_INCOMPATIBLE_IMAGE;
+   }
+}
+
+/**
+ * Many cameras call this, then insert the image again, when insertion fails
+ * with DEVICE_BUFFER_OVERFLOW. That is the Clear overflow policy, so it is
+ * applied (with drop accounting) only under that policy; under the others the
+ * retry fails again, as the policy requires.
+ */
 void CoreCallback::ClearImageBuffer(const MM::Device* /*caller*/)
 {
-   core_->cbuf_->Clear();
+   if (core_->cbuf_->GetOverflowPolicy() == CircularBuffer::OverflowClear)
+      core_->cbuf_->DiscardAllUnread();
 }
 
 bool CoreCallback::InitializeImageBuffer(unsigned channels, unsigned slices,
@@ -350,6 +437,13 @@ int CoreCallback::InsertMultiChannel(const MM::Device* caller,
       MM::ImageProcessor* ip = GetImageProcessor(caller);
       if( NULL != ip)
       {
+         // Asynchronous processors take single images only
+         if (ip->IsProcessingAsynchronous())
+         {
+            LOG_ERROR(core_->coreLogger_) <<
+               "Multi-channel images cannot be processed asynchronously";
+            return DEVICE_UNSUPPORTED_COMMAND;
+         }
          ip->Process( const_cast<unsigned char*>(buf), width, height, byteDepth);
       }
       if (core_->cbuf_->InsertMultiChannel(buf, numChannels, width, height, byteDepth, &md))
@@ -378,6 +472,16 @@ int CoreCallback::AcqFinished(const MM::Device* caller, int /*statusCode*/)
       return DEVICE_ERR;
    }
 
+   // Images still being processed belong to the acquisition
+   MM::ImageProcessor* ip = GetImageProcessor(caller);
+   if (ip)
+   {
+      int ret = ip->FinishAsyncProcessing();
+      if (ret != DEVICE_OK)
+         LOG_ERROR(core_->coreLogger_) << "Image processor failed to insert "
+            "images at the end of the acquisition (error " << ret << ")";
+   }
+
    std::shared_ptr<DeviceInstance> currentCamera =
       core_->currentCameraDevice_.lock();
 
@@ -636,6 +740,56 @@ int CoreCallback::OnSLMExposureChanged(const MM::Device* device, double newExpos
    return DEVICE_OK;
 }
 
+/**
+ * Handler for camera trigger configuration changes
+ */
+int CoreCallback::OnCameraTriggerChanged(const MM::Device* device, int triggerSelector, int triggerMode, int triggerSource)
+{
+   if (core_->externalCallback_) {
+      char label[MM::MaxStrLength];
+      device->GetLabel(label);
+      core_->externalCallback_->onCameraTriggerChanged(label, triggerSelector, triggerMode, triggerSource);
+   }
+   return DEVICE_OK;
+}
+
+/**
+ * Handler for camera events (trigger API). Timestamps the event and keeps
+ * the exposure start/end times so that they can be added to the metadata of
+ * the next frame inserted by the camera.
+ * Called on the camera's thread, so must not do anything lengthy.
+ */
+int CoreCallback::OnCameraEvent(const MM::Device* device, int eventType)
+{
+   const double timestampUs = GetCurrentMMTime().getUsec();
+
+   char label[MM::MaxStrLength];
+   device->GetLabel(label);
+
+   if (eventType == MM::CameraEventExposureStart ||
+         eventType == MM::CameraEventExposureEnd)
+   {
+      std::lock_guard<std::mutex> lock(cameraEventTimesMutex_);
+      CameraEventTimes& times = cameraEventTimes_[label];
+      if (eventType == MM::CameraEventExposureStart)
+      {
+         // A new exposure: discard an end time left over from the previous one
+         times.hasExposureStart = true;
+         times.exposureStartUs = timestampUs;
+         times.hasExposureEnd = false;
+      }
+      else
+      {
+         times.hasExposureEnd = true;
+         times.exposureEndUs = timestampUs;
+      }
+   }
+
+   if (core_->externalCallback_)
+      core_->externalCallback_->onCameraEvent(label, eventType, timestampUs);
+   return DEVICE_OK;
+}
+
 /**
  * Handler for magnifier changer
  * 
@@ -734,6 +888,33 @@ int CoreCallback::ReadFromSerial(const MM::Device* caller, const char* portName,
    return pSerial->Read(buf, bufLength, bytesRead);
 }
 
+/**
+ * Reads bytes from the serial port, waiting up to timeoutMs for data to
+ * arrive if none is available.
+ */
+int CoreCallback::ReadFromSerialWithTimeout(const MM::Device* caller, const char* portName, unsigned char* buf, unsigned long bufLength, unsigned long &bytesRead, long timeoutMs)
+{
+   std::shared_ptr<SerialInstance> pSerial;
+   try
+   {
+      pSerial = core_->deviceManager_->GetDeviceOfType<SerialInstance>(portName);
+   }
+   catch (CMMError& err)
+   {
+      return err.getCode();    
+   }
+   catch (...)
+   {
+      return DEVICE_SERIAL_COMMAND_FAILED;
+   }
+
+   // don't allow self reference
+   if (pSerial->GetRawPtr() == caller)
+      return DEVICE_SELF_REFERENCE;
+
+   return pSerial->ReadWithTimeout(buf, bufLength, bytesRead, timeoutMs);
+}
+
 /**
  * Clears port buffers.
  */
@@ -1077,3 +1258,40 @@ MM::MMTime CoreCallback::GetCurrentMMTime()
 {
    return MM::MMTime::fromUs(SteadyMicroseconds());
 }
+
+/**
+ * Runs work->Run() over [0, count) on the core's worker threads (see
+ * CMMCore::setWorkerThreadCount()) and the calling thread, in chunks of at
+ * least grainSize items. Returns once all chunks are done.
+ */
+int CoreCallback::ParallelFor(const MM::Device* /*caller*/, MM::ParallelWork* work,
+      unsigned long count, unsigned long grainSize)
+{
+   if (!work)
+      return DEVICE_INVALID_INPUT_PARAM;
+   std::shared_ptr<ThreadPool> pool = core_->getThreadPool();
+   try
+   {
+      pool->ParallelFor(0, count, grainSize,
+            [work](size_t begin, size_t end) {
+               work->Run(static_cast<unsigned long>(begin),
+                     static_cast<unsigned long>(end));
+            });
+   }
+   catch (const std::exception& e)
+   {
+      LOG_ERROR(core_->coreLogger_) << "Parallel work failed: " << e.what();
+      return DEVICE_ERR;
+   }
+   catch (...)
+   {
+      LOG_ERROR(core_->coreLogger_) << "Parallel work failed";
+      return DEVICE_ERR;
+   }
+   return DEVICE_OK;
+}
+
+unsigned CoreCallback::GetWorkerThreadCount(const MM::Device* /*caller*/)
+{
+   return static_cast<unsigned>(core_->getThreadPool()->GetSize());
+}
@@ -30,6 +30,10 @@
 #include "MMEventCallback.h"
 #include "../MMDevice/DeviceUtils.h"
 
+#include <map>
+#include <mutex>
+#include <string>
+
 namespace mm
 {
    class DeviceManager;
@@ -59,6 +63,8 @@ public:
     * Returns a direct pointer to the device with the specified name.
     */
    MM::Device* GetDevice(const MM::Device* caller, const char* label);
+   MM::DeviceHandle GetDeviceHandle(const MM::Device* caller, const char* label);
+   MM::Device* GetDeviceByHandle(const MM::Device* caller, MM::DeviceHandle handle);
 
    MM::PortType GetSerialPortType(const char* portName) const;
  
@@ -72,6 +78,7 @@ public:
 
    int WriteToSerial(const MM::Device* caller, const char* portName, const unsigned char* buf, unsigned long length);
    int ReadFromSerial(const MM::Device* caller, const char* portName, unsigned char* buf, unsigned long bufLength, unsigned long &bytesRead);
+   int ReadFromSerialWithTimeout(const MM::Device* caller, const char* portName, unsigned char* buf, unsigned long bufLength, unsigned long &bytesRead, long timeoutMs);
    int PurgeSerial(const MM::Device* caller, const char* portName);
    int SetSerialCommand(const MM::Device*, const char* portName, const char* command, const char* term);
    int GetSerialAnswer(const MM::Device*, const char* portName, unsigned long ansLength, char* answerTxt, const char* term);
@@ -80,6 +87,9 @@ public:
 
    MM::MMTime GetCurrentMMTime();
 
+   int ParallelFor(const MM::Device* caller, MM::ParallelWork* work, unsigned long count, unsigned long grainSize);
+   unsigned GetWorkerThreadCount(const MM::Device* caller);
+
    void Sleep(const MM::Device* caller, double intervalMs);
 
    // continuous acquisition support
@@ -91,6 +101,7 @@ public:
    /*Deprecated*/ int InsertImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const Metadata* pMd = 0, const bool doProcess = true);
 
    /*Deprecated*/ int InsertMultiChannel(const MM::Device* caller, const unsigned char* buf, unsigned numChannels, unsigned width, unsigned height, unsigned byteDepth, Metadata* pMd = 0);
+   int InsertProcessedImage(const MM::Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata);
    void ClearImageBuffer(const MM::Device* caller);
    bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth);
 
@@ -120,6 +131,8 @@ public:
    int OnExposureChanged(const MM::Device* device, double newExposure);
    int OnSLMExposureChanged(const MM::Device* device, double newExposure);
    int OnMagnifierChanged(const MM::Device* device);
+   int OnCameraTriggerChanged(const MM::Device* device, int triggerSelector, int triggerMode, int triggerSource);
+   int OnCameraEvent(const MM::Device* device, int eventType);
 
 
    void NextPostedError(int& errorCode, char* pMessage, int maxlen, int& messageLength);
@@ -140,6 +153,20 @@ private:
    CMMCore* core_;
    MMThreadLock* pValueChangeLock_;
 
+   // Exposure start/end times reported through OnCameraEvent() and not yet
+   // attached to an inserted frame, per camera label
+   struct CameraEventTimes
+   {
+      CameraEventTimes() : hasExposureStart(false), hasExposureEnd(false),
+         exposureStartUs(0.0), exposureEndUs(0.0) {}
+      bool hasExposureStart;
+      bool hasExposureEnd;
+      double exposureStartUs;
+      double exposureEndUs;
+   };
+   std::mutex cameraEventTimesMutex_;
+   std::map<std::string, CameraEventTimes> cameraEventTimes_;
+
    Metadata AddCameraMetadata(const MM::Device* caller, const Metadata* pMd);
 
    int OnConfigGroupChanged(const char* groupName, const char* newConfigName);
@@ -75,6 +75,9 @@ DeviceManager::LoadDevice(std::shared_ptr<LoadedDeviceAdapter> module,
 
    devices_.push_back(std::make_pair(label, device));
    deviceRawPtrIndex_.insert(std::make_pair(device->GetRawPtr(), device));
+   const MM::DeviceHandle handle = nextDeviceHandle_++;
+   deviceHandleIndex_.insert(std::make_pair(handle, device));
+   deviceHandles_.insert(std::make_pair(device->GetRawPtr(), handle));
    return device;
 }
 
@@ -91,6 +94,13 @@ DeviceManager::UnloadDevice(std::shared_ptr<DeviceInstance> device)
       {
          device->Shutdown(); // TODO Should be automatic
          deviceRawPtrIndex_.erase(it->second->GetRawPtr());
+         std::map<const MM::Device*, MM::DeviceHandle>::iterator handleIt =
+            deviceHandles_.find(it->second->GetRawPtr());
+         if (handleIt != deviceHandles_.end())
+         {
+            deviceHandleIndex_.erase(handleIt->second);
+            deviceHandles_.erase(handleIt);
+         }
          devices_.erase(it);
          break;
       }
@@ -141,6 +151,8 @@ DeviceManager::UnloadAllDevices()
    }
 
    deviceRawPtrIndex_.clear();
+   deviceHandleIndex_.clear();
+   deviceHandles_.clear();
    devices_.clear();
 
    // Now the only remaining references to the device objects should be in
@@ -206,6 +218,29 @@ DeviceManager::GetDevice(const MM::Device* rawPtr) const
 }
 
 
+MM::DeviceHandle
+DeviceManager::GetDeviceHandle(std::shared_ptr<DeviceInstance> device) const
+{
+   std::map<const MM::Device*, MM::DeviceHandle>::const_iterator it =
+      deviceHandles_.find(device->GetRawPtr());
+   if (it == deviceHandles_.end())
+      throw CMMError("Device " + ToQuotedString(device->GetLabel()) +
+            " has no handle");
+   return it->second;
+}
+
+
+std::shared_ptr<DeviceInstance>
+DeviceManager::GetDeviceByHandle(MM::DeviceHandle handle) const
+{
+   typedef std::map< MM::DeviceHandle, std::weak_ptr<DeviceInstance> >::const_iterator Iterator;
+   Iterator it = deviceHandleIndex_.find(handle);
+   if (it == deviceHandleIndex_.end())
+      return std::shared_ptr<DeviceInstance>();
+   return it->second.lock();
+}
+
+
 std::vector<std::string>
 DeviceManager::GetDeviceList(MM::DeviceType type) const
 {
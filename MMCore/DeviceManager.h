@@ -52,7 +52,15 @@ class DeviceManager /* final */
    // where we need to retrieve device information from raw pointers.
    std::map< const MM::Device*, std::weak_ptr<DeviceInstance> > deviceRawPtrIndex_;
 
+   // Handles given out to devices (MM::Core::GetDeviceHandle()). A handle is
+   // assigned at load time, removed from the index on unload, and never
+   // reused, so that a stale handle cannot refer to a different device.
+   std::map< MM::DeviceHandle, std::weak_ptr<DeviceInstance> > deviceHandleIndex_;
+   std::map< const MM::Device*, MM::DeviceHandle > deviceHandles_;
+   MM::DeviceHandle nextDeviceHandle_;
+
 public:
+   DeviceManager() : nextDeviceHandle_(1) {}
    ~DeviceManager();
 
    /**
@@ -110,6 +118,19 @@ public:
     */
    std::shared_ptr<DeviceInstance> GetDevice(const MM::Device* rawPtr) const;
 
+   /**
+    * \brief Get the handle of a loaded device.
+    */
+   MM::DeviceHandle GetDeviceHandle(std::shared_ptr<DeviceInstance> device) const;
+
+   /**
+    * \brief Get a device by handle.
+    *
+    * \return The device, or null if the handle is invalid or the device has
+    * been unloaded.
+    */
+   std::shared_ptr<DeviceInstance> GetDeviceByHandle(MM::DeviceHandle handle) const;
+
    /**
     * \brief Get the labels of all loaded devices of a given type.
     */
@@ -153,4 +153,16 @@ int CameraInstance::StartExposureSequence() { RequireInitialized(__func__); retu
 int CameraInstance::StopExposureSequence() { RequireInitialized(__func__); return GetImpl()->StopExposureSequence(); }
 int CameraInstance::ClearExposureSequence() { RequireInitialized(__func__); return GetImpl()->ClearExposureSequence(); }
 int CameraInstance::AddToExposureSequence(double exposureTime_ms) { RequireInitialized(__func__); return GetImpl()->AddToExposureSequence(exposureTime_ms); }
+int CameraInstance::AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count)
+{ RequireInitialized(__func__); return GetImpl()->AddArrayToExposureSequence(exposureTimes_ms, count); }
 int CameraInstance::SendExposureSequence() const { RequireInitialized(__func__); return GetImpl()->SendExposureSequence(); }
+
+bool CameraInstance::IsTriggerAPIImplemented() { RequireInitialized(__func__); return GetImpl()->IsTriggerAPIImplemented(); }
+bool CameraInstance::HasTrigger(int triggerSelector) { RequireInitialized(__func__); return GetImpl()->HasTrigger(triggerSelector); }
+int CameraInstance::SetTriggerState(int triggerSelector, int triggerMode, int triggerSource, double triggerDelayUs, int triggerActivation, int triggerOverlap) { RequireInitialized(__func__); return GetImpl()->SetTriggerState(triggerSelector, triggerMode, triggerSource, triggerDelayUs, triggerActivation, triggerOverlap); }
+int CameraInstance::GetTriggerState(int triggerSelector, int& triggerMode, int& triggerSource, double& triggerDelayUs, int& triggerActivation, int& triggerOverlap) { RequireInitialized(__func__); return GetImpl()->GetTriggerState(triggerSelector, triggerMode, triggerSource, triggerDelayUs, triggerActivation, triggerOverlap); }
+int CameraInstance::TriggerSoftware(int triggerSelector) { RequireInitialized(__func__); return GetImpl()->TriggerSoftware(triggerSelector); }
+int CameraInstance::AcquisitionArm(int frameCount, double acquisitionFrameRate, int burstFrameCount) { RequireInitialized(__func__); return GetImpl()->AcquisitionArm(frameCount, acquisitionFrameRate, burstFrameCount); }
+int CameraInstance::AcquisitionStart() { RequireInitialized(__func__); return GetImpl()->AcquisitionStart(); }
+int CameraInstance::AcquisitionStop() { RequireInitialized(__func__); return GetImpl()->AcquisitionStop(); }
+int CameraInstance::AcquisitionAbort() { RequireInitialized(__func__); return GetImpl()->AcquisitionAbort(); }
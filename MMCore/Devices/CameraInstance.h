@@ -81,5 +81,18 @@ public:
    int StopExposureSequence();
    int ClearExposureSequence();
    int AddToExposureSequence(double exposureTime_ms);
+   int AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count);
    int SendExposureSequence() const;
+
+   bool IsTriggerAPIImplemented();
+   bool HasTrigger(int triggerSelector);
+   int SetTriggerState(int triggerSelector, int triggerMode, int triggerSource,
+         double triggerDelayUs, int triggerActivation, int triggerOverlap);
+   int GetTriggerState(int triggerSelector, int& triggerMode, int& triggerSource,
+         double& triggerDelayUs, int& triggerActivation, int& triggerOverlap);
+   int TriggerSoftware(int triggerSelector);
+   int AcquisitionArm(int frameCount, double acquisitionFrameRate, int burstFrameCount);
+   int AcquisitionStart();
+   int AcquisitionStop();
+   int AcquisitionAbort();
 };
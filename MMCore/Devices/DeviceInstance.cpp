@@ -177,10 +177,9 @@ DeviceInstance::GetProperty(const std::string& name) const
 }
 
 void
-DeviceInstance::SetProperty(const std::string& name,
-      const std::string& value) const
+DeviceInstance::CheckPropertyNotPreInit(const char* name) const
 {
-   if (initialized_ && GetPropertyInitStatus(name.c_str())) {
+   if (initialized_ && GetPropertyInitStatus(name)) {
       // Note: Some features (port scanning) may depend on setting serial port
       // properties post-init. We may want to exclude SerialManager from this
       // check (regardless of whether strictInitializationChecks is enabled).
@@ -194,6 +193,13 @@ DeviceInstance::SetProperty(const std::string& name,
             ") not permitted on initialized device (this will be an error in a future version of MMCore; for now we continue with the operation anyway, even though it might not be safe)";
       }
    }
+}
+
+void
+DeviceInstance::SetProperty(const std::string& name,
+      const std::string& value) const
+{
+   CheckPropertyNotPreInit(name.c_str());
 
    LOG_DEBUG(Logger()) << "Will set property \"" << name << "\" to \"" <<
       value << "\"";
@@ -207,6 +213,59 @@ DeviceInstance::SetProperty(const std::string& name,
       value << "\"";
 }
 
+template <typename T>
+void
+DeviceInstance::SetNumericProperty(const char* name, T value,
+      const std::string& valueString,
+      int (MM::Device::*setter)(const char*, T)) const
+{
+   CheckPropertyNotPreInit(name);
+
+   LOG_DEBUG(Logger()) << "Will set property \"" << name << "\" to \"" <<
+      valueString << "\"";
+
+   int err = (pImpl_->*setter)(name, value);
+   if (err == DEVICE_INVALID_PROPERTY_TYPE)
+      err = pImpl_->SetProperty(name, valueString.c_str());
+
+   ThrowIfError(err, "Cannot set property " + ToQuotedString(name) +
+         " to " + ToQuotedString(valueString));
+
+   LOG_DEBUG(Logger()) << "Did set property \"" << name << "\" to \"" <<
+      valueString << "\"";
+}
+
+template <typename T>
+bool
+DeviceInstance::GetNumericProperty(const char* name, T& value,
+      int (MM::Device::*getter)(const char*, T&) const) const
+{
+   int err = (pImpl_->*getter)(name, value);
+   if (err == DEVICE_INVALID_PROPERTY_TYPE)
+      return false;
+   ThrowIfError(err, "Cannot get value of property " +
+         ToQuotedString(name));
+   return true;
+}
+
+bool
+DeviceInstance::GetPropertyDouble(const char* name, double& value) const
+{ return GetNumericProperty(name, value, &MM::Device::GetPropertyDouble); }
+
+void
+DeviceInstance::SetPropertyDouble(const char* name, double value,
+      const std::string& valueString) const
+{ SetNumericProperty(name, value, valueString, &MM::Device::SetPropertyDouble); }
+
+bool
+DeviceInstance::GetPropertyLong(const char* name, long& value) const
+{ return GetNumericProperty(name, value, &MM::Device::GetPropertyLong); }
+
+void
+DeviceInstance::SetPropertyLong(const char* name, long value,
+      const std::string& valueString) const
+{ SetNumericProperty(name, value, valueString, &MM::Device::SetPropertyLong); }
+
 bool
 DeviceInstance::HasProperty(const std::string& name) const
 { return pImpl_->HasProperty(name.c_str()); }
@@ -329,6 +388,12 @@ DeviceInstance::AddToPropertySequence(const char* propertyName, const char* valu
    ThrowIfError(pImpl_->AddToPropertySequence(propertyName, value));
 }
 
+void
+DeviceInstance::AddArrayToPropertySequence(const char* propertyName, const double* values, unsigned long count)
+{
+   ThrowIfError(pImpl_->AddArrayToPropertySequence(propertyName, values, count));
+}
+
 void
 DeviceInstance::SendPropertySequence(const char* propertyName)
 {
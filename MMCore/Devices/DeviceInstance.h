@@ -186,8 +186,26 @@ private:
 public:
    std::string GetProperty(const std::string& name) const;
    void SetProperty(const std::string& name, const std::string& value) const;
+   // Numeric access without string conversion where the device supports
+   // it. The setters use valueString for logging and for properties that
+   // must be set as strings; the getters return false if the property must
+   // be read as a string.
+   bool GetPropertyDouble(const char* name, double& value) const;
+   void SetPropertyDouble(const char* name, double value,
+         const std::string& valueString) const;
+   bool GetPropertyLong(const char* name, long& value) const;
+   void SetPropertyLong(const char* name, long value,
+         const std::string& valueString) const;
    bool HasProperty(const std::string& name) const;
 private:
+   void CheckPropertyNotPreInit(const char* name) const;
+   template <typename T>
+   void SetNumericProperty(const char* name, T value,
+         const std::string& valueString,
+         int (MM::Device::*setter)(const char*, T)) const;
+   template <typename T>
+   bool GetNumericProperty(const char* name, T& value,
+         int (MM::Device::*getter)(const char*, T&) const) const;
    // Exposed through GetPropertyNames() only
    std::string GetPropertyName(size_t idx) const;
 public:
@@ -205,6 +223,7 @@ public:
    void StopPropertySequence(const char* propertyName);
    void ClearPropertySequence(const char* propertyName);
    void AddToPropertySequence(const char* propertyName, const char* value);
+   void AddArrayToPropertySequence(const char* propertyName, const double* values, unsigned long count);
    void SendPropertySequence(const char* propertyName);
    std::string GetErrorText(int code) const;
    bool Busy();
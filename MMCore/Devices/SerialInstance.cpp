@@ -27,4 +27,5 @@ int SerialInstance::SetCommand(const char* command, const char* term) { RequireI
 int SerialInstance::GetAnswer(char* txt, unsigned maxChars, const char* term) { RequireInitialized(__func__); return GetImpl()->GetAnswer(txt, maxChars, term); }
 int SerialInstance::Write(const unsigned char* buf, unsigned long bufLen) { RequireInitialized(__func__); return GetImpl()->Write(buf, bufLen); }
 int SerialInstance::Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead) { RequireInitialized(__func__); return GetImpl()->Read(buf, bufLen, charsRead); }
+int SerialInstance::ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs) { RequireInitialized(__func__); return GetImpl()->ReadWithTimeout(buf, bufLen, charsRead, timeoutMs); }
 int SerialInstance::Purge() { RequireInitialized(__func__); return GetImpl()->Purge(); }
@@ -41,5 +41,6 @@ public:
    int GetAnswer(char* txt, unsigned maxChars, const char* term);
    int Write(const unsigned char* buf, unsigned long bufLen);
    int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead);
+   int ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs);
    int Purge();
 };
@@ -33,4 +33,6 @@ int SignalIOInstance::StartDASequence() { RequireInitialized(__func__); return G
 int SignalIOInstance::StopDASequence() { RequireInitialized(__func__); return GetImpl()->StopDASequence(); }
 int SignalIOInstance::ClearDASequence() { RequireInitialized(__func__); return GetImpl()->ClearDASequence(); }
 int SignalIOInstance::AddToDASequence(double voltage) { RequireInitialized(__func__); return GetImpl()->AddToDASequence(voltage); }
+int SignalIOInstance::AddArrayToDASequence(const double* voltages, unsigned long count)
+{ RequireInitialized(__func__); return GetImpl()->AddArrayToDASequence(voltages, count); }
 int SignalIOInstance::SendDASequence() { RequireInitialized(__func__); return GetImpl()->SendDASequence(); }
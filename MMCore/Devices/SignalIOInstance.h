@@ -47,5 +47,6 @@ public:
    int StopDASequence();
    int ClearDASequence();
    int AddToDASequence(double voltage);
+   int AddArrayToDASequence(const double* voltages, unsigned long count);
    int SendDASequence();
 };
@@ -65,6 +65,8 @@ int StageInstance::StartStageSequence() { RequireInitialized(__func__); return G
 int StageInstance::StopStageSequence() { RequireInitialized(__func__); return GetImpl()->StopStageSequence(); }
 int StageInstance::ClearStageSequence() { RequireInitialized(__func__); return GetImpl()->ClearStageSequence(); }
 int StageInstance::AddToStageSequence(double position) { RequireInitialized(__func__); return GetImpl()->AddToStageSequence(position); }
+int StageInstance::AddArrayToStageSequence(const double* positions, unsigned long count)
+{ RequireInitialized(__func__); return GetImpl()->AddArrayToStageSequence(positions, count); }
 int StageInstance::SendStageSequence() { RequireInitialized(__func__); return GetImpl()->SendStageSequence(); }
 int StageInstance::SetStageLinearSequence(double dZ_um, long nSlices)
 { RequireInitialized(__func__); return GetImpl()->SetStageLinearSequence(dZ_um, nSlices); }
\ No newline at end of file
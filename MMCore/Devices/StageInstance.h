@@ -60,6 +60,7 @@ public:
    int StopStageSequence();
    int ClearStageSequence();
    int AddToStageSequence(double position);
+   int AddArrayToStageSequence(const double* positions, unsigned long count);
    int SendStageSequence();
    int SetStageLinearSequence(double dZ_um, long nSlices);
 };
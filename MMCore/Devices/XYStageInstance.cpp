@@ -45,4 +45,6 @@ int XYStageInstance::StartXYStageSequence() { RequireInitialized(__func__); retu
 int XYStageInstance::StopXYStageSequence() { RequireInitialized(__func__); return GetImpl()->StopXYStageSequence(); }
 int XYStageInstance::ClearXYStageSequence() { RequireInitialized(__func__); return GetImpl()->ClearXYStageSequence(); }
 int XYStageInstance::AddToXYStageSequence(double positionX, double positionY) { RequireInitialized(__func__); return GetImpl()->AddToXYStageSequence(positionX, positionY); }
+int XYStageInstance::AddArrayToXYStageSequence(const double* positionsX, const double* positionsY, unsigned long count)
+{ RequireInitialized(__func__); return GetImpl()->AddArrayToXYStageSequence(positionsX, positionsY, count); }
 int XYStageInstance::SendXYStageSequence() { RequireInitialized(__func__); return GetImpl()->SendXYStageSequence(); }
@@ -59,5 +59,6 @@ public:
    int StopXYStageSequence();
    int ClearXYStageSequence();
    int AddToXYStageSequence(double positionX, double positionY);
+   int AddArrayToXYStageSequence(const double* positionsX, const double* positionsY, unsigned long count);
    int SendXYStageSequence();
 };
@@ -0,0 +1,445 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Writes sequence acquisition images from the circular buffer
+//                to disk
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "DiskStreamWriter.h"
+
+#include "CircularBuffer.h"
+#include "Error.h"
+#include "ErrorCodes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mm {
+
+namespace {
+
+// Unbuffered writes must be aligned to the (physical) sector size; 4 KiB
+// covers both 512 B and 4 KiB sectors
+const std::size_t alignment = 4096;
+
+const std::size_t stagingBlockSize = 8 * 1024 * 1024;
+
+// How long the drain thread sleeps when the buffer is empty
+const std::chrono::microseconds pollInterval(500);
+
+unsigned char* AllocateAligned(std::size_t size)
+{
+#ifdef _WIN32
+   void* p = _aligned_malloc(size, alignment);
+#else
+   void* p = 0;
+   if (posix_memalign(&p, alignment, size) != 0)
+      p = 0;
+#endif
+   if (!p)
+      throw std::bad_alloc();
+   return static_cast<unsigned char*>(p);
+}
+
+void FreeAligned(unsigned char* p)
+{
+#ifdef _WIN32
+   _aligned_free(p);
+#else
+   std::free(p);
+#endif
+}
+
+std::string SystemErrorMessage()
+{
+#ifdef _WIN32
+   return "Windows error " + std::to_string(GetLastError());
+#else
+   return std::strerror(errno);
+#endif
+}
+
+} // anonymous namespace
+
+DiskStreamWriter::DiskStreamWriter(CircularBuffer& buffer,
+      const std::string& basePath, unsigned writerThreads) :
+   buffer_(buffer),
+   basePath_(basePath),
+#ifdef _WIN32
+   file_(INVALID_HANDLE_VALUE),
+#else
+   fd_(-1),
+#endif
+   unbuffered_(false),
+   blockSize_(stagingBlockSize),
+   current_(0),
+   currentFill_(0),
+   nextOffset_(0),
+   stopWriters_(false),
+   stopDrain_(false),
+   stopImageCounter_(0),
+   stopped_(false),
+   failed_(false),
+   imageCount_(0),
+   bytesWritten_(0)
+{
+   if (writerThreads == 0)
+      writerThreads = 1;
+
+   OpenRawFile(basePath_ + ".raw");
+   index_.open((basePath_ + ".idx").c_str(),
+         std::ios::out | std::ios::trunc | std::ios::binary);
+   if (!index_)
+   {
+      CloseRawFile(0);
+      throw CMMError("Cannot create image stream index file " + basePath_ +
+            ".idx", MMERR_DiskStreamingFailed);
+   }
+   index_ << "MMSTREAM 2\n";
+
+   try
+   {
+      // Enough blocks to keep every writer busy while the next ones fill
+      const unsigned blockCount = 2 * writerThreads + 2;
+      for (unsigned i = 0; i < blockCount; ++i)
+      {
+         blocks_.push_back(AllocateAligned(blockSize_));
+         free_.push_back(blocks_.back());
+      }
+   }
+   catch (const std::bad_alloc&)
+   {
+      for (unsigned char* block : blocks_)
+         FreeAligned(block);
+      CloseRawFile(0);
+      throw CMMError("Out of memory for image stream staging buffers",
+            MMERR_OutOfMemory);
+   }
+   current_ = free_.back();
+   free_.pop_back();
+
+   for (unsigned i = 0; i < writerThreads; ++i)
+      writerThreads_.push_back(std::thread([this] { WriteLoop(); }));
+   drainThread_ = std::thread([this] { DrainLoop(); });
+}
+
+DiskStreamWriter::~DiskStreamWriter()
+{
+   try
+   {
+      Stop();
+   }
+   catch (const CMMError&)
+   {
+   }
+}
+
+void DiskStreamWriter::Stop()
+{
+   if (!stopped_.exchange(true))
+   {
+      stopImageCounter_ = buffer_.GetImageCounter();
+      stopDrain_ = true;
+      drainThread_.join();
+      {
+         std::lock_guard<std::mutex> lock(mutex_);
+         stopWriters_ = true;
+      }
+      cv_.notify_all();
+      for (std::thread& t : writerThreads_)
+         t.join();
+
+      CloseRawFile(nextOffset_ + currentFill_);
+      index_.close();
+      for (unsigned char* block : blocks_)
+         FreeAligned(block);
+      blocks_.clear();
+      free_.clear();
+   }
+
+   if (failed_)
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      throw CMMError("Image streaming to " + basePath_ + " failed: " + error_,
+            MMERR_DiskStreamingFailed);
+   }
+}
+
+void DiskStreamWriter::DrainLoop()
+{
+   while (!failed_)
+   {
+      // Images inserted before Stop() are still written, but not later ones,
+      // which could keep arriving faster than they are written
+      if (stopDrain_ && buffer_.GetNextImageCounter() >= stopImageCounter_)
+         break;
+
+      unsigned long slot;
+      const ImgBuffer* img = buffer_.PinNextImageBuffer(0, slot);
+      if (!img)
+      {
+         if (stopDrain_)
+            break;
+         std::this_thread::sleep_for(pollInterval);
+         continue;
+      }
+
+      // The other channels stay in the buffer while the frame is pinned
+      bool ok = AppendImage(img, 0);
+      for (unsigned channel = 1; ok; ++channel)
+      {
+         img = buffer_.GetPinnedImageBuffer(slot, channel);
+         if (!img)
+            break;
+         ok = AppendImage(img, channel);
+      }
+      buffer_.UnpinImageBuffer(slot);
+      if (!ok)
+         break;
+      if (!index_)
+      {
+         Fail("Cannot write index file");
+         break;
+      }
+      ++imageCount_;
+   }
+
+   if (!failed_ && currentFill_ > 0)
+   {
+      std::size_t length = currentFill_;
+      if (unbuffered_)
+      {
+         // Pad to the alignment; the file is truncated after writing
+         length = (length + alignment - 1) / alignment * alignment;
+         std::memset(current_ + currentFill_, 0, length - currentFill_);
+      }
+      SubmitBlock(length);
+   }
+}
+
+// Appends the pixels of one channel of the current frame and its index record
+bool DiskStreamWriter::AppendImage(const ImgBuffer* img, unsigned channel)
+{
+   const std::size_t size = static_cast<std::size_t>(img->Width()) *
+      img->Height() * img->Depth();
+   const unsigned long long offset = nextOffset_ + currentFill_;
+   const std::string md = img->GetMetadata().Serialize();
+   if (!Append(img->GetPixels(), size))
+      return false;
+   index_ << imageCount_ << '\t' << channel << '\t' << offset << '\t' <<
+      size << '\t' << img->Width() << '\t' << img->Height() << '\t' <<
+      img->Depth() << '\t' << md.size() << '\n' << md << '\n';
+   return true;
+}
+
+// Copies data to the staging blocks, submitting each block when full. Waits
+// for a free block if all are being written. Returns false on failure.
+bool DiskStreamWriter::Append(const unsigned char* data, std::size_t size)
+{
+   while (size > 0)
+   {
+      const std::size_t n = std::min(size, blockSize_ - currentFill_);
+      std::memcpy(current_ + currentFill_, data, n);
+      currentFill_ += n;
+      data += n;
+      size -= n;
+      if (currentFill_ == blockSize_ && !SubmitBlock(blockSize_))
+         return false;
+   }
+   return true;
+}
+
+bool DiskStreamWriter::SubmitBlock(std::size_t length)
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   Block block = { current_, length, nextOffset_ };
+   pending_.push_back(block);
+   nextOffset_ += currentFill_;
+   currentFill_ = 0;
+   cv_.notify_all();
+
+   cv_.wait(lock, [this] { return !free_.empty() || failed_; });
+   if (failed_)
+   {
+      current_ = 0;
+      return false;
+   }
+   current_ = free_.back();
+   free_.pop_back();
+   return true;
+}
+
+void DiskStreamWriter::WriteLoop()
+{
+   std::unique_lock<std::mutex> lock(mutex_);
+   for (;;)
+   {
+      cv_.wait(lock, [this] { return !pending_.empty() || stopWriters_; });
+      if (pending_.empty())
+         return;
+      Block block = pending_.front();
+      pending_.pop_front();
+
+      lock.unlock();
+      std::string error;
+      bool ok = !failed_ && WriteAt(block.data, block.length, block.offset, error);
+      lock.lock();
+
+      if (ok)
+         bytesWritten_ += block.length;
+      else if (!failed_)
+      {
+         error_ = error;
+         failed_ = true;
+      }
+      free_.push_back(block.data);
+      cv_.notify_all();
+   }
+}
+
+void DiskStreamWriter::Fail(const std::string& message)
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (!failed_)
+   {
+      error_ = message;
+      failed_ = true;
+   }
+   cv_.notify_all();
+}
+
+#ifdef _WIN32
+
+void DiskStreamWriter::OpenRawFile(const std::string& path)
+{
+   file_ = CreateFileA(path.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS,
+         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, 0);
+   unbuffered_ = true;
+   if (file_ == INVALID_HANDLE_VALUE)
+   {
+      file_ = CreateFileA(path.c_str(), GENERIC_WRITE, 0, 0, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL, 0);
+      unbuffered_ = false;
+   }
+   if (file_ == INVALID_HANDLE_VALUE)
+      throw CMMError("Cannot create image stream file " + path + ": " +
+            SystemErrorMessage(), MMERR_DiskStreamingFailed);
+}
+
+bool DiskStreamWriter::WriteAt(const unsigned char* data, std::size_t length,
+      unsigned long long offset, std::string& error)
+{
+   while (length > 0)
+   {
+      OVERLAPPED ov = {};
+      ov.Offset = static_cast<DWORD>(offset);
+      ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      const DWORD chunk = static_cast<DWORD>(
+            std::min<std::size_t>(length, 1u << 30));
+      DWORD written = 0;
+      if (!WriteFile(file_, data, chunk, &written, &ov) || written == 0)
+      {
+         error = SystemErrorMessage();
+         return false;
+      }
+      data += written;
+      length -= written;
+      offset += written;
+   }
+   return true;
+}
+
+void DiskStreamWriter::CloseRawFile(unsigned long long size)
+{
+   if (file_ == INVALID_HANDLE_VALUE)
+      return;
+   FILE_END_OF_FILE_INFO eof;
+   eof.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+   SetFileInformationByHandle(file_, FileEndOfFileInfo, &eof, sizeof(eof));
+   CloseHandle(file_);
+   file_ = INVALID_HANDLE_VALUE;
+}
+
+#else // _WIN32
+
+void DiskStreamWriter::OpenRawFile(const std::string& path)
+{
+   const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+   fd_ = open(path.c_str(), flags | O_DIRECT, 0666);
+   unbuffered_ = fd_ >= 0;
+   if (fd_ < 0 && errno == EINVAL) // File system without O_DIRECT (tmpfs)
+#endif
+      fd_ = open(path.c_str(), flags, 0666);
+   if (fd_ < 0)
+      throw CMMError("Cannot create image stream file " + path + ": " +
+            SystemErrorMessage(), MMERR_DiskStreamingFailed);
+#ifdef F_NOCACHE
+   if (!unbuffered_)
+      unbuffered_ = fcntl(fd_, F_NOCACHE, 1) == 0;
+#endif
+}
+
+bool DiskStreamWriter::WriteAt(const unsigned char* data, std::size_t length,
+      unsigned long long offset, std::string& error)
+{
+   while (length > 0)
+   {
+      ssize_t written = pwrite(fd_, data, length, static_cast<off_t>(offset));
+      if (written < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         error = SystemErrorMessage();
+         return false;
+      }
+      if (written == 0)
+      {
+         error = "No space left on device";
+         return false;
+      }
+      data += written;
+      length -= static_cast<std::size_t>(written);
+      offset += static_cast<unsigned long long>(written);
+   }
+   return true;
+}
+
+void DiskStreamWriter::CloseRawFile(unsigned long long size)
+{
+   if (fd_ < 0)
+      return;
+   // On failure, the padding of the last block remains
+   int ret = ftruncate(fd_, static_cast<off_t>(size));
+   (void)ret;
+   close(fd_);
+   fd_ = -1;
+}
+
+#endif // _WIN32
+
+} // namespace mm
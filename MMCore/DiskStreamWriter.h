@@ -0,0 +1,138 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Writes sequence acquisition images from the circular buffer
+//                to disk
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CircularBuffer;
+
+namespace mm {
+
+class ImgBuffer;
+
+// Consumes images from the circular buffer (as GetNextImageBuffer() does)
+// and appends them to basePath + ".raw", with one record per image in
+// basePath + ".idx":
+//
+//   MMSTREAM 2
+//   <image> <channel> <offset> <bytes> <width> <height> <bytesPerPixel> <metadataBytes>
+//   <serialized metadata>
+//   ...
+//
+// (fields separated by tabs). All channels of a multi-channel frame are
+// written, in channel order, with the same image number. Images stay pinned
+// in the buffer until they have been copied to a staging block, so a slow
+// disk fills the buffer and its overflow policy applies.
+//
+// Staging blocks are page-aligned and written at block-aligned offsets by a
+// pool of writer threads, bypassing the OS page cache (O_DIRECT,
+// F_NOCACHE, or FILE_FLAG_NO_BUFFERING) where the file system allows it.
+//
+// The constructor throws CMMError if the files cannot be created.
+class DiskStreamWriter
+{
+public:
+   DiskStreamWriter(CircularBuffer& buffer, const std::string& basePath,
+         unsigned writerThreads);
+   ~DiskStreamWriter();
+
+   const std::string& BasePath() const { return basePath_; }
+   bool IsUnbuffered() const { return unbuffered_; }
+
+   // False once stopped or after a write error
+   bool IsActive() const { return !stopped_ && !failed_; }
+   bool IsStopped() const { return stopped_; }
+
+   // Number of images (frames, counting all their channels as one) taken
+   // from the buffer; all of them are on disk once Stop() returns
+   unsigned long long ImageCount() const { return imageCount_; }
+   unsigned long long BytesWritten() const { return bytesWritten_; }
+
+   // Writes the images inserted into the buffer before the call that are
+   // still unread, then closes the files; later images are left in the
+   // buffer. Throws CMMError if writing failed.
+   void Stop();
+
+private:
+   struct Block
+   {
+      unsigned char* data;
+      std::size_t length; // Including padding
+      unsigned long long offset;
+   };
+
+   void DrainLoop();
+   void WriteLoop();
+   bool AppendImage(const ImgBuffer* img, unsigned channel);
+   bool Append(const unsigned char* data, std::size_t size);
+   bool SubmitBlock(std::size_t length);
+   void Fail(const std::string& message);
+
+   void OpenRawFile(const std::string& path);
+   bool WriteAt(const unsigned char* data, std::size_t length,
+         unsigned long long offset, std::string& error);
+   void CloseRawFile(unsigned long long size);
+
+   CircularBuffer& buffer_;
+   std::string basePath_;
+#ifdef _WIN32
+   void* file_;
+#else
+   int fd_;
+#endif
+   bool unbuffered_;
+   std::ofstream index_;
+
+   std::vector<unsigned char*> blocks_; // All staging blocks
+   std::size_t blockSize_;
+
+   // Owned by the drain thread
+   unsigned char* current_;
+   std::size_t currentFill_;
+   unsigned long long nextOffset_;
+
+   std::mutex mutex_;
+   std::condition_variable cv_;
+   std::deque<Block> pending_;
+   std::vector<unsigned char*> free_;
+   bool stopWriters_;
+   std::string error_;
+
+   std::atomic<bool> stopDrain_;
+   std::atomic<long> stopImageCounter_; // Buffer's image counter at Stop()
+   std::atomic<bool> stopped_;
+   std::atomic<bool> failed_;
+   std::atomic<unsigned long long> imageCount_;
+   std::atomic<unsigned long long> bytesWritten_;
+
+   std::thread drainThread_;
+   std::vector<std::thread> writerThreads_;
+
+   DiskStreamWriter(const DiskStreamWriter&);
+   DiskStreamWriter& operator=(const DiskStreamWriter&);
+};
+
+} // namespace mm
@@ -78,4 +78,6 @@
 #define MMERR_CreatePeripheralFailed   50
 #define MMERR_PropertyNotInCache       51
 #define MMERR_BadAffineTransform       52
+#define MMERR_SharedMemoryExportFailed 53
+#define MMERR_DiskStreamingFailed      54
 #endif //_ERRORCODES_H_
@@ -20,11 +20,13 @@
 
 #include <cmath>
 #include <cstring>
+#include <utility>
 
 namespace mm {
 
 ImgBuffer::ImgBuffer(unsigned xSize, unsigned ySize, unsigned pixDepth) :
-   pixels_(0), width_(xSize), height_(ySize), pixDepth_(pixDepth)
+   pixels_(0), width_(xSize), height_(ySize), pixDepth_(pixDepth),
+   ownsPixels_(true)
 {
    pixels_ = new unsigned char[xSize * ySize * pixDepth];
    memset(pixels_, 0, xSize * ySize * pixDepth);
@@ -32,7 +34,20 @@ ImgBuffer::ImgBuffer(unsigned xSize, unsigned ySize, unsigned pixDepth) :
 
 ImgBuffer::~ImgBuffer()
 {
-   delete[] pixels_;
+   if (ownsPixels_)
+      delete[] pixels_;
+}
+
+void ImgBuffer::Attach(unsigned char* pixels, unsigned xSize, unsigned ySize,
+      unsigned pixDepth)
+{
+   if (ownsPixels_)
+      delete[] pixels_;
+   pixels_ = pixels;
+   ownsPixels_ = false;
+   width_ = xSize;
+   height_ = ySize;
+   pixDepth_ = pixDepth;
 }
 
 const unsigned char* ImgBuffer::GetPixels() const
@@ -48,10 +63,12 @@ void ImgBuffer::SetPixels(const void* pix)
 void ImgBuffer::Resize(unsigned xSize, unsigned ySize, unsigned pixDepth)
 {
    // re-allocate internal buffer if it is not big enough
-   if (width_ * height_ * pixDepth_ < xSize * ySize * pixDepth)
+   if (!ownsPixels_ || width_ * height_ * pixDepth_ < xSize * ySize * pixDepth)
    {
-      delete[] pixels_;
+      if (ownsPixels_)
+         delete[] pixels_;
       pixels_ = new unsigned char [xSize * ySize * pixDepth];
+      ownsPixels_ = true;
    }
 
    width_ = xSize;
@@ -62,10 +79,12 @@ void ImgBuffer::Resize(unsigned xSize, unsigned ySize, unsigned pixDepth)
 void ImgBuffer::Resize(unsigned xSize, unsigned ySize)
 {
    // re-allocate internal buffer if it is not big enough
-   if (width_ * height_ < xSize * ySize)
+   if (!ownsPixels_ || width_ * height_ < xSize * ySize)
    {
-      delete[] pixels_;
+      if (ownsPixels_)
+         delete[] pixels_;
       pixels_ = new unsigned char[xSize * ySize * pixDepth_];
+      ownsPixels_ = true;
    }
 
    width_ = xSize;
@@ -102,6 +121,15 @@ FrameBuffer::FrameBuffer()
    depth_ = 0;
 }
 
+FrameBuffer::FrameBuffer(FrameBuffer&& other) noexcept :
+   channels_(std::move(other.channels_)),
+   width_(other.width_),
+   height_(other.height_),
+   depth_(other.depth_)
+{
+   other.channels_.clear();
+}
+
 FrameBuffer::~FrameBuffer()
 {
    Clear();
@@ -170,6 +198,23 @@ ImgBuffer* FrameBuffer::FindImage(unsigned channel) const
    return channels_[channel];
 }
 
+ImgBuffer* FrameBuffer::AttachImage(unsigned channel, unsigned char* pixels,
+      unsigned xSize, unsigned ySize, unsigned pixDepth)
+{
+   ImgBuffer* img = FindImage(channel);
+   if (!img)
+   {
+      if (channel >= channels_.size())
+         channels_.resize(channel + 1, 0);
+      img = new ImgBuffer(0, 0, 0);
+      channels_[channel] = img;
+   }
+   if (img->GetPixels() != pixels || img->Width() != xSize ||
+         img->Height() != ySize || img->Depth() != pixDepth)
+      img->Attach(pixels, xSize, ySize, pixDepth);
+   return img;
+}
+
 ImgBuffer* FrameBuffer::InsertNewImage(unsigned channel)
 {
    if (channel >= channels_.size())
@@ -32,12 +32,18 @@ class ImgBuffer
    unsigned int width_;
    unsigned int height_;
    unsigned int pixDepth_;
+   bool ownsPixels_;
    Metadata metadata_;
 
 public:
    ImgBuffer(unsigned xSize, unsigned ySize, unsigned pixDepth);
    ~ImgBuffer();
 
+   // Switch to pixel memory owned by the caller, which must remain valid
+   // while this image uses it. Resize() switches back to owned memory.
+   void Attach(unsigned char* pixels, unsigned xSize, unsigned ySize,
+         unsigned pixDepth);
+
    unsigned int Width() const {return width_;}
    unsigned int Height() const {return height_;}
    unsigned int Depth() const {return pixDepth_;}
@@ -66,6 +72,7 @@ class FrameBuffer
 public:
    FrameBuffer(unsigned xSize, unsigned ySize, unsigned byteDepth);
    FrameBuffer();
+   FrameBuffer(FrameBuffer&& other) noexcept;
    ~FrameBuffer();
 
    void Resize(unsigned xSize, unsigned ySize, unsigned pixDepth);
@@ -73,6 +80,10 @@ public:
    void Preallocate(unsigned channels);
 
    ImgBuffer* FindImage(unsigned channel) const;
+   // Returns the image for the channel, created if necessary, using the
+   // given (caller-owned) pixel memory
+   ImgBuffer* AttachImage(unsigned channel, unsigned char* pixels,
+         unsigned xSize, unsigned ySize, unsigned pixDepth);
    const unsigned char* GetPixels(unsigned channel) const;
    bool SetPixels(unsigned channel, const unsigned char* pixels);
    unsigned Width() const {return width_;}
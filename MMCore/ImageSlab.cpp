@@ -0,0 +1,168 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Single lazily committed memory region backing the sequence
+//                (circular) buffer
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "ImageSlab.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+#define MADV_POPULATE_WRITE 23 // Linux 5.14
+#endif
+
+namespace mm {
+
+namespace {
+
+const std::size_t hugePageSize = 2 * 1024 * 1024;
+
+// Prefault in pieces so that the destructor does not wait long
+const std::size_t prefaultChunkSize = 64 * 1024 * 1024;
+
+std::size_t PageSize()
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo(&info);
+   return info.dwPageSize;
+#else
+   return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Commits the page without changing its contents, even if another thread is
+// writing to it
+void TouchPage(unsigned char* p)
+{
+#ifdef _MSC_VER
+   _InterlockedOr8(reinterpret_cast<volatile char*>(p), 0);
+#else
+   __atomic_fetch_or(p, static_cast<unsigned char>(0), __ATOMIC_RELAXED);
+#endif
+}
+
+} // anonymous namespace
+
+ImageSlab::ImageSlab(std::size_t sizeBytes, bool hugePages, bool prefault) :
+   data_(0),
+   size_(sizeBytes),
+   mappedSize_(0),
+   pageKind_(NormalPages),
+   stopPrefault_(false),
+   prefaulted_(!prefault)
+{
+   if (sizeBytes == 0)
+      return;
+
+#ifdef _WIN32
+   (void)hugePages; // Large pages need SeLockMemoryPrivilege; not attempted
+   void* p = VirtualAlloc(0, sizeBytes, MEM_RESERVE | MEM_COMMIT,
+         PAGE_READWRITE);
+   if (!p)
+      throw std::bad_alloc();
+   data_ = static_cast<unsigned char*>(p);
+   mappedSize_ = sizeBytes;
+#else
+   void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+   if (hugePages)
+   {
+      const std::size_t rounded =
+         (sizeBytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+      p = mmap(0, rounded, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED)
+      {
+         mappedSize_ = rounded;
+         pageKind_ = ExplicitHugePages;
+      }
+   }
+#endif
+   if (p == MAP_FAILED)
+   {
+      p = mmap(0, sizeBytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED)
+         throw std::bad_alloc();
+      mappedSize_ = sizeBytes;
+#ifdef MADV_HUGEPAGE
+      if (hugePages && madvise(p, sizeBytes, MADV_HUGEPAGE) == 0)
+         pageKind_ = TransparentHugePages;
+#endif
+   }
+   data_ = static_cast<unsigned char*>(p);
+#endif
+
+   if (prefault)
+      prefaultThread_ = std::thread([this] { Prefault(); });
+}
+
+ImageSlab::~ImageSlab()
+{
+   stopPrefault_ = true;
+   if (prefaultThread_.joinable())
+      prefaultThread_.join();
+
+   if (!data_)
+      return;
+#ifdef _WIN32
+   VirtualFree(data_, 0, MEM_RELEASE);
+#else
+   munmap(data_, mappedSize_);
+#endif
+}
+
+void ImageSlab::Prefault()
+{
+   const std::size_t pageSize = pageKind_ == ExplicitHugePages ?
+      hugePageSize : PageSize();
+#ifdef __linux__
+   bool populate = true;
+#endif
+   for (std::size_t offset = 0; offset < mappedSize_;
+         offset += prefaultChunkSize)
+   {
+      if (stopPrefault_)
+         return;
+      const std::size_t len = std::min(prefaultChunkSize, mappedSize_ - offset);
+#ifdef __linux__
+      if (populate)
+      {
+         if (madvise(data_ + offset, len, MADV_POPULATE_WRITE) == 0)
+            continue;
+         if (errno != EINVAL)
+            return; // Out of memory; leave the rest to be faulted on use
+         populate = false; // Not supported by this kernel
+      }
+#endif
+      for (std::size_t page = 0; page < len; page += pageSize)
+         TouchPage(data_ + offset + page);
+   }
+   prefaulted_ = true;
+}
+
+} // namespace mm
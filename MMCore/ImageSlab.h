@@ -0,0 +1,80 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Single lazily committed memory region backing the sequence
+//                (circular) buffer
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace mm {
+
+// One anonymous memory mapping, zero-filled and backed by physical memory
+// page by page on first touch. Because the memory is not touched when the
+// slab is created, creating even a very large slab is fast; the page faults
+// happen when images are first written, unless prefaulting is enabled.
+//
+// On Windows the whole slab is committed (charged against the system commit
+// limit, i.e. RAM plus page file) when it is created, so creation fails up
+// front if the commit limit is too low. Physical pages are still only
+// assigned on first touch.
+//
+// With hugePages, explicit huge pages (MAP_HUGETLB) are tried first, then
+// transparent huge pages (madvise(MADV_HUGEPAGE)). Both are Linux-only and
+// silently fall back to normal pages.
+//
+// With prefault, a background thread commits all pages of the slab. This
+// does not modify the contents, so the slab can be written concurrently.
+//
+// The constructor throws std::bad_alloc if the memory cannot be mapped.
+class ImageSlab
+{
+public:
+   enum PageKind
+   {
+      NormalPages,
+      TransparentHugePages,
+      ExplicitHugePages,
+   };
+
+   ImageSlab(std::size_t sizeBytes, bool hugePages, bool prefault);
+   ~ImageSlab();
+
+   unsigned char* Data() const { return data_; }
+   std::size_t Size() const { return size_; }
+   PageKind GetPageKind() const { return pageKind_; }
+
+   // True once the background prefault has finished (or was not requested)
+   bool IsPrefaulted() const { return prefaulted_.load(); }
+
+private:
+   void Prefault();
+
+   unsigned char* data_;
+   std::size_t size_;
+   std::size_t mappedSize_;
+   PageKind pageKind_;
+
+   std::atomic<bool> stopPrefault_;
+   std::atomic<bool> prefaulted_;
+   std::thread prefaultThread_;
+
+   ImageSlab(const ImageSlab&);
+   ImageSlab& operator=(const ImageSlab&);
+};
+
+} // namespace mm
@@ -49,15 +49,21 @@
 #include "CoreProperty.h"
 #include "CoreUtils.h"
 #include "DeviceManager.h"
+#include "DiskStreamWriter.h"
 #include "Devices/DeviceInstances.h"
 #include "LogManager.h"
 #include "MMCore.h"
 #include "MMEventCallback.h"
 #include "PluginManager.h"
+#include "PreviewStream.h"
+#include "SequencePlan.h"
+#include "SharedFrameRing.h"
+#include "ThreadPool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <deque>
 #include <fstream>
@@ -65,6 +71,7 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <system_error>
 #include <thread>
 #include <vector>
 
@@ -112,7 +119,7 @@
  * (Keep the 3 numbers on one line to make it easier to look at diffs when
  * merging/rebasing.)
  */
-const int MMCore_versionMajor = 11, MMCore_versionMinor = 4, MMCore_versionPatch = 1;
+const int MMCore_versionMajor = 11, MMCore_versionMinor = 17, MMCore_versionPatch = 0;
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -138,8 +145,20 @@ CMMCore::CMMCore() :
    externalCallback_(0),
    pixelSizeGroup_(0),
    cbuf_(0),
+   cbufHugePages_(false),
+   cbufPrefault_(false),
+   cbufPacking_(false),
+   imageStatistics_(false),
+   imageStatisticsBins_(0),
+   bufferOverflowPolicy_(BufferOverflowClear),
    pluginManager_(new CPluginManager()),
    deviceManager_(new mm::DeviceManager()),
+   sequencePlan_(new mm::SequencePlan()),
+   previewWidth_(0),
+   previewHeight_(0),
+   previewBytesPerPixel_(0),
+   previewComponents_(0),
+   nextPinId_(0),
    pPostedErrorsLock_(NULL)
 {
    configGroups_ = new ConfigGroupCollection();
@@ -151,7 +170,9 @@ CMMCore::CMMCore() :
    callback_ = new CoreCallback(this);
 
    const unsigned seqBufMegabytes = (sizeof(void*) > 4) ? 250 : 25;
-   cbuf_ = new CircularBuffer(seqBufMegabytes);
+   threadPool_ = std::make_shared<ThreadPool>();
+   cbuf_ = new CircularBuffer(seqBufMegabytes, false, false, threadPool_);
+   applyBufferOverflowPolicy(false);
 
    nullAffine_ = new std::vector<double>(6);
    for (int i = 0; i < 6; i++) {
@@ -181,7 +202,10 @@ CMMCore::~CMMCore()
    delete callback_;
    delete configGroups_;
    delete properties_;
+   diskStreamWriter_.reset(); // Uses cbuf_
+   previewStream_.reset(); // Uses cbuf_
    delete cbuf_;
+   sharedFrameRing_.reset();
    delete pixelSizeGroup_;
    delete pPostedErrorsLock_;
 
@@ -2186,7 +2210,7 @@ long CMMCore::getExposureSequenceMaxLength(const char* cameraLabel) throw (CMMEr
  * @param cameraLabel      the camera device label
  * @param exposureTime_ms  sequence of exposure times the camera will use during a sequence acquisition
  */
-void CMMCore::loadExposureSequence(const char* cameraLabel, std::vector<double> exposureTime_ms) throw (CMMError)
+void CMMCore::loadExposureSequence(const char* cameraLabel, const std::vector<double>& exposureTime_ms) throw (CMMError)
 {
    std::shared_ptr<CameraInstance> pCamera =
       deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
@@ -2205,15 +2229,224 @@ void CMMCore::loadExposureSequence(const char* cameraLabel, std::vector<double>
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pCamera));
 
-   std::vector<double>::iterator it;
-   for ( it=exposureTime_ms.begin() ; it < exposureTime_ms.end(); it++ )
+   ret = pCamera->AddArrayToExposureSequence(exposureTime_ms.data(),
+         static_cast<unsigned long>(exposureTime_ms.size()));
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+
+   ret = pCamera->SendExposureSequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+
+/**
+ * Returns true if the camera implements the trigger API
+ * (setCameraTriggerState(), armCameraAcquisition(), etc.).
+ * @param cameraLabel   the camera device label
+ */
+bool CMMCore::isCameraTriggerAPIImplemented(const char* cameraLabel) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+   return pCamera->IsTriggerAPIImplemented();
+}
+
+/**
+ * Returns true if the camera supports the given trigger.
+ * @param cameraLabel       the camera device label
+ * @param triggerSelector   one of the MM::TriggerSelector* constants
+ */
+bool CMMCore::hasCameraTrigger(const char* cameraLabel, int triggerSelector) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+   return pCamera->HasTrigger(triggerSelector);
+}
+
+/**
+ * Configures a camera trigger, with no delay, rising edge activation and no
+ * trigger overlap.
+ * @param cameraLabel       the camera device label
+ * @param triggerSelector   one of the MM::TriggerSelector* constants
+ * @param triggerMode       MM::TriggerModeOn or MM::TriggerModeOff
+ * @param triggerSource     one of the MM::TriggerSource* constants
+ */
+void CMMCore::setCameraTriggerState(const char* cameraLabel, int triggerSelector,
+      int triggerMode, int triggerSource) throw (CMMError)
+{
+   setCameraTriggerState(cameraLabel, triggerSelector, triggerMode, triggerSource,
+         0.0, MM::TriggerActivationRisingEdge, MM::TriggerOverlapOff);
+}
+
+/**
+ * Configures a camera trigger.
+ * @param cameraLabel         the camera device label
+ * @param triggerSelector     one of the MM::TriggerSelector* constants
+ * @param triggerMode         MM::TriggerModeOn or MM::TriggerModeOff
+ * @param triggerSource       one of the MM::TriggerSource* constants
+ * @param triggerDelayUs      delay between trigger and its effect, in microseconds
+ * @param triggerActivation   one of the MM::TriggerActivation* constants
+ * @param triggerOverlap      one of the MM::TriggerOverlap* constants
+ */
+void CMMCore::setCameraTriggerState(const char* cameraLabel, int triggerSelector,
+      int triggerMode, int triggerSource, double triggerDelayUs,
+      int triggerActivation, int triggerOverlap) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int ret = pCamera->SetTriggerState(triggerSelector, triggerMode,
+         triggerSource, triggerDelayUs, triggerActivation, triggerOverlap);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+/**
+ * Returns the mode (MM::TriggerModeOn or MM::TriggerModeOff) of a camera
+ * trigger.
+ * @param cameraLabel       the camera device label
+ * @param triggerSelector   one of the MM::TriggerSelector* constants
+ */
+int CMMCore::getCameraTriggerMode(const char* cameraLabel, int triggerSelector) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int mode, source, activation, overlap;
+   double delayUs;
+   int ret = pCamera->GetTriggerState(triggerSelector, mode, source, delayUs,
+         activation, overlap);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+   return mode;
+}
+
+/**
+ * Returns the source (one of the MM::TriggerSource* constants) of a camera
+ * trigger.
+ * @param cameraLabel       the camera device label
+ * @param triggerSelector   one of the MM::TriggerSelector* constants
+ */
+int CMMCore::getCameraTriggerSource(const char* cameraLabel, int triggerSelector) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int mode, source, activation, overlap;
+   double delayUs;
+   int ret = pCamera->GetTriggerState(triggerSelector, mode, source, delayUs,
+         activation, overlap);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+   return source;
+}
+
+/**
+ * Sends a software trigger to the camera. The trigger must have been set to
+ * on with MM::TriggerSourceSoftware as its source.
+ * @param cameraLabel       the camera device label
+ * @param triggerSelector   one of the MM::TriggerSelector* constants
+ */
+void CMMCore::sendCameraSoftwareTrigger(const char* cameraLabel, int triggerSelector) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int ret = pCamera->TriggerSoftware(triggerSelector);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+/**
+ * Validates the camera settings and prepares for a fast
+ * startCameraAcquisition().
+ * @param cameraLabel       the camera device label
+ * @param frameCount        number of frames; -1 for continuous acquisition
+ * @param frameRateHz       frame rate when the frame trigger is off (0 to
+ *                          run as fast as possible)
+ * @param burstFrameCount   frames per burst trigger (0 if not used)
+ */
+void CMMCore::armCameraAcquisition(const char* cameraLabel, int frameCount,
+      double frameRateHz, int burstFrameCount) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int ret = pCamera->AcquisitionArm(frameCount, frameRateHz, burstFrameCount);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+/**
+ * Starts the acquisition armed by armCameraAcquisition(). Frames are
+ * delivered to the circular buffer as in a sequence acquisition.
+ * @param cameraLabel   the camera device label
+ */
+void CMMCore::startCameraAcquisition(const char* cameraLabel) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+   if (pCamera->IsCapturing())
+      throw CMMError(getCoreErrorText(MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
+                     MMERR_NotAllowedDuringSequenceAcquisition);
+
+   if (!cbuf_->Initialize(pCamera->GetNumberOfChannels(), pCamera->GetImageWidth(), pCamera->GetImageHeight(), pCamera->GetImageBytesPerPixel(), pCamera->GetBitDepth()))
    {
-      ret = pCamera->AddToExposureSequence(*it);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pCamera));
+      logError(getDeviceName(pCamera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
    }
+   cbuf_->Clear();
 
-   ret = pCamera->SendExposureSequence();
+   int ret = pCamera->AcquisitionStart();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+/**
+ * Stops the camera acquisition at the end of the current frame.
+ * @param cameraLabel   the camera device label
+ */
+void CMMCore::stopCameraAcquisition(const char* cameraLabel) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int ret = pCamera->AcquisitionStop();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pCamera));
+}
+
+/**
+ * Aborts the camera acquisition immediately.
+ * @param cameraLabel   the camera device label
+ */
+void CMMCore::abortCameraAcquisition(const char* cameraLabel) throw (CMMError)
+{
+   std::shared_ptr<CameraInstance> pCamera =
+      deviceManager_->GetDeviceOfType<CameraInstance>(cameraLabel);
+
+   mm::DeviceModuleLockGuard guard(pCamera);
+
+   int ret = pCamera->AcquisitionAbort();
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pCamera));
 }
@@ -2320,7 +2553,7 @@ long CMMCore::getStageSequenceMaxLength(const char* label) throw (CMMError)
  * @param label              the device label
  * @param positionSequence   a sequence of positions that the stage will execute in response to external triggers
  */
-void CMMCore::loadStageSequence(const char* label, std::vector<double> positionSequence) throw (CMMError)
+void CMMCore::loadStageSequence(const char* label, const std::vector<double>& positionSequence) throw (CMMError)
 {
    std::shared_ptr<StageInstance> pStage =
       deviceManager_->GetDeviceOfType<StageInstance>(label);
@@ -2332,13 +2565,10 @@ void CMMCore::loadStageSequence(const char* label, std::vector<double> positionS
    if (ret != DEVICE_OK)
       throw CMMError(getDeviceErrorText(ret, pStage));
 
-   std::vector<double>::iterator it;
-   for ( it=positionSequence.begin() ; it < positionSequence.end(); it++ )
-   {
-      ret = pStage->AddToStageSequence(*it);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pStage));
-   }
+   ret = pStage->AddArrayToStageSequence(positionSequence.data(),
+         static_cast<unsigned long>(positionSequence.size()));
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pStage));
 
    ret = pStage->SendStageSequence();
    if (ret != DEVICE_OK)
@@ -2426,61 +2656,604 @@ void CMMCore::stopXYStageSequence(const char* label) throw (CMMError)
 }
 
 /**
- * Gets the maximum length of an XY stage's position sequence.
- * This should only be called for XY stages that are sequenceable
- * @param label   the XY stage device label
- * @return        the maximum allowed sequence length
+ * Gets the maximum length of an XY stage's position sequence.
+ * This should only be called for XY stages that are sequenceable
+ * @param label   the XY stage device label
+ * @return        the maximum allowed sequence length
+ */
+long CMMCore::getXYStageSequenceMaxLength(const char* label) throw (CMMError)
+{
+   std::shared_ptr<XYStageInstance> pStage =
+      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pStage);
+   long length;
+   int ret = pStage->GetXYStageSequenceMaxLength(length);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pStage));
+
+   return length;
+}
+
+/**
+ * Transfer a sequence of stage positions to the xy stage.
+ * xSequence and ySequence must have the same length.
+ * This should only be called for XY stages that are sequenceable
+ * @param label        the XY stage device label
+ * @param xSequence    the sequence of x positions that the stage will execute in response to external triggers
+ * @param ySequence    the sequence of y positions that the stage will execute in response to external triggers
+ */
+void CMMCore::loadXYStageSequence(const char* label,
+                                  const std::vector<double>& xSequence,
+                                  const std::vector<double>& ySequence) throw (CMMError)
+{
+   std::shared_ptr<XYStageInstance> pStage =
+      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pStage);
+
+   int ret;
+   ret = pStage->ClearXYStageSequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pStage));
+
+   // As before, extra points in the longer sequence are ignored
+   const size_t count = std::min(xSequence.size(), ySequence.size());
+   ret = pStage->AddArrayToXYStageSequence(xSequence.data(), ySequence.data(),
+         static_cast<unsigned long>(count));
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pStage));
+
+   ret = pStage->SendXYStageSequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pStage));
+}
+
+/**
+ * Queries a signal output (DA) device if it can be used in a sequence
+ * @param label   the DA device label
+ * @return   true if the DA device can be sequenced
+ */
+bool CMMCore::isDASequenceable(const char* label) throw (CMMError)
+{
+   std::shared_ptr<SignalIOInstance> pDA =
+      deviceManager_->GetDeviceOfType<SignalIOInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pDA);
+
+   bool isSequenceable;
+   int ret = pDA->IsDASequenceable(isSequenceable);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+
+   return isSequenceable;
+}
+
+/**
+ * Starts an ongoing sequence of triggered voltages in a DA device
+ * This should only be called for DA devices that are sequenceable
+ * @param label   the DA device label
+ */
+void CMMCore::startDASequence(const char* label) throw (CMMError)
+{
+   std::shared_ptr<SignalIOInstance> pDA =
+      deviceManager_->GetDeviceOfType<SignalIOInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pDA);
+
+   int ret = pDA->StartDASequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+}
+
+/**
+ * Stops an ongoing sequence of triggered voltages in a DA device
+ * This should only be called for DA devices that are sequenceable
+ * @param label   the DA device label
+ */
+void CMMCore::stopDASequence(const char* label) throw (CMMError)
+{
+   std::shared_ptr<SignalIOInstance> pDA =
+      deviceManager_->GetDeviceOfType<SignalIOInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pDA);
+
+   int ret = pDA->StopDASequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+}
+
+/**
+ * Gets the maximum length of a DA device's voltage sequence.
+ * This should only be called for DA devices that are sequenceable
+ * @param label   the DA device label
+ * @return        the maximum length (integer)
+ */
+long CMMCore::getDASequenceMaxLength(const char* label) throw (CMMError)
+{
+   std::shared_ptr<SignalIOInstance> pDA =
+      deviceManager_->GetDeviceOfType<SignalIOInstance>(label);
+
+   mm::DeviceModuleLockGuard guard(pDA);
+   long length;
+   int ret = pDA->GetDASequenceMaxLength(length);
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+
+   return length;
+}
+
+/**
+ * Transfer a sequence of voltages to a DA device.
+ * This should only be called for DA devices that are sequenceable
+ * @param label             the DA device label
+ * @param voltageSequence   the sequence of voltages that the device will output in response to external triggers
+ */
+void CMMCore::loadDASequence(const char* label, const std::vector<double>& voltageSequence) throw (CMMError)
+{
+   std::shared_ptr<SignalIOInstance> pDA =
+      deviceManager_->GetDeviceOfType<SignalIOInstance>(label);
+
+   unsigned long maxLength = getDASequenceMaxLength(label);
+   if (voltageSequence.size() > maxLength) {
+      throw CMMError("The length of the requested voltage sequence (" + ToString(voltageSequence.size()) +
+            ") exceeds the maximum allowed (" + ToString(maxLength) +
+            ") by the DA device " + ToQuotedString(label));
+   }
+
+   mm::DeviceModuleLockGuard guard(pDA);
+
+   int ret = pDA->ClearDASequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+
+   ret = pDA->AddArrayToDASequence(voltageSequence.data(),
+         static_cast<unsigned long>(voltageSequence.size()));
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+
+   ret = pDA->SendDASequence();
+   if (ret != DEVICE_OK)
+      throw CMMError(getDeviceErrorText(ret, pDA));
+}
+
+
+/**
+ * Discards the current hardware sequence plan.
+ *
+ * A sequence plan describes a hardware-triggered acquisition over channels
+ * (presets of a configuration group), focus positions and time points. When
+ * compiled, the plan is checked against the sequencing capabilities of the
+ * devices involved and split into chunks that can each run without software
+ * intervention.
+ */
+void CMMCore::clearSequencePlan()
+{
+   sequencePlan_.reset(new mm::SequencePlan());
+}
+
+/**
+ * Sets the channels of the sequence plan.
+ * @param groupName     the configuration group whose presets form the channels
+ * @param presetNames   the presets, in acquisition order
+ */
+void CMMCore::setSequencePlanChannels(const char* groupName,
+      const std::vector<std::string>& presetNames) throw (CMMError)
+{
+   CheckConfigGroupName(groupName);
+   for (const std::string& preset : presetNames)
+   {
+      CheckConfigPresetName(preset.c_str());
+      if (!isConfigDefined(groupName, preset.c_str()))
+         throw CMMError(ToQuotedString(groupName) + "/" + ToQuotedString(preset) +
+               ": " + getCoreErrorText(MMERR_NoConfiguration), MMERR_NoConfiguration);
+   }
+   sequencePlan_->channelGroup = groupName;
+   sequencePlan_->channelPresets = presetNames;
+   sequencePlan_->compiled = false;
+}
+
+/**
+ * Sets a camera exposure for each channel of the sequence plan. The
+ * exposures apply to the camera that is current when the plan is compiled.
+ * Pass an empty vector to leave the exposure unchanged.
+ * @param exposures_ms   one exposure per channel preset
+ */
+void CMMCore::setSequencePlanChannelExposures(
+      const std::vector<double>& exposures_ms) throw (CMMError)
+{
+   for (double exposure : exposures_ms)
+   {
+      if (exposure < 0.0)
+         throw CMMError("Sequence plan exposures must not be negative");
+   }
+   sequencePlan_->channelExposures = exposures_ms;
+   sequencePlan_->compiled = false;
+}
+
+/**
+ * Sets the focus positions of the sequence plan.
+ * @param stageLabel   the focus stage
+ * @param positions    the positions in microns, in acquisition order
+ */
+void CMMCore::setSequencePlanZPositions(const char* stageLabel,
+      const std::vector<double>& positions) throw (CMMError)
+{
+   if (!positions.empty())
+      deviceManager_->GetDeviceOfType<StageInstance>(stageLabel);
+   sequencePlan_->spec.focusStage = positions.empty() ? "" : stageLabel;
+   sequencePlan_->spec.focusPositions = positions;
+   sequencePlan_->compiled = false;
+}
+
+/**
+ * Sets the order of the sequence plan.
+ * @param channelsFirst   if true (the default), all channels are acquired at
+ *                        each focus position; otherwise a full focus stack
+ *                        is acquired for each channel
+ */
+void CMMCore::setSequencePlanChannelsFirst(bool channelsFirst)
+{
+   sequencePlan_->spec.channelsFirst = channelsFirst;
+   sequencePlan_->compiled = false;
+}
+
+/**
+ * Sets the number of times the sequence plan is repeated.
+ * @param timePoints   the number of time points (at least 1)
+ */
+void CMMCore::setSequencePlanTimePoints(long timePoints) throw (CMMError)
+{
+   if (timePoints < 1)
+      throw CMMError("Number of sequence plan time points must be at least 1");
+   sequencePlan_->spec.timePoints = timePoints;
+   sequencePlan_->compiled = false;
+}
+
+/**
+ * Compiles the sequence plan. The sequencing capabilities of all devices
+ * set by the plan are queried, and the frames are split into chunks. Within
+ * a chunk, only devices that can be sequenced change, and no sequence
+ * exceeds its device's maximum length. Settings that stay the same for a
+ * whole chunk are applied by software before the chunk starts.
+ * @return the number of chunks
+ */
+long CMMCore::compileSequencePlan() throw (CMMError)
+{
+   mm::SequencePlan& plan = *sequencePlan_;
+   plan.compiled = false;
+   plan.spec.channels.clear();
+
+   const std::vector<double>& exposures = plan.channelExposures;
+   if (!exposures.empty() && exposures.size() != plan.channelPresets.size())
+      throw CMMError("Sequence plan has " + ToString(exposures.size()) +
+            " exposures for " + ToString(plan.channelPresets.size()) + " channels");
+   std::string camera;
+   if (!exposures.empty())
+   {
+      camera = getCameraDevice();
+      if (camera.empty())
+         throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(),
+               MMERR_CameraNotAvailable);
+   }
+
+   for (size_t i = 0; i < plan.channelPresets.size(); ++i)
+   {
+      Configuration config = getConfigData(plan.channelGroup.c_str(),
+            plan.channelPresets[i].c_str());
+      mm::FrameSettings channel;
+      for (size_t j = 0; j < config.size(); ++j)
+      {
+         PropertySetting setting = config.getSetting(j);
+         channel[mm::SequenceTarget(mm::SequenceTarget::Property,
+               setting.getDeviceLabel(), setting.getPropertyName())] =
+            setting.getPropertyValue();
+      }
+      if (!exposures.empty())
+         channel[mm::SequenceTarget(mm::SequenceTarget::Exposure, camera)] =
+            mm::FormatSequenceValue(exposures[i]);
+      plan.spec.channels.push_back(channel);
+   }
+
+   const std::vector<mm::FrameSettings> frames = mm::ExpandSequencePlan(plan.spec);
+
+   mm::SequenceCapabilities caps;
+   if (!frames.empty())
+   {
+      for (const auto& setting : frames.front())
+      {
+         const mm::SequenceTarget& target = setting.first;
+         const char* label = target.device.c_str();
+         long maxLength = 0;
+         switch (target.kind)
+         {
+            case mm::SequenceTarget::Property:
+               if (!IsCoreDeviceLabel(label) &&
+                     isPropertySequenceable(label, target.property.c_str()))
+                  maxLength = getPropertySequenceMaxLength(label,
+                        target.property.c_str());
+               break;
+            case mm::SequenceTarget::Stage:
+               if (isStageSequenceable(label))
+                  maxLength = getStageSequenceMaxLength(label);
+               break;
+            case mm::SequenceTarget::Exposure:
+               if (isExposureSequenceable(label))
+                  maxLength = getExposureSequenceMaxLength(label);
+               break;
+         }
+         caps[target] = maxLength;
+      }
+   }
+
+   plan.chunks = mm::CompileSequencePlan(frames, caps);
+   plan.frameCount = frames.size();
+   plan.compiled = true;
+
+   LOG_INFO(coreLogger_) << "Sequence plan of " << plan.frameCount <<
+      " frames compiled into " << plan.chunks.size() << " chunks";
+   return static_cast<long>(plan.chunks.size());
+}
+
+/**
+ * Returns the total number of frames in the compiled sequence plan.
+ */
+long CMMCore::getSequencePlanFrameCount() throw (CMMError)
+{
+   if (!sequencePlan_->compiled)
+      throw CMMError("Sequence plan has not been compiled");
+   return static_cast<long>(sequencePlan_->frameCount);
+}
+
+/**
+ * Returns the number of chunks in the compiled sequence plan.
+ */
+long CMMCore::getSequencePlanChunkCount() throw (CMMError)
+{
+   if (!sequencePlan_->compiled)
+      throw CMMError("Sequence plan has not been compiled");
+   return static_cast<long>(sequencePlan_->chunks.size());
+}
+
+/**
+ * Returns the number of frames in a chunk of the compiled sequence plan. The
+ * camera should be started for this many frames after the chunk is loaded.
+ * @param chunk   the chunk index
+ */
+long CMMCore::getSequencePlanChunkFrameCount(long chunk) throw (CMMError)
+{
+   return static_cast<long>(getSequencePlanChunk(chunk).frameCount);
+}
+
+/**
+ * Returns the settings that are sequenced in hardware during a chunk of the
+ * compiled sequence plan, for display. Property targets are given as
+ * "Device-Property"; stage and exposure targets as "Device (position)" and
+ * "Device (exposure)".
+ * @param chunk   the chunk index
+ */
+std::vector<std::string> CMMCore::getSequencePlanSequencedTargets(long chunk) throw (CMMError)
+{
+   const mm::SequenceChunk& c = getSequencePlanChunk(chunk);
+   std::vector<std::string> targets;
+   for (const auto& seq : c.sequences)
+      targets.push_back(seq.first.ToString());
+   return targets;
+}
+
+/**
+ * Prepares the devices for a chunk of the compiled sequence plan. The
+ * constant settings of the chunk are applied and waited for, and then the
+ * sequences are sent to the devices. Sequences for devices in different
+ * device adapters are sent in parallel, as uploading long sequences over
+ * serial ports can take a substantial time.
+ * @param chunk   the chunk index
+ */
+void CMMCore::loadSequencePlanChunk(long chunk) throw (CMMError)
+{
+   const mm::SequenceChunk& c = getSequencePlanChunk(chunk);
+
+   std::set<std::string> changedDevices;
+   for (const auto& setting : c.constants)
+   {
+      const mm::SequenceTarget& target = setting.first;
+      const char* label = target.device.c_str();
+      switch (target.kind)
+      {
+         case mm::SequenceTarget::Property:
+            setProperty(label, target.property.c_str(), setting.second.c_str());
+            break;
+         case mm::SequenceTarget::Stage:
+            setPosition(label, mm::ParseSequenceValue(setting.second));
+            break;
+         case mm::SequenceTarget::Exposure:
+            setExposure(label, mm::ParseSequenceValue(setting.second));
+            break;
+      }
+      changedDevices.insert(target.device);
+   }
+   for (const std::string& label : changedDevices)
+   {
+      if (!IsCoreDeviceLabel(label.c_str()))
+         waitForDevice(label.c_str());
+   }
+
+   std::map<std::shared_ptr<LoadedDeviceAdapter>, std::vector<mm::SequenceTarget>> moduleMap;
+   for (const auto& seq : c.sequences)
+   {
+      std::shared_ptr<DeviceInstance> pDevice =
+         deviceManager_->GetDevice(seq.first.device);
+      moduleMap[pDevice->GetAdapterModule()].push_back(seq.first);
+   }
+
+   if (moduleMap.size() == 1)
+   {
+      loadSequencePlanSequences(c, moduleMap.begin()->second);
+      return;
+   }
+
+   std::vector<std::future<void>> futures;
+   for (const auto& module : moduleMap)
+   {
+      futures.push_back(std::async(std::launch::async,
+               &CMMCore::loadSequencePlanSequences, this,
+               std::cref(c), std::cref(module.second)));
+   }
+   // Wait for all uploads to finish before reporting the first error
+   std::exception_ptr firstError;
+   for (auto& f : futures)
+   {
+      try
+      {
+         f.get();
+      }
+      catch (...)
+      {
+         if (!firstError)
+            firstError = std::current_exception();
+      }
+   }
+   if (firstError)
+      std::rethrow_exception(firstError);
+}
+
+/**
+ * Starts the hardware sequences of a loaded chunk of the sequence plan. The
+ * camera acquisition (e.g. startSequenceAcquisition() with the chunk's frame
+ * count) should be started afterwards.
+ * @param chunk   the chunk index
  */
-long CMMCore::getXYStageSequenceMaxLength(const char* label) throw (CMMError)
+void CMMCore::startSequencePlanChunk(long chunk) throw (CMMError)
 {
-   std::shared_ptr<XYStageInstance> pStage =
-      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
-
-   mm::DeviceModuleLockGuard guard(pStage);
-   long length;
-   int ret = pStage->GetXYStageSequenceMaxLength(length);
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pStage));
-
-   return length;
+   const mm::SequenceChunk& c = getSequencePlanChunk(chunk);
+   for (const auto& seq : c.sequences)
+   {
+      const mm::SequenceTarget& target = seq.first;
+      const char* label = target.device.c_str();
+      switch (target.kind)
+      {
+         case mm::SequenceTarget::Property:
+            startPropertySequence(label, target.property.c_str());
+            break;
+         case mm::SequenceTarget::Stage:
+            startStageSequence(label);
+            break;
+         case mm::SequenceTarget::Exposure:
+            startExposureSequence(label);
+            break;
+      }
+   }
 }
 
 /**
- * Transfer a sequence of stage positions to the xy stage.
- * xSequence and ySequence must have the same length.
- * This should only be called for XY stages that are sequenceable
- * @param label        the XY stage device label
- * @param xSequence    the sequence of x positions that the stage will execute in response to external triggers
- * @param ySequence    the sequence of y positions that the stage will execute in response to external triggers
+ * Stops the hardware sequences of a chunk of the sequence plan.
+ * @param chunk   the chunk index
  */
-void CMMCore::loadXYStageSequence(const char* label,
-                                  std::vector<double> xSequence,
-                                  std::vector<double> ySequence) throw (CMMError)
+void CMMCore::stopSequencePlanChunk(long chunk) throw (CMMError)
 {
-   std::shared_ptr<XYStageInstance> pStage =
-      deviceManager_->GetDeviceOfType<XYStageInstance>(label);
+   const mm::SequenceChunk& c = getSequencePlanChunk(chunk);
+   for (const auto& seq : c.sequences)
+   {
+      const mm::SequenceTarget& target = seq.first;
+      const char* label = target.device.c_str();
+      switch (target.kind)
+      {
+         case mm::SequenceTarget::Property:
+            stopPropertySequence(label, target.property.c_str());
+            break;
+         case mm::SequenceTarget::Stage:
+            stopStageSequence(label);
+            break;
+         case mm::SequenceTarget::Exposure:
+            stopExposureSequence(label);
+            break;
+      }
+   }
+}
 
-   mm::DeviceModuleLockGuard guard(pStage);
+/**
+ * Estimates the highest frame rate at which the compiled sequence plan can
+ * run, over all chunks. The frame period of a chunk is taken to be its
+ * longest exposure plus the current camera's readout time (if the camera
+ * has a ReadoutTime property), but no shorter than the action delay of any
+ * device that is sequenced in the chunk. Time spent between chunks is not
+ * included.
+ * @return the frame rate in frames per second
+ */
+double CMMCore::getSequencePlanMaxFrameRate() throw (CMMError)
+{
+   if (!sequencePlan_->compiled)
+      throw CMMError("Sequence plan has not been compiled");
 
-   int ret;
-   ret = pStage->ClearXYStageSequence();
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pStage));
+   const std::string camera = getCameraDevice();
+   if (camera.empty())
+      throw CMMError(getCoreErrorText(MMERR_CameraNotAvailable).c_str(),
+            MMERR_CameraNotAvailable);
+   const mm::SequenceTarget exposureTarget(mm::SequenceTarget::Exposure, camera);
+   const double currentExposure = getExposure();
+   double readout = 0.0;
+   if (hasProperty(camera.c_str(), MM::g_Keyword_ReadoutTime))
+      readout = mm::ParseSequenceValue(
+            getProperty(camera.c_str(), MM::g_Keyword_ReadoutTime));
 
-   std::vector<double>::iterator itx, ity;
-   for ( itx=xSequence.begin(), ity=ySequence.begin() ;
-         (itx < xSequence.end()) && (ity < ySequence.end()); itx++, ity++)
+   double longestPeriod = 0.0;
+   for (const mm::SequenceChunk& c : sequencePlan_->chunks)
    {
-      ret = pStage->AddToXYStageSequence(*itx, *ity);
-      if (ret != DEVICE_OK)
-         throw CMMError(getDeviceErrorText(ret, pStage));
+      double exposure = currentExposure;
+      auto constant = c.constants.find(exposureTarget);
+      if (constant != c.constants.end())
+         exposure = mm::ParseSequenceValue(constant->second);
+      auto seq = c.sequences.find(exposureTarget);
+      if (seq != c.sequences.end())
+      {
+         exposure = 0.0;
+         for (const std::string& value : seq->second)
+            exposure = std::max(exposure, mm::ParseSequenceValue(value));
+      }
+
+      double period = exposure + readout;
+      for (const auto& s : c.sequences)
+         period = std::max(period, getDeviceDelayMs(s.first.device.c_str()));
+      longestPeriod = std::max(longestPeriod, period);
    }
+   if (longestPeriod <= 0.0)
+      return 0.0;
+   return 1000.0 / longestPeriod;
+}
 
-   ret = pStage->SendXYStageSequence();
-   if (ret != DEVICE_OK)
-      throw CMMError(getDeviceErrorText(ret, pStage));
+const mm::SequenceChunk& CMMCore::getSequencePlanChunk(long chunk) throw (CMMError)
+{
+   if (!sequencePlan_->compiled)
+      throw CMMError("Sequence plan has not been compiled");
+   if (chunk < 0 || chunk >= static_cast<long>(sequencePlan_->chunks.size()))
+      throw CMMError("Sequence plan chunk index " + ToString(chunk) +
+            " is out of range");
+   return sequencePlan_->chunks[chunk];
 }
 
+void CMMCore::loadSequencePlanSequences(const mm::SequenceChunk& chunk,
+      const std::vector<mm::SequenceTarget>& targets) throw (CMMError)
+{
+   for (const mm::SequenceTarget& target : targets)
+   {
+      const std::vector<std::string>& values = chunk.sequences.find(target)->second;
+      const char* label = target.device.c_str();
+      if (target.kind == mm::SequenceTarget::Property)
+      {
+         loadPropertySequence(label, target.property.c_str(), values);
+         continue;
+      }
+
+      std::vector<double> numbers;
+      numbers.reserve(values.size());
+      for (const std::string& value : values)
+         numbers.push_back(mm::ParseSequenceValue(value));
+      if (target.kind == mm::SequenceTarget::Stage)
+         loadStageSequence(label, numbers);
+      else
+         loadExposureSequence(label, numbers);
+   }
+}
 
 /**
  * Acquires a single image with current settings.
@@ -2827,12 +3600,13 @@ void CMMCore::startSequenceAcquisition(long numImages, double intervalMs, bool s
 
 		try
 		{
-			if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+			if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel(), camera->GetBitDepth()))
 			{
 				logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
 				throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
 			}
 			cbuf_->Clear();
+         applyBufferOverflowPolicy(stopOnOverflow);
          mm::DeviceModuleLockGuard guard(camera);
 
          LOG_DEBUG(coreLogger_) << "Will start sequence acquisition from default camera";
@@ -2871,12 +3645,13 @@ void CMMCore::startSequenceAcquisition(const char* label, long numImages, double
       throw CMMError(getCoreErrorText(MMERR_NotAllowedDuringSequenceAcquisition).c_str(),
                      MMERR_NotAllowedDuringSequenceAcquisition);
 
-   if (!cbuf_->Initialize(pCam->GetNumberOfChannels(), pCam->GetImageWidth(), pCam->GetImageHeight(), pCam->GetImageBytesPerPixel()))
+   if (!cbuf_->Initialize(pCam->GetNumberOfChannels(), pCam->GetImageWidth(), pCam->GetImageHeight(), pCam->GetImageBytesPerPixel(), pCam->GetBitDepth()))
    {
       logError(getDeviceName(pCam).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
       throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
    }
    cbuf_->Clear();
+   applyBufferOverflowPolicy(stopOnOverflow);
 	
    LOG_DEBUG(coreLogger_) <<
       "Will start sequence acquisition from camera " << label;
@@ -2922,7 +3697,7 @@ void CMMCore::initializeCircularBuffer() throw (CMMError)
    if (camera)
    {
       mm::DeviceModuleLockGuard guard(camera);
-      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel(), camera->GetBitDepth()))
       {
          logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
          throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
@@ -2974,12 +3749,13 @@ void CMMCore::startContinuousSequenceAcquisition(double intervalMs) throw (CMMEr
             ,MMERR_NotAllowedDuringSequenceAcquisition);
       }
 
-      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+      if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel(), camera->GetBitDepth()))
       {
          logError(getDeviceName(camera).c_str(), getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str());
          throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
       }
       cbuf_->Clear();
+      applyBufferOverflowPolicy(false);
       LOG_DEBUG(coreLogger_) << "Will start continuous sequence acquisition from current camera";
       int nRet = camera->StartSequenceAcquisition(intervalMs);
       if (nRet != DEVICE_OK)
@@ -3143,64 +3919,431 @@ void* CMMCore::getNBeforeLastImageMD(unsigned long n, Metadata& md) const throw
 }
 
 /**
- * Gets and removes the next image from the circular buffer.
- * Returns 0 if the buffer is empty.
+ * Gets and removes the next image from the circular buffer.
+ * Returns 0 if the buffer is empty.
+ *
+ * Supported data types are byte (8 bits per pixel, 1 component), short 
+ * (16 bits per pixel, 1 component), float (32 bits per pixel, 1 component, not
+ * supported by the UI yet), RGB_32 (8 bits per component, 4 components), RGB_64
+ * (16 bits per component, 4 components, not supported by UI yet).  
+ * RGB buffers are expected to be in big endian ARGB format (ARGB8888), which means that
+ * on little endian the format is BGRA888 
+ * (see: https://en.wikipedia.org/wiki/RGBA_color_model).
+ */
+void* CMMCore::popNextImage() throw (CMMError)
+{
+   unsigned char* pBuf = const_cast<unsigned char*>(cbuf_->GetNextImage());
+   if (pBuf != 0)
+      return pBuf;
+   else
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+}
+
+/**
+ * Gets and removes the next image (and metadata) from the circular buffer
+ * channel indicates which cameraChannel image should be retrieved.
+ * slice has not been implement and should always be 0
+ */
+void* CMMCore::popNextImageMD(unsigned channel, unsigned slice, Metadata& md) throw (CMMError)
+{
+   // Slices have never been implemented on the device interface side
+   if (slice != 0)
+      throw CMMError("Slice must be 0");
+
+   const mm::ImgBuffer* pBuf = cbuf_->GetNextImageBuffer(channel);
+   if (pBuf != 0)
+   {
+      md = pBuf->GetMetadata();
+      return const_cast<unsigned char*>(pBuf->GetPixels());
+   }
+   else
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+}
+
+/**
+ * Gets and removes the next image (and metadata) from the circular buffer
+ */
+void* CMMCore::popNextImageMD(Metadata& md) throw (CMMError)
+{
+   return popNextImageMD(0, 0, md);
+}
+
+/**
+ * Removes all images from the circular buffer.
+ *
+ * It is rarely necessary to call this directly since starting a sequence
+ * acquisition or changing the ROI will always clear the buffer.
+ */
+void CMMCore::clearCircularBuffer() throw (CMMError)
+{
+   cbuf_->Clear();
+}
+
+/**
+ * Gets and removes the next image (and metadata) from the circular buffer,
+ * like popNextImageMD(), but pins it instead of letting it be overwritten.
+ *
+ * The returned pin gives access to the pixels, in place, through
+ * getPinnedImage(). The buffer slot is not reused until
+ * releasePinnedImage() is called: if the camera catches up with a pinned
+ * image, the buffer overflows. The circular buffer cannot be resized or
+ * reallocated for a new image size while any image is pinned.
+ *
+ * md is overwritten, so that callers can reuse the same object.
+ */
+long CMMCore::pinNextImageMD(unsigned channel, Metadata& md) throw (CMMError)
+{
+   unsigned long slot;
+   const mm::ImgBuffer* pBuf = cbuf_->PinNextImageBuffer(channel, slot);
+   if (pBuf == 0)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   md = pBuf->GetMetadata();
+
+   MMThreadGuard g(pinnedImagesLock_);
+   PinnedImage pinned = { slot, pBuf };
+   pinnedImages_[nextPinId_] = pinned;
+   return nextPinId_++;
+}
+
+/**
+ * Pins the image that was last inserted into the circular buffer, without
+ * removing it, and provides its metadata. See pinNextImageMD().
+ */
+long CMMCore::pinLastImageMD(unsigned channel, Metadata& md) throw (CMMError)
+{
+   unsigned long slot;
+   const mm::ImgBuffer* pBuf = cbuf_->PinTopImageBuffer(channel, slot);
+   if (pBuf == 0)
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   md = pBuf->GetMetadata();
+
+   MMThreadGuard g(pinnedImagesLock_);
+   PinnedImage pinned = { slot, pBuf };
+   pinnedImages_[nextPinId_] = pinned;
+   return nextPinId_++;
+}
+
+/**
+ * Returns a pointer to the pixels of a pinned image, valid until the image
+ * is released. The size in bytes is given by getPinnedImageBufferSize().
+ */
+void* CMMCore::getPinnedImage(long pin) throw (CMMError)
+{
+   return const_cast<unsigned char*>(getPinnedImageBuffer(pin)->GetPixels());
+}
+
+/**
+ * Returns the size in bytes of the pixels of a pinned image.
+ */
+long CMMCore::getPinnedImageBufferSize(long pin) throw (CMMError)
+{
+   const mm::ImgBuffer* img = getPinnedImageBuffer(pin);
+   return static_cast<long>(img->Width()) * img->Height() * img->Depth();
+}
+
+/**
+ * Returns the width of a pinned image.
+ */
+unsigned CMMCore::getPinnedImageWidth(long pin) throw (CMMError)
+{
+   return getPinnedImageBuffer(pin)->Width();
+}
+
+/**
+ * Returns the height of a pinned image.
+ */
+unsigned CMMCore::getPinnedImageHeight(long pin) throw (CMMError)
+{
+   return getPinnedImageBuffer(pin)->Height();
+}
+
+/**
+ * Returns the number of bytes per pixel (including all components) of a
+ * pinned image.
+ */
+unsigned CMMCore::getPinnedImageBytesPerPixel(long pin) throw (CMMError)
+{
+   return getPinnedImageBuffer(pin)->Depth();
+}
+
+/**
+ * Releases a pinned image, allowing its buffer slot to be reused. Pointers
+ * to its pixels must not be used afterwards.
+ */
+void CMMCore::releasePinnedImage(long pin) throw (CMMError)
+{
+   MMThreadGuard g(pinnedImagesLock_);
+   std::map<long, PinnedImage>::iterator it = pinnedImages_.find(pin);
+   if (it == pinnedImages_.end())
+      throw CMMError("No pinned image " + ToString(pin));
+   cbuf_->UnpinImageBuffer(it->second.slot);
+   pinnedImages_.erase(it);
+}
+
+/**
+ * Returns the number of images currently pinned.
+ */
+long CMMCore::getPinnedImageCount()
+{
+   MMThreadGuard g(pinnedImagesLock_);
+   return static_cast<long>(pinnedImages_.size());
+}
+
+const mm::ImgBuffer* CMMCore::getPinnedImageBuffer(long pin) throw (CMMError)
+{
+   MMThreadGuard g(pinnedImagesLock_);
+   std::map<long, PinnedImage>::const_iterator it = pinnedImages_.find(pin);
+   if (it == pinnedImages_.end())
+      throw CMMError("No pinned image " + ToString(pin));
+   return it->second.image;
+}
+
+/**
+ * Starts exporting sequence acquisition images to a named POSIX shared-memory
+ * segment, so that other processes can read them without copying.
+ *
+ * Every image inserted into the circular buffer from now on is also written
+ * to the segment, which is a ring of its own (images already in the circular
+ * buffer are not exported). The segment layout is documented in
+ * SharedFrames/SharedFrameLayout.h, and SharedFrames/SharedFrameReader.h is
+ * a C library for reading it.
+ *
+ * The segment is removed when export is disabled or the Core is destroyed.
+ * Any previous export is stopped first. Not supported on Windows.
+ *
+ * @param name   the shared-memory object name, e.g. "/mm-frames"
+ * @param sizeMB the segment size, which determines how many images it holds
+ */
+void CMMCore::enableSharedMemoryExport(const char* name, unsigned sizeMB) throw (CMMError)
+{
+   if (name == 0)
+      throw CMMError(errorText_[MMERR_NullPointerException], MMERR_NullPointerException);
+   disableSharedMemoryExport();
+
+   std::shared_ptr<mm::SharedFrameRing> ring =
+      std::make_shared<mm::SharedFrameRing>(name,
+            static_cast<std::size_t>(sizeMB) << 20);
+   sharedFrameRing_ = ring;
+   cbuf_->SetSharedFrameRing(ring);
+   LOG_INFO(coreLogger_) << "Exporting images to shared memory segment " <<
+      ring->Name() << " (" << sizeMB << " MB)";
+}
+
+/**
+ * Stops exporting images to shared memory and removes the segment.
+ *
+ * Readers that have the segment open can continue to read the images
+ * already exported.
+ */
+void CMMCore::disableSharedMemoryExport()
+{
+   if (!sharedFrameRing_)
+      return;
+   cbuf_->SetSharedFrameRing(std::shared_ptr<mm::SharedFrameRing>());
+   LOG_INFO(coreLogger_) << "Stopped exporting images to shared memory segment " <<
+      sharedFrameRing_->Name() << " after " <<
+      sharedFrameRing_->FramesPublished() << " images";
+   sharedFrameRing_.reset();
+}
+
+/**
+ * Returns the shared-memory object name images are being exported to, or an
+ * empty string if export is disabled.
+ */
+std::string CMMCore::getSharedMemoryExportName()
+{
+   if (!sharedFrameRing_)
+      return std::string();
+   return sharedFrameRing_->Name();
+}
+
+/**
+ * Starts writing the images in the circular buffer to disk, in the
+ * background.
+ *
+ * Pixels are appended to basePath.raw, and an index with the offset, size
+ * and metadata of each image to basePath.idx. All channels of multi-channel
+ * cameras are written, each with its channel number in the index. The images are consumed, as
+ * by popNextImage(), so the application should not pop images while
+ * streaming (getLastImage() can be used for display). If the disk cannot
+ * keep up, the circular buffer fills and its overflow policy applies (see
+ * setBufferOverflowPolicy()).
+ *
+ * Files are written with the operating system's page cache bypassed where
+ * the file system supports it.
+ *
+ * @param basePath        path of the files to create, without extension
+ * @param writerThreads   number of concurrent disk writes (at least 1)
+ */
+void CMMCore::startDiskStreaming(const char* basePath, unsigned writerThreads) throw (CMMError)
+{
+   if (basePath == 0)
+      throw CMMError(errorText_[MMERR_NullPointerException], MMERR_NullPointerException);
+   if (isDiskStreaming())
+      throw CMMError("Already streaming to " + diskStreamWriter_->BasePath(),
+            MMERR_NotAllowedDuringSequenceAcquisition);
+   diskStreamWriter_.reset();
+
+   diskStreamWriter_ = std::make_shared<mm::DiskStreamWriter>(*cbuf_,
+         basePath, writerThreads);
+   LOG_INFO(coreLogger_) << "Started streaming images to " << basePath <<
+      (diskStreamWriter_->IsUnbuffered() ? " (unbuffered)" : "");
+}
+
+/**
+ * Writes the unread images inserted into the circular buffer before this
+ * call to disk, then stops streaming and closes the files. Images inserted
+ * later stay in the buffer.
+ *
+ * Throws if a write error occurred while streaming (streaming stops at the
+ * first error).
+ */
+void CMMCore::stopDiskStreaming() throw (CMMError)
+{
+   if (!diskStreamWriter_ || diskStreamWriter_->IsStopped())
+      return;
+   diskStreamWriter_->Stop();
+   LOG_INFO(coreLogger_) << "Stopped streaming images to " <<
+      diskStreamWriter_->BasePath() << " after " <<
+      diskStreamWriter_->ImageCount() << " images";
+}
+
+/**
+ * Returns whether images are being streamed to disk (false after a write
+ * error).
+ */
+bool CMMCore::isDiskStreaming() const
+{
+   return diskStreamWriter_ && diskStreamWriter_->IsActive();
+}
+
+/**
+ * Returns the number of images streamed to disk since the last call to
+ * startDiskStreaming().
+ */
+long CMMCore::getDiskStreamingImageCount() const
+{
+   if (!diskStreamWriter_)
+      return 0;
+   return static_cast<long>(diskStreamWriter_->ImageCount());
+}
+
+/**
+ * Starts producing preview images for live display in the background.
+ *
+ * The newest image in the circular buffer is binned (averaging binning x
+ * binning blocks of pixels) at most maxFps times per second, and only when a
+ * new image has arrived. Display clients can then poll getPreviewImage(),
+ * which does not access the circular buffer and so never delays the camera,
+ * unlike getLastImage(). Images are not removed from the circular buffer.
+ * Only channel 0 of multi-channel cameras is previewed.
+ *
+ * Calling this while the preview stream is running changes its settings.
+ *
+ * @param binning   binning factor (1 to 16; 1 for full resolution)
+ * @param maxFps    maximum number of preview images per second
+ */
+void CMMCore::startPreviewStream(unsigned binning, double maxFps) throw (CMMError)
+{
+   if (binning < 1 || binning > 16)
+      throw CMMError("Preview binning must be between 1 and 16",
+            MMERR_InvalidContents);
+   if (!(maxFps > 0.0))
+      throw CMMError("Preview frame rate must be positive",
+            MMERR_InvalidContents);
+   previewStream_.reset();
+   previewStream_ = std::make_shared<mm::PreviewStream>(*cbuf_, binning, maxFps);
+   LOG_DEBUG(coreLogger_) << "Started preview stream (binning " << binning <<
+      ", at most " << maxFps << " fps)";
+}
+
+/**
+ * Stops producing preview images.
+ */
+void CMMCore::stopPreviewStream()
+{
+   if (!previewStream_)
+      return;
+   previewStream_.reset();
+   LOG_DEBUG(coreLogger_) << "Stopped preview stream";
+}
+
+/**
+ * Returns whether preview images are being produced.
+ */
+bool CMMCore::isPreviewStreamRunning() const
+{
+   return previewStream_ != 0;
+}
+
+/**
+ * Returns the number of preview images produced since startPreviewStream().
+ *
+ * Clients can poll this cheaply to find out whether getPreviewImage() has a
+ * new image.
+ */
+long CMMCore::getPreviewImageCount() const
+{
+   if (!previewStream_)
+      return 0;
+   return static_cast<long>(previewStream_->ImageCount());
+}
+
+/**
+ * Returns the latest preview image (see startPreviewStream()).
  *
- * Supported data types are byte (8 bits per pixel, 1 component), short 
- * (16 bits per pixel, 1 component), float (32 bits per pixel, 1 component, not
- * supported by the UI yet), RGB_32 (8 bits per component, 4 components), RGB_64
- * (16 bits per component, 4 components, not supported by UI yet).  
- * RGB buffers are expected to be in big endian ARGB format (ARGB8888), which means that
- * on little endian the format is BGRA888 
- * (see: https://en.wikipedia.org/wiki/RGBA_color_model).
+ * The image has the pixel type of the camera image and the dimensions given
+ * by getPreviewImageWidth() and getPreviewImageHeight(), which describe the
+ * image last returned by this function. The returned pixels remain valid
+ * until the next call. The metadata is that of the source image, except
+ * for the Width and Height tags.
+ *
+ * Throws if the preview stream is not running or has not produced an image
+ * yet.
  */
-void* CMMCore::popNextImage() throw (CMMError)
+void* CMMCore::getPreviewImage(Metadata& md) throw (CMMError)
 {
-   unsigned char* pBuf = const_cast<unsigned char*>(cbuf_->GetNextImage());
-   if (pBuf != 0)
-      return pBuf;
-   else
-      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+   if (!previewStream_)
+      throw CMMError("Preview stream is not running");
+   if (!previewStream_->GetLatest(previewPixels_, previewWidth_,
+            previewHeight_, previewBytesPerPixel_, previewComponents_, md))
+      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(),
+            MMERR_CircularBufferEmpty);
+   return previewPixels_.data();
 }
 
 /**
- * Gets and removes the next image (and metadata) from the circular buffer
- * channel indicates which cameraChannel image should be retrieved.
- * slice has not been implement and should always be 0
+ * Returns the width of the image last returned by getPreviewImage().
  */
-void* CMMCore::popNextImageMD(unsigned channel, unsigned slice, Metadata& md) throw (CMMError)
+unsigned CMMCore::getPreviewImageWidth() const
 {
-   // Slices have never been implemented on the device interface side
-   if (slice != 0)
-      throw CMMError("Slice must be 0");
+   return previewWidth_;
+}
 
-   const mm::ImgBuffer* pBuf = cbuf_->GetNextImageBuffer(channel);
-   if (pBuf != 0)
-   {
-      md = pBuf->GetMetadata();
-      return const_cast<unsigned char*>(pBuf->GetPixels());
-   }
-   else
-      throw CMMError(getCoreErrorText(MMERR_CircularBufferEmpty).c_str(), MMERR_CircularBufferEmpty);
+/**
+ * Returns the height of the image last returned by getPreviewImage().
+ */
+unsigned CMMCore::getPreviewImageHeight() const
+{
+   return previewHeight_;
 }
 
 /**
- * Gets and removes the next image (and metadata) from the circular buffer
+ * Returns the bytes per pixel of the image last returned by
+ * getPreviewImage().
  */
-void* CMMCore::popNextImageMD(Metadata& md) throw (CMMError)
+unsigned CMMCore::getPreviewImageBytesPerPixel() const
 {
-   return popNextImageMD(0, 0, md);
+   return previewBytesPerPixel_;
 }
 
 /**
- * Removes all images from the circular buffer.
- *
- * It is rarely necessary to call this directly since starting a sequence
- * acquisition or changing the ROI will always clear the buffer.
+ * Returns the number of components (1, or 4 for RGB) of the image last
+ * returned by getPreviewImage().
  */
-void CMMCore::clearCircularBuffer() throw (CMMError)
+unsigned CMMCore::getPreviewImageNumberOfComponents() const
 {
-   cbuf_->Clear();
+   return previewComponents_;
 }
 
 /**
@@ -3209,12 +4352,21 @@ void CMMCore::clearCircularBuffer() throw (CMMError)
 void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
                                                ) throw (CMMError)
 {
+   if (getPinnedImageCount() > 0)
+      throw CMMError("Cannot change the circular buffer size while images are pinned");
+   if (isDiskStreaming())
+      throw CMMError("Cannot change the circular buffer size while streaming to disk");
+   // The preview stream is restarted on the new buffer
+   unsigned previewBinning = previewStream_ ? previewStream_->Binning() : 0;
+   double previewMaxFps = previewStream_ ? previewStream_->MaxFps() : 0.0;
+   previewStream_.reset();
    delete cbuf_; // discard old buffer
    LOG_DEBUG(coreLogger_) << "Will set circular buffer size to " <<
       sizeMB << " MB";
 	try
 	{
-		cbuf_ = new CircularBuffer(sizeMB);
+		cbuf_ = new CircularBuffer(sizeMB, cbufHugePages_, cbufPrefault_,
+            getThreadPool());
 	}
 	catch (std::bad_alloc& ex)
 	{
@@ -3224,6 +4376,13 @@ void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
 		throw CMMError(messs.str().c_str() , MMERR_OutOfMemory);
 	}
 	if (NULL == cbuf_) throw CMMError(getCoreErrorText(MMERR_OutOfMemory).c_str(), MMERR_OutOfMemory);
+   cbuf_->SetSharedFrameRing(sharedFrameRing_);
+   cbuf_->SetPackedStorage(cbufPacking_);
+   cbuf_->SetImageStatistics(imageStatistics_, imageStatisticsBins_);
+   applyBufferOverflowPolicy(false);
+   if (previewBinning > 0)
+      previewStream_ = std::make_shared<mm::PreviewStream>(*cbuf_,
+            previewBinning, previewMaxFps);
 
 
 	try
@@ -3234,12 +4393,12 @@ void CMMCore::setCircularBufferMemoryFootprint(unsigned sizeMB ///< n megabytes
       if (camera)
 		{
          mm::DeviceModuleLockGuard guard(camera);
-         if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel()))
+         if (!cbuf_->Initialize(camera->GetNumberOfChannels(), camera->GetImageWidth(), camera->GetImageHeight(), camera->GetImageBytesPerPixel(), camera->GetBitDepth()))
 				throw CMMError(getCoreErrorText(MMERR_CircularBufferFailedToInitialize).c_str(), MMERR_CircularBufferFailedToInitialize);
 		}
 
       LOG_DEBUG(coreLogger_) << "Did set circular buffer size to " <<
-         sizeMB << " MB";
+         sizeMB << " MB" << (cbuf_->UsesHugePages() ? " (huge pages)" : "");
 	}
 	catch (std::bad_alloc& ex)
 	{
@@ -3263,6 +4422,261 @@ unsigned CMMCore::getCircularBufferMemoryFootprint()
    return 0;
 }
 
+/**
+ * Request huge pages for the circular buffer memory, which reduces page
+ * faults and TLB misses when streaming large images.
+ *
+ * Only effective on Linux (explicit huge pages if the system has reserved
+ * them, otherwise transparent huge pages); elsewhere, and if huge pages are
+ * unavailable, normal pages are used. Changing the setting reallocates the
+ * circular buffer, discarding its contents.
+ */
+void CMMCore::enableCircularBufferHugePages(bool enable) throw (CMMError)
+{
+   if (enable == cbufHugePages_)
+      return;
+   if (getPinnedImageCount() > 0)
+      throw CMMError("Cannot reallocate the circular buffer while images are pinned");
+   if (isDiskStreaming())
+      throw CMMError("Cannot reallocate the circular buffer while streaming to disk");
+   cbufHugePages_ = enable;
+   setCircularBufferMemoryFootprint(getCircularBufferMemoryFootprint());
+}
+
+/**
+ * Returns whether huge pages are requested for the circular buffer.
+ */
+bool CMMCore::isCircularBufferHugePagesEnabled() const
+{
+   return cbufHugePages_;
+}
+
+/**
+ * Commit the circular buffer memory in a background thread as soon as the
+ * buffer is allocated, so that the first frames of an acquisition do not
+ * incur page faults.
+ *
+ * By default, memory is committed as it is first written. Prefaulting makes
+ * the whole buffer resident, even if only part of it is used. Changing the
+ * setting reallocates the circular buffer, discarding its contents.
+ */
+void CMMCore::enableCircularBufferPrefault(bool enable) throw (CMMError)
+{
+   if (enable == cbufPrefault_)
+      return;
+   if (getPinnedImageCount() > 0)
+      throw CMMError("Cannot reallocate the circular buffer while images are pinned");
+   if (isDiskStreaming())
+      throw CMMError("Cannot reallocate the circular buffer while streaming to disk");
+   cbufPrefault_ = enable;
+   setCircularBufferMemoryFootprint(getCircularBufferMemoryFootprint());
+}
+
+/**
+ * Returns whether the circular buffer memory is committed in advance.
+ */
+bool CMMCore::isCircularBufferPrefaultEnabled() const
+{
+   return cbufPrefault_;
+}
+
+/**
+ * Store 16-bit images of 10, 12, or 14 bits per pixel bit-packed in the
+ * circular buffer, so that it holds up to 60% more images.
+ *
+ * The bit depth is the one reported by the camera (getImageBitDepth()), and
+ * bits above it are discarded, so this should only be enabled for cameras
+ * whose images fit their reported bit depth. Images are packed as they are
+ * inserted and unpacked when retrieved; the retrieval functions return
+ * ordinary 16-bit images. Other images are stored unpacked. The setting
+ * takes effect when the buffer is next initialized, discarding its
+ * contents.
+ */
+void CMMCore::enableCircularBufferPacking(bool enable) throw (CMMError)
+{
+   if (enable == cbufPacking_)
+      return;
+   if (getPinnedImageCount() > 0)
+      throw CMMError("Cannot change the circular buffer storage while images are pinned");
+   if (isDiskStreaming())
+      throw CMMError("Cannot change the circular buffer storage while streaming to disk");
+   cbufPacking_ = enable;
+   cbuf_->SetPackedStorage(enable);
+}
+
+/**
+ * Returns whether 10- to 14-bit images are stored bit-packed in the circular
+ * buffer.
+ */
+bool CMMCore::isCircularBufferPackingEnabled() const
+{
+   return cbufPacking_;
+}
+
+/**
+ * Compute pixel statistics of each image as it is inserted into the circular
+ * buffer.
+ *
+ * The minimum, maximum, mean, standard deviation, number of saturated
+ * samples, and (optionally) a histogram are attached to the image metadata
+ * (tags Statistics-Min, Statistics-Max, Statistics-Mean, Statistics-StdDev,
+ * Statistics-SaturatedCount, and the array tag Statistics-Histogram), and
+ * those of the last image are also available from getLastImageStatistics().
+ * Saturation and the histogram range are based on the bit depth of the
+ * camera (getImageBitDepth()). Statistics are computed for 8- and 16-bit
+ * grayscale and for RGB32 images (over the color components, ignoring
+ * alpha); other images get none.
+ *
+ * This adds to the time taken to insert each image: for a 4-megapixel
+ * 16-bit image on one thread with AVX2, under a millisecond, or a few
+ * milliseconds with a histogram. Large images are split among the threads
+ * that copy images into the buffer.
+ *
+ * @param enable          whether to compute statistics
+ * @param histogramBins   number of histogram bins (a power of 2, up to
+ *                        65536), or 0 for no histogram
+ */
+void CMMCore::enableImageStatistics(bool enable, unsigned histogramBins) throw (CMMError)
+{
+   if (histogramBins > 65536 || (histogramBins & (histogramBins - 1)) != 0)
+      throw CMMError("Histogram bin count must be 0 or a power of 2 up to 65536",
+            MMERR_InvalidContents);
+   imageStatistics_ = enable;
+   imageStatisticsBins_ = histogramBins;
+   cbuf_->SetImageStatistics(enable, histogramBins);
+   LOG_DEBUG(coreLogger_) << (enable ? "Enabled" : "Disabled") <<
+      " image statistics (" << histogramBins << " histogram bins)";
+}
+
+/**
+ * Returns whether pixel statistics are computed for each image inserted into
+ * the circular buffer.
+ */
+bool CMMCore::isImageStatisticsEnabled() const
+{
+   return imageStatistics_;
+}
+
+/**
+ * Returns the pixel statistics of the last image inserted into the circular
+ * buffer (see enableImageStatistics()), without reading its pixels.
+ *
+ * Throws if no image has been inserted with statistics since the buffer was
+ * last cleared.
+ */
+ImageStatistics CMMCore::getLastImageStatistics() throw (CMMError)
+{
+   return getLastImageStatistics(0);
+}
+
+/**
+ * Returns the pixel statistics of the given channel of the last image
+ * inserted into the circular buffer (see enableImageStatistics()).
+ */
+ImageStatistics CMMCore::getLastImageStatistics(unsigned channel) throw (CMMError)
+{
+   mm::PixelStatistics::Result stats;
+   if (!cbuf_->GetLastImageStatistics(channel, stats))
+      throw CMMError("No image statistics available", MMERR_CircularBufferEmpty);
+   ImageStatistics ret;
+   ret.sampleCount = static_cast<long>(stats.sampleCount);
+   ret.minimum = static_cast<long>(stats.minimum);
+   ret.maximum = static_cast<long>(stats.maximum);
+   ret.mean = stats.mean;
+   ret.standardDeviation = stats.standardDeviation;
+   ret.saturatedCount = static_cast<long>(stats.saturatedCount);
+   ret.histogram.assign(stats.histogram.begin(), stats.histogram.end());
+   return ret;
+}
+
+/**
+ * Sets the number of worker threads.
+ *
+ * The worker threads copy images into the circular buffer and compute their
+ * statistics, and run the parallel loops of device adapters
+ * (MM::Core::ParallelFor()). Work queued by a thread goes to its own queue,
+ * and idle threads take work from the others. By default there is one
+ * thread per hardware thread.
+ *
+ * The threads are replaced once the work in progress is done; the CPU
+ * affinity (see setWorkerThreadAffinity()) is kept.
+ *
+ * @param count   number of threads, or 0 for one per hardware thread
+ */
+void CMMCore::setWorkerThreadCount(unsigned count) throw (CMMError)
+{
+   replaceThreadPool(count, getWorkerThreadAffinity());
+}
+
+/**
+ * Returns the number of worker threads.
+ */
+unsigned CMMCore::getWorkerThreadCount()
+{
+   return static_cast<unsigned>(getThreadPool()->GetSize());
+}
+
+/**
+ * Restricts the worker threads to the given CPUs: thread n runs only on CPU
+ * cpus[n % cpus.size()]. An empty list lets the threads run on any CPU.
+ *
+ * Pinning the threads to the cores near the camera's memory and interrupts
+ * can make frame processing times more predictable. Ignored on platforms
+ * without thread affinity (macOS).
+ *
+ * @param cpus   CPU indices, as numbered by the operating system
+ */
+void CMMCore::setWorkerThreadAffinity(std::vector<unsigned> cpus) throw (CMMError)
+{
+   const unsigned hardwareThreads = std::thread::hardware_concurrency();
+   for (unsigned cpu : cpus)
+   {
+      if (hardwareThreads > 0 && cpu >= hardwareThreads)
+         throw CMMError("Invalid CPU index " + ToString(cpu) +
+               " for worker thread affinity", MMERR_InvalidContents);
+   }
+   const std::shared_ptr<ThreadPool> pool = getThreadPool();
+   replaceThreadPool(static_cast<unsigned>(pool->GetSize()), cpus);
+}
+
+/**
+ * Returns the CPUs the worker threads are restricted to, or an empty list if
+ * they may run on any CPU.
+ */
+std::vector<unsigned> CMMCore::getWorkerThreadAffinity()
+{
+   return getThreadPool()->GetCpuAffinity();
+}
+
+std::shared_ptr<ThreadPool> CMMCore::getThreadPool()
+{
+   MMThreadGuard guard(threadPoolLock_);
+   return threadPool_;
+}
+
+void CMMCore::replaceThreadPool(unsigned count,
+      const std::vector<unsigned>& cpus) throw (CMMError)
+{
+   std::shared_ptr<ThreadPool> pool;
+   try
+   {
+      pool = std::make_shared<ThreadPool>(count, cpus);
+   }
+   catch (const std::system_error& e)
+   {
+      throw CMMError("Cannot create worker threads: " + std::string(e.what()));
+   }
+   {
+      MMThreadGuard guard(threadPoolLock_);
+      threadPool_ = pool;
+   }
+   // Waits for the insertion in progress, if any, which still uses the old
+   // threads; parallel loops of devices keep their pool until they finish
+   cbuf_->SetThreadPool(pool);
+   LOG_DEBUG(coreLogger_) << "Using " << pool->GetSize() <<
+      " worker threads" << (cpus.empty() ? "" : " with CPU affinity");
+}
+
 /**
  * Returns number ofimages available in the Circular Buffer
  */
@@ -3309,6 +4723,74 @@ bool CMMCore::isBufferOverflowed() const
    return cbuf_->Overflow();
 }
 
+/**
+ * Sets what happens when a camera inserts an image into a full circular
+ * buffer.
+ *
+ * The policy is applied by the Core, for all cameras. It takes effect
+ * immediately and for subsequent acquisitions, except that an acquisition
+ * started with stopOnOverflow set to true always stops on overflow. Only
+ * BufferOverflowStop causes isBufferOverflowed() to return true; the images
+ * discarded under the other policies are counted in getBufferStatistics(),
+ * and show up as gaps in the ImageNumber metadata tag.
+ *
+ * @param policy   the overflow policy; the default is BufferOverflowClear
+ */
+void CMMCore::setBufferOverflowPolicy(BufferOverflowPolicy policy)
+{
+   bufferOverflowPolicy_ = policy;
+   applyBufferOverflowPolicy(false);
+   LOG_DEBUG(coreLogger_) << "Set buffer overflow policy to " << policy;
+}
+
+/**
+ * Returns the circular buffer overflow policy.
+ */
+BufferOverflowPolicy CMMCore::getBufferOverflowPolicy() const
+{
+   return bufferOverflowPolicy_;
+}
+
+/**
+ * Returns the image and overflow counts of the circular buffer since it was
+ * last cleared (normally, at the start of the current or last sequence
+ * acquisition).
+ */
+BufferStatistics CMMCore::getBufferStatistics() const
+{
+   CircularBuffer::Statistics stats = cbuf_->GetStatistics();
+   BufferStatistics ret;
+   ret.insertedImageCount = static_cast<long>(stats.insertedImages);
+   ret.droppedImageCount = static_cast<long>(stats.droppedImages);
+   ret.overflowCount = static_cast<long>(stats.overflows);
+   ret.imageNumberGapCount = static_cast<long>(stats.imageNumberGaps);
+   return ret;
+}
+
+void CMMCore::applyBufferOverflowPolicy(bool stopOnOverflow)
+{
+   CircularBuffer::OverflowPolicy policy = CircularBuffer::OverflowStop;
+   if (!stopOnOverflow)
+   {
+      switch (bufferOverflowPolicy_)
+      {
+         case BufferOverflowStop:
+            policy = CircularBuffer::OverflowStop;
+            break;
+         case BufferOverflowClear:
+            policy = CircularBuffer::OverflowClear;
+            break;
+         case BufferOverflowOverwriteOldest:
+            policy = CircularBuffer::OverflowOverwriteOldest;
+            break;
+         case BufferOverflowDropNewest:
+            policy = CircularBuffer::OverflowDropNewest;
+            break;
+      }
+   }
+   cbuf_->SetOverflowPolicy(policy);
+}
+
 /**
  * Returns the label of the currently selected camera device.
  * @return camera name
@@ -3825,6 +5307,117 @@ std::string CMMCore::getPropertyFromCache(const char* label, const char* propNam
    }
 }
 
+static void SetNumericDeviceProperty(DeviceInstance& device,
+      const char* propName, double value, const std::string& valueString)
+{ device.SetPropertyDouble(propName, value, valueString); }
+
+static void SetNumericDeviceProperty(DeviceInstance& device,
+      const char* propName, long value, const std::string& valueString)
+{ device.SetPropertyLong(propName, value, valueString); }
+
+static bool GetNumericDeviceProperty(DeviceInstance& device,
+      const char* propName, double& value)
+{ return device.GetPropertyDouble(propName, value); }
+
+static bool GetNumericDeviceProperty(DeviceInstance& device,
+      const char* propName, long& value)
+{ return device.GetPropertyLong(propName, value); }
+
+static bool ParseNumericPropertyValue(const std::string& str, double& value)
+{
+   char* end;
+   value = std::strtod(str.c_str(), &end);
+   return end != str.c_str() && *end == '\0';
+}
+
+static bool ParseNumericPropertyValue(const std::string& str, long& value)
+{
+   char* end;
+   value = std::strtol(str.c_str(), &end, 10);
+   return end != str.c_str() && *end == '\0';
+}
+
+// Numeric properties are passed to the device without string conversion
+// (DeviceInstance falls back to the string for properties that need it).
+// The string is still made once, for logging and the state cache.
+template <typename T>
+void CMMCore::setNumericProperty(const char* label, const char* propName,
+      T propValue) throw (CMMError)
+{
+   CheckDeviceLabel(label);
+   CheckPropertyName(propName);
+
+   const std::string valueString = ToString(propValue);
+   if (IsCoreDeviceLabel(label))
+   {
+      setProperty(label, propName, valueString.c_str());
+      return;
+   }
+
+   std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
+
+   mm::DeviceModuleLockGuard guard(pDevice);
+
+   SetNumericDeviceProperty(*pDevice, propName, propValue, valueString);
+
+   {
+      MMThreadGuard scg(stateCacheLock_);
+      stateCache_.addSetting(PropertySetting(label, propName,
+               valueString.c_str()));
+   }
+}
+
+template <typename T>
+T CMMCore::getNumericProperty(const char* label, const char* propName) throw (CMMError)
+{
+   T value;
+   if (!IsCoreDeviceLabel(label))
+   {
+      std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
+      CheckPropertyName(propName);
+
+      mm::DeviceModuleLockGuard guard(pDevice);
+      if (GetNumericDeviceProperty(*pDevice, propName, value))
+         return value;
+   }
+
+   if (!ParseNumericPropertyValue(getProperty(label, propName), value))
+      throw CMMError("Property " + ToQuotedString(propName) + " of device " +
+            ToQuotedString(label) + " is not numeric");
+   return value;
+}
+
+/**
+ * Returns the value of a numeric property.
+ *
+ * Float and integer device properties are read without conversion to and
+ * from a string. Other properties are read as strings and parsed; an
+ * exception is thrown if the value is not a number. Unlike getProperty(),
+ * this does not update the system state cache.
+ *
+ * @return the property value
+ * @param label      the device label
+ * @param propName   the property name
+ */
+double CMMCore::getPropertyAsDouble(const char* label, const char* propName) throw (CMMError)
+{
+   return getNumericProperty<double>(label, propName);
+}
+
+/**
+ * Returns the value of a numeric property as an integer.
+ *
+ * See getPropertyAsDouble(). Float properties are truncated.
+ *
+ * @return the property value
+ * @param label      the device label
+ * @param propName   the property name
+ */
+long CMMCore::getPropertyAsLong(const char* label, const char* propName) throw (CMMError)
+{
+   return getNumericProperty<long>(label, propName);
+}
+
 /**
  * Changes the value of the device property.
  *
@@ -3891,7 +5484,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
 void CMMCore::setProperty(const char* label, const char* propName,
                           const long propValue) throw (CMMError)
 {
-   setProperty(label, propName, ToString(propValue).c_str());
+   setNumericProperty(label, propName, propValue);
 }
 
 /**
@@ -3904,12 +5497,16 @@ void CMMCore::setProperty(const char* label, const char* propName,
 void CMMCore::setProperty(const char* label, const char* propName,
                           const float propValue) throw (CMMError)
 {
-   setProperty(label, propName, ToString(propValue).c_str());
+   setNumericProperty(label, propName, static_cast<double>(propValue));
 }
 
 /**
  * Changes the value of the device property.
  *
+ * Float and integer properties without a list of allowed values are set
+ * without conversion to a string (this also applies to the long and float
+ * overloads).
+ *
  * @param label          the device label
  * @param propName       the property name
  * @param propValue      the new property value
@@ -3917,7 +5514,7 @@ void CMMCore::setProperty(const char* label, const char* propName,
 void CMMCore::setProperty(const char* label, const char* propName,
                           const double propValue) throw (CMMError)
 {
-   setProperty(label, propName, ToString(propValue).c_str());
+   setNumericProperty(label, propName, propValue);
 }
 
 
@@ -4093,7 +5690,7 @@ void CMMCore::stopPropertySequence(const char* label, const char* propName) thro
  * @param propName        the property label
  * @param eventSequence   the sequence of events/states that the device will execute in response to external triggers
  */
-void CMMCore::loadPropertySequence(const char* label, const char* propName, std::vector<std::string> eventSequence) throw (CMMError)
+void CMMCore::loadPropertySequence(const char* label, const char* propName, const std::vector<std::string>& eventSequence) throw (CMMError)
 {
    if (IsCoreDeviceLabel(label))
       // XXX Should be a throw
@@ -4115,6 +5712,35 @@ void CMMCore::loadPropertySequence(const char* label, const char* propName, std:
    pDevice->SendPropertySequence(propName);
 }
 
+/**
+ * Transfer a sequence of numeric values to the device. Equivalent to
+ * loadPropertySequence() for numeric properties, but the values are passed
+ * to the device in a single call, which is much faster for long sequences.
+ * This should only be called for device-properties that are sequenceable
+ * @param label           the device name
+ * @param propName        the property label
+ * @param valueSequence   the sequence of values that the device will execute in response to external triggers
+ */
+void CMMCore::loadNumericPropertySequence(const char* label, const char* propName, const std::vector<double>& valueSequence) throw (CMMError)
+{
+   if (IsCoreDeviceLabel(label))
+      // XXX Should be a throw
+      return;
+   std::shared_ptr<DeviceInstance> pDevice = deviceManager_->GetDevice(label);
+   CheckPropertyName(propName);
+
+   mm::DeviceModuleLockGuard guard(pDevice);
+   MM::PropertyType type = pDevice->GetPropertyType(propName);
+   if (type != MM::Float && type != MM::Integer)
+      throw CMMError("Property " + ToQuotedString(propName) + " of device " +
+            ToQuotedString(label) + " is not numeric");
+
+   pDevice->ClearPropertySequence(propName);
+   pDevice->AddArrayToPropertySequence(propName, valueSequence.data(),
+         static_cast<unsigned long>(valueSequence.size()));
+   pDevice->SendPropertySequence(propName);
+}
+
 /**
  * Returns the intrinsic property type.
  */
@@ -7581,6 +9207,8 @@ void CMMCore::InitializeErrorMessages()
    errorText_[MMERR_NullPointerException] = "Null Pointer Exception.";
    errorText_[MMERR_CreatePeripheralFailed] = "Hub failed to create specified peripheral device.";
    errorText_[MMERR_BadAffineTransform] = "Bad affine transform.  Affine transforms need to have 6 numbers; 2 rows of 3 column.";
+   errorText_[MMERR_SharedMemoryExportFailed] = "Shared memory image export failed.";
+   errorText_[MMERR_DiskStreamingFailed] = "Streaming images to disk failed.";
 }
 
 void CMMCore::CreateCoreProperties()
@@ -95,6 +95,7 @@ class CorePropertyCollection;
 class MMEventCallback;
 class Metadata;
 class PixelSizeConfigGroup;
+class ThreadPool;
 
 class AutoFocusInstance;
 class CameraInstance;
@@ -110,7 +111,14 @@ class CMMCore;
 
 namespace mm {
    class DeviceManager;
+   class ImgBuffer;
    class LogManager;
+   class DiskStreamWriter;
+   class PreviewStream;
+   class SharedFrameRing;
+   struct SequenceChunk;
+   struct SequencePlan;
+   struct SequenceTarget;
 } // namespace mm
 
 typedef unsigned int* imgRGB32;
@@ -121,6 +129,34 @@ enum DeviceInitializationState {
    InitializationFailed,
 };
 
+/// What the circular buffer does with a new image when it is full.
+enum BufferOverflowPolicy {
+   BufferOverflowStop, ///< Reject the image; the acquisition stops
+   BufferOverflowClear, ///< Discard all unread images (the default)
+   BufferOverflowOverwriteOldest, ///< Discard the oldest unread image
+   BufferOverflowDropNewest, ///< Discard the new image
+};
+
+/// Circular buffer counters since it was last cleared, in frames.
+struct BufferStatistics {
+   long insertedImageCount;
+   long droppedImageCount; ///< Discarded because the buffer was full
+   long overflowCount; ///< Number of inserts that found the buffer full
+   long imageNumberGapCount; ///< Discontinuities seen by popNextImage()
+};
+
+/// Pixel statistics of an image, computed when it was inserted into the
+/// circular buffer (see CMMCore::enableImageStatistics()).
+struct ImageStatistics {
+   long sampleCount; ///< Pixels (3 per pixel for RGB images)
+   long minimum;
+   long maximum;
+   double mean;
+   double standardDeviation;
+   long saturatedCount; ///< Samples of 2^bitDepth - 1 or more
+   std::vector<long> histogram; ///< Equal-width bins from 0 to 2^bitDepth - 1
+};
+
 
 /// The Micro-Manager Core.
 /**
@@ -229,6 +265,8 @@ public:
    std::vector<std::string> getDevicePropertyNames(const char* label) throw (CMMError);
    bool hasProperty(const char* label, const char* propName) throw (CMMError);
    std::string getProperty(const char* label, const char* propName) throw (CMMError);
+   double getPropertyAsDouble(const char* label, const char* propName) throw (CMMError);
+   long getPropertyAsLong(const char* label, const char* propName) throw (CMMError);
    void setProperty(const char* label, const char* propName, const char* propValue) throw (CMMError);
    void setProperty(const char* label, const char* propName, const bool propValue) throw (CMMError);
    void setProperty(const char* label, const char* propName, const long propValue) throw (CMMError);
@@ -247,7 +285,8 @@ public:
    void startPropertySequence(const char* label, const char* propName) throw (CMMError);
    void stopPropertySequence(const char* label, const char* propName) throw (CMMError);
    long getPropertySequenceMaxLength(const char* label, const char* propName) throw (CMMError);
-   void loadPropertySequence(const char* label, const char* propName, std::vector<std::string> eventSequence) throw (CMMError);
+   void loadPropertySequence(const char* label, const char* propName, const std::vector<std::string>& eventSequence) throw (CMMError);
+   void loadNumericPropertySequence(const char* label, const char* propName, const std::vector<double>& valueSequence) throw (CMMError);
 
    bool deviceBusy(const char* label) throw (CMMError);
    void waitForDevice(const char* label) throw (CMMError);
@@ -434,17 +473,78 @@ public:
    long getBufferTotalCapacity();
    long getBufferFreeCapacity();
    bool isBufferOverflowed() const;
+   void setBufferOverflowPolicy(BufferOverflowPolicy policy);
+   BufferOverflowPolicy getBufferOverflowPolicy() const;
+   BufferStatistics getBufferStatistics() const;
    void setCircularBufferMemoryFootprint(unsigned sizeMB) throw (CMMError);
    unsigned getCircularBufferMemoryFootprint();
    void initializeCircularBuffer() throw (CMMError);
    void clearCircularBuffer() throw (CMMError);
+   void enableCircularBufferHugePages(bool enable) throw (CMMError);
+   bool isCircularBufferHugePagesEnabled() const;
+   void enableCircularBufferPrefault(bool enable) throw (CMMError);
+   bool isCircularBufferPrefaultEnabled() const;
+   void enableCircularBufferPacking(bool enable) throw (CMMError);
+   bool isCircularBufferPackingEnabled() const;
+   void enableImageStatistics(bool enable, unsigned histogramBins) throw (CMMError);
+   bool isImageStatisticsEnabled() const;
+   ImageStatistics getLastImageStatistics() throw (CMMError);
+   ImageStatistics getLastImageStatistics(unsigned channel) throw (CMMError);
+
+   long pinNextImageMD(unsigned channel, Metadata& md) throw (CMMError);
+   long pinLastImageMD(unsigned channel, Metadata& md) throw (CMMError);
+   void* getPinnedImage(long pin) throw (CMMError);
+   long getPinnedImageBufferSize(long pin) throw (CMMError);
+   unsigned getPinnedImageWidth(long pin) throw (CMMError);
+   unsigned getPinnedImageHeight(long pin) throw (CMMError);
+   unsigned getPinnedImageBytesPerPixel(long pin) throw (CMMError);
+   void releasePinnedImage(long pin) throw (CMMError);
+   long getPinnedImageCount();
+
+   void enableSharedMemoryExport(const char* name, unsigned sizeMB) throw (CMMError);
+   void disableSharedMemoryExport();
+   std::string getSharedMemoryExportName();
+
+   void startDiskStreaming(const char* basePath, unsigned writerThreads) throw (CMMError);
+   void stopDiskStreaming() throw (CMMError);
+   bool isDiskStreaming() const;
+   long getDiskStreamingImageCount() const;
+
+   void startPreviewStream(unsigned binning, double maxFps) throw (CMMError);
+   void stopPreviewStream();
+   bool isPreviewStreamRunning() const;
+   long getPreviewImageCount() const;
+   void* getPreviewImage(Metadata& md) throw (CMMError);
+   unsigned getPreviewImageWidth() const;
+   unsigned getPreviewImageHeight() const;
+   unsigned getPreviewImageBytesPerPixel() const;
+   unsigned getPreviewImageNumberOfComponents() const;
 
    bool isExposureSequenceable(const char* cameraLabel) throw (CMMError);
    void startExposureSequence(const char* cameraLabel) throw (CMMError);
    void stopExposureSequence(const char* cameraLabel) throw (CMMError);
    long getExposureSequenceMaxLength(const char* cameraLabel) throw (CMMError);
    void loadExposureSequence(const char* cameraLabel,
-         std::vector<double> exposureSequence_ms) throw (CMMError);
+         const std::vector<double>& exposureSequence_ms) throw (CMMError);
+   ///@}
+
+   /** \name Camera triggers and hardware-timed acquisition. */
+   ///@{
+   bool isCameraTriggerAPIImplemented(const char* cameraLabel) throw (CMMError);
+   bool hasCameraTrigger(const char* cameraLabel, int triggerSelector) throw (CMMError);
+   void setCameraTriggerState(const char* cameraLabel, int triggerSelector,
+         int triggerMode, int triggerSource) throw (CMMError);
+   void setCameraTriggerState(const char* cameraLabel, int triggerSelector,
+         int triggerMode, int triggerSource, double triggerDelayUs,
+         int triggerActivation, int triggerOverlap) throw (CMMError);
+   int getCameraTriggerMode(const char* cameraLabel, int triggerSelector) throw (CMMError);
+   int getCameraTriggerSource(const char* cameraLabel, int triggerSelector) throw (CMMError);
+   void sendCameraSoftwareTrigger(const char* cameraLabel, int triggerSelector) throw (CMMError);
+   void armCameraAcquisition(const char* cameraLabel, int frameCount,
+         double frameRateHz, int burstFrameCount) throw (CMMError);
+   void startCameraAcquisition(const char* cameraLabel) throw (CMMError);
+   void stopCameraAcquisition(const char* cameraLabel) throw (CMMError);
+   void abortCameraAcquisition(const char* cameraLabel) throw (CMMError);
    ///@}
 
    /** \name Autofocus control. */
@@ -499,7 +599,7 @@ public:
    void stopStageSequence(const char* stageLabel) throw (CMMError);
    long getStageSequenceMaxLength(const char* stageLabel) throw (CMMError);
    void loadStageSequence(const char* stageLabel,
-         std::vector<double> positionSequence) throw (CMMError);
+         const std::vector<double>& positionSequence) throw (CMMError);
    void setStageLinearSequence(const char* stageLabel, double dZ_um, int nSlices) throw (CMMError);
    ///@}
 
@@ -535,8 +635,40 @@ public:
    void stopXYStageSequence(const char* xyStageLabel) throw (CMMError);
    long getXYStageSequenceMaxLength(const char* xyStageLabel) throw (CMMError);
    void loadXYStageSequence(const char* xyStageLabel,
-         std::vector<double> xSequence,
-         std::vector<double> ySequence) throw (CMMError);
+         const std::vector<double>& xSequence,
+         const std::vector<double>& ySequence) throw (CMMError);
+   ///@}
+
+   /** \name Signal output (DA) control. */
+   ///@{
+   bool isDASequenceable(const char* daLabel) throw (CMMError);
+   void startDASequence(const char* daLabel) throw (CMMError);
+   void stopDASequence(const char* daLabel) throw (CMMError);
+   long getDASequenceMaxLength(const char* daLabel) throw (CMMError);
+   void loadDASequence(const char* daLabel,
+         const std::vector<double>& voltageSequence) throw (CMMError);
+   ///@}
+
+   /** \name Hardware sequence plans. */
+   ///@{
+   void clearSequencePlan();
+   void setSequencePlanChannels(const char* groupName,
+         const std::vector<std::string>& presetNames) throw (CMMError);
+   void setSequencePlanChannelExposures(
+         const std::vector<double>& exposures_ms) throw (CMMError);
+   void setSequencePlanZPositions(const char* stageLabel,
+         const std::vector<double>& positions) throw (CMMError);
+   void setSequencePlanChannelsFirst(bool channelsFirst);
+   void setSequencePlanTimePoints(long timePoints) throw (CMMError);
+   long compileSequencePlan() throw (CMMError);
+   long getSequencePlanFrameCount() throw (CMMError);
+   long getSequencePlanChunkCount() throw (CMMError);
+   long getSequencePlanChunkFrameCount(long chunk) throw (CMMError);
+   std::vector<std::string> getSequencePlanSequencedTargets(long chunk) throw (CMMError);
+   void loadSequencePlanChunk(long chunk) throw (CMMError);
+   void startSequencePlanChunk(long chunk) throw (CMMError);
+   void stopSequencePlanChunk(long chunk) throw (CMMError);
+   double getSequencePlanMaxFrameRate() throw (CMMError);
    ///@}
 
    /** \name Serial port control. */
@@ -637,6 +769,18 @@ public:
    std::vector<std::string> getLoadedPeripheralDevices(const char* hubLabel) throw (CMMError);
    ///@}
 
+   /** \name Worker threads.
+    *
+    * Threads shared by the circular buffer and by device adapters (through
+    * MM::Core::ParallelFor()) for data-parallel work on images.
+    */
+   ///@{
+   void setWorkerThreadCount(unsigned count) throw (CMMError);
+   unsigned getWorkerThreadCount();
+   void setWorkerThreadAffinity(std::vector<unsigned> cpus) throw (CMMError);
+   std::vector<unsigned> getWorkerThreadAffinity();
+   ///@}
+
 private:
    // make object non-copyable
    CMMCore(const CMMCore&);
@@ -671,11 +815,39 @@ private:
    MMEventCallback* externalCallback_;  // notification hook to the higher layer (e.g. GUI)
    PixelSizeConfigGroup* pixelSizeGroup_;
    CircularBuffer* cbuf_;
+   bool cbufHugePages_;
+   bool cbufPrefault_;
+   bool cbufPacking_;
+   bool imageStatistics_;
+   unsigned imageStatisticsBins_;
+   BufferOverflowPolicy bufferOverflowPolicy_;
+
+   MMThreadLock threadPoolLock_;
+   std::shared_ptr<ThreadPool> threadPool_; // Synchronized by threadPoolLock_
 
    std::shared_ptr<CPluginManager> pluginManager_;
    std::shared_ptr<mm::DeviceManager> deviceManager_;
    std::map<int, std::string> errorText_;
 
+   std::shared_ptr<mm::SequencePlan> sequencePlan_;
+   std::shared_ptr<mm::SharedFrameRing> sharedFrameRing_;
+   std::shared_ptr<mm::DiskStreamWriter> diskStreamWriter_;
+   std::shared_ptr<mm::PreviewStream> previewStream_;
+   std::vector<unsigned char> previewPixels_; // Last from getPreviewImage()
+   unsigned previewWidth_;
+   unsigned previewHeight_;
+   unsigned previewBytesPerPixel_;
+   unsigned previewComponents_;
+
+   struct PinnedImage
+   {
+      unsigned long slot;
+      const mm::ImgBuffer* image;
+   };
+   MMThreadLock pinnedImagesLock_;
+   std::map<long, PinnedImage> pinnedImages_; // Synchronized by pinnedImagesLock_
+   long nextPinId_;
+
    // Must be unlocked when calling MMEventCallback or calling device methods
    // or acquiring a module lock
    mutable MMThreadLock stateCacheLock_;
@@ -697,6 +869,11 @@ private:
    static void CheckConfigPresetName(const char* presetName) throw (CMMError);
    bool IsCoreDeviceLabel(const char* label) const throw (CMMError);
 
+   template <typename T>
+   void setNumericProperty(const char* label, const char* propName, T propValue) throw (CMMError);
+   template <typename T>
+   T getNumericProperty(const char* label, const char* propName) throw (CMMError);
+
    void applyConfiguration(const Configuration& config) throw (CMMError);
    int applyProperties(std::vector<PropertySetting>& props, std::string& lastError);
    void waitForDevice(std::shared_ptr<DeviceInstance> pDev) throw (CMMError);
@@ -711,6 +888,13 @@ private:
    void initializeAllDevicesSerial() throw (CMMError);
    void initializeAllDevicesParallel() throw (CMMError);
    int initializeVectorOfDevices(std::vector<std::pair<std::shared_ptr<DeviceInstance>, std::string> > pDevices);
+   const mm::SequenceChunk& getSequencePlanChunk(long chunk) throw (CMMError);
+   void loadSequencePlanSequences(const mm::SequenceChunk& chunk,
+         const std::vector<mm::SequenceTarget>& targets) throw (CMMError);
+   const mm::ImgBuffer* getPinnedImageBuffer(long pin) throw (CMMError);
+   void applyBufferOverflowPolicy(bool stopOnOverflow);
+   std::shared_ptr<ThreadPool> getThreadPool();
+   void replaceThreadPool(unsigned count, const std::vector<unsigned>& cpus) throw (CMMError);
 };
 
 #if defined(__GNUC__) && !defined(__clang__)
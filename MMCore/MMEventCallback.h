@@ -86,4 +86,16 @@ public:
       std::cout << "onSLMExposureChanged()" << name << " " << newExposure << '\n';
    }
 
+   virtual void onCameraTriggerChanged(const char* name, int triggerSelector, int triggerMode, int triggerSource)
+   {
+      std::cout << "onCameraTriggerChanged()" << name << " " << triggerSelector << " " << triggerMode << " " << triggerSource << '\n';
+   }
+
+   // Called on the camera's thread; timestampUs is on the same clock as the
+   // ExposureStartTime-us/ExposureEndTime-us image metadata. Silent by
+   // default, as it can be called several times per frame.
+   virtual void onCameraEvent(const char* /* name */, int /* eventType */, double /* timestampUs */)
+   {
+   }
+
 };
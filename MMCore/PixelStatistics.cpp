@@ -0,0 +1,430 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Per-image pixel statistics (range, mean, standard
+//                deviation, saturation, histogram), with an AVX2
+//                implementation selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PixelStatistics.h"
+
+#include "../MMDevice/CpuFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXELSTATISTICS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define PIXELSTATISTICS_TARGET_AVX2
+#else
+#define PIXELSTATISTICS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace mm {
+namespace PixelStatistics {
+
+namespace {
+
+// The AVX2 loops keep lane sums that would overflow on large images, so
+// they work in blocks of this many samples, adding up the lanes after each.
+// The histogram of each block is counted right after, while the block is
+// still in the L1 cache.
+const std::size_t blockSamples = 4096;
+
+struct Sums
+{
+   unsigned min;
+   unsigned max;
+   std::uint64_t sum;
+   std::uint64_t sumSquares;
+   std::uint64_t saturated;
+};
+
+// Histogram counting is limited by the latency of incrementing the same
+// bin repeatedly, so consecutive samples are counted in 4 separate tables
+// (of last + 1 bins each), which are added up at the end.
+struct Binning
+{
+   std::uint32_t* counts; // Null for no histogram
+   unsigned shift; // Sample to bin
+   std::size_t last; // Index of the last bin
+};
+
+template <typename T>
+void CountBins(const Binning& binning, const T* samples, std::size_t n)
+{
+   if (!binning.counts)
+      return;
+   const std::size_t last = binning.last;
+   const unsigned shift = binning.shift;
+   std::uint32_t* const t0 = binning.counts;
+   std::uint32_t* const t1 = t0 + last + 1;
+   std::uint32_t* const t2 = t1 + last + 1;
+   std::uint32_t* const t3 = t2 + last + 1;
+   std::size_t i = 0;
+   for (; i + 4 <= n; i += 4)
+   {
+      ++t0[std::min<std::size_t>(samples[i] >> shift, last)];
+      ++t1[std::min<std::size_t>(samples[i + 1] >> shift, last)];
+      ++t2[std::min<std::size_t>(samples[i + 2] >> shift, last)];
+      ++t3[std::min<std::size_t>(samples[i + 3] >> shift, last)];
+   }
+   for (; i < n; ++i)
+      ++t0[std::min<std::size_t>(samples[i] >> shift, last)];
+}
+
+/*
+ * Scalar implementation, also used for color images and for the samples
+ * left over by the AVX2 loops. The alpha component of color pixels is
+ * skipped.
+ */
+
+template <typename T>
+void ScalarAdd(Sums& sums, const Binning& binning, const T* samples,
+      std::size_t pixelCount, unsigned nComponents, unsigned saturation)
+{
+   const unsigned used = nComponents > 1 ? nComponents - 1 : 1;
+   for (std::size_t i = 0; i < pixelCount; ++i, samples += nComponents)
+   {
+      for (unsigned c = 0; c < used; ++c)
+      {
+         const unsigned v = samples[c];
+         sums.min = std::min(sums.min, v);
+         sums.max = std::max(sums.max, v);
+         sums.sum += v;
+         sums.sumSquares += static_cast<std::uint64_t>(v) * v;
+         sums.saturated += v >= saturation;
+         if (binning.counts)
+            ++binning.counts[std::min<std::size_t>(v >> binning.shift, binning.last)];
+      }
+   }
+}
+
+#ifdef PIXELSTATISTICS_X86
+
+/*
+ * AVX2 implementation, for grayscale images. Minimum, maximum, and
+ * saturation (v == max(v, saturation)) are computed on whole registers;
+ * sums are widened to 32-bit lanes (8-bit samples: 64-bit, with SAD), and
+ * squares of 16-bit samples to 64-bit lanes (with unsigned 32 x 32 -> 64
+ * multiplies of the even and odd 32-bit lanes).
+ */
+
+PIXELSTATISTICS_TARGET_AVX2
+void AVX2Add(Sums& sums, const Binning& binning, const std::uint16_t* samples,
+      std::size_t n, unsigned saturation)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i sat = _mm256_set1_epi16(static_cast<short>(saturation));
+   __m256i vmin = _mm256_set1_epi16(-1);
+   __m256i vmax = zero;
+   __m256i squares = zero;
+
+   std::size_t i = 0;
+   while (i + 16 <= n)
+   {
+      const std::size_t start = i;
+      const std::size_t end = i + std::min(blockSamples, (n - i) & ~std::size_t(15));
+      __m256i sum = zero; // 32-bit lanes, at most 2 * 65535 per iteration
+      __m256i saturated = zero; // 16-bit lanes, at most 1 per iteration
+      for (; i < end; i += 16)
+      {
+         const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+         vmin = _mm256_min_epu16(vmin, v);
+         vmax = _mm256_max_epu16(vmax, v);
+         saturated = _mm256_sub_epi16(saturated,
+               _mm256_cmpeq_epi16(_mm256_max_epu16(v, sat), v));
+         const __m256i lo = _mm256_unpacklo_epi16(v, zero);
+         const __m256i hi = _mm256_unpackhi_epi16(v, zero);
+         sum = _mm256_add_epi32(sum, _mm256_add_epi32(lo, hi));
+         squares = _mm256_add_epi64(squares, _mm256_add_epi64(
+                  _mm256_mul_epu32(lo, lo), _mm256_mul_epu32(hi, hi)));
+         const __m256i loOdd = _mm256_srli_epi64(lo, 32);
+         const __m256i hiOdd = _mm256_srli_epi64(hi, 32);
+         squares = _mm256_add_epi64(squares, _mm256_add_epi64(
+                  _mm256_mul_epu32(loOdd, loOdd), _mm256_mul_epu32(hiOdd, hiOdd)));
+      }
+
+      std::uint32_t sumLanes[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumLanes), sum);
+      std::uint16_t saturatedLanes[16];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(saturatedLanes), saturated);
+      for (int k = 0; k < 8; ++k)
+         sums.sum += sumLanes[k];
+      for (int k = 0; k < 16; ++k)
+         sums.saturated += saturatedLanes[k];
+
+      CountBins(binning, samples + start, i - start);
+   }
+
+   std::uint16_t minLanes[16], maxLanes[16];
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(minLanes), vmin);
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxLanes), vmax);
+   std::uint64_t squareLanes[4];
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(squareLanes), squares);
+   if (i > 0)
+   {
+      for (int k = 0; k < 16; ++k)
+      {
+         sums.min = std::min<unsigned>(sums.min, minLanes[k]);
+         sums.max = std::max<unsigned>(sums.max, maxLanes[k]);
+      }
+   }
+   for (int k = 0; k < 4; ++k)
+      sums.sumSquares += squareLanes[k];
+
+   ScalarAdd(sums, binning, samples + i, n - i, 1, saturation);
+}
+
+PIXELSTATISTICS_TARGET_AVX2
+void AVX2Add(Sums& sums, const Binning& binning, const std::uint8_t* samples,
+      std::size_t n, unsigned saturation)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i ones = _mm256_set1_epi8(1);
+   const __m256i sat = _mm256_set1_epi8(static_cast<char>(saturation));
+   __m256i vmin = _mm256_set1_epi8(-1);
+   __m256i vmax = zero;
+   __m256i sum = zero; // 64-bit lanes
+   __m256i saturated = zero; // 64-bit lanes
+
+   std::size_t i = 0;
+   while (i + 32 <= n)
+   {
+      const std::size_t start = i;
+      const std::size_t end = i + std::min(blockSamples, (n - i) & ~std::size_t(31));
+      __m256i squares = zero; // 32-bit lanes, at most 4 * 255^2 per iteration
+      for (; i < end; i += 32)
+      {
+         const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+         vmin = _mm256_min_epu8(vmin, v);
+         vmax = _mm256_max_epu8(vmax, v);
+         const __m256i isSaturated = _mm256_and_si256(ones,
+               _mm256_cmpeq_epi8(_mm256_max_epu8(v, sat), v));
+         saturated = _mm256_add_epi64(saturated, _mm256_sad_epu8(isSaturated, zero));
+         sum = _mm256_add_epi64(sum, _mm256_sad_epu8(v, zero));
+         const __m256i lo = _mm256_unpacklo_epi8(v, zero);
+         const __m256i hi = _mm256_unpackhi_epi8(v, zero);
+         squares = _mm256_add_epi32(squares, _mm256_add_epi32(
+                  _mm256_madd_epi16(lo, lo), _mm256_madd_epi16(hi, hi)));
+      }
+
+      std::uint32_t squareLanes[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(squareLanes), squares);
+      for (int k = 0; k < 8; ++k)
+         sums.sumSquares += squareLanes[k];
+
+      CountBins(binning, samples + start, i - start);
+   }
+
+   std::uint8_t minLanes[32], maxLanes[32];
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(minLanes), vmin);
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxLanes), vmax);
+   std::uint64_t sumLanes[4], saturatedLanes[4];
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(sumLanes), sum);
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(saturatedLanes), saturated);
+   if (i > 0)
+   {
+      for (int k = 0; k < 32; ++k)
+      {
+         sums.min = std::min<unsigned>(sums.min, minLanes[k]);
+         sums.max = std::max<unsigned>(sums.max, maxLanes[k]);
+      }
+   }
+   for (int k = 0; k < 4; ++k)
+   {
+      sums.sum += sumLanes[k];
+      sums.saturated += saturatedLanes[k];
+   }
+
+   ScalarAdd(sums, binning, samples + i, n - i, 1, saturation);
+}
+
+#endif // PIXELSTATISTICS_X86
+
+Implementation DetectBestImplementation()
+{
+#ifdef PIXELSTATISTICS_X86
+   if (CpuFeatures::HasAVX2())
+      return ImplementationAVX2;
+#endif
+   return ImplementationScalar;
+}
+
+#ifdef PIXELSTATISTICS_X86
+Implementation Resolve(Implementation impl)
+{
+   if (impl == ImplementationAuto)
+      return GetBestImplementation();
+   if (!IsImplementationAvailable(impl))
+      return ImplementationScalar;
+   return impl;
+}
+#endif
+
+template <typename T>
+void AddSamples(Sums& sums, const Binning& binning, const unsigned char* pixels,
+      std::size_t pixelCount, unsigned nComponents, unsigned saturation,
+      Implementation impl)
+{
+   const T* samples = reinterpret_cast<const T*>(pixels);
+#ifdef PIXELSTATISTICS_X86
+   if (nComponents == 1 && Resolve(impl) == ImplementationAVX2)
+   {
+      AVX2Add(sums, binning, samples, pixelCount, saturation);
+      return;
+   }
+#else
+   (void)impl;
+#endif
+   ScalarAdd(sums, binning, samples, pixelCount, nComponents, saturation);
+}
+
+} // anonymous namespace
+
+
+bool IsImplementationAvailable(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto:
+      case ImplementationScalar:
+         return true;
+#ifdef PIXELSTATISTICS_X86
+      case ImplementationAVX2:
+         return GetBestImplementation() == ImplementationAVX2;
+#endif
+      default:
+         return false;
+   }
+}
+
+
+Implementation GetBestImplementation()
+{
+   static const Implementation best = DetectBestImplementation();
+   return best;
+}
+
+
+bool IsSupported(unsigned bytesPerPixel, unsigned nComponents)
+{
+   if (nComponents <= 1)
+      return bytesPerPixel == 1 || bytesPerPixel == 2;
+   return nComponents == 4 && bytesPerPixel == 4;
+}
+
+
+Accumulator::Accumulator(unsigned bitDepth, unsigned histogramBins) :
+   bitDepth_(bitDepth),
+   count_(0),
+   min_(~0u),
+   max_(0),
+   sum_(0),
+   sumSquares_(0),
+   saturated_(0),
+   histogram_(histogramBins, 0)
+{
+}
+
+
+void Accumulator::Add(const unsigned char* pixels, std::size_t pixelCount,
+      unsigned bytesPerPixel, unsigned nComponents, Implementation impl)
+{
+   if (nComponents == 0)
+      nComponents = 1;
+   if (pixelCount == 0 || !IsSupported(bytesPerPixel, nComponents))
+      return;
+
+   const unsigned sampleBits = bytesPerPixel == 2 ? 16 : 8;
+   const unsigned bits = bitDepth_ > 0 && bitDepth_ < sampleBits ? bitDepth_ : sampleBits;
+
+   // 32-bit counts suffice for the pixels of one camera image
+   std::vector<std::uint32_t> binCounts(4 * histogram_.size());
+   Binning binning;
+   binning.counts = histogram_.empty() ? 0 : binCounts.data();
+   binning.last = histogram_.size() - 1;
+   unsigned binBits = 0;
+   while ((std::size_t(2) << binBits) <= histogram_.size())
+      ++binBits;
+   binning.shift = bits > binBits ? bits - binBits : 0;
+
+   Sums sums = { min_, max_, 0, 0, 0 };
+   const unsigned saturation = (1u << bits) - 1;
+   if (bytesPerPixel == 2)
+      AddSamples<std::uint16_t>(sums, binning, pixels, pixelCount, 1, saturation, impl);
+   else
+      AddSamples<std::uint8_t>(sums, binning, pixels, pixelCount, nComponents, saturation, impl);
+
+   count_ += pixelCount * (nComponents > 1 ? nComponents - 1 : 1);
+   min_ = sums.min;
+   max_ = sums.max;
+   sum_ += sums.sum;
+   sumSquares_ += sums.sumSquares;
+   saturated_ += sums.saturated;
+   for (std::size_t i = 0; i < binCounts.size(); ++i)
+      histogram_[i % histogram_.size()] += binCounts[i];
+}
+
+
+void Accumulator::Merge(const Accumulator& other)
+{
+   count_ += other.count_;
+   min_ = std::min(min_, other.min_);
+   max_ = std::max(max_, other.max_);
+   sum_ += other.sum_;
+   sumSquares_ += other.sumSquares_;
+   saturated_ += other.saturated_;
+   const std::size_t bins = std::min(histogram_.size(), other.histogram_.size());
+   for (std::size_t i = 0; i < bins; ++i)
+      histogram_[i] += other.histogram_[i];
+}
+
+
+Result Accumulator::GetResult() const
+{
+   Result result;
+   result.sampleCount = count_;
+   result.minimum = count_ > 0 ? min_ : 0;
+   result.maximum = max_;
+   result.mean = 0.0;
+   result.standardDeviation = 0.0;
+   if (count_ > 0)
+   {
+      const double n = static_cast<double>(count_);
+      result.mean = static_cast<double>(sum_) / n;
+      const double variance = static_cast<double>(sumSquares_) / n -
+         result.mean * result.mean;
+      result.standardDeviation = variance > 0.0 ? std::sqrt(variance) : 0.0;
+   }
+   result.saturatedCount = saturated_;
+   result.histogram = histogram_;
+   return result;
+}
+
+
+Result Compute(const unsigned char* pixels, std::size_t pixelCount,
+      unsigned bytesPerPixel, unsigned nComponents, unsigned bitDepth,
+      unsigned histogramBins, Implementation impl)
+{
+   Accumulator acc(bitDepth, histogramBins);
+   acc.Add(pixels, pixelCount, bytesPerPixel, nComponents, impl);
+   return acc.GetResult();
+}
+
+} // namespace PixelStatistics
+} // namespace mm
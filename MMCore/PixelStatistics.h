@@ -0,0 +1,89 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Per-image pixel statistics (range, mean, standard
+//                deviation, saturation, histogram), with an AVX2
+//                implementation selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace mm {
+namespace PixelStatistics {
+
+enum Implementation
+{
+   ImplementationAuto, // Fastest one available on this CPU
+   ImplementationScalar,
+   ImplementationAVX2,
+};
+
+bool IsImplementationAvailable(Implementation impl);
+Implementation GetBestImplementation();
+
+// True for the pixel formats supported here: 8- and 16-bit grayscale, and
+// 8-bit color with 4 components (of which the last, alpha, is ignored)
+bool IsSupported(unsigned bytesPerPixel, unsigned nComponents);
+
+struct Result
+{
+   unsigned long long sampleCount; // Pixels, or 3 per pixel for color
+   unsigned minimum;
+   unsigned maximum;
+   double mean;
+   double standardDeviation; // Of the population
+   unsigned long long saturatedCount; // Samples >= 2^bitDepth - 1
+   // Equal-width bins from 0 to 2^bitDepth - 1; samples with bits above
+   // the bit depth are counted in the last bin
+   std::vector<unsigned long long> histogram;
+};
+
+// Accumulates statistics over one or more runs of pixels of the same
+// format. Accumulators for parts of an image (for example, computed on
+// different threads) can be merged.
+class Accumulator
+{
+public:
+   // bitDepth is the number of significant bits per sample, or 0 for all of
+   // them; it sets the saturation level and the histogram range.
+   // histogramBins must be a power of 2, or 0 for no histogram.
+   explicit Accumulator(unsigned bitDepth = 0, unsigned histogramBins = 0);
+
+   void Add(const unsigned char* pixels, std::size_t pixelCount,
+         unsigned bytesPerPixel, unsigned nComponents,
+         Implementation impl = ImplementationAuto);
+   void Merge(const Accumulator& other);
+
+   Result GetResult() const;
+
+private:
+   unsigned bitDepth_;
+   unsigned long long count_;
+   unsigned min_;
+   unsigned max_;
+   unsigned long long sum_;
+   unsigned long long sumSquares_;
+   unsigned long long saturated_;
+   std::vector<unsigned long long> histogram_;
+};
+
+// Statistics of a whole image, on the calling thread
+Result Compute(const unsigned char* pixels, std::size_t pixelCount,
+      unsigned bytesPerPixel, unsigned nComponents, unsigned bitDepth,
+      unsigned histogramBins, Implementation impl = ImplementationAuto);
+
+} // namespace PixelStatistics
+} // namespace mm
@@ -0,0 +1,273 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Rate-limited, binned copies of the newest sequence
+//                acquisition image, for live display
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "PreviewStream.h"
+
+#include "CircularBuffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+// SSE2 is part of the x86-64 baseline, so no run-time check is needed
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PREVIEWSTREAM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mm {
+
+namespace {
+
+// How often to check for a new image while none arrives
+const std::chrono::milliseconds idlePollInterval(5);
+
+/*
+ * Binning: factor rows at a time are summed into a row of 32-bit
+ * accumulators (the bulk of the work, done with SSE2), whose factor-wide
+ * groups are then summed and divided.
+ */
+
+template <typename T>
+void AccumulateScalar(std::uint32_t* acc, const T* row, std::size_t n)
+{
+   for (std::size_t i = 0; i < n; ++i)
+      acc[i] += row[i];
+}
+
+#ifdef PREVIEWSTREAM_SSE2
+
+void Accumulate(std::uint32_t* acc, const std::uint8_t* row, std::size_t n)
+{
+   const __m128i zero = _mm_setzero_si128();
+   std::size_t i = 0;
+   for (; i + 16 <= n; i += 16)
+   {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      const __m128i lo = _mm_unpacklo_epi8(v, zero);
+      const __m128i hi = _mm_unpackhi_epi8(v, zero);
+      __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+      _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero)));
+      _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+      _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+      _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+   }
+   AccumulateScalar(acc + i, row + i, n - i);
+}
+
+void Accumulate(std::uint32_t* acc, const std::uint16_t* row, std::size_t n)
+{
+   const __m128i zero = _mm_setzero_si128();
+   std::size_t i = 0;
+   for (; i + 8 <= n; i += 8)
+   {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+      _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(v, zero)));
+      _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(v, zero)));
+   }
+   AccumulateScalar(acc + i, row + i, n - i);
+}
+
+#else
+
+template <typename T>
+void Accumulate(std::uint32_t* acc, const T* row, std::size_t n)
+{
+   AccumulateScalar(acc, row, n);
+}
+
+#endif // PREVIEWSTREAM_SSE2
+
+template <typename T>
+void Bin(unsigned char* dst, const unsigned char* src, unsigned width,
+      unsigned height, unsigned nComponents, unsigned factor)
+{
+   const unsigned outWidth = width / factor;
+   const unsigned outHeight = height / factor;
+   const std::size_t rowSamples = (std::size_t)width * nComponents;
+   const std::size_t usedSamples = (std::size_t)outWidth * factor * nComponents;
+   const std::uint32_t count = factor * factor;
+   std::vector<std::uint32_t> acc(usedSamples);
+
+   const T* in = reinterpret_cast<const T*>(src);
+   T* out = reinterpret_cast<T*>(dst);
+   for (unsigned y = 0; y < outHeight; ++y)
+   {
+      std::fill(acc.begin(), acc.end(), 0);
+      for (unsigned k = 0; k < factor; ++k)
+         Accumulate(acc.data(), in + ((std::size_t)y * factor + k) * rowSamples,
+               usedSamples);
+
+      const std::uint32_t* group = acc.data();
+      for (unsigned x = 0; x < outWidth; ++x, group += factor * nComponents)
+      {
+         for (unsigned c = 0; c < nComponents; ++c)
+         {
+            std::uint32_t sum = 0;
+            for (unsigned k = 0; k < factor; ++k)
+               sum += group[k * nComponents + c];
+            *out++ = static_cast<T>((sum + count / 2) / count);
+         }
+      }
+   }
+}
+
+void Subsample(unsigned char* dst, const unsigned char* src, unsigned width,
+      unsigned height, unsigned bytesPerPixel, unsigned factor)
+{
+   const unsigned outWidth = width / factor;
+   const unsigned outHeight = height / factor;
+   for (unsigned y = 0; y < outHeight; ++y)
+   {
+      const unsigned char* row = src + (std::size_t)y * factor * width * bytesPerPixel;
+      for (unsigned x = 0; x < outWidth; ++x, dst += bytesPerPixel)
+         std::memcpy(dst, row + (std::size_t)x * factor * bytesPerPixel, bytesPerPixel);
+   }
+}
+
+} // anonymous namespace
+
+void BinImage(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned bytesPerPixel,
+      unsigned nComponents, unsigned factor)
+{
+   if (factor <= 1)
+   {
+      std::memcpy(dst, src, (std::size_t)width * height * bytesPerPixel);
+      return;
+   }
+   if (nComponents == 0 || bytesPerPixel % nComponents != 0)
+      nComponents = 1;
+   const unsigned sampleBytes = bytesPerPixel / nComponents;
+   if (sampleBytes == 1)
+      Bin<std::uint8_t>(dst, src, width, height, nComponents, factor);
+   else if (sampleBytes == 2)
+      Bin<std::uint16_t>(dst, src, width, height, nComponents, factor);
+   else
+      Subsample(dst, src, width, height, bytesPerPixel, factor);
+}
+
+PreviewStream::PreviewStream(CircularBuffer& buffer, unsigned binning,
+      double maxFps) :
+   buffer_(buffer),
+   binning_(binning > 0 ? binning : 1),
+   maxFps_(maxFps),
+   lastImageCounter_(-1),
+   back_(),
+   stop_(false),
+   front_(),
+   imageCount_(0)
+{
+   thread_ = std::thread([this] { Run(); });
+}
+
+PreviewStream::~PreviewStream()
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+   }
+   cv_.notify_all();
+   thread_.join();
+}
+
+bool PreviewStream::GetLatest(std::vector<unsigned char>& pixels,
+      unsigned& width, unsigned& height, unsigned& bytesPerPixel,
+      unsigned& nComponents, Metadata& md) const
+{
+   std::lock_guard<std::mutex> lock(mutex_);
+   if (imageCount_ == 0)
+      return false;
+   pixels.assign(front_.pixels.begin(), front_.pixels.end());
+   width = front_.width;
+   height = front_.height;
+   bytesPerPixel = front_.bytesPerPixel;
+   nComponents = front_.nComponents;
+   md = front_.md;
+   return true;
+}
+
+void PreviewStream::Run()
+{
+   using namespace std::chrono;
+   const steady_clock::duration period = maxFps_ > 0.0 ?
+      duration_cast<steady_clock::duration>(duration<double>(1.0 / maxFps_)) :
+      steady_clock::duration::zero();
+   const steady_clock::duration idle = period > steady_clock::duration::zero() &&
+      period < idlePollInterval ? period : idlePollInterval;
+
+   std::unique_lock<std::mutex> lock(mutex_);
+   steady_clock::time_point next = steady_clock::now();
+   for (;;)
+   {
+      if (cv_.wait_until(lock, next, [this] { return stop_; }))
+         return;
+      lock.unlock();
+      const steady_clock::time_point start = steady_clock::now();
+      const bool produced = Produce();
+      lock.lock();
+      next = produced ? start + period : steady_clock::now() + idle;
+   }
+}
+
+// Bins the top image into back_ and swaps it to the front. Returns false if
+// there was no new image.
+bool PreviewStream::Produce()
+{
+   const long counter = buffer_.GetImageCounter();
+   if (counter == lastImageCounter_)
+      return false;
+   unsigned long slot;
+   const ImgBuffer* img = buffer_.PinTopImageBuffer(0, slot);
+   if (!img)
+      return false;
+   lastImageCounter_ = counter;
+
+   back_.md = img->GetMetadata();
+   std::string pixelType;
+   if (back_.md.HasTag(MM::g_Keyword_PixelType))
+      pixelType = back_.md.GetSingleTag(MM::g_Keyword_PixelType).GetValue();
+   back_.nComponents = pixelType == MM::g_Keyword_PixelType_RGB32 ||
+      pixelType == MM::g_Keyword_PixelType_RGB64 ? 4 : 1;
+   back_.bytesPerPixel = img->Depth();
+   back_.width = img->Width() / binning_;
+   back_.height = img->Height() / binning_;
+   const bool empty = back_.width == 0 || back_.height == 0;
+   if (!empty)
+   {
+      back_.pixels.resize((std::size_t)back_.width * back_.height * back_.bytesPerPixel);
+      BinImage(back_.pixels.data(), img->GetPixels(), img->Width(),
+            img->Height(), back_.bytesPerPixel, back_.nComponents, binning_);
+   }
+   buffer_.UnpinImageBuffer(slot);
+   if (empty)
+      return false;
+
+   back_.md.PutImageTag(MM::g_Keyword_Metadata_Width, back_.width);
+   back_.md.PutImageTag(MM::g_Keyword_Metadata_Height, back_.height);
+   {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::swap(front_, back_);
+      ++imageCount_;
+   }
+   return true;
+}
+
+} // namespace mm
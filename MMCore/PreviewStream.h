@@ -0,0 +1,99 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Rate-limited, binned copies of the newest sequence
+//                acquisition image, for live display
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "../MMDevice/ImageMetadata.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CircularBuffer;
+
+namespace mm {
+
+// Averages factor x factor blocks of a width x height image into a
+// (width / factor) x (height / factor) image of the same pixel type.
+// Leftover columns and rows at the right and bottom are ignored. Each
+// component is averaged separately for color images; 32-bit grayscale
+// pixels (which may be floating point) are subsampled instead.
+void BinImage(unsigned char* dst, const unsigned char* src,
+      unsigned width, unsigned height, unsigned bytesPerPixel,
+      unsigned nComponents, unsigned factor);
+
+// Produces binned copies (see BinImage()) of the newest image in the
+// circular buffer on a worker thread, at most maxFps times per second and
+// only when a new image has been inserted. The source image is pinned (not
+// locked) while it is binned, so the buffer stays available to the camera.
+//
+// Readers get the latest preview image from a double buffer guarded by the
+// stream's own mutex, and never touch the circular buffer. Only channel 0
+// of multi-channel cameras is previewed.
+class PreviewStream
+{
+public:
+   PreviewStream(CircularBuffer& buffer, unsigned binning, double maxFps);
+   ~PreviewStream();
+
+   unsigned Binning() const { return binning_; }
+   double MaxFps() const { return maxFps_; }
+
+   // Number of preview images produced so far
+   unsigned long long ImageCount() const { return imageCount_; }
+
+   // Copies the latest preview image; returns false if there is none yet
+   bool GetLatest(std::vector<unsigned char>& pixels, unsigned& width,
+         unsigned& height, unsigned& bytesPerPixel, unsigned& nComponents,
+         Metadata& md) const;
+
+private:
+   struct Image
+   {
+      std::vector<unsigned char> pixels;
+      unsigned width;
+      unsigned height;
+      unsigned bytesPerPixel;
+      unsigned nComponents;
+      Metadata md;
+   };
+
+   void Run();
+   bool Produce();
+
+   CircularBuffer& buffer_;
+   const unsigned binning_;
+   const double maxFps_;
+   long lastImageCounter_; // Owned by the worker thread
+   Image back_; // Owned by the worker thread
+
+   mutable std::mutex mutex_;
+   std::condition_variable cv_;
+   bool stop_;
+   Image front_;
+   std::atomic<unsigned long long> imageCount_;
+
+   std::thread thread_;
+
+   PreviewStream(const PreviewStream&);
+   PreviewStream& operator=(const PreviewStream&);
+};
+
+} // namespace mm
@@ -0,0 +1,196 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Compilation of multi-device hardware sequence plans
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SequencePlan.h"
+
+#include "CoreUtils.h"
+#include "Error.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <tuple>
+
+namespace mm {
+
+bool SequenceTarget::operator<(const SequenceTarget& rhs) const
+{
+   return std::tie(kind, device, property) <
+      std::tie(rhs.kind, rhs.device, rhs.property);
+}
+
+bool SequenceTarget::operator==(const SequenceTarget& rhs) const
+{
+   return kind == rhs.kind && device == rhs.device && property == rhs.property;
+}
+
+std::string SequenceTarget::ToString() const
+{
+   switch (kind)
+   {
+      case Property:
+         return device + "-" + property;
+      case Stage:
+         return device + " (position)";
+      case Exposure:
+         return device + " (exposure)";
+   }
+   return device;
+}
+
+std::string FormatSequenceValue(double value)
+{
+   // Round-trips exactly, so that equal positions compare equal as strings
+   char buf[32];
+   std::snprintf(buf, sizeof(buf), "%.17g", value);
+   return buf;
+}
+
+double ParseSequenceValue(const std::string& value)
+{
+   return std::atof(value.c_str());
+}
+
+std::vector<FrameSettings> ExpandSequencePlan(const SequencePlanSpec& spec)
+{
+   std::vector<FrameSettings> channels = spec.channels;
+   if (channels.empty())
+      channels.push_back(FrameSettings());
+
+   std::vector<std::string> positions;
+   for (double z : spec.focusPositions)
+      positions.push_back(FormatSequenceValue(z));
+   const bool hasFocus = !spec.focusStage.empty() && !positions.empty();
+   if (!hasFocus)
+      positions.assign(1, std::string());
+
+   const SequenceTarget focus(SequenceTarget::Stage, spec.focusStage);
+   const size_t outerCount = spec.channelsFirst ? positions.size() : channels.size();
+   const size_t innerCount = spec.channelsFirst ? channels.size() : positions.size();
+
+   std::vector<FrameSettings> pass;
+   pass.reserve(outerCount * innerCount);
+   for (size_t outer = 0; outer < outerCount; ++outer)
+   {
+      for (size_t inner = 0; inner < innerCount; ++inner)
+      {
+         const size_t c = spec.channelsFirst ? inner : outer;
+         const size_t z = spec.channelsFirst ? outer : inner;
+         FrameSettings frame = channels[c];
+         if (hasFocus)
+            frame[focus] = positions[z];
+         pass.push_back(frame);
+      }
+   }
+
+   std::vector<FrameSettings> frames;
+   if (spec.timePoints > 0)
+      frames.reserve(pass.size() * static_cast<size_t>(spec.timePoints));
+   for (long t = 0; t < spec.timePoints; ++t)
+      frames.insert(frames.end(), pass.begin(), pass.end());
+   return frames;
+}
+
+namespace {
+
+void CheckFrameTargets(const std::vector<FrameSettings>& frames,
+      const SequenceCapabilities& caps)
+{
+   const FrameSettings& first = frames.front();
+   for (const auto& setting : first)
+   {
+      if (caps.find(setting.first) == caps.end())
+         throw CMMError("No sequencing information for " +
+               ToQuotedString(setting.first.ToString()));
+   }
+   for (size_t i = 1; i < frames.size(); ++i)
+   {
+      const FrameSettings& frame = frames[i];
+      bool same = frame.size() == first.size();
+      for (auto it = frame.begin(), jt = first.begin();
+            same && it != frame.end(); ++it, ++jt)
+         same = it->first == jt->first;
+      if (!same)
+         throw CMMError("Frame " + ToString(i) +
+               " of sequence plan does not set the same devices as frame 0");
+   }
+}
+
+} // anonymous namespace
+
+std::vector<SequenceChunk> CompileSequencePlan(
+      const std::vector<FrameSettings>& frames,
+      const SequenceCapabilities& caps)
+{
+   std::vector<SequenceChunk> chunks;
+   if (frames.empty())
+      return chunks;
+   CheckFrameTargets(frames, caps);
+
+   size_t start = 0;
+   while (start < frames.size())
+   {
+      const FrameSettings& head = frames[start];
+      std::set<SequenceTarget> varying;
+      size_t end = start + 1;
+      for (; end < frames.size(); ++end)
+      {
+         const long length = static_cast<long>(end - start + 1);
+         std::set<SequenceTarget> newVarying = varying;
+         bool fits = true;
+         for (auto it = frames[end].begin(), jt = head.begin();
+               it != frames[end].end(); ++it, ++jt)
+         {
+            if (it->second != jt->second)
+               newVarying.insert(it->first);
+         }
+         for (const SequenceTarget& target : newVarying)
+         {
+            if (caps.at(target) < length)
+            {
+               fits = false;
+               break;
+            }
+         }
+         if (!fits)
+            break;
+         varying.swap(newVarying);
+      }
+
+      SequenceChunk chunk;
+      chunk.firstFrame = start;
+      chunk.frameCount = end - start;
+      for (const auto& setting : head)
+      {
+         if (varying.count(setting.first))
+         {
+            std::vector<std::string>& seq = chunk.sequences[setting.first];
+            seq.reserve(chunk.frameCount);
+            for (size_t i = start; i < end; ++i)
+               seq.push_back(frames[i].find(setting.first)->second);
+         }
+         else
+         {
+            chunk.constants.insert(setting);
+         }
+      }
+      chunks.push_back(chunk);
+      start = end;
+   }
+   return chunks;
+}
+
+} // namespace mm
@@ -0,0 +1,116 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Compilation of multi-device hardware sequence plans
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mm {
+
+// Something that takes one value per frame of a hardware-triggered
+// acquisition: a device property, a focus stage position, or a camera
+// exposure.
+struct SequenceTarget
+{
+   enum Kind { Property, Stage, Exposure };
+
+   Kind kind;
+   std::string device;
+   std::string property; // Only for Property
+
+   SequenceTarget(Kind k, const std::string& dev,
+         const std::string& prop = std::string()) :
+      kind(k), device(dev), property(prop)
+   {}
+
+   bool operator<(const SequenceTarget& rhs) const;
+   bool operator==(const SequenceTarget& rhs) const;
+
+   // For messages, e.g. "Dichroic-Label", "Z (position)"
+   std::string ToString() const;
+};
+
+// Value of every target for one frame. Stage positions and exposures are
+// stored formatted with FormatSequenceValue().
+typedef std::map<SequenceTarget, std::string> FrameSettings;
+
+// Maximum hardware sequence length of each target, or 0 if the target cannot
+// be sequenced
+typedef std::map<SequenceTarget, long> SequenceCapabilities;
+
+std::string FormatSequenceValue(double value);
+double ParseSequenceValue(const std::string& value);
+
+// Run of consecutive frames that can execute without software intervention
+struct SequenceChunk
+{
+   std::size_t firstFrame;
+   std::size_t frameCount;
+
+   // Targets whose value does not change during the chunk; set by software
+   // before the chunk starts
+   FrameSettings constants;
+
+   // Targets that change during the chunk, with one value per frame
+   std::map<SequenceTarget, std::vector<std::string> > sequences;
+};
+
+// The acquisition to be run: channels (each a set of target values, as
+// from a configuration group preset) crossed with focus positions, repeated
+// for each time point.
+struct SequencePlanSpec
+{
+   std::vector<FrameSettings> channels;
+   std::string focusStage;
+   std::vector<double> focusPositions;
+   bool channelsFirst; // Channel changes every frame; otherwise focus does
+   long timePoints;
+
+   SequencePlanSpec() : channelsFirst(true), timePoints(1) {}
+};
+
+// Plan state kept by CMMCore between configuration, compilation and
+// execution
+struct SequencePlan
+{
+   std::string channelGroup;
+   std::vector<std::string> channelPresets;
+   std::vector<double> channelExposures; // Empty to leave exposure alone
+   SequencePlanSpec spec; // channels is filled in on compilation
+
+   std::vector<SequenceChunk> chunks;
+   std::size_t frameCount;
+   bool compiled;
+
+   SequencePlan() : frameCount(0), compiled(false) {}
+};
+
+// Returns the settings for each frame of the plan.
+std::vector<FrameSettings> ExpandSequencePlan(const SequencePlanSpec& spec);
+
+// Splits frames into chunks. Within a chunk, only sequenceable targets
+// change value, and no sequence is longer than its target allows. A new
+// chunk is started whenever a non-sequenceable target changes or a sequence
+// would become too long. All frames must set the same targets, and every
+// target must appear in caps; otherwise CMMError is thrown.
+std::vector<SequenceChunk> CompileSequencePlan(
+      const std::vector<FrameSettings>& frames,
+      const SequenceCapabilities& caps);
+
+} // namespace mm
@@ -0,0 +1,277 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Export of sequence acquisition frames to a named POSIX
+//                shared-memory segment
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "SharedFrameRing.h"
+
+#include "CoreUtils.h"
+#include "Error.h"
+#include "ErrorCodes.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(MMSFHeader) <= MMSF_HEADER_SIZE,
+      "Shared frame header must fit in MMSF_HEADER_SIZE");
+
+namespace mm {
+
+#ifdef _WIN32
+
+SharedFrameRing::SharedFrameRing(const std::string&, std::size_t) :
+   base_(0), size_(0), header_(0), pixelCapacity_(0), slotStride_(0),
+   slotCount_(0), nextFrame_(0), generation_(0)
+{
+   throw CMMError("Shared memory image export is not supported on Windows",
+         MMERR_SharedMemoryExportFailed);
+}
+
+SharedFrameRing::~SharedFrameRing() {}
+
+bool SharedFrameRing::Publish(const unsigned char*, unsigned, unsigned,
+      unsigned, unsigned, unsigned, const std::string&)
+{
+   return false;
+}
+
+void SharedFrameRing::Reslice(std::size_t) {}
+
+#else // _WIN32
+
+namespace {
+
+std::size_t AlignUp(std::size_t n)
+{
+   return (n + MMSF_ALIGNMENT - 1) / MMSF_ALIGNMENT * MMSF_ALIGNMENT;
+}
+
+const std::size_t slotHeaderSize = AlignUp(sizeof(MMSFSlotHeader));
+
+template <typename T>
+void StoreRelaxed(T* p, T value)
+{
+   __atomic_store_n(p, value, __ATOMIC_RELAXED);
+}
+
+template <typename T>
+void StoreRelease(T* p, T value)
+{
+   __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+std::string ShmName(const std::string& name)
+{
+   std::string shmName = name;
+   if (shmName.empty() || shmName[0] != '/')
+      shmName = "/" + shmName;
+   if (shmName.size() < 2 || shmName.size() > 255 ||
+         shmName.find('/', 1) != std::string::npos)
+      throw CMMError("Invalid shared memory name " + ToQuotedString(name) +
+            " (must be a single path component)",
+            MMERR_SharedMemoryExportFailed);
+   return shmName;
+}
+
+CMMError SystemError(const std::string& what, const std::string& name)
+{
+   return CMMError(what + " " + ToQuotedString(name) + ": " +
+         std::strerror(errno), MMERR_SharedMemoryExportFailed);
+}
+
+// True if the existing segment belongs to a live writer
+bool SegmentInUse(const std::string& shmName)
+{
+   int fd = shm_open(shmName.c_str(), O_RDONLY, 0);
+   if (fd < 0)
+      return false;
+   struct stat st;
+   void* p = MAP_FAILED;
+   if (fstat(fd, &st) == 0 && st.st_size >= MMSF_HEADER_SIZE)
+      p = mmap(0, MMSF_HEADER_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (p == MAP_FAILED)
+      return false; // Not ours, or truncated; treat as stale
+
+   const MMSFHeader* header = static_cast<const MMSFHeader*>(p);
+   bool inUse = header->magic == MMSF_MAGIC &&
+      __atomic_load_n(&header->writerOpen, __ATOMIC_ACQUIRE) != 0 &&
+      (kill(static_cast<pid_t>(header->writerPid), 0) == 0 || errno == EPERM);
+   munmap(p, MMSF_HEADER_SIZE);
+   return inUse;
+}
+
+} // anonymous namespace
+
+SharedFrameRing::SharedFrameRing(const std::string& name,
+      std::size_t sizeBytes) :
+   name_(ShmName(name)),
+   base_(0),
+   size_(0),
+   header_(0),
+   pixelCapacity_(0),
+   slotStride_(0),
+   slotCount_(0),
+   nextFrame_(0),
+   generation_(0)
+{
+   if (sizeBytes < MMSF_HEADER_SIZE + slotHeaderSize + MetadataCapacity)
+      throw CMMError("Shared memory export segment is too small",
+            MMERR_SharedMemoryExportFailed);
+
+   int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+   if (fd < 0 && errno == EEXIST)
+   {
+      if (SegmentInUse(name_))
+         throw CMMError("Shared memory segment " + ToQuotedString(name_) +
+               " is in use by another process",
+               MMERR_SharedMemoryExportFailed);
+      // Left behind by a process that did not shut down cleanly
+      shm_unlink(name_.c_str());
+      fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+   }
+   if (fd < 0)
+      throw SystemError("Cannot create shared memory segment", name_);
+
+   if (ftruncate(fd, static_cast<off_t>(sizeBytes)) != 0)
+   {
+      CMMError err = SystemError("Cannot size shared memory segment", name_);
+      close(fd);
+      shm_unlink(name_.c_str());
+      throw err;
+   }
+   void* p = mmap(0, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (p == MAP_FAILED)
+   {
+      CMMError err = SystemError("Cannot map shared memory segment", name_);
+      close(fd);
+      shm_unlink(name_.c_str());
+      throw err;
+   }
+   close(fd);
+
+   base_ = static_cast<unsigned char*>(p);
+   size_ = sizeBytes;
+   header_ = static_cast<MMSFHeader*>(p);
+
+   // The new segment is zero-filled
+   header_->version = MMSF_VERSION;
+   header_->segmentSize = sizeBytes;
+   header_->headerSize = MMSF_HEADER_SIZE;
+   header_->slotHeaderSize = static_cast<uint32_t>(slotHeaderSize);
+   header_->writerPid = static_cast<uint32_t>(getpid());
+   header_->metadataCapacity = MetadataCapacity;
+   header_->writerOpen = 1;
+   StoreRelease(&header_->magic, static_cast<uint32_t>(MMSF_MAGIC));
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+   StoreRelease(&header_->writerOpen, static_cast<uint32_t>(0));
+   munmap(base_, size_);
+   shm_unlink(name_.c_str());
+}
+
+void SharedFrameRing::Reslice(std::size_t pixelSize)
+{
+   StoreRelaxed(&header_->layoutGeneration, static_cast<uint64_t>(++generation_));
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   for (std::size_t i = 0; i < slotCount_; ++i)
+   {
+      MMSFSlotHeader* slot = reinterpret_cast<MMSFSlotHeader*>(
+            base_ + MMSF_HEADER_SIZE + i * slotStride_);
+      StoreRelaxed(&slot->sequence, static_cast<uint64_t>(0));
+   }
+
+   pixelCapacity_ = AlignUp(pixelSize);
+   slotStride_ = slotHeaderSize + pixelCapacity_ + MetadataCapacity;
+   slotCount_ = (size_ - MMSF_HEADER_SIZE) / slotStride_;
+
+   // The new slot headers overlap old pixels and metadata, which could look
+   // like a valid sequence number to a reader of the new layout
+   for (std::size_t i = 0; i < slotCount_; ++i)
+   {
+      unsigned char* slotBase = base_ + MMSF_HEADER_SIZE + i * slotStride_;
+      StoreRelaxed(&reinterpret_cast<MMSFSlotHeader*>(slotBase)->sequence,
+            static_cast<uint64_t>(0));
+      std::memset(slotBase + sizeof(uint64_t), 0,
+            sizeof(MMSFSlotHeader) - sizeof(uint64_t));
+   }
+
+   header_->slotCount = slotCount_;
+   header_->slotStride = slotStride_;
+   header_->pixelCapacity = pixelCapacity_;
+
+   StoreRelease(&header_->layoutGeneration, static_cast<uint64_t>(++generation_));
+}
+
+bool SharedFrameRing::Publish(const unsigned char* pixels, unsigned width,
+      unsigned height, unsigned bytesPerPixel, unsigned nComponents,
+      unsigned channel, const std::string& serializedMetadata)
+{
+   const std::size_t pixelSize =
+      static_cast<std::size_t>(width) * height * bytesPerPixel;
+   if (AlignUp(pixelSize) != pixelCapacity_)
+      Reslice(pixelSize);
+   if (slotCount_ == 0)
+   {
+      __atomic_fetch_add(&header_->framesSkipped, static_cast<uint64_t>(1),
+            __ATOMIC_RELAXED);
+      return false;
+   }
+
+   const unsigned long long n = nextFrame_;
+   unsigned char* slotBase =
+      base_ + MMSF_HEADER_SIZE + (n % slotCount_) * slotStride_;
+   MMSFSlotHeader* slot = reinterpret_cast<MMSFSlotHeader*>(slotBase);
+
+   StoreRelaxed(&slot->sequence, static_cast<uint64_t>(2 * n + 1));
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   const bool metadataFits = serializedMetadata.size() <= MetadataCapacity;
+   slot->pixelOffset = slotHeaderSize;
+   slot->pixelSize = pixelSize;
+   slot->metadataOffset = slotHeaderSize + pixelCapacity_;
+   slot->metadataSize = metadataFits ? serializedMetadata.size() : 0;
+   slot->width = width;
+   slot->height = height;
+   slot->bytesPerPixel = bytesPerPixel;
+   slot->numberOfComponents = nComponents;
+   slot->channel = channel;
+   slot->flags = metadataFits ? 0 : MMSF_SLOT_METADATA_TRUNCATED;
+
+   std::memcpy(slotBase + slotHeaderSize, pixels, pixelSize);
+   if (metadataFits)
+      std::memcpy(slotBase + slotHeaderSize + pixelCapacity_,
+            serializedMetadata.data(), serializedMetadata.size());
+
+   StoreRelease(&slot->sequence, static_cast<uint64_t>(2 * n + 2));
+   StoreRelease(&header_->framesPublished, static_cast<uint64_t>(n + 1));
+   ++nextFrame_;
+   return true;
+}
+
+#endif // _WIN32
+
+} // namespace mm
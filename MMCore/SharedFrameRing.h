@@ -0,0 +1,77 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Export of sequence acquisition frames to a named POSIX
+//                shared-memory segment
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "SharedFrames/SharedFrameLayout.h"
+
+#include <cstddef>
+#include <string>
+
+namespace mm {
+
+// Writer side of the segment described in SharedFrames/SharedFrameLayout.h.
+// Readers in other processes use SharedFrames/SharedFrameReader.h.
+//
+// The segment is created (and any stale segment of the same name left by a
+// process that no longer exists is replaced) by the constructor, which
+// throws CMMError on failure or on platforms without POSIX shared memory.
+// The destructor unlinks it; readers that still have it mapped can finish
+// reading.
+//
+// Publish() must not be called concurrently from multiple threads.
+class SharedFrameRing
+{
+public:
+   // Bytes reserved for serialized metadata in each slot
+   static const std::size_t MetadataCapacity = 64 * 1024;
+
+   SharedFrameRing(const std::string& name, std::size_t sizeBytes);
+   ~SharedFrameRing();
+
+   const std::string& Name() const { return name_; }
+   std::size_t SizeBytes() const { return size_; }
+   std::size_t SlotCount() const { return slotCount_; }
+   unsigned long long FramesPublished() const { return nextFrame_; }
+
+   // Copies one image (one channel) into the next slot. The segment is
+   // re-sliced if the image size differs from the previous one. Returns
+   // false, and counts the image as skipped, if it does not fit in the
+   // segment.
+   bool Publish(const unsigned char* pixels, unsigned width, unsigned height,
+         unsigned bytesPerPixel, unsigned nComponents, unsigned channel,
+         const std::string& serializedMetadata);
+
+private:
+   void Reslice(std::size_t pixelSize);
+
+   std::string name_;
+   unsigned char* base_;
+   std::size_t size_;
+   MMSFHeader* header_;
+
+   std::size_t pixelCapacity_;
+   std::size_t slotStride_;
+   std::size_t slotCount_;
+   unsigned long long nextFrame_;
+   unsigned long long generation_;
+
+   SharedFrameRing(const SharedFrameRing&);
+   SharedFrameRing& operator=(const SharedFrameRing&);
+};
+
+} // namespace mm
@@ -0,0 +1,108 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Layout of the shared-memory segment used to export frames
+//                to other processes (CMMCore::enableSharedMemoryExport())
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+// This header is plain C so that it can be used by readers that do not link
+// to MMCore (see SharedFrameReader.h).
+//
+// The segment is a named POSIX shared-memory object (shm_open()) of fixed
+// size, created by the Core. All integers are in host byte order; readers
+// must run on the same machine.
+//
+//    offset 0                            MMSFHeader
+//    offset headerSize                   slot 0
+//    offset headerSize + k * slotStride  slot k (k < slotCount)
+//
+// Each slot holds one image (one channel of a camera frame):
+//
+//    offset 0                            MMSFSlotHeader
+//    offset pixelOffset                  pixels (pixelSize bytes; rows are
+//                                        packed, with no padding)
+//    offset metadataOffset               metadata (metadataSize bytes, in
+//                                        the format of Metadata::Serialize(),
+//                                        not null-terminated)
+//
+// Every image exported gets a frame number, starting at 0 and incremented
+// for each image (so a 3-channel camera frame uses 3 frame numbers). Frame n
+// is stored in slot n % slotCount.
+//
+// Synchronization is lock-free, using sequence numbers that readers check
+// before and after using the data (a "seqlock"); the writer never waits for
+// readers. Fields marked (atomic) must be read with acquire semantics:
+//
+// - MMSFSlotHeader::sequence is 0 for an empty slot, 2n + 1 while frame n is
+//   being written, and 2n + 2 once frame n is complete. A reader has a valid
+//   copy of frame n if it read 2n + 2 both before and after copying the slot.
+//
+// - MMSFHeader::layoutGeneration is odd while the writer re-slices the
+//   segment (which happens when the image size changes). The slicing fields
+//   (slotCount through metadataCapacity) are only meaningful, and slot data
+//   can only be trusted, if the same even value is read before and after.
+//   Re-slicing resets all slot sequence numbers to 0.
+//
+// - MMSFHeader::framesPublished is the number of the next frame to be
+//   written; frames below it are complete unless overwritten.
+
+#pragma once
+
+#include <stdint.h>
+
+#define MMSF_MAGIC 0x46534d4du // "MMSF" in little-endian byte order
+#define MMSF_VERSION 1u
+
+// Offset of slot 0; the header is zero-padded to this size
+#define MMSF_HEADER_SIZE 4096u
+
+// Slot headers, pixel data and metadata start on this alignment
+#define MMSF_ALIGNMENT 64u
+
+// MMSFSlotHeader::flags
+#define MMSF_SLOT_METADATA_TRUNCATED 1u // Metadata was too large; omitted
+
+typedef struct MMSFHeader
+{
+   uint32_t magic; // MMSF_MAGIC; written last when the segment is created
+   uint32_t version; // MMSF_VERSION
+   uint64_t segmentSize; // Size of the whole segment in bytes
+   uint32_t headerSize; // Offset of slot 0
+   uint32_t slotHeaderSize; // Size reserved for MMSFSlotHeader in each slot
+   uint32_t writerPid;
+   uint32_t writerOpen; // (atomic) 1 while the writer has the segment open
+
+   uint64_t layoutGeneration; // (atomic) Odd while re-slicing
+   uint64_t slotCount; // 0 until the first frame is exported
+   uint64_t slotStride; // Distance between consecutive slots
+   uint64_t pixelCapacity; // Bytes reserved for pixels in each slot
+   uint64_t metadataCapacity; // Bytes reserved for metadata in each slot
+
+   uint64_t framesPublished; // (atomic)
+   uint64_t framesSkipped; // (atomic) Images too large for the segment
+} MMSFHeader;
+
+typedef struct MMSFSlotHeader
+{
+   uint64_t sequence; // (atomic)
+   uint64_t pixelOffset; // From start of slot
+   uint64_t pixelSize;
+   uint64_t metadataOffset; // From start of slot
+   uint64_t metadataSize;
+   uint32_t width;
+   uint32_t height;
+   uint32_t bytesPerPixel; // Including all components
+   uint32_t numberOfComponents; // 1 for grayscale; 4 for RGB
+   uint32_t channel;
+   uint32_t flags; // MMSF_SLOT_*
+} MMSFSlotHeader;
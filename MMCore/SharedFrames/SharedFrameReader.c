@@ -0,0 +1,228 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   C library for reading frames exported by the Core to a
+//                shared-memory segment
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "SharedFrameReader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct MMSFReader
+{
+   const unsigned char* base;
+   size_t size;
+   const MMSFHeader* header;
+};
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+int mmsf_open(const char* name, MMSFReader** reader)
+{
+   *reader = NULL;
+
+   size_t len = strlen(name);
+   char* shmName = (char*)malloc(len + 2);
+   if (!shmName)
+      return MMSF_ERR_SYSTEM;
+   if (name[0] == '/')
+      memcpy(shmName, name, len + 1);
+   else
+   {
+      shmName[0] = '/';
+      memcpy(shmName + 1, name, len + 1);
+   }
+   int fd = shm_open(shmName, O_RDONLY, 0);
+   free(shmName);
+   if (fd < 0)
+      return MMSF_ERR_SYSTEM;
+
+   struct stat st;
+   if (fstat(fd, &st) != 0)
+   {
+      int err = errno;
+      close(fd);
+      errno = err;
+      return MMSF_ERR_SYSTEM;
+   }
+   if ((size_t)st.st_size < MMSF_HEADER_SIZE)
+   {
+      close(fd);
+      return MMSF_ERR_FORMAT;
+   }
+
+   size_t size = (size_t)st.st_size;
+   void* base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+   int err = errno;
+   close(fd); // The mapping stays valid
+   if (base == MAP_FAILED)
+   {
+      errno = err;
+      return MMSF_ERR_SYSTEM;
+   }
+
+   const MMSFHeader* header = (const MMSFHeader*)base;
+   if (LOAD_ACQUIRE(&header->magic) != MMSF_MAGIC ||
+         header->version != MMSF_VERSION ||
+         header->segmentSize != size ||
+         header->headerSize < sizeof(MMSFHeader) ||
+         header->slotHeaderSize < sizeof(MMSFSlotHeader))
+   {
+      munmap(base, size);
+      return MMSF_ERR_FORMAT;
+   }
+
+   MMSFReader* r = (MMSFReader*)malloc(sizeof(MMSFReader));
+   if (!r)
+   {
+      munmap(base, size);
+      return MMSF_ERR_SYSTEM;
+   }
+   r->base = (const unsigned char*)base;
+   r->size = size;
+   r->header = header;
+   *reader = r;
+   return MMSF_OK;
+}
+
+void mmsf_close(MMSFReader* reader)
+{
+   if (!reader)
+      return;
+   munmap((void*)reader->base, reader->size);
+   free(reader);
+}
+
+int mmsf_writer_open(const MMSFReader* reader)
+{
+   return LOAD_ACQUIRE(&reader->header->writerOpen) != 0;
+}
+
+uint64_t mmsf_frames_published(const MMSFReader* reader)
+{
+   return LOAD_ACQUIRE(&reader->header->framesPublished);
+}
+
+uint64_t mmsf_frames_skipped(const MMSFReader* reader)
+{
+   return LOAD_RELAXED(&reader->header->framesSkipped);
+}
+
+int mmsf_view_frame(MMSFReader* reader, uint64_t frameNumber,
+      MMSFFrame* frame)
+{
+   const MMSFHeader* h = reader->header;
+
+   uint64_t generation = LOAD_ACQUIRE(&h->layoutGeneration);
+   if (generation & 1)
+      return MMSF_ERR_BUSY;
+   uint64_t published = LOAD_ACQUIRE(&h->framesPublished);
+   if (frameNumber >= published)
+      return MMSF_ERR_NOT_YET;
+
+   uint64_t slotCount = LOAD_RELAXED(&h->slotCount);
+   uint64_t slotStride = LOAD_RELAXED(&h->slotStride);
+   if (slotCount == 0 || published - frameNumber > slotCount)
+      return MMSF_ERR_OVERWRITTEN;
+
+   // The slicing may be torn if the writer has started re-slicing; check
+   // bounds before touching the slot. The generation check below then
+   // rejects the result.
+   uint64_t slotOffset = h->headerSize + (frameNumber % slotCount) * slotStride;
+   if (slotStride < sizeof(MMSFSlotHeader) || slotOffset > reader->size ||
+         reader->size - slotOffset < slotStride)
+      return MMSF_ERR_BUSY;
+   const MMSFSlotHeader* slot =
+      (const MMSFSlotHeader*)(reader->base + slotOffset);
+
+   uint64_t sequence = LOAD_ACQUIRE(&slot->sequence);
+   if (sequence != 2 * frameNumber + 2)
+      return MMSF_ERR_OVERWRITTEN;
+
+   uint64_t pixelOffset = LOAD_RELAXED(&slot->pixelOffset);
+   uint64_t pixelSize = LOAD_RELAXED(&slot->pixelSize);
+   uint64_t metadataOffset = LOAD_RELAXED(&slot->metadataOffset);
+   uint64_t metadataSize = LOAD_RELAXED(&slot->metadataSize);
+   if (pixelOffset > slotStride || slotStride - pixelOffset < pixelSize ||
+         metadataOffset > slotStride ||
+         slotStride - metadataOffset < metadataSize)
+      return MMSF_ERR_OVERWRITTEN;
+
+   frame->frameNumber = frameNumber;
+   frame->width = LOAD_RELAXED(&slot->width);
+   frame->height = LOAD_RELAXED(&slot->height);
+   frame->bytesPerPixel = LOAD_RELAXED(&slot->bytesPerPixel);
+   frame->numberOfComponents = LOAD_RELAXED(&slot->numberOfComponents);
+   frame->channel = LOAD_RELAXED(&slot->channel);
+   frame->flags = LOAD_RELAXED(&slot->flags);
+   frame->pixels = (const unsigned char*)slot + pixelOffset;
+   frame->pixelSize = (size_t)pixelSize;
+   frame->metadata = (const char*)slot + metadataOffset;
+   frame->metadataSize = (size_t)metadataSize;
+   frame->slot_ = slot;
+   frame->sequence_ = sequence;
+   frame->layoutGeneration_ = generation;
+
+   // Make sure the header fields just read belong to this frame
+   return mmsf_validate_frame(reader, frame);
+}
+
+int mmsf_validate_frame(const MMSFReader* reader, const MMSFFrame* frame)
+{
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   if (LOAD_RELAXED(&frame->slot_->sequence) != frame->sequence_ ||
+         LOAD_RELAXED(&reader->header->layoutGeneration) !=
+         frame->layoutGeneration_)
+      return MMSF_ERR_OVERWRITTEN;
+   return MMSF_OK;
+}
+
+int mmsf_copy_frame(MMSFReader* reader, uint64_t frameNumber,
+      MMSFFrame* frame, void* pixelBuf, size_t pixelBufSize,
+      char* metadataBuf, size_t metadataBufSize)
+{
+   int err = mmsf_view_frame(reader, frameNumber, frame);
+   if (err != MMSF_OK)
+      return err;
+
+   if (pixelBufSize < frame->pixelSize ||
+         (metadataBuf && metadataBufSize < frame->metadataSize + 1))
+      return MMSF_ERR_BUFFER_TOO_SMALL;
+
+   memcpy(pixelBuf, frame->pixels, frame->pixelSize);
+   if (metadataBuf)
+   {
+      memcpy(metadataBuf, frame->metadata, frame->metadataSize);
+      metadataBuf[frame->metadataSize] = '\0';
+   }
+
+   err = mmsf_validate_frame(reader, frame);
+   if (err != MMSF_OK)
+      return err;
+
+   frame->pixels = pixelBuf;
+   frame->metadata = metadataBuf;
+   if (!metadataBuf)
+      frame->metadataSize = 0;
+   return MMSF_OK;
+}
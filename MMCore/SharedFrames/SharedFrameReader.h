@@ -0,0 +1,119 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   C library for reading frames exported by the Core to a
+//                shared-memory segment
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+// Usage, polling for the newest frame:
+//
+//    MMSFReader* reader;
+//    if (mmsf_open("/my-export", &reader) != MMSF_OK) ...
+//    uint64_t published = mmsf_frames_published(reader);
+//    MMSFFrame frame;
+//    if (published > 0 &&
+//          mmsf_view_frame(reader, published - 1, &frame) == MMSF_OK) {
+//       ... use frame.pixels, zero-copy ...
+//       if (mmsf_validate_frame(reader, &frame) != MMSF_OK)
+//          ... the writer overwrote the frame meanwhile; discard results ...
+//    }
+//    mmsf_close(reader);
+//
+// A reader never blocks the writer, so a frame can be overwritten at any
+// time once it is older than the ring (slotCount frames). Use
+// mmsf_copy_frame() to get a copy that is known to be intact.
+//
+// Reader functions may be called from multiple threads, except that
+// mmsf_close() must not race with the others. The library is POSIX only.
+
+#pragma once
+
+#include "SharedFrameLayout.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Return codes
+#define MMSF_OK 0
+#define MMSF_ERR_NOT_YET 1 // Frame has not been published yet
+#define MMSF_ERR_OVERWRITTEN 2 // Frame is no longer in the ring
+#define MMSF_ERR_BUSY 3 // Writer is re-slicing the segment; try again
+#define MMSF_ERR_SYSTEM 4 // System call failed; errno is set
+#define MMSF_ERR_FORMAT 5 // Not a segment of a supported version
+#define MMSF_ERR_BUFFER_TOO_SMALL 6
+
+typedef struct MMSFReader MMSFReader;
+
+// A frame in the segment. The pointers refer to shared memory (or, after
+// mmsf_copy_frame(), to the caller's buffers).
+typedef struct MMSFFrame
+{
+   uint64_t frameNumber;
+   uint32_t width;
+   uint32_t height;
+   uint32_t bytesPerPixel;
+   uint32_t numberOfComponents;
+   uint32_t channel;
+   uint32_t flags; // MMSF_SLOT_*
+   const void* pixels;
+   size_t pixelSize;
+   const char* metadata; // Not null-terminated
+   size_t metadataSize;
+
+   // Private to the library
+   const MMSFSlotHeader* slot_;
+   uint64_t sequence_;
+   uint64_t layoutGeneration_;
+} MMSFFrame;
+
+// Maps the segment read-only. The name is as passed to
+// CMMCore::enableSharedMemoryExport(); a leading '/' is added if missing.
+int mmsf_open(const char* name, MMSFReader** reader);
+void mmsf_close(MMSFReader* reader);
+
+// Nonzero while the Core has the segment open. Once the Core closes it, the
+// frames already published stay readable until the reader closes.
+int mmsf_writer_open(const MMSFReader* reader);
+
+// Number of the next frame to be published (0 if none yet)
+uint64_t mmsf_frames_published(const MMSFReader* reader);
+
+// Images that were not exported because they did not fit in the segment
+uint64_t mmsf_frames_skipped(const MMSFReader* reader);
+
+// Points frame at frame frameNumber in shared memory, without copying. The
+// data may be overwritten while in use; call mmsf_validate_frame() after
+// using it.
+int mmsf_view_frame(MMSFReader* reader, uint64_t frameNumber,
+      MMSFFrame* frame);
+
+// Returns MMSF_OK if frame (from mmsf_view_frame()) has not been touched by
+// the writer since it was viewed, or MMSF_ERR_OVERWRITTEN.
+int mmsf_validate_frame(const MMSFReader* reader, const MMSFFrame* frame);
+
+// Copies frame frameNumber into the caller's buffers and sets frame to point
+// to them. metadataBuf may be null to skip the metadata, otherwise the
+// metadata is null-terminated. Returns MMSF_ERR_BUFFER_TOO_SMALL (with the
+// required sizes in frame->pixelSize and frame->metadataSize) if a buffer is
+// too small.
+int mmsf_copy_frame(MMSFReader* reader, uint64_t frameNumber,
+      MMSFFrame* frame, void* pixelBuf, size_t pixelBufSize,
+      char* metadataBuf, size_t metadataBufSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
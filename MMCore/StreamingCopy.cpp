@@ -0,0 +1,174 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Memory copy with non-temporal (cache-bypassing) stores, with
+//                SSE2 and AVX implementations selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "StreamingCopy.h"
+
+#include "../MMDevice/CpuFeatures.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define STREAMINGCOPY_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define STREAMINGCOPY_TARGET_SSE2
+#define STREAMINGCOPY_TARGET_AVX
+#else
+#define STREAMINGCOPY_TARGET_SSE2 __attribute__((target("sse2")))
+#define STREAMINGCOPY_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+namespace mm {
+namespace StreamingCopy {
+
+namespace {
+
+// Non-temporal stores are written out a cache line at a time
+const std::size_t lineBytes = 64;
+
+#ifdef STREAMINGCOPY_X86
+
+// Number of bytes to copy normally before dst reaches a line boundary
+std::size_t Prologue(const void* dst, std::size_t bytes)
+{
+   const std::size_t misalignment =
+      reinterpret_cast<std::uintptr_t>(dst) % lineBytes;
+   const std::size_t head = misalignment ? lineBytes - misalignment : 0;
+   return head < bytes ? head : bytes;
+}
+
+/*
+ * One cache line per iteration: unaligned loads, aligned streaming stores.
+ * The trailing sfence orders the streaming stores before whatever the
+ * caller does next (such as signaling another thread that the data is
+ * ready).
+ */
+
+STREAMINGCOPY_TARGET_SSE2
+void SSE2Copy(unsigned char* dst, const unsigned char* src, std::size_t lines)
+{
+   for (std::size_t i = 0; i < lines; ++i, dst += lineBytes, src += lineBytes)
+   {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+      const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+   }
+   _mm_sfence();
+}
+
+STREAMINGCOPY_TARGET_AVX
+void AVXCopy(unsigned char* dst, const unsigned char* src, std::size_t lines)
+{
+   for (std::size_t i = 0; i < lines; ++i, dst += lineBytes, src += lineBytes)
+   {
+      const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+      const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+   }
+   _mm_sfence();
+}
+
+#endif // STREAMINGCOPY_X86
+
+Implementation DetectBestImplementation()
+{
+#ifdef STREAMINGCOPY_X86
+   if (CpuFeatures::HasAVX())
+      return ImplementationAVX;
+   if (CpuFeatures::HasSSE2())
+      return ImplementationSSE2;
+#endif
+   return ImplementationMemcpy;
+}
+
+Implementation Resolve(Implementation impl)
+{
+   if (impl == ImplementationAuto)
+      return GetBestImplementation();
+   if (!IsImplementationAvailable(impl))
+      return ImplementationMemcpy;
+   return impl;
+}
+
+} // anonymous namespace
+
+
+bool IsImplementationAvailable(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto:
+      case ImplementationMemcpy:
+         return true;
+#ifdef STREAMINGCOPY_X86
+      case ImplementationSSE2:
+         return GetBestImplementation() != ImplementationMemcpy;
+      case ImplementationAVX:
+         return GetBestImplementation() == ImplementationAVX;
+#endif
+      default:
+         return false;
+   }
+}
+
+
+Implementation GetBestImplementation()
+{
+   static const Implementation best = DetectBestImplementation();
+   return best;
+}
+
+
+void Copy(void* dst, const void* src, std::size_t bytes, Implementation impl)
+{
+   impl = Resolve(impl);
+   if (impl == ImplementationMemcpy || bytes < 2 * lineBytes)
+   {
+      std::memcpy(dst, src, bytes);
+      return;
+   }
+
+#ifdef STREAMINGCOPY_X86
+   unsigned char* d = static_cast<unsigned char*>(dst);
+   const unsigned char* s = static_cast<const unsigned char*>(src);
+   const std::size_t head = Prologue(d, bytes);
+   std::memcpy(d, s, head);
+   d += head;
+   s += head;
+   bytes -= head;
+
+   const std::size_t lines = bytes / lineBytes;
+   if (impl == ImplementationAVX)
+      AVXCopy(d, s, lines);
+   else
+      SSE2Copy(d, s, lines);
+
+   const std::size_t body = lines * lineBytes;
+   std::memcpy(d + body, s + body, bytes - body);
+#endif
+}
+
+} // namespace StreamingCopy
+} // namespace mm
@@ -0,0 +1,47 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Memory copy with non-temporal (cache-bypassing) stores, with
+//                SSE2 and AVX implementations selected at run time
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include <cstddef>
+
+namespace mm {
+namespace StreamingCopy {
+
+enum Implementation
+{
+   ImplementationAuto, // Fastest one available on this CPU
+   ImplementationMemcpy, // Plain std::memcpy, through the caches
+   ImplementationSSE2,
+   ImplementationAVX,
+};
+
+bool IsImplementationAvailable(Implementation impl);
+Implementation GetBestImplementation();
+
+// Copies bytes from src to dst, writing dst with non-temporal stores that
+// do not allocate cache lines, so that copying a large image does not evict
+// the data other threads are working on. Worth it only for data that will
+// not be read again soon. The bytes before the first 64-byte boundary of dst
+// and after the last one are copied with std::memcpy. Source and
+// destination must not overlap, and need not be aligned. Returns once the
+// stores are globally visible.
+void Copy(void* dst, const void* src, std::size_t bytes,
+      Implementation impl = ImplementationAuto);
+
+} // namespace StreamingCopy
+} // namespace mm
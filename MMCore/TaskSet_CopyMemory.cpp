@@ -23,21 +23,60 @@
 
 #include "TaskSet_CopyMemory.h"
 
+#include "StreamingCopy.h"
+
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Copies of this size and up bypass the caches. About a core's share of the
+// last-level cache: a bigger frame would not stay cached until it is read
+// anyway, and would only evict the data of the threads processing earlier
+// frames.
+const size_t streamingThreshold = 2 * 1024 * 1024;
+
+// Calibration compares the time the pool takes to run a set of empty tasks
+// with the time one thread takes to copy; a chunk handed to another thread
+// must take overheadFactor times longer to copy than its dispatch.
+const size_t calibrationBytes = 4 * 1024 * 1024;
+const int calibrationRuns = 5;
+const double overheadFactor = 4.0;
+const size_t minBytesPerTaskFloor = 256 * 1024;
+const size_t minBytesPerTaskCeiling = 64 * 1024 * 1024;
+
+// Calibrated minimum per pool size, since a bigger pool takes longer to
+// dispatch to (and a pool of one thread never splits)
+std::mutex calibrationMutex;
+std::map<size_t, size_t> minBytesPerTaskByPoolSize;
+
+void CopyChunk(void* dst, const void* src, size_t bytes, bool streaming)
+{
+    if (streaming)
+        mm::StreamingCopy::Copy(dst, src, bytes);
+    else
+        std::memcpy(dst, src, bytes);
+}
+
+} // anonymous namespace
 
 TaskSet_CopyMemory::ATask::ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount)
     : Task(semDone, taskIndex, totalTaskCount)
 {
 }
 
-void TaskSet_CopyMemory::ATask::SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount)
+void TaskSet_CopyMemory::ATask::SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount, bool streaming)
 {
     dst_ = dst;
     src_ = src;
     bytes_ = bytes;
     usedTaskCount_ = usedTaskCount;
+    streaming_ = streaming;
 }
 
 void TaskSet_CopyMemory::ATask::Execute()
@@ -45,21 +84,79 @@ void TaskSet_CopyMemory::ATask::Execute()
     if (taskIndex_ >= usedTaskCount_)
         return;
 
-    size_t chunkBytes = bytes_ / usedTaskCount_;
+    // Chunks are whole cache lines, so that streaming stores need no
+    // prologue in chunks other than the first
+    size_t chunkBytes = (bytes_ / usedTaskCount_) & ~size_t(63);
     const size_t chunkOffset = taskIndex_ * chunkBytes;
     if (taskIndex_ == usedTaskCount_ - 1)
-        chunkBytes += bytes_ % usedTaskCount_;
+        chunkBytes = bytes_ - chunkOffset;
 
     void* dst = static_cast<char*>(dst_) + chunkOffset;
     const void* src = static_cast<const char*>(src_) + chunkOffset;
 
-    std::memcpy(dst, src, chunkBytes);
+    CopyChunk(dst, src, chunkBytes, streaming_);
 }
 
 TaskSet_CopyMemory::TaskSet_CopyMemory(std::shared_ptr<ThreadPool> pool)
     : TaskSet(pool)
 {
     CreateTasks<ATask>();
+
+    std::lock_guard<std::mutex> lock(calibrationMutex);
+    auto it = minBytesPerTaskByPoolSize.find(tasks_.size());
+    if (it == minBytesPerTaskByPoolSize.end())
+        it = minBytesPerTaskByPoolSize.emplace(tasks_.size(), Calibrate()).first;
+    minBytesPerTask_ = it->second;
+}
+
+size_t TaskSet_CopyMemory::GetStreamingThreshold()
+{
+    return streamingThreshold;
+}
+
+size_t TaskSet_CopyMemory::GetMinBytesPerTask() const
+{
+    return minBytesPerTask_;
+}
+
+size_t TaskSet_CopyMemory::Calibrate()
+{
+    using Clock = std::chrono::steady_clock;
+
+    if (tasks_.size() < 2)
+        return minBytesPerTaskCeiling; // Nothing to split among
+
+    std::vector<unsigned char> src(calibrationBytes, 1);
+    std::vector<unsigned char> dst(calibrationBytes, 0);
+
+    // Best of a few runs; the first ones also warm up the pages and threads
+    Clock::duration copyTime = Clock::duration::max();
+    Clock::duration dispatchTime = Clock::duration::max();
+    for (int run = 0; run < calibrationRuns; ++run)
+    {
+        const Clock::time_point copyStart = Clock::now();
+        CopyChunk(dst.data(), src.data(), calibrationBytes,
+                calibrationBytes >= streamingThreshold);
+        copyTime = std::min(copyTime, Clock::now() - copyStart);
+
+        usedTaskCount_ = tasks_.size();
+        for (Task* task : tasks_)
+            static_cast<ATask*>(task)->SetUp(dst.data(), src.data(), 0, usedTaskCount_, false);
+        const Clock::time_point dispatchStart = Clock::now();
+        TaskSet::Execute();
+        semaphore_->Wait(usedTaskCount_);
+        dispatchTime = std::min(dispatchTime, Clock::now() - dispatchStart);
+    }
+
+    const double copySeconds = std::max(1e-9,
+            std::chrono::duration<double>(copyTime).count());
+    const double dispatchSeconds =
+        std::chrono::duration<double>(dispatchTime).count();
+    const double bytes =
+        overheadFactor * dispatchSeconds * calibrationBytes / copySeconds;
+    if (bytes >= minBytesPerTaskCeiling)
+        return minBytesPerTaskCeiling;
+    return std::max(minBytesPerTaskFloor, static_cast<size_t>(bytes) & ~size_t(63));
 }
 
 void TaskSet_CopyMemory::SetUp(void* dst, const void* src, size_t bytes)
@@ -68,18 +165,20 @@ void TaskSet_CopyMemory::SetUp(void* dst, const void* src, size_t bytes)
     assert(src);
     assert(bytes > 0);
 
-    // Call memcpy directly without threading for small frames up to 1MB
-    // Otherwise do parallel copy and add one thread for each 1MB
-    // The limits were found experimentally
-    usedTaskCount_ = std::min<size_t>(1 + bytes / 1000000, tasks_.size());
-    if (usedTaskCount_ == 1)
+    // Copy directly without threading unless each thread gets at least
+    // the calibrated minimum (see Calibrate())
+    const bool streaming = bytes >= streamingThreshold;
+    usedTaskCount_ = std::min<size_t>(
+            std::max<size_t>(1, bytes / minBytesPerTask_), tasks_.size());
+    if (usedTaskCount_ <= 1)
     {
-        std::memcpy(dst, src, bytes);
+        usedTaskCount_ = 1;
+        CopyChunk(dst, src, bytes, streaming);
         return;
     }
 
     for (Task* task : tasks_)
-        static_cast<ATask*>(task)->SetUp(dst, src, bytes, usedTaskCount_);
+        static_cast<ATask*>(task)->SetUp(dst, src, bytes, usedTaskCount_, streaming);
 }
 
 void TaskSet_CopyMemory::Execute()
@@ -33,7 +33,7 @@ private:
     public:
         explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount);
 
-        void SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount);
+        void SetUp(void* dst, const void* src, size_t bytes, size_t usedTaskCount, bool streaming);
 
         virtual void Execute() override;
 
@@ -41,6 +41,7 @@ private:
         void* dst_{ nullptr };
         const void* src_{ nullptr };
         size_t bytes_{ 0 };
+        bool streaming_{ false };
     };
 
 public:
@@ -53,4 +54,16 @@ public:
 
     // Helper blocking method calling SetUp, Execute and Wait
     void MemCopy(void* dst, const void* src, size_t bytes);
+
+    // Copies of at least this size use non-temporal stores (see
+    // mm::StreamingCopy)
+    static size_t GetStreamingThreshold();
+    // Smallest chunk worth handing to another thread, measured by a short
+    // benchmark when the first task set for a pool of this size is created
+    size_t GetMinBytesPerTask() const;
+
+private:
+    size_t Calibrate();
+
+    size_t minBytesPerTask_;
 };
@@ -0,0 +1,118 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Task set for parallelized pixel statistics.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#include "TaskSet_PixelStatistics.h"
+
+#include <algorithm>
+#include <cassert>
+
+TaskSet_PixelStatistics::ATask::ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount)
+    : Task(semDone, taskIndex, totalTaskCount)
+{
+}
+
+void TaskSet_PixelStatistics::ATask::SetUp(const unsigned char* pixels, size_t pixelCount,
+        unsigned bytesPerPixel, unsigned nComponents,
+        unsigned bitDepth, unsigned histogramBins, size_t usedTaskCount)
+{
+    pixels_ = pixels;
+    pixelCount_ = pixelCount;
+    bytesPerPixel_ = bytesPerPixel;
+    nComponents_ = nComponents;
+    acc_ = mm::PixelStatistics::Accumulator(bitDepth, histogramBins);
+    usedTaskCount_ = usedTaskCount;
+}
+
+void TaskSet_PixelStatistics::ATask::Execute()
+{
+    if (taskIndex_ >= usedTaskCount_)
+        return;
+
+    size_t chunkPixels = pixelCount_ / usedTaskCount_;
+    const size_t chunkOffset = taskIndex_ * chunkPixels;
+    if (taskIndex_ == usedTaskCount_ - 1)
+        chunkPixels += pixelCount_ % usedTaskCount_;
+
+    acc_.Add(pixels_ + chunkOffset * bytesPerPixel_, chunkPixels,
+            bytesPerPixel_, nComponents_);
+}
+
+TaskSet_PixelStatistics::TaskSet_PixelStatistics(std::shared_ptr<ThreadPool> pool)
+    : TaskSet(pool)
+{
+    CreateTasks<ATask>();
+}
+
+void TaskSet_PixelStatistics::SetUp(const unsigned char* pixels, size_t pixelCount,
+        unsigned bytesPerPixel, unsigned nComponents,
+        unsigned bitDepth, unsigned histogramBins)
+{
+    assert(pixels);
+
+    // Compute directly without threading for images up to 1 Mpixel, and
+    // otherwise add one thread for each Mpixel (as for memory copies, the
+    // kernels are about as fast as memory)
+    usedTaskCount_ = std::min<size_t>(1 + pixelCount / 1000000, tasks_.size());
+    if (usedTaskCount_ <= 1)
+    {
+        usedTaskCount_ = 1;
+        inlineAcc_ = mm::PixelStatistics::Accumulator(bitDepth, histogramBins);
+        inlineAcc_.Add(pixels, pixelCount, bytesPerPixel, nComponents);
+        return;
+    }
+
+    for (Task* task : tasks_)
+        static_cast<ATask*>(task)->SetUp(pixels, pixelCount, bytesPerPixel,
+                nComponents, bitDepth, histogramBins, usedTaskCount_);
+}
+
+void TaskSet_PixelStatistics::Execute()
+{
+    if (usedTaskCount_ == 1)
+        return; // Already done in SetUp, nothing to execute
+
+    TaskSet::Execute();
+}
+
+void TaskSet_PixelStatistics::Wait()
+{
+    if (usedTaskCount_ == 1)
+        return; // Already done in SetUp, nothing to wait for
+
+    semaphore_->Wait(usedTaskCount_);
+}
+
+mm::PixelStatistics::Result TaskSet_PixelStatistics::GetResult() const
+{
+    if (usedTaskCount_ == 1)
+        return inlineAcc_.GetResult();
+
+    mm::PixelStatistics::Accumulator acc =
+        static_cast<const ATask*>(tasks_[0])->GetAccumulator();
+    for (size_t n = 1; n < usedTaskCount_; ++n)
+        acc.Merge(static_cast<const ATask*>(tasks_[n])->GetAccumulator());
+    return acc.GetResult();
+}
+
+mm::PixelStatistics::Result TaskSet_PixelStatistics::Compute(const unsigned char* pixels,
+        size_t pixelCount, unsigned bytesPerPixel, unsigned nComponents,
+        unsigned bitDepth, unsigned histogramBins)
+{
+    SetUp(pixels, pixelCount, bytesPerPixel, nComponents, bitDepth, histogramBins);
+    Execute();
+    Wait();
+    return GetResult();
+}
@@ -0,0 +1,68 @@
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMCore
+//
+// DESCRIPTION:   Task set for parallelized pixel statistics.
+//
+// LICENSE:       This file is distributed under the "Lesser GPL" (LGPL) license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+
+#pragma once
+
+#include "PixelStatistics.h"
+#include "TaskSet.h"
+
+// Each task accumulates the statistics of a contiguous run of pixels; the
+// partial results are merged when all are done.
+class TaskSet_PixelStatistics : public TaskSet
+{
+private:
+    class ATask : public Task
+    {
+    public:
+        explicit ATask(std::shared_ptr<Semaphore> semDone, size_t taskIndex, size_t totalTaskCount);
+
+        void SetUp(const unsigned char* pixels, size_t pixelCount,
+                unsigned bytesPerPixel, unsigned nComponents,
+                unsigned bitDepth, unsigned histogramBins, size_t usedTaskCount);
+
+        virtual void Execute() override;
+
+        const mm::PixelStatistics::Accumulator& GetAccumulator() const { return acc_; }
+
+    private:
+        const unsigned char* pixels_{ nullptr };
+        size_t pixelCount_{ 0 };
+        unsigned bytesPerPixel_{ 0 };
+        unsigned nComponents_{ 0 };
+        mm::PixelStatistics::Accumulator acc_;
+    };
+
+public:
+    explicit TaskSet_PixelStatistics(std::shared_ptr<ThreadPool> pool);
+
+    void SetUp(const unsigned char* pixels, size_t pixelCount,
+            unsigned bytesPerPixel, unsigned nComponents,
+            unsigned bitDepth, unsigned histogramBins);
+
+    virtual void Execute() override;
+    virtual void Wait() override;
+
+    // Valid after Wait()
+    mm::PixelStatistics::Result GetResult() const;
+
+    // Helper blocking method calling SetUp, Execute, Wait and GetResult
+    mm::PixelStatistics::Result Compute(const unsigned char* pixels,
+            size_t pixelCount, unsigned bytesPerPixel, unsigned nComponents,
+            unsigned bitDepth, unsigned histogramBins);
+
+private:
+    mm::PixelStatistics::Accumulator inlineAcc_; // When not split into tasks
+};
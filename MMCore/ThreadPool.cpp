@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
 //                and scaling number of threads based on hardware.
+//                Each thread has its own queue, and idle threads steal
+//                tasks from the others.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -28,16 +30,72 @@
 
 #include <algorithm>
 #include <cassert>
+#include <exception>
 #include <mutex>
 #include <thread>
 
-ThreadPool::ThreadPool()
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// The pool and queue index of the current thread, if it is a pool thread
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+void SetThreadAffinity(std::thread& thread, unsigned cpu)
+{
+#ifdef _WIN32
+    if (cpu < 8 * sizeof(DWORD_PTR))
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    // No thread affinity (macOS only has scheduling hints)
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+} // anonymous namespace
+
+struct ThreadPool::ForLoop
 {
-    const size_t hwThreadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
-    for (size_t n = 0; n < hwThreadCount; ++n)
+    const std::function<void(size_t, size_t)>* fn{ nullptr };
+    size_t begin{ 0 };
+    size_t count{ 0 };
+    size_t chunks{ 0 };
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> done{ 0 };
+    std::mutex mx{};
+    std::condition_variable cv{};
+    std::exception_ptr error{};
+};
+
+ThreadPool::ThreadPool(size_t threadCount, const std::vector<unsigned>& cpuAffinity)
+    : cpuAffinity_(cpuAffinity)
+{
+    if (threadCount == 0)
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t n = 0; n < threadCount; ++n)
+        workers_.push_back(std::make_unique<Worker>());
+
+    // All queues must exist before any thread starts stealing
+    for (size_t n = 0; n < threadCount; ++n)
     {
-        auto thread = std::make_unique<std::thread>(&ThreadPool::ThreadFunc, this);
-        threads_.push_back(std::move(thread));
+        workers_[n]->thread = std::thread(&ThreadPool::ThreadFunc, this, n);
+        if (!cpuAffinity_.empty())
+            SetThreadAffinity(workers_[n]->thread, cpuAffinity_[n % cpuAffinity_.size()]);
     }
 }
 
@@ -49,13 +107,18 @@ ThreadPool::~ThreadPool()
     }
     cv_.notify_all();
 
-    for (const auto& thread : threads_)
-        thread->join();
+    for (const auto& worker : workers_)
+        worker->thread.join();
 }
 
 size_t ThreadPool::GetSize() const
 {
-    return threads_.size();
+    return workers_.size();
+}
+
+const std::vector<unsigned>& ThreadPool::GetCpuAffinity() const
+{
+    return cpuAffinity_;
 }
 
 void ThreadPool::Execute(Task* task)
@@ -65,9 +128,8 @@ void ThreadPool::Execute(Task* task)
         std::lock_guard<std::mutex> lock(mx_);
         if (abortFlag_)
             return;
-        queue_.push_back(task);
     }
-    cv_.notify_one();
+    Push([task]() { task->Execute(); task->Done(); });
 }
 
 void ThreadPool::Execute(const std::vector<Task*>& tasks)
@@ -78,29 +140,145 @@ void ThreadPool::Execute(const std::vector<Task*>& tasks)
         std::lock_guard<std::mutex> lock(mx_);
         if (abortFlag_)
             return;
-        for (Task* task : tasks)
+    }
+    for (Task* task : tasks)
+    {
+        assert(task);
+        Push([task]() { task->Execute(); task->Done(); });
+    }
+}
+
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grainSize,
+        const std::function<void(size_t, size_t)>& fn)
+{
+    if (end <= begin)
+        return;
+
+    // A few chunks per thread, so that threads that finish early (or start
+    // late) take over the work of the others
+    const size_t count = end - begin;
+    const size_t maxChunks = 4 * (workers_.size() + 1);
+    const size_t chunks = std::min(count / std::max<size_t>(grainSize, 1), maxChunks);
+    bool aborted;
+    {
+        std::lock_guard<std::mutex> lock(mx_);
+        aborted = abortFlag_;
+    }
+    if (chunks <= 1 || aborted)
+    {
+        fn(begin, end);
+        return;
+    }
+
+    // Helpers that start after all chunks are taken return without touching
+    // fn, so they may outlive this call
+    auto loop = std::make_shared<ForLoop>();
+    loop->fn = &fn;
+    loop->begin = begin;
+    loop->count = count;
+    loop->chunks = chunks;
+    const size_t helpers = std::min(chunks - 1, workers_.size());
+    for (size_t n = 0; n < helpers; ++n)
+        Push([loop]() { RunChunks(*loop); });
+
+    RunChunks(*loop);
+
+    std::unique_lock<std::mutex> lock(loop->mx);
+    loop->cv.wait(lock, [&]() { return loop->done == loop->chunks; });
+    if (loop->error)
+        std::rethrow_exception(loop->error);
+}
+
+void ThreadPool::RunChunks(ForLoop& loop)
+{
+    const size_t base = loop.count / loop.chunks;
+    const size_t extra = loop.count % loop.chunks; // The first chunks get one more
+    for (;;)
+    {
+        const size_t chunk = loop.next++;
+        if (chunk >= loop.chunks)
+            return;
+        const size_t first = loop.begin + chunk * base + std::min(chunk, extra);
+        const size_t last = first + base + (chunk < extra ? 1 : 0);
+        try
+        {
+            (*loop.fn)(first, last);
+        }
+        catch (...)
         {
-            assert(task);
-            queue_.push_back(task);
+            std::lock_guard<std::mutex> lock(loop.mx);
+            if (!loop.error)
+                loop.error = std::current_exception();
+        }
+        if (++loop.done == loop.chunks)
+        {
+            std::lock_guard<std::mutex> lock(loop.mx);
+            loop.cv.notify_all();
         }
     }
-    cv_.notify_all();
 }
 
-void ThreadPool::ThreadFunc()
+// Jobs pushed by a pool thread go to its own queue (to be stolen by idle
+// threads), others are spread over all queues. Wakes one sleeping thread.
+void ThreadPool::Push(Job job)
+{
+    const size_t index = currentPool == this ?
+        currentIndex : nextWorker_++ % workers_.size();
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->mx);
+        workers_[index]->jobs.push_back(std::move(job));
+    }
+    ++queued_;
+    {
+        // Pairs with the wait in ThreadFunc, so that the wake-up is not lost
+        std::lock_guard<std::mutex> lock(mx_);
+    }
+    cv_.notify_one();
+}
+
+// Takes the newest job of the own queue, whose data is most likely still
+// cached, or else steals the oldest job of another queue.
+bool ThreadPool::TryPop(size_t index, Job& job)
 {
+    const size_t count = workers_.size();
+    for (size_t k = 0; k < count; ++k)
+    {
+        Worker& worker = *workers_[(index + k) % count];
+        std::lock_guard<std::mutex> lock(worker.mx);
+        if (worker.jobs.empty())
+            continue;
+        if (k == 0)
+        {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+        --queued_;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::ThreadFunc(size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
     for (;;)
     {
-        Task* task = nullptr;
+        Job job;
+        if (TryPop(index, job))
         {
-            std::unique_lock<std::mutex> lock(mx_);
-            cv_.wait(lock, [&]() { return abortFlag_ || !queue_.empty(); });
-            if (abortFlag_)
-                break;
-            task = queue_.front();
-            queue_.pop_front();
+            job();
+            continue;
         }
-        task->Execute();
-        task->Done();
+
+        std::unique_lock<std::mutex> lock(mx_);
+        cv_.wait(lock, [&]() { return abortFlag_ || queued_ > 0; });
+        if (abortFlag_)
+            break;
     }
 }
@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------------------
 // DESCRIPTION:   A class executing queued tasks on separate threads
 //                and scaling number of threads based on hardware.
+//                Each thread has its own queue, and idle threads steal
+//                tasks from the others.
 //
 // AUTHOR:        Tomas Hanak, tomas.hanak@teledyne.com, 03/03/2021
 //                Andrej Bencur, andrej.bencur@teledyne.com, 03/03/2021
@@ -24,8 +26,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -36,21 +41,50 @@ class Task;
 class ThreadPool final
 {
 public:
-    explicit ThreadPool();
+    // threadCount 0 means one thread per hardware thread. If cpuAffinity is
+    // not empty, thread n runs only on CPU cpuAffinity[n % size] (ignored on
+    // platforms without thread affinity).
+    explicit ThreadPool(size_t threadCount = 0,
+            const std::vector<unsigned>& cpuAffinity = std::vector<unsigned>());
     ~ThreadPool();
 
     size_t GetSize() const;
+    const std::vector<unsigned>& GetCpuAffinity() const;
 
     void Execute(Task* task);
     void Execute(const std::vector<Task*>& tasks);
 
+    // Calls fn(chunkBegin, chunkEnd) for disjoint chunks covering
+    // [begin, end), each of at least grainSize items, on the pool threads
+    // and the calling thread, and returns when all chunks are done. The
+    // first exception thrown by fn is rethrown. May be called from a task
+    // running on the pool.
+    void ParallelFor(size_t begin, size_t end, size_t grainSize,
+            const std::function<void(size_t, size_t)>& fn);
+
 private:
-    void ThreadFunc();
+    using Job = std::function<void()>;
+
+    struct Worker
+    {
+        std::mutex mx{};
+        std::deque<Job> jobs{};
+        std::thread thread{};
+    };
+
+    struct ForLoop;
+    static void RunChunks(ForLoop& loop);
+
+    void Push(Job job);
+    bool TryPop(size_t index, Job& job);
+    void ThreadFunc(size_t index);
 
 private:
-    std::vector<std::unique_ptr<std::thread>> threads_{};
+    std::vector<std::unique_ptr<Worker>> workers_{};
+    const std::vector<unsigned> cpuAffinity_;
+    std::atomic<size_t> nextWorker_{ 0 }; // For jobs pushed from outside
+    std::atomic<size_t> queued_{ 0 };
     bool abortFlag_{ false };
-    std::mutex mx_{};
+    std::mutex mx_{}; // Guards abortFlag_ and sleeping
     std::condition_variable cv_{};
-    std::deque<Task*> queue_{};
 };
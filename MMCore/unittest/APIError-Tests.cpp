@@ -84,4 +84,19 @@ TEST_CASE("detectDevice with invalid device", "[APIError]")
    CHECK(c.detectDevice("") == MM::Unimplemented);
    CHECK(c.detectDevice("Blah") == MM::Unimplemented);
    CHECK(c.detectDevice("Core") == MM::Unimplemented);
-}
\ No newline at end of file
+}
+TEST_CASE("Numeric property access with invalid device or value", "[APIError]")
+{
+   CMMCore c;
+   CHECK_THROWS_AS(c.getPropertyAsDouble(nullptr, "Exposure"), CMMError);
+   CHECK_THROWS_AS(c.getPropertyAsDouble("", "Exposure"), CMMError);
+   CHECK_THROWS_AS(c.getPropertyAsDouble("Blah", "Exposure"), CMMError);
+   CHECK_THROWS_AS(c.getPropertyAsLong("Blah", "Exposure"), CMMError);
+   CHECK_THROWS_AS(c.setProperty("Blah", "Exposure", 1.0), CMMError);
+   CHECK_THROWS_AS(c.setProperty("Blah", "Exposure", 1L), CMMError);
+
+   // Core properties are parsed from their string values
+   CHECK(c.getPropertyAsLong("Core", "TimeoutMs") == 5000);
+   CHECK(c.getPropertyAsDouble("Core", "TimeoutMs") == 5000.0);
+   CHECK_THROWS_AS(c.getPropertyAsDouble("Core", "Camera"), CMMError);
+}
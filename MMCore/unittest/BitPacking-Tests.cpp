@@ -0,0 +1,167 @@
+#include <catch2/catch_all.hpp>
+
+#include "BitPacking.h"
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace mm::BitPacking;
+
+namespace {
+
+const unsigned allBitDepths[] = { 10, 12, 14 };
+
+std::string ImplementationName(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto: return "auto";
+      case ImplementationScalar: return "scalar";
+      case ImplementationSSSE3: return "SSSE3";
+   }
+   return "?";
+}
+
+std::vector<unsigned short> RandomPixels(std::size_t pixelCount, unsigned bitDepth)
+{
+   std::mt19937 gen(42);
+   std::uniform_int_distribution<int> dist(0, (1 << bitDepth) - 1);
+   std::vector<unsigned short> pixels(pixelCount);
+   for (std::size_t i = 0; i < pixelCount; ++i)
+      pixels[i] = static_cast<unsigned short>(dist(gen));
+   return pixels;
+}
+
+std::vector<unsigned char> PackPixels(const std::vector<unsigned short>& pixels,
+      unsigned bitDepth, Implementation impl)
+{
+   // Guard bytes detect writes past the end
+   std::vector<unsigned char> packed(PackedSize(pixels.size(), bitDepth) + 16, 0xcd);
+   Pack(packed.data(), reinterpret_cast<const unsigned char*>(pixels.data()),
+         pixels.size(), bitDepth, impl);
+   return packed;
+}
+
+std::vector<unsigned short> UnpackPixels(const std::vector<unsigned char>& packed,
+      std::size_t pixelCount, unsigned bitDepth, Implementation impl)
+{
+   std::vector<unsigned short> pixels(pixelCount + 8, 0xcdcd);
+   Unpack(reinterpret_cast<unsigned char*>(pixels.data()), packed.data(),
+         pixelCount, bitDepth, impl);
+   return pixels;
+}
+
+} // anonymous namespace
+
+TEST_CASE("BitPacking sizes", "[BitPacking]")
+{
+   CHECK(PackedSize(4, 10) == 5);
+   CHECK(PackedSize(2, 12) == 3);
+   CHECK(PackedSize(4, 14) == 7);
+   CHECK(PackedSize(1, 10) == 2);
+   CHECK(PackedSize(2048 * 2048, 12) == 2048 * 2048 * 3 / 2);
+   CHECK(IsPackable(12));
+   CHECK_FALSE(IsPackable(16));
+   CHECK_FALSE(IsPackable(8));
+}
+
+TEST_CASE("BitPacking layout is a little-endian bit stream", "[BitPacking]")
+{
+   const std::vector<unsigned short> pixels12 = { 0x0abc, 0x0def };
+   const std::vector<unsigned char> packed12 =
+      PackPixels(pixels12, 12, ImplementationScalar);
+   CHECK(packed12[0] == 0xbc);
+   CHECK(packed12[1] == 0xfa);
+   CHECK(packed12[2] == 0xde);
+
+   // Bits above the bit depth are discarded
+   const std::vector<unsigned short> pixels10 = { 0xffff, 0, 0, 0x0201 };
+   const std::vector<unsigned char> packed10 =
+      PackPixels(pixels10, 10, ImplementationScalar);
+   CHECK(packed10[0] == 0xff);
+   CHECK(packed10[1] == 0x03);
+   CHECK(packed10[2] == 0x00);
+   CHECK(packed10[3] == 0x40);
+   CHECK(packed10[4] == 0x80);
+}
+
+TEST_CASE("BitPacking round trip", "[BitPacking]")
+{
+   for (unsigned bits : allBitDepths)
+   {
+      // Sizes around the SIMD block and group sizes
+      for (std::size_t n : { std::size_t(0), std::size_t(1), std::size_t(3),
+            std::size_t(15), std::size_t(16), std::size_t(17), std::size_t(23),
+            std::size_t(24), std::size_t(1001) })
+      {
+         const std::vector<unsigned short> pixels = RandomPixels(n, bits);
+         for (Implementation impl : { ImplementationScalar, ImplementationAuto })
+         {
+            CAPTURE(bits, n, ImplementationName(impl));
+            const std::vector<unsigned char> packed = PackPixels(pixels, bits, impl);
+            CHECK(packed[PackedSize(n, bits)] == 0xcd);
+            const std::vector<unsigned short> unpacked =
+               UnpackPixels(packed, n, bits, impl);
+            CHECK(std::memcmp(unpacked.data(), pixels.data(),
+                     n * sizeof(unsigned short)) == 0);
+            CHECK(unpacked[n] == 0xcdcd);
+         }
+      }
+   }
+}
+
+TEST_CASE("BitPacking SIMD matches scalar", "[BitPacking]")
+{
+   if (!IsImplementationAvailable(ImplementationSSSE3))
+   {
+      WARN("SSSE3 not available on this CPU");
+      return;
+   }
+
+   const std::size_t n = 4099;
+   for (unsigned bits : allBitDepths)
+   {
+      CAPTURE(bits);
+      // Include bits above the bit depth, which must be discarded
+      const std::vector<unsigned short> pixels = RandomPixels(n, 16);
+      const std::vector<unsigned char> scalar =
+         PackPixels(pixels, bits, ImplementationScalar);
+      CHECK(PackPixels(pixels, bits, ImplementationSSSE3) == scalar);
+      CHECK(UnpackPixels(scalar, n, bits, ImplementationSSSE3) ==
+            UnpackPixels(scalar, n, bits, ImplementationScalar));
+   }
+}
+
+// Not run by default; run with the tag [.benchmark] to compare throughput
+TEST_CASE("BitPacking benchmark", "[.benchmark][BitPacking]")
+{
+   const std::size_t n = 2048 * 2048;
+   for (unsigned bits : allBitDepths)
+   {
+      const std::vector<unsigned short> pixels = RandomPixels(n, bits);
+      std::vector<unsigned char> packed(PackedSize(n, bits));
+      std::vector<unsigned short> unpacked(n);
+      for (Implementation impl : { ImplementationScalar, ImplementationSSSE3 })
+      {
+         if (!IsImplementationAvailable(impl))
+            continue;
+         const std::string name = std::to_string(bits) + "-bit 2048x2048 " +
+            ImplementationName(impl);
+         BENCHMARK("Pack " + name)
+         {
+            Pack(packed.data(), reinterpret_cast<const unsigned char*>(pixels.data()),
+                  n, bits, impl);
+            return packed[0];
+         };
+         BENCHMARK("Unpack " + name)
+         {
+            Unpack(reinterpret_cast<unsigned char*>(unpacked.data()), packed.data(),
+                  n, bits, impl);
+            return unpacked[0];
+         };
+      }
+   }
+}
@@ -0,0 +1,382 @@
+#include <catch2/catch_all.hpp>
+
+#include "CircularBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const unsigned width = 512, height = 512, depth = 2;
+const unsigned long frameBytes = width * height * depth;
+
+bool Insert(CircularBuffer& cbuf, unsigned char value)
+{
+   const std::vector<unsigned char> pixels(frameBytes, value);
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   return cbuf.InsertImage(pixels.data(), width, height, depth, &md);
+}
+
+} // anonymous namespace
+
+TEST_CASE("CircularBuffer does not overwrite pinned images", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2); // Room for 4 frames
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   REQUIRE(cbuf.GetSize() == 4);
+
+   REQUIRE(Insert(cbuf, 1));
+   unsigned long slot;
+   const mm::ImgBuffer* pinned = cbuf.PinNextImageBuffer(0, slot);
+   REQUIRE(pinned != 0);
+   CHECK(pinned->GetPixels()[0] == 1);
+   CHECK(cbuf.GetRemainingImageCount() == 0);
+   CHECK(cbuf.GetPinnedImageCount() == 1);
+
+   // The three free slots fill up; the fourth insert would hit the pin
+   CHECK(Insert(cbuf, 2));
+   CHECK(Insert(cbuf, 3));
+   CHECK(Insert(cbuf, 4));
+   CHECK_FALSE(Insert(cbuf, 5));
+   CHECK(cbuf.Overflow());
+   CHECK(pinned->GetPixels()[0] == 1);
+
+   // Reallocation is refused while pinned; same geometry is still fine
+   CHECK(cbuf.Initialize(1, width, height, depth));
+   CHECK_FALSE(cbuf.Initialize(1, width / 2, height, depth));
+
+   cbuf.UnpinImageBuffer(slot);
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+   cbuf.Clear();
+   CHECK(Insert(cbuf, 6));
+   CHECK(cbuf.Initialize(1, width / 2, height, depth));
+}
+
+TEST_CASE("CircularBuffer pins the top image without removing it", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2);
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+
+   unsigned long slot;
+   CHECK(cbuf.PinTopImageBuffer(0, slot) == 0);
+   REQUIRE(Insert(cbuf, 1));
+   REQUIRE(Insert(cbuf, 2));
+
+   const mm::ImgBuffer* top = cbuf.PinTopImageBuffer(0, slot);
+   REQUIRE(top != 0);
+   CHECK(top->GetPixels()[0] == 2);
+   CHECK(cbuf.GetRemainingImageCount() == 2);
+
+   // Pins are counted
+   unsigned long slot2;
+   CHECK(cbuf.PinTopImageBuffer(0, slot2) == top);
+   CHECK(slot2 == slot);
+   cbuf.UnpinImageBuffer(slot);
+   CHECK(cbuf.GetPinnedImageCount() == 1);
+   cbuf.UnpinImageBuffer(slot2);
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+}
+
+TEST_CASE("CircularBuffer re-slices its memory when the geometry changes", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2);
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   REQUIRE(Insert(cbuf, 1));
+
+   // Half-size frames: twice the capacity, images refer to the new size
+   REQUIRE(cbuf.Initialize(1, width / 2, height, depth));
+   CHECK(cbuf.GetSize() == 8);
+   CHECK(cbuf.GetRemainingImageCount() == 0);
+   for (unsigned char v = 1; v <= 8; ++v)
+   {
+      const std::vector<unsigned char> pixels(frameBytes / 2, v);
+      Metadata md;
+      md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+      REQUIRE(cbuf.InsertImage(pixels.data(), width / 2, height, depth, &md));
+   }
+   for (unsigned char v = 1; v <= 8; ++v)
+   {
+      const mm::ImgBuffer* img = cbuf.GetNextImageBuffer(0);
+      REQUIRE(img != 0);
+      CHECK(img->Width() == width / 2);
+      CHECK(img->GetPixels()[0] == v);
+      CHECK(img->GetPixels()[frameBytes / 2 - 1] == v);
+   }
+
+   // Back to the original geometry; a 2-channel frame takes two images
+   REQUIRE(cbuf.Initialize(2, width, height, depth));
+   CHECK(cbuf.GetSize() == 2);
+   const std::vector<unsigned char> pixels(2 * frameBytes, 3);
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   REQUIRE(cbuf.InsertMultiChannel(pixels.data(), 2, width, height, depth, &md));
+   const mm::ImgBuffer* ch0 = cbuf.GetTopImageBuffer(0);
+   const mm::ImgBuffer* ch1 = cbuf.GetTopImageBuffer(1);
+   REQUIRE(ch0 != 0);
+   REQUIRE(ch1 != 0);
+   CHECK(ch1->GetPixels() >= ch0->GetPixels() + frameBytes);
+   CHECK(ch1->GetPixels()[frameBytes - 1] == 3);
+
+   const std::vector<unsigned char> tooMany(3 * frameBytes, 4);
+   CHECK_THROWS_AS(cbuf.InsertMultiChannel(tooMany.data(), 3, width, height,
+            depth, &md), CMMError);
+}
+
+TEST_CASE("CircularBuffer re-slicing waits for short pins", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2);
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   REQUIRE(Insert(cbuf, 1));
+   unsigned long slot;
+   REQUIRE(cbuf.PinTopImageBuffer(0, slot) != 0);
+
+   std::thread unpinner([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      cbuf.UnpinImageBuffer(slot);
+   });
+   CHECK(cbuf.Initialize(1, width / 2, height, depth));
+   unpinner.join();
+   CHECK(cbuf.Width() == width / 2);
+
+   // But not forever
+   const std::vector<unsigned char> half(frameBytes / 2, 2);
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   REQUIRE(cbuf.InsertImage(half.data(), width / 2, height, depth, &md));
+   REQUIRE(cbuf.PinTopImageBuffer(0, slot) != 0);
+   CHECK_FALSE(cbuf.Initialize(1, width, height, depth));
+   cbuf.UnpinImageBuffer(slot);
+}
+
+TEST_CASE("CircularBuffer with prefaulted memory", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(4, true, true);
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   REQUIRE(Insert(cbuf, 7));
+   const mm::ImgBuffer* img = cbuf.GetTopImageBuffer(0);
+   REQUIRE(img != 0);
+   CHECK(img->GetPixels()[frameBytes - 1] == 7);
+}
+
+namespace {
+
+long ImageNumber(const mm::ImgBuffer* img)
+{
+   return std::stol(img->GetMetadata().GetSingleTag(
+         MM::g_Keyword_Metadata_ImageNumber).GetValue());
+}
+
+} // anonymous namespace
+
+TEST_CASE("CircularBuffer overflow policies", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2); // Room for 4 frames
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   CHECK(cbuf.GetOverflowPolicy() == CircularBuffer::OverflowStop);
+
+   SECTION("Stop")
+   {
+      for (unsigned char v = 0; v < 4; ++v)
+         REQUIRE(Insert(cbuf, v));
+      CHECK_FALSE(Insert(cbuf, 4));
+      CHECK(cbuf.Overflow());
+      CHECK(cbuf.GetStatistics().droppedImages == 1);
+   }
+
+   SECTION("Clear")
+   {
+      cbuf.SetOverflowPolicy(CircularBuffer::OverflowClear);
+      for (unsigned char v = 0; v < 6; ++v)
+         REQUIRE(Insert(cbuf, v));
+      CHECK_FALSE(cbuf.Overflow());
+      CHECK(cbuf.GetRemainingImageCount() == 2);
+      const mm::ImgBuffer* img = cbuf.GetNextImageBuffer(0);
+      CHECK(img->GetPixels()[0] == 4);
+      CHECK(ImageNumber(img) == 4);
+      CHECK(img->GetMetadata().GetSingleTag(
+               MM::g_Keyword_Metadata_DroppedImages).GetValue() == "4");
+      CircularBuffer::Statistics stats = cbuf.GetStatistics();
+      CHECK(stats.insertedImages == 6);
+      CHECK(stats.droppedImages == 4);
+      CHECK(stats.overflows == 1);
+      CHECK(stats.imageNumberGaps == 1);
+   }
+
+   SECTION("Discarding unread images keeps the statistics")
+   {
+      for (unsigned char v = 0; v < 3; ++v)
+         REQUIRE(Insert(cbuf, v));
+      cbuf.DiscardAllUnread();
+      CHECK(cbuf.GetRemainingImageCount() == 0);
+      REQUIRE(Insert(cbuf, 3));
+      const mm::ImgBuffer* img = cbuf.GetNextImageBuffer(0);
+      CHECK(ImageNumber(img) == 3);
+      CircularBuffer::Statistics stats = cbuf.GetStatistics();
+      CHECK(stats.insertedImages == 4);
+      CHECK(stats.droppedImages == 3);
+      CHECK(stats.imageNumberGaps == 1);
+   }
+
+   SECTION("OverwriteOldest")
+   {
+      cbuf.SetOverflowPolicy(CircularBuffer::OverflowOverwriteOldest);
+      for (unsigned char v = 0; v < 6; ++v)
+         REQUIRE(Insert(cbuf, v));
+      CHECK(cbuf.GetRemainingImageCount() == 4);
+      for (unsigned char v = 2; v < 6; ++v)
+      {
+         const mm::ImgBuffer* img = cbuf.GetNextImageBuffer(0);
+         CHECK(img->GetPixels()[0] == v);
+         CHECK(ImageNumber(img) == v);
+      }
+      CircularBuffer::Statistics stats = cbuf.GetStatistics();
+      CHECK(stats.droppedImages == 2);
+      CHECK(stats.overflows == 2);
+      CHECK(stats.imageNumberGaps == 1);
+
+      // Cleared at the start of an acquisition
+      cbuf.Clear();
+      CHECK(cbuf.GetStatistics().droppedImages == 0);
+   }
+
+   SECTION("DropNewest")
+   {
+      cbuf.SetOverflowPolicy(CircularBuffer::OverflowDropNewest);
+      for (unsigned char v = 0; v < 6; ++v)
+         REQUIRE(Insert(cbuf, v));
+      CHECK_FALSE(cbuf.Overflow());
+      for (unsigned char v = 0; v < 4; ++v)
+         CHECK(cbuf.GetNextImageBuffer(0)->GetPixels()[0] == v);
+      REQUIRE(Insert(cbuf, 6));
+      const mm::ImgBuffer* img = cbuf.GetNextImageBuffer(0);
+      CHECK(img->GetPixels()[0] == 6);
+      CHECK(ImageNumber(img) == 6); // Numbers 4 and 5 were dropped
+      CircularBuffer::Statistics stats = cbuf.GetStatistics();
+      CHECK(stats.droppedImages == 2);
+      CHECK(stats.imageNumberGaps == 1);
+   }
+
+   SECTION("Pinned images are never overwritten")
+   {
+      cbuf.SetOverflowPolicy(CircularBuffer::OverflowOverwriteOldest);
+      REQUIRE(Insert(cbuf, 0));
+      unsigned long slot;
+      const mm::ImgBuffer* pinned = cbuf.PinNextImageBuffer(0, slot);
+      REQUIRE(pinned != 0);
+      for (unsigned char v = 1; v < 8; ++v)
+         REQUIRE(Insert(cbuf, v));
+      CHECK(pinned->GetPixels()[0] == 0);
+      CHECK(cbuf.GetStatistics().droppedImages > 0);
+      cbuf.UnpinImageBuffer(slot);
+   }
+}
+
+TEST_CASE("CircularBuffer packed storage", "[CircularBuffer]")
+{
+   std::vector<unsigned short> ramp(width * height);
+   for (std::size_t i = 0; i < ramp.size(); ++i)
+      ramp[i] = static_cast<unsigned short>(i * 7 % 4096);
+   const unsigned char* pixels = reinterpret_cast<const unsigned char*>(ramp.data());
+   const auto matches = [&](const mm::ImgBuffer* img) {
+      return img && img->Depth() == 2 &&
+         std::equal(ramp.begin(), ramp.end(),
+               reinterpret_cast<const unsigned short*>(img->GetPixels()));
+   };
+
+   CircularBuffer cbuf(2);
+   cbuf.SetPackedStorage(true);
+
+   // 16-bit images are stored packed only below 16 bits per pixel
+   REQUIRE(cbuf.Initialize(1, width, height, depth, 16));
+   CHECK(cbuf.GetPackedBitDepth() == 0);
+   CHECK(cbuf.GetSize() == 4);
+
+   REQUIRE(cbuf.Initialize(1, width, height, depth, 12));
+   CHECK(cbuf.GetPackedBitDepth() == 12);
+   CHECK(cbuf.GetSize() == 5); // 384 KiB per image
+
+   // The bit depth is kept when not given
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   CHECK(cbuf.GetPackedBitDepth() == 12);
+
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   for (int i = 0; i < 3; ++i)
+      REQUIRE(cbuf.InsertImage(pixels, width, height, depth, &md));
+
+   CHECK(matches(cbuf.GetTopImageBuffer(0)));
+   CHECK(cbuf.GetTopImageBuffer(0)->GetMetadata().GetSingleTag(
+            MM::g_Keyword_Metadata_ImageNumber).GetValue() == "2");
+
+   unsigned long nextSlot, topSlot;
+   const mm::ImgBuffer* pinned = cbuf.PinNextImageBuffer(0, nextSlot);
+   CHECK(matches(pinned));
+   CHECK(cbuf.PinTopImageBuffer(0, topSlot) != pinned);
+   cbuf.UnpinImageBuffer(topSlot);
+   CHECK(matches(cbuf.GetNextImageBuffer(0)));
+   CHECK(matches(pinned)); // Not affected by other reads
+   cbuf.UnpinImageBuffer(nextSlot);
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+
+   // Each reading thread unpacks into its own scratch images
+   const mm::ImgBuffer* top = cbuf.GetTopImageBuffer(0);
+   const mm::ImgBuffer* otherTop = 0;
+   std::thread([&] { otherTop = cbuf.GetTopImageBuffer(0); }).join();
+   CHECK(otherTop != top);
+   CHECK(matches(otherTop));
+
+   // Takes effect at the next Initialize()
+   cbuf.SetPackedStorage(false);
+   CHECK(cbuf.GetPackedBitDepth() == 12);
+   REQUIRE(cbuf.Initialize(1, width, height, depth));
+   CHECK(cbuf.GetPackedBitDepth() == 0);
+   CHECK(cbuf.GetSize() == 4);
+}
+
+TEST_CASE("CircularBuffer image statistics", "[CircularBuffer]")
+{
+   CircularBuffer cbuf(2);
+   REQUIRE(cbuf.Initialize(1, width, height, depth, 12));
+   mm::PixelStatistics::Result stats;
+
+   // Off by default
+   REQUIRE(Insert(cbuf, 1));
+   CHECK_FALSE(cbuf.GetLastImageStatistics(0, stats));
+   Metadata stored = cbuf.GetTopImageBuffer(0)->GetMetadata();
+   CHECK_FALSE(stored.HasTag(MM::g_Keyword_Metadata_StatisticsMean));
+
+   cbuf.SetImageStatistics(true, 16);
+   std::vector<unsigned short> pixels(width * height, 100);
+   pixels[0] = 4095;
+   pixels[1] = 5000; // Above the bit depth
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   REQUIRE(cbuf.InsertImage(reinterpret_cast<const unsigned char*>(pixels.data()),
+            width, height, depth, &md));
+
+   REQUIRE(cbuf.GetLastImageStatistics(0, stats));
+   CHECK(stats.sampleCount == width * height);
+   CHECK(stats.minimum == 100);
+   CHECK(stats.maximum == 5000);
+   CHECK(stats.saturatedCount == 2);
+   REQUIRE(stats.histogram.size() == 16);
+   CHECK(stats.histogram[0] == width * height - 2);
+   CHECK(stats.histogram[15] == 2);
+   CHECK_FALSE(cbuf.GetLastImageStatistics(1, stats));
+
+   stored = cbuf.GetTopImageBuffer(0)->GetMetadata();
+   CHECK(stored.GetSingleTag(MM::g_Keyword_Metadata_StatisticsMin).GetValue() == "100");
+   CHECK(stored.GetSingleTag(MM::g_Keyword_Metadata_StatisticsMax).GetValue() == "5000");
+   CHECK(stored.GetSingleTag(MM::g_Keyword_Metadata_StatisticsSaturated).GetValue() == "2");
+   const MetadataArrayTag histogram =
+      stored.GetArrayTag(MM::g_Keyword_Metadata_StatisticsHistogram);
+   REQUIRE(histogram.GetSize() == 16);
+   CHECK(histogram.GetValue(15) == "2");
+
+   cbuf.Clear();
+   CHECK_FALSE(cbuf.GetLastImageStatistics(0, stats));
+}
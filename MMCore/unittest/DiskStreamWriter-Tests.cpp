@@ -0,0 +1,253 @@
+#include <catch2/catch_all.hpp>
+
+#include "CircularBuffer.h"
+#include "DiskStreamWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string TempBasePath(const char* name)
+{
+#ifdef _WIN32
+   const char* dir = std::getenv("TEMP");
+#else
+   const char* dir = std::getenv("TMPDIR");
+   if (!dir)
+      dir = "/tmp";
+#endif
+   return std::string(dir ? dir : ".") + "/mmcore-test-" + name;
+}
+
+std::string ReadFile(const std::string& path)
+{
+   std::ifstream f(path.c_str(), std::ios::binary);
+   return std::string(std::istreambuf_iterator<char>(f),
+         std::istreambuf_iterator<char>());
+}
+
+bool Insert(CircularBuffer& cbuf, unsigned width, unsigned height,
+      unsigned char value)
+{
+   const std::vector<unsigned char> pixels(width * height * 2, value);
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   return cbuf.InsertImage(pixels.data(), width, height, 2, &md);
+}
+
+} // anonymous namespace
+
+TEST_CASE("DiskStreamWriter writes buffered images and an index", "[DiskStreamWriter]")
+{
+   // Odd size, so that images straddle the aligned staging blocks
+   const unsigned width = 1001, height = 999;
+   const std::size_t imageBytes = width * height * 2;
+   const int imageCount = 12;
+
+   CircularBuffer cbuf(32);
+   REQUIRE(cbuf.Initialize(1, width, height, 2));
+   const std::string base = TempBasePath("stream");
+   {
+      mm::DiskStreamWriter writer(cbuf, base, 2);
+      CHECK(writer.IsActive());
+      for (int i = 0; i < imageCount; ++i)
+         REQUIRE(Insert(cbuf, width, height, static_cast<unsigned char>(i + 1)));
+      writer.Stop();
+      CHECK_FALSE(writer.IsActive());
+      CHECK(writer.ImageCount() == imageCount);
+   }
+   CHECK(cbuf.GetRemainingImageCount() == 0);
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+
+   const std::string raw = ReadFile(base + ".raw");
+   REQUIRE(raw.size() == imageBytes * imageCount);
+   for (int i = 0; i < imageCount; ++i)
+   {
+      CHECK(raw[i * imageBytes] == i + 1);
+      CHECK(raw[(i + 1) * imageBytes - 1] == i + 1);
+   }
+
+   std::istringstream index(ReadFile(base + ".idx"));
+   std::string header;
+   std::getline(index, header);
+   CHECK(header == "MMSTREAM 2");
+   for (int i = 0; i < imageCount; ++i)
+   {
+      unsigned long long n, offset, bytes, metadataBytes;
+      unsigned channel, w, h, depth;
+      REQUIRE(index >> n >> channel >> offset >> bytes >> w >> h >> depth >> metadataBytes);
+      CHECK(n == static_cast<unsigned long long>(i));
+      CHECK(channel == 0);
+      CHECK(offset == i * imageBytes);
+      CHECK(bytes == imageBytes);
+      CHECK(w == width);
+      CHECK(h == height);
+      CHECK(depth == 2);
+      index.get(); // Newline
+      std::string serialized(metadataBytes, '\0');
+      index.read(&serialized[0], metadataBytes);
+      Metadata md;
+      REQUIRE(md.Restore(serialized.c_str()));
+      CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_ImageNumber).GetValue() ==
+            std::to_string(i));
+   }
+
+   std::remove((base + ".raw").c_str());
+   std::remove((base + ".idx").c_str());
+}
+
+TEST_CASE("DiskStreamWriter writes every channel of multi-channel frames", "[DiskStreamWriter]")
+{
+   const unsigned width = 64, height = 48, channels = 3;
+   const std::size_t imageBytes = width * height * 2;
+   const int frameCount = 5;
+
+   CircularBuffer cbuf(8);
+   REQUIRE(cbuf.Initialize(channels, width, height, 2));
+   const std::string base = TempBasePath("stream-channels");
+   {
+      mm::DiskStreamWriter writer(cbuf, base, 1);
+      for (int i = 0; i < frameCount; ++i)
+      {
+         std::vector<unsigned char> pixels(imageBytes * channels);
+         for (unsigned c = 0; c < channels; ++c)
+            std::fill(pixels.begin() + c * imageBytes,
+                  pixels.begin() + (c + 1) * imageBytes,
+                  static_cast<unsigned char>(10 * i + c));
+         Metadata md;
+         md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+         REQUIRE(cbuf.InsertMultiChannel(pixels.data(), channels, width,
+                  height, 2, &md));
+      }
+      writer.Stop();
+      CHECK(writer.ImageCount() == frameCount);
+   }
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+
+   const std::string raw = ReadFile(base + ".raw");
+   REQUIRE(raw.size() == imageBytes * channels * frameCount);
+   std::istringstream index(ReadFile(base + ".idx"));
+   std::string header;
+   std::getline(index, header);
+   for (int i = 0; i < frameCount; ++i)
+   {
+      for (unsigned c = 0; c < channels; ++c)
+      {
+         unsigned long long n, offset, bytes, metadataBytes;
+         unsigned channel, w, h, depth;
+         REQUIRE(index >> n >> channel >> offset >> bytes >> w >> h >> depth >> metadataBytes);
+         CHECK(n == static_cast<unsigned long long>(i));
+         CHECK(channel == c);
+         CHECK(offset == (i * channels + c) * imageBytes);
+         CHECK(raw[offset] == static_cast<char>(10 * i + c));
+         CHECK(raw[offset + bytes - 1] == static_cast<char>(10 * i + c));
+         index.ignore(metadataBytes + 2); // Newlines and metadata
+      }
+   }
+
+   std::remove((base + ".raw").c_str());
+   std::remove((base + ".idx").c_str());
+}
+
+TEST_CASE("DiskStreamWriter stops while images keep arriving", "[DiskStreamWriter]")
+{
+   const unsigned width = 1024, height = 1024;
+
+   CircularBuffer cbuf(64);
+   REQUIRE(cbuf.Initialize(1, width, height, 2));
+   cbuf.SetOverflowPolicy(CircularBuffer::OverflowOverwriteOldest);
+   // Touch every slot first, so that insertion runs at full speed
+   for (unsigned long i = 0; i < cbuf.GetSize(); ++i)
+      REQUIRE(Insert(cbuf, width, height, 1));
+   cbuf.Clear();
+   const std::string base = TempBasePath("stream-running");
+   {
+      mm::DiskStreamWriter writer(cbuf, base, 1);
+
+      // Keep the buffer from running empty, as a camera faster than the
+      // disk would, for up to 10 s
+      std::atomic<bool> stopInserting(false);
+      std::thread camera([&] {
+         const std::vector<unsigned char> pixels(width * height * 2, 1);
+         Metadata md;
+         md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+         const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::seconds(10);
+         while (!stopInserting && std::chrono::steady_clock::now() < deadline)
+         {
+            if (cbuf.GetRemainingImageCount() < 8)
+               cbuf.InsertImage(pixels.data(), width, height, 2, &md);
+            else
+               std::this_thread::yield();
+         }
+      });
+      while (writer.ImageCount() < 4)
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+      const auto start = std::chrono::steady_clock::now();
+      writer.Stop();
+      const auto stopTime = std::chrono::steady_clock::now() - start;
+      stopInserting = true;
+      camera.join();
+
+      CHECK(stopTime < std::chrono::seconds(5));
+      // Images inserted after Stop() are left to other readers
+      CHECK(cbuf.GetRemainingImageCount() > 0);
+   }
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+
+   std::remove((base + ".raw").c_str());
+   std::remove((base + ".idx").c_str());
+}
+
+TEST_CASE("DiskStreamWriter reports files that cannot be created", "[DiskStreamWriter]")
+{
+   CircularBuffer cbuf(8);
+   CHECK_THROWS_AS(mm::DiskStreamWriter(cbuf,
+            TempBasePath("no-such-dir/stream"), 1), CMMError);
+}
+
+// Not run by default; run with the tag [.benchmark] to measure the sustained
+// bandwidth to the temporary directory (set TMPDIR to test another disk)
+TEST_CASE("DiskStreamWriter benchmark", "[.benchmark][DiskStreamWriter]")
+{
+   const unsigned width = 2048, height = 2048;
+   const int imageCount = 256; // 2 GiB
+   CircularBuffer cbuf(512);
+   cbuf.SetOverflowPolicy(CircularBuffer::OverflowStop);
+   REQUIRE(cbuf.Initialize(1, width, height, 2));
+   const std::string base = TempBasePath("stream-benchmark");
+
+   for (unsigned threads : { 1u, 2u, 4u })
+   {
+      cbuf.Clear();
+      mm::DiskStreamWriter writer(cbuf, base, threads);
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < imageCount; ++i)
+      {
+         // Wait while the buffer is full (the writer is the bottleneck)
+         while (!Insert(cbuf, width, height, static_cast<unsigned char>(i)))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      writer.Stop();
+      const std::chrono::duration<double> elapsed =
+         std::chrono::steady_clock::now() - start;
+      const double mb = writer.BytesWritten() / 1048576.0;
+      std::printf("%u writer thread(s), %s: %.0f MB in %.2f s = %.0f MB/s\n",
+            threads, writer.IsUnbuffered() ? "unbuffered" : "buffered",
+            mb, elapsed.count(), mb / elapsed.count());
+   }
+
+   std::remove((base + ".raw").c_str());
+   std::remove((base + ".idx").c_str());
+}
@@ -0,0 +1,202 @@
+#include <catch2/catch_all.hpp>
+
+#include "PixelStatistics.h"
+#include "TaskSet_PixelStatistics.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace mm::PixelStatistics;
+
+namespace {
+
+std::string ImplementationName(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto: return "auto";
+      case ImplementationScalar: return "scalar";
+      case ImplementationAVX2: return "AVX2";
+   }
+   return "?";
+}
+
+template <typename T>
+std::vector<T> RandomSamples(std::size_t n, unsigned maxValue)
+{
+   std::mt19937 gen(42);
+   std::uniform_int_distribution<unsigned> dist(0, maxValue);
+   std::vector<T> samples(n);
+   for (std::size_t i = 0; i < n; ++i)
+      samples[i] = static_cast<T>(dist(gen));
+   return samples;
+}
+
+template <typename T>
+Result ComputeSamples(const std::vector<T>& samples, unsigned bitDepth,
+      unsigned bins, Implementation impl)
+{
+   return Compute(reinterpret_cast<const unsigned char*>(samples.data()),
+         samples.size(), sizeof(T), 1, bitDepth, bins, impl);
+}
+
+void CheckEqual(const Result& a, const Result& b)
+{
+   CHECK(a.sampleCount == b.sampleCount);
+   CHECK(a.minimum == b.minimum);
+   CHECK(a.maximum == b.maximum);
+   // The sums are exact, so only the final division may differ
+   CHECK(std::fabs(a.mean - b.mean) <= 1e-9 * b.mean);
+   CHECK(std::fabs(a.standardDeviation - b.standardDeviation) <=
+         1e-6 * b.standardDeviation);
+   CHECK(a.saturatedCount == b.saturatedCount);
+   CHECK(a.histogram == b.histogram);
+}
+
+} // anonymous namespace
+
+TEST_CASE("PixelStatistics of a small image", "[PixelStatistics]")
+{
+   const std::vector<std::uint16_t> samples = { 0, 1023, 1024, 4095, 4095, 65535 };
+   for (Implementation impl : { ImplementationScalar, ImplementationAuto })
+   {
+      CAPTURE(ImplementationName(impl));
+      const Result r = ComputeSamples(samples, 12, 4, impl);
+      CHECK(r.sampleCount == 6);
+      CHECK(r.minimum == 0);
+      CHECK(r.maximum == 65535);
+      CHECK(r.mean == (1023.0 + 1024 + 4095 + 4095 + 65535) / 6);
+      CHECK(r.saturatedCount == 3);
+      // 1024-wide bins; values above 4095 go in the last bin
+      CHECK(r.histogram == std::vector<unsigned long long>({ 2, 1, 0, 3 }));
+   }
+
+   const std::vector<std::uint8_t> constant(100, 7);
+   const Result r = ComputeSamples(constant, 0, 0, ImplementationAuto);
+   CHECK(r.mean == 7.0);
+   CHECK(r.standardDeviation == 0.0);
+   CHECK(r.saturatedCount == 0);
+   CHECK(r.histogram.empty());
+
+   const Result empty = ComputeSamples(std::vector<std::uint8_t>(), 8, 2, ImplementationAuto);
+   CHECK(empty.sampleCount == 0);
+   CHECK(empty.minimum == 0);
+   CHECK(empty.mean == 0.0);
+}
+
+TEST_CASE("PixelStatistics standard deviation", "[PixelStatistics]")
+{
+   // Alternating 1000 and 3000: mean 2000, standard deviation 1000
+   std::vector<std::uint16_t> samples(1000);
+   for (std::size_t i = 0; i < samples.size(); ++i)
+      samples[i] = i % 2 ? 3000 : 1000;
+   const Result r = ComputeSamples(samples, 16, 0, ImplementationAuto);
+   CHECK(r.mean == 2000.0);
+   CHECK(r.standardDeviation == 1000.0);
+}
+
+TEST_CASE("PixelStatistics of color images ignore alpha", "[PixelStatistics]")
+{
+   CHECK(IsSupported(4, 4));
+   CHECK_FALSE(IsSupported(4, 1));
+   CHECK_FALSE(IsSupported(8, 4));
+
+   std::vector<std::uint8_t> pixels;
+   for (int i = 0; i < 10; ++i)
+   {
+      pixels.push_back(10); // B
+      pixels.push_back(20); // G
+      pixels.push_back(255); // R
+      pixels.push_back(0); // Alpha
+   }
+   const Result r = Compute(pixels.data(), 10, 4, 4, 8, 2);
+   CHECK(r.sampleCount == 30);
+   CHECK(r.minimum == 10);
+   CHECK(r.maximum == 255);
+   CHECK(r.saturatedCount == 10);
+   CHECK(r.histogram == std::vector<unsigned long long>({ 20, 10 }));
+}
+
+TEST_CASE("PixelStatistics SIMD matches scalar", "[PixelStatistics]")
+{
+   if (!IsImplementationAvailable(ImplementationAVX2))
+   {
+      WARN("AVX2 not available on this CPU");
+      return;
+   }
+
+   // Sizes around the SIMD block sizes
+   for (std::size_t n : { std::size_t(1), std::size_t(15), std::size_t(16),
+         std::size_t(33), std::size_t(4095), std::size_t(4096),
+         std::size_t(4097), std::size_t(100003) })
+   {
+      CAPTURE(n);
+      const std::vector<std::uint16_t> samples16 = RandomSamples<std::uint16_t>(n, 65535);
+      for (unsigned bits : { 10u, 16u })
+      {
+         CAPTURE(bits);
+         CheckEqual(ComputeSamples(samples16, bits, 64, ImplementationAVX2),
+               ComputeSamples(samples16, bits, 64, ImplementationScalar));
+      }
+      const std::vector<std::uint8_t> samples8 = RandomSamples<std::uint8_t>(n, 255);
+      CheckEqual(ComputeSamples(samples8, 8, 256, ImplementationAVX2),
+            ComputeSamples(samples8, 8, 256, ImplementationScalar));
+      CheckEqual(ComputeSamples(samples8, 6, 8, ImplementationAVX2),
+            ComputeSamples(samples8, 6, 8, ImplementationScalar));
+   }
+
+   // Full-scale images large enough to overflow narrow lane sums
+   const std::vector<std::uint16_t> bright16(3000000, 65535);
+   const Result r16 = ComputeSamples(bright16, 16, 4, ImplementationAVX2);
+   CHECK(r16.mean == 65535.0);
+   CHECK(r16.saturatedCount == bright16.size());
+   CheckEqual(r16, ComputeSamples(bright16, 16, 4, ImplementationScalar));
+   const std::vector<std::uint8_t> bright8(3000000, 255);
+   CheckEqual(ComputeSamples(bright8, 8, 4, ImplementationAVX2),
+         ComputeSamples(bright8, 8, 4, ImplementationScalar));
+}
+
+TEST_CASE("PixelStatistics task set matches single-threaded", "[PixelStatistics]")
+{
+   auto pool = std::make_shared<ThreadPool>();
+   TaskSet_PixelStatistics tasks(pool);
+   for (std::size_t n : { std::size_t(1000), std::size_t(4100007) })
+   {
+      CAPTURE(n);
+      const std::vector<std::uint16_t> samples = RandomSamples<std::uint16_t>(n, 4095);
+      CheckEqual(tasks.Compute(reinterpret_cast<const unsigned char*>(samples.data()),
+                  n, 2, 1, 12, 256),
+            ComputeSamples(samples, 12, 256, ImplementationAuto));
+   }
+}
+
+// Not run by default; run with the tag [.benchmark] to compare throughput
+TEST_CASE("PixelStatistics benchmark", "[.benchmark][PixelStatistics]")
+{
+   const std::size_t n = 2048 * 2048;
+   const std::vector<std::uint16_t> samples16 = RandomSamples<std::uint16_t>(n, 4095);
+   const std::vector<std::uint8_t> samples8 = RandomSamples<std::uint8_t>(n, 255);
+   for (Implementation impl : { ImplementationScalar, ImplementationAVX2 })
+   {
+      if (!IsImplementationAvailable(impl))
+         continue;
+      for (unsigned bins : { 0u, 256u })
+      {
+         const std::string name = " 2048x2048, " + std::to_string(bins) +
+            " bins, " + ImplementationName(impl);
+         BENCHMARK("16-bit" + name)
+         {
+            return ComputeSamples(samples16, 12, bins, impl).maximum;
+         };
+         BENCHMARK("8-bit" + name)
+         {
+            return ComputeSamples(samples8, 8, bins, impl).maximum;
+         };
+      }
+   }
+}
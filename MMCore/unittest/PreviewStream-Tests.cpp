@@ -0,0 +1,160 @@
+#include <catch2/catch_all.hpp>
+
+#include "CircularBuffer.h"
+#include "PreviewStream.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool WaitForPreview(const mm::PreviewStream& preview, unsigned long long count)
+{
+   for (int i = 0; i < 2000 && preview.ImageCount() < count; ++i)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   return preview.ImageCount() >= count;
+}
+
+bool Insert(CircularBuffer& cbuf, const std::vector<std::uint16_t>& pixels,
+      unsigned width, unsigned height)
+{
+   Metadata md;
+   md.PutImageTag<std::string>(MM::g_Keyword_Metadata_CameraLabel, "Camera");
+   return cbuf.InsertImage(reinterpret_cast<const unsigned char*>(pixels.data()),
+         width, height, 2, &md);
+}
+
+} // anonymous namespace
+
+TEST_CASE("BinImage averages blocks", "[PreviewStream]")
+{
+   SECTION("8-bit, with leftover rows and columns")
+   {
+      // 5x3 image binned by 2 gives 2x1
+      const std::vector<std::uint8_t> src = {
+         0, 2, 10, 20, 99,
+         4, 6, 30, 41, 99,
+         99, 99, 99, 99, 99,
+      };
+      std::vector<std::uint8_t> dst(2);
+      mm::BinImage(dst.data(), src.data(), 5, 3, 1, 1, 2);
+      CHECK(dst[0] == 3);
+      CHECK(dst[1] == 25); // 25.25
+   }
+
+   SECTION("16-bit, wider than a SIMD block")
+   {
+      const unsigned width = 37, height = 8, factor = 4;
+      std::vector<std::uint16_t> src(width * height);
+      for (unsigned y = 0; y < height; ++y)
+         for (unsigned x = 0; x < width; ++x)
+            src[y * width + x] = static_cast<std::uint16_t>(60000 + x / factor + y);
+      std::vector<std::uint16_t> dst((width / factor) * (height / factor));
+      mm::BinImage(reinterpret_cast<unsigned char*>(dst.data()),
+            reinterpret_cast<const unsigned char*>(src.data()),
+            width, height, 2, 1, factor);
+      for (unsigned y = 0; y < height / factor; ++y)
+         for (unsigned x = 0; x < width / factor; ++x)
+            CHECK(dst[y * (width / factor) + x] == 60000 + x + y * factor + 2); // 1.5 rounds up
+   }
+
+   SECTION("RGB32 components are averaged separately")
+   {
+      std::vector<std::uint8_t> src(4 * 4 * 4);
+      for (unsigned i = 0; i < 16; ++i)
+      {
+         src[4 * i] = 10;
+         src[4 * i + 1] = static_cast<std::uint8_t>(i % 2 ? 200 : 100);
+         src[4 * i + 2] = 255;
+         src[4 * i + 3] = 0;
+      }
+      std::vector<std::uint8_t> dst(4 * 2 * 2);
+      mm::BinImage(dst.data(), src.data(), 4, 4, 4, 4, 2);
+      for (unsigned i = 0; i < 4; ++i)
+      {
+         CHECK(dst[4 * i] == 10);
+         CHECK(dst[4 * i + 1] == 150);
+         CHECK(dst[4 * i + 2] == 255);
+         CHECK(dst[4 * i + 3] == 0);
+      }
+   }
+
+   SECTION("32-bit grayscale is subsampled")
+   {
+      const std::vector<float> src = {
+         1.5f, 2.0f, 3.0f, 4.0f,
+         5.0f, 6.0f, 7.0f, 8.0f,
+      };
+      std::vector<float> dst(2);
+      mm::BinImage(reinterpret_cast<unsigned char*>(dst.data()),
+            reinterpret_cast<const unsigned char*>(src.data()), 4, 2, 4, 1, 2);
+      CHECK(dst[0] == 1.5f);
+      CHECK(dst[1] == 3.0f);
+   }
+}
+
+TEST_CASE("PreviewStream bins the newest image", "[PreviewStream]")
+{
+   const unsigned width = 64, height = 48;
+   CircularBuffer cbuf(8);
+   REQUIRE(cbuf.Initialize(1, width, height, 2));
+   mm::PreviewStream preview(cbuf, 4, 1000.0);
+
+   std::vector<std::uint16_t> pixels(width * height, 1000);
+   REQUIRE(Insert(cbuf, pixels, width, height));
+   REQUIRE(WaitForPreview(preview, 1));
+
+   std::vector<unsigned char> binned;
+   unsigned w, h, bytesPerPixel, nComponents;
+   Metadata md;
+   REQUIRE(preview.GetLatest(binned, w, h, bytesPerPixel, nComponents, md));
+   CHECK(w == width / 4);
+   CHECK(h == height / 4);
+   CHECK(bytesPerPixel == 2);
+   CHECK(nComponents == 1);
+   REQUIRE(binned.size() == w * h * 2);
+   std::uint16_t value;
+   std::memcpy(&value, binned.data(), 2);
+   CHECK(value == 1000);
+   CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_Width).GetValue() == "16");
+   CHECK(md.GetSingleTag(MM::g_Keyword_Metadata_ImageNumber).GetValue() == "0");
+
+   // The preview leaves the image in the buffer, and no pins behind
+   CHECK(cbuf.GetRemainingImageCount() == 1);
+   CHECK(cbuf.GetPinnedImageCount() == 0);
+
+   // No new image, no new preview
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   CHECK(preview.ImageCount() == 1);
+
+   std::fill(pixels.begin(), pixels.end(), 2000);
+   REQUIRE(Insert(cbuf, pixels, width, height));
+   REQUIRE(WaitForPreview(preview, 2));
+   REQUIRE(preview.GetLatest(binned, w, h, bytesPerPixel, nComponents, md));
+   std::memcpy(&value, binned.data(), 2);
+   CHECK(value == 2000);
+}
+
+TEST_CASE("PreviewStream limits its frame rate", "[PreviewStream]")
+{
+   const unsigned width = 32, height = 32;
+   CircularBuffer cbuf(8);
+   cbuf.SetOverflowPolicy(CircularBuffer::OverflowOverwriteOldest);
+   REQUIRE(cbuf.Initialize(1, width, height, 2));
+   const std::vector<std::uint16_t> pixels(width * height, 7);
+
+   mm::PreviewStream preview(cbuf, 2, 10.0);
+   const auto start = std::chrono::steady_clock::now();
+   while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(450))
+   {
+      REQUIRE(Insert(cbuf, pixels, width, height));
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+   // Images at about 0, 100, 200, 300, 400 ms
+   CHECK(preview.ImageCount() >= 3);
+   CHECK(preview.ImageCount() <= 6);
+}
@@ -0,0 +1,200 @@
+#include <catch2/catch_all.hpp>
+
+#include "Error.h"
+#include "SequencePlan.h"
+
+#include <string>
+#include <vector>
+
+namespace mm {
+
+namespace {
+
+const SequenceTarget filter(SequenceTarget::Property, "Filter", "Label");
+const SequenceTarget shutter(SequenceTarget::Property, "Shutter", "State");
+const SequenceTarget z(SequenceTarget::Stage, "Z");
+const SequenceTarget exposure(SequenceTarget::Exposure, "Camera");
+
+FrameSettings Channel(const std::string& filterValue, double exposure_ms)
+{
+   FrameSettings channel;
+   channel[filter] = filterValue;
+   channel[exposure] = FormatSequenceValue(exposure_ms);
+   return channel;
+}
+
+SequencePlanSpec TwoChannelsThreeSlices()
+{
+   SequencePlanSpec spec;
+   spec.channels.push_back(Channel("DAPI", 10.0));
+   spec.channels.push_back(Channel("FITC", 20.0));
+   spec.focusStage = "Z";
+   spec.focusPositions = { 0.0, 0.5, 1.0 };
+   return spec;
+}
+
+} // anonymous namespace
+
+TEST_CASE("ExpandSequencePlan orders channels within slices", "[SequencePlan]")
+{
+   SequencePlanSpec spec = TwoChannelsThreeSlices();
+   std::vector<FrameSettings> frames = ExpandSequencePlan(spec);
+   REQUIRE(frames.size() == 6);
+   CHECK(frames[0].at(filter) == "DAPI");
+   CHECK(frames[1].at(filter) == "FITC");
+   CHECK(frames[1].at(z) == "0");
+   CHECK(frames[2].at(z) == "0.5");
+
+   spec.channelsFirst = false;
+   frames = ExpandSequencePlan(spec);
+   REQUIRE(frames.size() == 6);
+   CHECK(frames[2].at(filter) == "DAPI");
+   CHECK(frames[3].at(filter) == "FITC");
+   CHECK(frames[3].at(z) == "0");
+}
+
+TEST_CASE("ExpandSequencePlan repeats time points", "[SequencePlan]")
+{
+   SequencePlanSpec spec = TwoChannelsThreeSlices();
+   spec.timePoints = 3;
+   const std::vector<FrameSettings> frames = ExpandSequencePlan(spec);
+   REQUIRE(frames.size() == 18);
+   CHECK(frames[6] == frames[0]);
+   CHECK(frames[17] == frames[5]);
+}
+
+TEST_CASE("ExpandSequencePlan without channels or focus", "[SequencePlan]")
+{
+   SequencePlanSpec spec;
+   spec.focusStage = "Z";
+   spec.focusPositions = { 1.0, 2.0 };
+   CHECK(ExpandSequencePlan(spec).size() == 2);
+
+   spec = SequencePlanSpec();
+   spec.channels.push_back(Channel("DAPI", 10.0));
+   const std::vector<FrameSettings> frames = ExpandSequencePlan(spec);
+   REQUIRE(frames.size() == 1);
+   CHECK(frames[0].count(z) == 0);
+}
+
+TEST_CASE("CompileSequencePlan fully sequenceable plan is one chunk", "[SequencePlan]")
+{
+   const std::vector<FrameSettings> frames = ExpandSequencePlan(TwoChannelsThreeSlices());
+   SequenceCapabilities caps;
+   caps[filter] = 100;
+   caps[z] = 100;
+   caps[exposure] = 100;
+
+   const std::vector<SequenceChunk> chunks = CompileSequencePlan(frames, caps);
+   REQUIRE(chunks.size() == 1);
+   CHECK(chunks[0].firstFrame == 0);
+   CHECK(chunks[0].frameCount == 6);
+   CHECK(chunks[0].constants.empty());
+   REQUIRE(chunks[0].sequences.size() == 3);
+   CHECK(chunks[0].sequences.at(filter) ==
+         std::vector<std::string>({ "DAPI", "FITC", "DAPI", "FITC", "DAPI", "FITC" }));
+   CHECK(chunks[0].sequences.at(z) ==
+         std::vector<std::string>({ "0", "0", "0.5", "0.5", "1", "1" }));
+}
+
+TEST_CASE("CompileSequencePlan splits where a fixed device changes", "[SequencePlan]")
+{
+   SequencePlanSpec spec = TwoChannelsThreeSlices();
+   spec.channelsFirst = false;
+   const std::vector<FrameSettings> frames = ExpandSequencePlan(spec);
+   SequenceCapabilities caps;
+   caps[filter] = 0;
+   caps[z] = 100;
+   caps[exposure] = 0;
+
+   const std::vector<SequenceChunk> chunks = CompileSequencePlan(frames, caps);
+   REQUIRE(chunks.size() == 2);
+   for (const SequenceChunk& chunk : chunks)
+   {
+      CHECK(chunk.frameCount == 3);
+      CHECK(chunk.constants.size() == 2);
+      REQUIRE(chunk.sequences.size() == 1);
+      CHECK(chunk.sequences.count(z) == 1);
+   }
+   CHECK(chunks[0].constants.at(filter) == "DAPI");
+   CHECK(chunks[1].constants.at(filter) == "FITC");
+   CHECK(chunks[1].firstFrame == 3);
+}
+
+TEST_CASE("CompileSequencePlan splits at the maximum sequence length", "[SequencePlan]")
+{
+   SequencePlanSpec spec;
+   spec.focusStage = "Z";
+   for (int i = 0; i < 10; ++i)
+      spec.focusPositions.push_back(0.1 * i);
+   SequenceCapabilities caps;
+   caps[z] = 4;
+
+   const std::vector<SequenceChunk> chunks =
+      CompileSequencePlan(ExpandSequencePlan(spec), caps);
+   REQUIRE(chunks.size() == 3);
+   CHECK(chunks[0].frameCount == 4);
+   CHECK(chunks[1].frameCount == 4);
+   CHECK(chunks[2].frameCount == 2);
+   CHECK(chunks[2].firstFrame == 8);
+   CHECK(chunks[2].sequences.at(z).size() == 2);
+}
+
+TEST_CASE("CompileSequencePlan keeps constant devices out of sequences", "[SequencePlan]")
+{
+   SequencePlanSpec spec = TwoChannelsThreeSlices();
+   for (FrameSettings& channel : spec.channels)
+      channel[shutter] = "1";
+   SequenceCapabilities caps;
+   caps[filter] = 100;
+   caps[z] = 100;
+   caps[exposure] = 100;
+   caps[shutter] = 0;
+
+   const std::vector<SequenceChunk> chunks =
+      CompileSequencePlan(ExpandSequencePlan(spec), caps);
+   REQUIRE(chunks.size() == 1);
+   CHECK(chunks[0].constants.size() == 1);
+   CHECK(chunks[0].constants.at(shutter) == "1");
+   CHECK(chunks[0].sequences.count(shutter) == 0);
+}
+
+TEST_CASE("CompileSequencePlan with nothing sequenceable gives a chunk per change", "[SequencePlan]")
+{
+   SequenceCapabilities caps;
+   caps[filter] = 0;
+   caps[z] = 0;
+   caps[exposure] = 0;
+
+   const std::vector<SequenceChunk> chunks =
+      CompileSequencePlan(ExpandSequencePlan(TwoChannelsThreeSlices()), caps);
+   CHECK(chunks.size() == 6);
+   for (const SequenceChunk& chunk : chunks)
+      CHECK(chunk.sequences.empty());
+}
+
+TEST_CASE("CompileSequencePlan rejects missing capabilities", "[SequencePlan]")
+{
+   SequenceCapabilities caps;
+   caps[filter] = 100;
+   CHECK_THROWS_AS(CompileSequencePlan(ExpandSequencePlan(TwoChannelsThreeSlices()), caps),
+         CMMError);
+}
+
+TEST_CASE("CompileSequencePlan rejects inconsistent frames", "[SequencePlan]")
+{
+   std::vector<FrameSettings> frames(2);
+   frames[0][filter] = "DAPI";
+   frames[1][z] = "0";
+   SequenceCapabilities caps;
+   caps[filter] = 100;
+   caps[z] = 100;
+   CHECK_THROWS_AS(CompileSequencePlan(frames, caps), CMMError);
+}
+
+TEST_CASE("CompileSequencePlan of no frames is empty", "[SequencePlan]")
+{
+   CHECK(CompileSequencePlan(std::vector<FrameSettings>(), SequenceCapabilities()).empty());
+}
+
+} // namespace mm
@@ -0,0 +1,253 @@
+#include <catch2/catch_all.hpp>
+
+#ifndef _WIN32
+
+#include "Error.h"
+#include "SharedFrameRing.h"
+#include "SharedFrames/SharedFrameReader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace mm {
+
+namespace {
+
+std::string TestSegmentName(const char* suffix)
+{
+   return "/mmcore-test-" + std::to_string(getpid()) + "-" + suffix;
+}
+
+const std::size_t segmentSize = 1 << 20;
+
+std::vector<unsigned char> Image(std::size_t size, unsigned char value)
+{
+   return std::vector<unsigned char>(size, value);
+}
+
+void Publish(SharedFrameRing& ring, unsigned width, unsigned height,
+      unsigned char value, const std::string& md = std::string())
+{
+   const std::vector<unsigned char> img = Image(width * height * 2, value);
+   REQUIRE(ring.Publish(img.data(), width, height, 2, 1, 0, md));
+}
+
+struct ReaderGuard
+{
+   MMSFReader* reader;
+   explicit ReaderGuard(const std::string& name) : reader(0)
+   {
+      REQUIRE(mmsf_open(name.c_str(), &reader) == MMSF_OK);
+   }
+   ~ReaderGuard() { mmsf_close(reader); }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Shared frames round-trip through the reader", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("roundtrip");
+   SharedFrameRing ring(name, segmentSize);
+   ReaderGuard r(name);
+   CHECK(mmsf_writer_open(r.reader));
+   CHECK(mmsf_frames_published(r.reader) == 0);
+
+   std::vector<unsigned char> img(64 * 32 * 4);
+   for (std::size_t i = 0; i < img.size(); ++i)
+      img[i] = static_cast<unsigned char>(i);
+   REQUIRE(ring.Publish(img.data(), 64, 32, 4, 4, 2, "md"));
+   REQUIRE(mmsf_frames_published(r.reader) == 1);
+
+   MMSFFrame frame;
+   REQUIRE(mmsf_view_frame(r.reader, 0, &frame) == MMSF_OK);
+   CHECK(frame.width == 64);
+   CHECK(frame.height == 32);
+   CHECK(frame.bytesPerPixel == 4);
+   CHECK(frame.numberOfComponents == 4);
+   CHECK(frame.channel == 2);
+   CHECK(frame.flags == 0);
+   REQUIRE(frame.pixelSize == img.size());
+   CHECK(std::vector<unsigned char>(
+            static_cast<const unsigned char*>(frame.pixels),
+            static_cast<const unsigned char*>(frame.pixels) + frame.pixelSize) == img);
+   CHECK(std::string(frame.metadata, frame.metadataSize) == "md");
+   CHECK(reinterpret_cast<std::uintptr_t>(frame.pixels) % MMSF_ALIGNMENT == 0);
+   CHECK(mmsf_validate_frame(r.reader, &frame) == MMSF_OK);
+
+   std::vector<unsigned char> copy(img.size());
+   char md[8];
+   REQUIRE(mmsf_copy_frame(r.reader, 0, &frame, copy.data(), copy.size(),
+            md, sizeof(md)) == MMSF_OK);
+   CHECK(copy == img);
+   CHECK(std::string(md) == "md");
+   CHECK(mmsf_copy_frame(r.reader, 0, &frame, copy.data(), copy.size() - 1,
+            0, 0) == MMSF_ERR_BUFFER_TOO_SMALL);
+   CHECK(mmsf_view_frame(r.reader, 1, &frame) == MMSF_ERR_NOT_YET);
+}
+
+TEST_CASE("Shared frames are overwritten when the ring wraps", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("wrap");
+   SharedFrameRing ring(name, segmentSize);
+   ReaderGuard r(name);
+
+   Publish(ring, 128, 128, 0);
+   const std::size_t slots = ring.SlotCount();
+   REQUIRE(slots > 1);
+
+   MMSFFrame viewed;
+   REQUIRE(mmsf_view_frame(r.reader, 0, &viewed) == MMSF_OK);
+   for (std::size_t i = 1; i <= slots; ++i)
+      Publish(ring, 128, 128, static_cast<unsigned char>(i));
+
+   CHECK(mmsf_validate_frame(r.reader, &viewed) == MMSF_ERR_OVERWRITTEN);
+   MMSFFrame frame;
+   CHECK(mmsf_view_frame(r.reader, 0, &frame) == MMSF_ERR_OVERWRITTEN);
+   REQUIRE(mmsf_view_frame(r.reader, 1, &frame) == MMSF_OK);
+   CHECK(static_cast<const unsigned char*>(frame.pixels)[0] == 1);
+   REQUIRE(mmsf_view_frame(r.reader, slots, &frame) == MMSF_OK);
+   CHECK(static_cast<const unsigned char*>(frame.pixels)[0] ==
+         static_cast<unsigned char>(slots));
+}
+
+TEST_CASE("Shared frame ring is re-sliced when the image size changes", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("reslice");
+   SharedFrameRing ring(name, segmentSize);
+   ReaderGuard r(name);
+
+   Publish(ring, 64, 64, 1);
+   const std::size_t smallSlots = ring.SlotCount();
+   Publish(ring, 256, 256, 2);
+   CHECK(ring.SlotCount() < smallSlots);
+
+   MMSFFrame frame;
+   CHECK(mmsf_view_frame(r.reader, 0, &frame) == MMSF_ERR_OVERWRITTEN);
+   REQUIRE(mmsf_view_frame(r.reader, 1, &frame) == MMSF_OK);
+   CHECK(frame.width == 256);
+   CHECK(static_cast<const unsigned char*>(frame.pixels)[frame.pixelSize - 1] == 2);
+}
+
+TEST_CASE("Re-slicing clears stale data under the new slot headers", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("reslice-stale");
+   SharedFrameRing ring(name, segmentSize);
+   ReaderGuard r(name);
+
+   // Fill all small slots with what reads as "frame 11 is complete"
+   const uint64_t complete11 = 2 * 11 + 2;
+   std::vector<uint64_t> pattern(SharedFrameRing::MetadataCapacity / 8, complete11);
+   const std::string md(reinterpret_cast<const char*>(pattern.data()),
+         SharedFrameRing::MetadataCapacity);
+   const std::size_t smallSlots = (segmentSize - MMSF_HEADER_SIZE) /
+      (64 + 64 * 64 * 2 + SharedFrameRing::MetadataCapacity);
+   for (std::size_t i = 0; i < smallSlots; ++i)
+      REQUIRE(ring.Publish(reinterpret_cast<const unsigned char*>(pattern.data()),
+               64, 64, 2, 1, 0, md));
+
+   // The next frame re-slices; frame 11 is within the ring's frame count,
+   // but its slot in the new layout was never written
+   Publish(ring, 256, 256, 2);
+   REQUIRE(ring.FramesPublished() - 11 <= ring.SlotCount());
+   MMSFFrame frame;
+   CHECK(mmsf_view_frame(r.reader, 11, &frame) == MMSF_ERR_OVERWRITTEN);
+}
+
+TEST_CASE("Shared frame ring skips images that do not fit", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("skip");
+   SharedFrameRing ring(name, segmentSize);
+   ReaderGuard r(name);
+
+   const std::vector<unsigned char> img = Image(1024 * 1024, 0);
+   CHECK_FALSE(ring.Publish(img.data(), 1024, 1024, 1, 1, 0, std::string()));
+   CHECK(mmsf_frames_skipped(r.reader) == 1);
+   CHECK(mmsf_frames_published(r.reader) == 0);
+
+   // Oversized metadata is dropped but the pixels are exported
+   Publish(ring, 16, 16, 3,
+         std::string(SharedFrameRing::MetadataCapacity + 1, 'x'));
+   MMSFFrame frame;
+   REQUIRE(mmsf_view_frame(r.reader, 0, &frame) == MMSF_OK);
+   CHECK(frame.flags == MMSF_SLOT_METADATA_TRUNCATED);
+   CHECK(frame.metadataSize == 0);
+}
+
+TEST_CASE("Shared frame segment lifetime", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("lifetime");
+   MMSFReader* reader = 0;
+   {
+      SharedFrameRing ring(name.substr(1), segmentSize); // Without the slash
+      CHECK(ring.Name() == name);
+      CHECK_THROWS_AS(SharedFrameRing(name, segmentSize), CMMError);
+      REQUIRE(mmsf_open(name.c_str(), &reader) == MMSF_OK);
+      Publish(ring, 16, 16, 7);
+   }
+
+   // Closed by the writer and unlinked, but still mapped by the reader
+   CHECK_FALSE(mmsf_writer_open(reader));
+   MMSFFrame frame;
+   REQUIRE(mmsf_view_frame(reader, 0, &frame) == MMSF_OK);
+   CHECK(static_cast<const unsigned char*>(frame.pixels)[0] == 7);
+   mmsf_close(reader);
+
+   CHECK(mmsf_open(name.c_str(), &reader) == MMSF_ERR_SYSTEM);
+   CHECK_THROWS_AS(SharedFrameRing("/a/b", segmentSize), CMMError);
+   CHECK_THROWS_AS(SharedFrameRing(name, 1024), CMMError);
+}
+
+TEST_CASE("Shared frame reader never sees torn frames", "[SharedFrameRing]")
+{
+   const std::string name = TestSegmentName("torn");
+   // Few slots, so that the writer laps the reader often
+   SharedFrameRing ring(name, 4 * 1024 * 1024);
+   const unsigned width = 512, height = 512;
+   Publish(ring, width, height, 0);
+
+   std::atomic<bool> done(false);
+   std::atomic<long long> intact(0);
+   long long torn = 0;
+   MMSFReader* reader = 0;
+   REQUIRE(mmsf_open(name.c_str(), &reader) == MMSF_OK);
+   std::thread readerThread([&] {
+      std::vector<unsigned char> copy(width * height * 2);
+      MMSFFrame frame;
+      while (!done)
+      {
+         uint64_t published = mmsf_frames_published(reader);
+         if (mmsf_copy_frame(reader, published - 1, &frame, copy.data(),
+                  copy.size(), 0, 0) != MMSF_OK)
+            continue;
+         const unsigned char expected =
+            static_cast<unsigned char>(frame.frameNumber);
+         bool same = true;
+         for (std::size_t i = 0; i < copy.size(); i += 509)
+            same = same && copy[i] == expected;
+         same = same && copy.back() == expected;
+         if (same)
+            ++intact;
+         else
+            ++torn;
+      }
+   });
+
+   // Keep going until the reader has had a chance to run
+   for (unsigned n = 1; n < 2000 || (intact == 0 && n < 1000000); ++n)
+      Publish(ring, width, height, static_cast<unsigned char>(n));
+   done = true;
+   readerThread.join();
+   mmsf_close(reader);
+
+   CHECK(torn == 0);
+   CHECK(intact > 0);
+}
+
+} // namespace mm
+
+#endif // _WIN32
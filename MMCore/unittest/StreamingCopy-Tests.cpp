@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+
+#include "StreamingCopy.h"
+#include "TaskSet_CopyMemory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mm::StreamingCopy;
+
+namespace {
+
+std::string ImplementationName(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto: return "auto";
+      case ImplementationMemcpy: return "memcpy";
+      case ImplementationSSE2: return "SSE2";
+      case ImplementationAVX: return "AVX";
+   }
+   return "?";
+}
+
+std::vector<unsigned char> Pattern(std::size_t bytes)
+{
+   std::vector<unsigned char> data(bytes);
+   for (std::size_t i = 0; i < bytes; ++i)
+      data[i] = static_cast<unsigned char>(i * 31 + (i >> 8));
+   return data;
+}
+
+} // anonymous namespace
+
+TEST_CASE("StreamingCopy copies exactly, at any alignment", "[StreamingCopy]")
+{
+   const std::vector<unsigned char> src = Pattern(4096 + 256);
+   for (Implementation impl : { ImplementationMemcpy, ImplementationSSE2,
+         ImplementationAVX, ImplementationAuto })
+   {
+      if (!IsImplementationAvailable(impl))
+         continue;
+      INFO(ImplementationName(impl));
+      for (std::size_t bytes : { 0, 1, 63, 64, 127, 128, 129, 1000, 4096 })
+      {
+         for (std::size_t srcOffset : { 0, 1, 17, 64 })
+         {
+            for (std::size_t dstOffset : { 0, 3, 32, 63 })
+            {
+               INFO(bytes << " bytes, offsets " << srcOffset << ", " << dstOffset);
+               // Guard bytes detect writes outside the destination
+               std::vector<unsigned char> dst(bytes + dstOffset + 64, 0xcd);
+               Copy(dst.data() + dstOffset, src.data() + srcOffset, bytes, impl);
+               bool ok = true;
+               for (std::size_t i = 0; i < dst.size(); ++i)
+               {
+                  const bool inside = i >= dstOffset && i < dstOffset + bytes;
+                  const unsigned char expected = inside ?
+                     src[srcOffset + i - dstOffset] : 0xcd;
+                  ok = ok && dst[i] == expected;
+               }
+               CHECK(ok);
+            }
+         }
+      }
+   }
+}
+
+TEST_CASE("Parallel copy is calibrated and exact", "[StreamingCopy]")
+{
+   auto pool = std::make_shared<ThreadPool>(4);
+   TaskSet_CopyMemory tasks(pool);
+   CHECK(tasks.GetMinBytesPerTask() >= 256 * 1024);
+   CHECK(tasks.GetMinBytesPerTask() % 64 == 0);
+
+   // Below, around and above the streaming threshold, split or not
+   const std::size_t threshold = TaskSet_CopyMemory::GetStreamingThreshold();
+   const std::size_t minPerTask = tasks.GetMinBytesPerTask();
+   for (std::size_t bytes : { std::size_t(1000), threshold - 1, threshold + 7,
+         4 * minPerTask + 12345, 3 * threshold + 1 })
+   {
+      INFO(bytes << " bytes");
+      const std::vector<unsigned char> src = Pattern(bytes + 1);
+      std::vector<unsigned char> dst(bytes + 2, 0xcd);
+      tasks.MemCopy(dst.data() + 1, src.data() + 1, bytes);
+      CHECK(dst[0] == 0xcd);
+      CHECK(dst[bytes + 1] == 0xcd);
+      CHECK(std::equal(src.begin() + 1, src.end(), dst.begin() + 1));
+   }
+}
+
+TEST_CASE("Parallel copy is calibrated per pool size", "[StreamingCopy]")
+{
+   // A single thread never splits copies, which must not keep a bigger pool
+   // created later from splitting them
+   TaskSet_CopyMemory single(std::make_shared<ThreadPool>(1));
+   CHECK(single.GetMinBytesPerTask() == 64 * 1024 * 1024);
+   TaskSet_CopyMemory multi(std::make_shared<ThreadPool>(3));
+   CHECK(multi.GetMinBytesPerTask() % 64 == 0);
+   CHECK(multi.GetMinBytesPerTask() >= 256 * 1024);
+
+   // Set up to split unless calibration says a thread is not worth it
+   if (multi.GetMinBytesPerTask() < 64 * 1024 * 1024)
+   {
+      const std::size_t bytes = 3 * multi.GetMinBytesPerTask();
+      const std::vector<unsigned char> src = Pattern(bytes);
+      std::vector<unsigned char> dst(bytes);
+      multi.SetUp(dst.data(), src.data(), bytes);
+      CHECK(multi.GetUsedTaskCount() == 3);
+      multi.Execute();
+      multi.Wait();
+      CHECK(dst == src);
+   }
+}
+
+// Not run by default; run with the tag [.benchmark] to compare throughput
+TEST_CASE("StreamingCopy benchmark", "[.benchmark][StreamingCopy]")
+{
+   for (std::size_t bytes : { 2048 * 2048 * 2, 4096 * 4096 * 2 })
+   {
+      const std::vector<unsigned char> src = Pattern(bytes);
+      std::vector<unsigned char> dst(bytes);
+      for (Implementation impl : { ImplementationMemcpy, ImplementationSSE2,
+            ImplementationAVX })
+      {
+         if (!IsImplementationAvailable(impl))
+            continue;
+         BENCHMARK("Copy " + std::to_string(bytes >> 20) + " MiB " +
+               ImplementationName(impl))
+         {
+            Copy(dst.data(), src.data(), bytes, impl);
+            return dst[0];
+         };
+      }
+   }
+}
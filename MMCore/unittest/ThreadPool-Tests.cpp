@@ -0,0 +1,150 @@
+#include <catch2/catch_all.hpp>
+
+#include "MMCore.h"
+#include "TaskSet_CopyMemory.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ParallelFor covers the range once", "[ThreadPool]")
+{
+   ThreadPool pool(4);
+   REQUIRE(pool.GetSize() == 4);
+
+   for (size_t count : { 0, 1, 7, 1000, 100000 })
+   {
+      std::vector<std::atomic<int>> visits(count);
+      for (auto& v : visits)
+         v = 0;
+      std::atomic<size_t> smallChunks{ 0 };
+      pool.ParallelFor(0, count, 10, [&](size_t begin, size_t end) {
+         if (end - begin < 10 && end != count)
+            ++smallChunks;
+         for (size_t i = begin; i < end; ++i)
+            ++visits[i];
+      });
+      CHECK(smallChunks == 0);
+      CHECK(std::all_of(visits.begin(), visits.end(),
+            [](const std::atomic<int>& v) { return v == 1; }));
+   }
+}
+
+TEST_CASE("ParallelFor uses the pool threads", "[ThreadPool]")
+{
+   ThreadPool pool(3);
+   std::atomic<int> inside{ 0 };
+   std::atomic<int> maxInside{ 0 };
+   pool.ParallelFor(0, 64, 1, [&](size_t, size_t) {
+      const int n = ++inside;
+      int m = maxInside;
+      while (n > m && !maxInside.compare_exchange_weak(m, n)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      --inside;
+   });
+   CHECK(maxInside > 1);
+}
+
+TEST_CASE("ParallelFor can be nested", "[ThreadPool]")
+{
+   // Inner loops run from pool threads must not deadlock, even when all the
+   // threads are busy with the outer loop
+   ThreadPool pool(2);
+   std::atomic<size_t> total{ 0 };
+   pool.ParallelFor(0, 8, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+         pool.ParallelFor(0, 1000, 10, [&](size_t b, size_t e) {
+            total += e - b;
+         });
+      }
+   });
+   CHECK(total == 8000);
+}
+
+TEST_CASE("ParallelFor rethrows exceptions", "[ThreadPool]")
+{
+   ThreadPool pool(4);
+   std::atomic<size_t> done{ 0 };
+   CHECK_THROWS_AS(pool.ParallelFor(0, 100, 1, [&](size_t begin, size_t end) {
+      if (begin <= 50 && 50 < end)
+         throw std::runtime_error("50");
+      done += end - begin;
+   }), std::runtime_error);
+   CHECK(done < 100);
+
+   // The pool is still usable
+   done = 0;
+   pool.ParallelFor(0, 100, 1, [&](size_t begin, size_t end) {
+      done += end - begin;
+   });
+   CHECK(done == 100);
+}
+
+TEST_CASE("ParallelFor from several threads at once", "[ThreadPool]")
+{
+   ThreadPool pool(2);
+   std::atomic<size_t> total{ 0 };
+   std::vector<std::thread> callers;
+   for (int t = 0; t < 4; ++t)
+   {
+      callers.emplace_back([&] {
+         for (int n = 0; n < 50; ++n)
+         {
+            pool.ParallelFor(0, 256, 16, [&](size_t begin, size_t end) {
+               total += end - begin;
+            });
+         }
+      });
+   }
+   for (auto& t : callers)
+      t.join();
+   CHECK(total == 4 * 50 * 256);
+}
+
+TEST_CASE("Task sets run on the work-stealing pool", "[ThreadPool]")
+{
+   auto pool = std::make_shared<ThreadPool>(3);
+   TaskSet_CopyMemory tasks(pool);
+   std::vector<unsigned char> src(3 * 1000 * 1000 + 17);
+   for (size_t i = 0; i < src.size(); ++i)
+      src[i] = static_cast<unsigned char>(i * 7);
+   std::vector<unsigned char> dst(src.size());
+   tasks.MemCopy(dst.data(), src.data(), src.size());
+   CHECK(dst == src);
+}
+
+TEST_CASE("ThreadPool keeps its CPU affinity", "[ThreadPool]")
+{
+   ThreadPool pool(2, { 0 });
+   CHECK(pool.GetCpuAffinity() == std::vector<unsigned>{ 0 });
+   std::atomic<size_t> total{ 0 };
+   pool.ParallelFor(0, 100, 1, [&](size_t begin, size_t end) {
+      total += end - begin;
+   });
+   CHECK(total == 100);
+}
+
+TEST_CASE("CMMCore worker thread settings", "[ThreadPool]")
+{
+   CMMCore c;
+   CHECK(c.getWorkerThreadCount() >= 1);
+   CHECK(c.getWorkerThreadAffinity().empty());
+
+   c.setWorkerThreadCount(3);
+   CHECK(c.getWorkerThreadCount() == 3);
+
+   c.setWorkerThreadAffinity({ 0 });
+   CHECK(c.getWorkerThreadCount() == 3);
+   CHECK(c.getWorkerThreadAffinity() == std::vector<unsigned>{ 0 });
+
+   CHECK_THROWS_AS(c.setWorkerThreadAffinity({ 1u << 20 }), CMMError);
+
+   c.setWorkerThreadCount(0);
+   CHECK(c.getWorkerThreadCount() == std::max(1u, std::thread::hardware_concurrency()));
+   CHECK(c.getWorkerThreadAffinity() == std::vector<unsigned>{ 0 });
+}
@@ -510,6 +510,92 @@
    }
 }
 
+// Java typemap
+// map the return value of getPinnedImage() to a direct ByteBuffer over the
+// circular buffer slot, without copying (see PinnedImage.java). The buffer
+// is in native byte order and read-only.
+//
+// Assumes that class has the following method defined:
+// long getPinnedImageBufferSize(long pin)
+
+%typemap(jni) void* getPinnedImage        "jobject"
+%typemap(jtype) void* getPinnedImage      "java.nio.ByteBuffer"
+%typemap(jstype) void* getPinnedImage     "java.nio.ByteBuffer"
+%typemap(javaout) void* getPinnedImage {
+   return $jnicall.asReadOnlyBuffer().order(java.nio.ByteOrder.nativeOrder());
+}
+%typemap(out) void* getPinnedImage
+{
+   jlong lSize = (jlong)(arg1)->getPinnedImageBufferSize(arg2);
+   $result = JCALL2(NewDirectByteBuffer, jenv, result, lSize);
+   if ($result == 0)
+   {
+      jclass excep = jenv->FindClass("java/lang/UnsupportedOperationException");
+      if (excep)
+         jenv->ThrowNew(excep, "The JVM does not support direct buffer access");
+      return $result;
+   }
+}
+
+// Java typemap
+// map the return value of getPreviewImage() to a pixel array, as for
+// getLastImage(), but with the dimensions of the (binned) preview image.
+//
+// Assumes that class has the following methods defined:
+// unsigned getPreviewImageWidth()
+// unsigned getPreviewImageHeight()
+// unsigned getPreviewImageBytesPerPixel()
+// unsigned getPreviewImageNumberOfComponents()
+
+%typemap(jni) void* getPreviewImage        "jobject"
+%typemap(jtype) void* getPreviewImage      "Object"
+%typemap(jstype) void* getPreviewImage     "Object"
+%typemap(javaout) void* getPreviewImage {
+   return $jnicall;
+}
+%typemap(out) void* getPreviewImage
+{
+   long lSize = (arg1)->getPreviewImageWidth() * (arg1)->getPreviewImageHeight();
+   unsigned bytesPerPixel = (arg1)->getPreviewImageBytesPerPixel();
+   bool isColor = (arg1)->getPreviewImageNumberOfComponents() > 1;
+
+   $result = 0;
+   if (bytesPerPixel == 1 || (bytesPerPixel == 4 && isColor))
+   {
+      jbyteArray data = JCALL1(NewByteArray, jenv, lSize * bytesPerPixel);
+      if (data)
+         JCALL4(SetByteArrayRegion, jenv, data, 0, lSize * bytesPerPixel, (jbyte*)result);
+      $result = data;
+   }
+   else if (bytesPerPixel == 2 || bytesPerPixel == 8)
+   {
+      jshortArray data = JCALL1(NewShortArray, jenv, lSize * bytesPerPixel / 2);
+      if (data)
+         JCALL4(SetShortArrayRegion, jenv, data, 0, lSize * bytesPerPixel / 2, (jshort*)result);
+      $result = data;
+   }
+   else if (bytesPerPixel == 4)
+   {
+      jfloatArray data = JCALL1(NewFloatArray, jenv, lSize);
+      if (data)
+         JCALL4(SetFloatArrayRegion, jenv, data, 0, lSize, (jfloat*)result);
+      $result = data;
+   }
+   else
+   {
+      // don't know how to map
+      return $result;
+   }
+
+   if ($result == 0)
+   {
+      jclass excep = jenv->FindClass("java/lang/OutOfMemoryError");
+      if (excep)
+         jenv->ThrowNew(excep, "The system ran out of memory!");
+      return $result;
+   }
+}
+
 // Java typemap
 // change default SWIG mapping of void* return values
 // to return CObject containing array of pixel values
@@ -806,6 +892,23 @@
       return popNextTaggedImage(0);
    }
 
+   /**
+    * Zero-copy variant of popNextImageMD(). The pixels are accessed in
+    * place, and md (which can be reused from call to call) is filled in
+    * with the image's metadata. The image must be closed when done with,
+    * or the circular buffer will eventually overflow.
+    */
+   public PinnedImage popNextPinnedImage(int cameraChannelIndex, Metadata md) throws java.lang.Exception {
+      return new PinnedImage(this, pinNextImageMD(cameraChannelIndex, md));
+   }
+
+   /**
+    * Zero-copy variant of getLastImageMD(); see popNextPinnedImage().
+    */
+   public PinnedImage getLastPinnedImage(int cameraChannelIndex, Metadata md) throws java.lang.Exception {
+      return new PinnedImage(this, pinLastImageMD(cameraChannelIndex, md));
+   }
+
    // convenience functions follow
    
    /*
@@ -0,0 +1,46 @@
+package mmcorej;
+
+import java.nio.ByteBuffer;
+
+/**
+ * An image in the Core's circular buffer, accessed without copying.
+ *
+ * The buffer slot holding the image is not reused until the image is
+ * closed, after which pixels must no longer be accessed. Obtain instances
+ * from CMMCore.popNextPinnedImage() or CMMCore.getLastPinnedImage(),
+ * preferably in a try-with-resources statement.
+ */
+public class PinnedImage implements AutoCloseable {
+   /** Read-only view of the pixels, in native byte order */
+   public final ByteBuffer pixels;
+   public final int width;
+   public final int height;
+   public final int bytesPerPixel;
+
+   private final CMMCore core_;
+   // C++ long, which SWIG maps to Java int
+   private final int pin_;
+   private boolean closed_ = false;
+
+   PinnedImage(CMMCore core, int pin) throws java.lang.Exception {
+      core_ = core;
+      pin_ = pin;
+      try {
+         pixels = core.getPinnedImage(pin);
+         width = (int) core.getPinnedImageWidth(pin);
+         height = (int) core.getPinnedImageHeight(pin);
+         bytesPerPixel = (int) core.getPinnedImageBytesPerPixel(pin);
+      } catch (java.lang.Exception e) {
+         core.releasePinnedImage(pin);
+         throw e;
+      }
+   }
+
+   @Override
+   public synchronized void close() throws java.lang.Exception {
+      if (!closed_) {
+         closed_ = true;
+         core_.releasePinnedImage(pin_);
+      }
+   }
+}
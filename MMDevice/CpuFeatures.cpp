@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CpuFeatures.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Run-time detection of the x86 instruction set extensions
+//                used by the SIMD pixel kernels.
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPUFEATURES_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace CpuFeatures {
+
+namespace {
+
+struct Features
+{
+   bool sse2;
+   bool ssse3;
+   bool avx;
+   bool avx2;
+};
+
+Features Detect()
+{
+   Features f = { false, false, false, false };
+#if defined(CPUFEATURES_X86) && defined(_MSC_VER)
+   int regs[4];
+   __cpuid(regs, 0);
+   const int maxLeaf = regs[0];
+   __cpuid(regs, 1);
+   f.sse2 = (regs[3] & (1 << 26)) != 0;
+   f.ssse3 = (regs[2] & (1 << 9)) != 0;
+   const bool osxsave = (regs[2] & (1 << 27)) != 0;
+   const bool avx = (regs[2] & (1 << 28)) != 0;
+   // The OS must save the YMM registers on context switches
+   f.avx = osxsave && avx && (_xgetbv(0) & 6) == 6;
+   if (f.avx && maxLeaf >= 7)
+   {
+      __cpuidex(regs, 7, 0);
+      f.avx2 = (regs[1] & (1 << 5)) != 0;
+   }
+#elif defined(CPUFEATURES_X86)
+   __builtin_cpu_init();
+   f.sse2 = __builtin_cpu_supports("sse2") != 0;
+   f.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+   f.avx = __builtin_cpu_supports("avx") != 0;
+   f.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+   return f;
+}
+
+const Features& Get()
+{
+   static const Features features = Detect();
+   return features;
+}
+
+} // anonymous namespace
+
+bool HasSSE2() { return Get().sse2; }
+bool HasSSSE3() { return Get().ssse3; }
+bool HasAVX() { return Get().avx; }
+bool HasAVX2() { return Get().avx2; }
+
+} // namespace CpuFeatures
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          CpuFeatures.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Run-time detection of the x86 instruction set extensions
+//                used by the SIMD pixel kernels.
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#pragma once
+
+namespace CpuFeatures {
+
+// Whether the CPU supports an extension and, for AVX and AVX2, the OS saves
+// the YMM registers. The CPU is queried once per process. All are false on
+// other architectures.
+bool HasSSE2();
+bool HasSSSE3();
+bool HasAVX();
+bool HasAVX2();
+
+} // namespace CpuFeatures
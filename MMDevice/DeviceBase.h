@@ -33,11 +33,14 @@
 #include <math.h>
 #include <assert.h>
 
+#include <chrono>
+#include <cstdio>
 #include <string>
 #include <vector>
 #include <iomanip>
 #include <map>
 #include <sstream>
+#include <type_traits>
 
 // common error messages
 const char* const g_Msg_ERR = "Unknown error in the device";
@@ -211,8 +214,12 @@ public:
    */
    int GetProperty(const char* name, double& val)
    {
+      int nRet = properties_.Get(name, val);
+      if (nRet != DEVICE_INVALID_PROPERTY_TYPE)
+         return nRet;
+
       std::string strVal;
-      int nRet = properties_.Get(name, strVal);
+      nRet = properties_.Get(name, strVal);
       if (nRet == DEVICE_OK)
          val = atof(strVal.c_str());
       return nRet;
@@ -225,13 +232,45 @@ public:
    */
    int GetProperty(const char* name, long& val)
    {
+      int nRet = properties_.Get(name, val);
+      if (nRet != DEVICE_INVALID_PROPERTY_TYPE)
+         return nRet;
+
       std::string strVal;
-      int nRet = properties_.Get(name, strVal);
+      nRet = properties_.Get(name, strVal);
       if (nRet == DEVICE_OK)
          val = atol(strVal.c_str());
       return nRet;
    }
 
+   /**
+   * Obtains the value of a numeric property without string conversion.
+   * Returns DEVICE_INVALID_PROPERTY_TYPE for string properties.
+   * @param name - property identifier (name)
+   * @param value - the value of the property
+   */
+   virtual int GetPropertyDouble(const char* name, double& value) const
+   {
+      int ret = properties_.Get(name, value);
+      if (ret != DEVICE_OK && ret != DEVICE_INVALID_PROPERTY_TYPE)
+         SetMorePropertyErrorInfo(name);
+      return ret;
+   }
+
+   /**
+   * Obtains the value of a numeric property without string conversion.
+   * Returns DEVICE_INVALID_PROPERTY_TYPE for string properties.
+   * @param name - property identifier (name)
+   * @param value - the value of the property
+   */
+   virtual int GetPropertyLong(const char* name, long& value) const
+   {
+      int ret = properties_.Get(name, value);
+      if (ret != DEVICE_OK && ret != DEVICE_INVALID_PROPERTY_TYPE)
+         SetMorePropertyErrorInfo(name);
+      return ret;
+   }
+
    /**
     * Check if the property value is equal to a specific string
     * @return true only if property exists and is equal to, false otherwise
@@ -461,6 +500,31 @@ public:
       return pProp->AddToSequence(value);
    }
 
+   /**
+    * This function is used by the Core to communicate a sequence of numeric
+    * values to the device. The default adds the values to the property's
+    * sequence as strings; adapters that keep numeric sequences can override
+    * it to avoid the conversion.
+    * @param name - name of the sequenceable property
+    */
+   virtual int AddArrayToPropertySequence(const char* name, const double* values, unsigned long count)
+   {
+      MM::Property* pProp;
+      int ret = GetSequenceableProperty(&pProp, name);
+      if (ret != DEVICE_OK)
+         return ret;
+
+      char buf[MM::MaxStrLength];
+      for (unsigned long i = 0; i < count; ++i)
+      {
+         std::snprintf(buf, MM::MaxStrLength, "%.17g", values[i]);
+         ret = pProp->AddToSequence(buf);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
    /**
     * This function is used by the Core to communicate a sequence to the device
     * Sends the sequence to the device by calling the properties functor
@@ -522,6 +586,42 @@ public:
       return ret;
    }
 
+   /**
+   * Sets the value of a numeric property without string conversion; the
+   * action handler receives the value as set. Returns
+   * DEVICE_INVALID_PROPERTY_TYPE for string properties and for properties
+   * with allowed values, which must be set with SetProperty(). Also returns
+   * DEVICE_INVALID_PROPERTY_TYPE if the device class overrides
+   * SetProperty(), so that the override sees every value set.
+   * @param name - property name
+   * @param value - property value
+   */
+   virtual int SetPropertyDouble(const char* name, double value)
+   {
+      if (OverridesSetProperty())
+         return DEVICE_INVALID_PROPERTY_TYPE;
+      int ret = properties_.Set(name, value);
+      if (ret != DEVICE_OK && ret != DEVICE_INVALID_PROPERTY_TYPE)
+         SetMorePropertyErrorInfo(name);
+      return ret;
+   }
+
+   /**
+   * Sets the value of a numeric property without string conversion.
+   * See SetPropertyDouble().
+   * @param name - property name
+   * @param value - property value
+   */
+   virtual int SetPropertyLong(const char* name, long value)
+   {
+      if (OverridesSetProperty())
+         return DEVICE_INVALID_PROPERTY_TYPE;
+      int ret = properties_.Set(name, value);
+      if (ret != DEVICE_OK && ret != DEVICE_INVALID_PROPERTY_TYPE)
+         SetMorePropertyErrorInfo(name);
+      return ret;
+   }
+
    /**
    * Checks if device supports a given property.
    */
@@ -957,6 +1057,29 @@ protected:
       return 0;
    }
 
+   /**
+   * Gets the specified device, using and updating a cached handle.
+   * Devices that access another device repeatedly should keep one handle
+   * per label (initially 0, and reset to 0 when the label changes). The
+   * label is only looked up when the handle is not yet resolved or the
+   * device it referred to has been unloaded.
+   */
+   MM::Device* GetDevice(const char* deviceLabel, MM::DeviceHandle& handle) const
+   {
+      if (!callback_)
+         return 0;
+      if (handle != 0)
+      {
+         MM::Device* pDevice = callback_->GetDeviceByHandle(this, handle);
+         if (pDevice)
+            return pDevice;
+      }
+      handle = callback_->GetDeviceHandle(this, deviceLabel);
+      if (handle == 0)
+         return 0;
+      return callback_->GetDeviceByHandle(this, handle);
+   }
+
    /**
    * Provides access to the names of devices of a given type
    * deviceIterator determines which device in the list of devices of the
@@ -1037,6 +1160,18 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+   * Reads the current contents of Rx serial buffer, waiting up to timeoutMs
+   * for data if the buffer is empty. Lets a receive thread block until data
+   * arrives instead of polling.
+   */
+   int ReadFromComPortWithTimeout(const char* portLabel, unsigned char* buf, unsigned bufLength, unsigned long& read, long timeoutMs)
+   {
+      if (callback_)
+         return callback_->ReadFromSerialWithTimeout(this, portLabel, buf, bufLength, read, timeoutMs);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
    /**
    * Clears the serial port buffers
    */
@@ -1127,6 +1262,26 @@ protected:
       return DEVICE_NO_CALLBACK_REGISTERED;
    }
 
+   /**
+    * Signals that the configuration of a camera trigger has changed.
+    */
+   int OnCameraTriggerChanged(int triggerSelector, int triggerMode, int triggerSource)
+   {
+      if (callback_)
+         return callback_->OnCameraTriggerChanged(this, triggerSelector, triggerMode, triggerSource);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
+   /**
+    * Reports a camera event (one of the MM::CameraEvent* constants).
+    */
+   int OnCameraEvent(int eventType)
+   {
+      if (callback_)
+         return callback_->OnCameraEvent(this, eventType);
+      return DEVICE_NO_CALLBACK_REGISTERED;
+   }
+
    /**
    * Gets the system ticks in microseconds.
    * OBSOLETE, use GetCurrentTime()
@@ -1166,6 +1321,34 @@ protected:
       return callback_;
    }
 
+   /**
+   * Calls fn(begin, end) for disjoint ranges covering [0, count), each of at
+   * least grainSize items, on the Core's worker threads (see
+   * MM::Core::ParallelFor()), and returns when all have returned. Without a
+   * callback, calls fn(0, count) on the calling thread.
+   */
+   template <typename F>
+   int ParallelFor(unsigned long count, unsigned long grainSize, F fn) const
+   {
+      class Work : public MM::ParallelWork
+      {
+      public:
+         explicit Work(F& f) : f_(f) {}
+         virtual void Run(unsigned long begin, unsigned long end) { f_(begin, end); }
+      private:
+         F& f_;
+      };
+
+      if (!callback_)
+      {
+         if (count > 0)
+            fn(0, count);
+         return DEVICE_OK;
+      }
+      Work work(fn);
+      return callback_->ParallelFor(this, &work, count, grainSize);
+   }
+
    /**
    * If this flag is set the device signals to the rest of the system that it will respond to delay settings.
    */
@@ -1224,6 +1407,24 @@ private:
       return properties_.Find(propName) != 0;
    }
 
+   // Deduces the class that declares U::SetProperty(const char*, const char*)
+   template <class C>
+   static C* SetPropertyDeclarer(int (C::*)(const char*, const char*));
+
+   template <class V>
+   static auto OverridesSetProperty(int) ->
+      decltype(SetPropertyDeclarer(&V::SetProperty), bool())
+   {
+      return !std::is_same<decltype(SetPropertyDeclarer(&V::SetProperty)),
+            CDeviceBase*>::value;
+   }
+
+   // U is not always the device class (e.g. std::monostate in PyDevice)
+   template <class V>
+   static bool OverridesSetProperty(long) { return false; }
+
+   static bool OverridesSetProperty() { return OverridesSetProperty<U>(0); }
+
    /**
     * Finds a property by name and determines whether it is a sequenceable property
     * @param pProp - pointer to pointer used to return the property if found
@@ -1458,6 +1659,20 @@ public:
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation that calls AddToExposureSequence() for each value
+   */
+   virtual int AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count)
+   {
+      for (unsigned long i = 0; i < count; ++i)
+      {
+         int ret = this->AddToExposureSequence(exposureTimes_ms[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
    virtual int SendExposureSequence() const
    {
       return DEVICE_UNSUPPORTED_COMMAND;
@@ -1504,6 +1719,60 @@ public:
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+    * Cameras implementing the trigger API should override this and the
+    * functions below.
+    */
+   virtual bool IsTriggerAPIImplemented()
+   {
+      return false;
+   }
+
+   virtual bool HasTrigger(int /* triggerSelector */)
+   {
+      return false;
+   }
+
+   virtual int SetTriggerState(int /* triggerSelector */, int /* triggerMode */,
+         int /* triggerSource */, double /* triggerDelayUs */,
+         int /* triggerActivation */, int /* triggerOverlap */)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int GetTriggerState(int /* triggerSelector */, int& /* triggerMode */,
+         int& /* triggerSource */, double& /* triggerDelayUs */,
+         int& /* triggerActivation */, int& /* triggerOverlap */)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int TriggerSoftware(int /* triggerSelector */)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int AcquisitionArm(int /* frameCount */,
+         double /* acquisitionFrameRate */, int /* burstFrameCount */)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int AcquisitionStart()
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int AcquisitionStop()
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int AcquisitionAbort()
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
 protected:
    /////////////////////////////////////////////
    // utility methods for use by derived classes
@@ -1543,18 +1812,11 @@ protected:
       this->GetLabel(label);
       Metadata md;
       md.put(MM::g_Keyword_Metadata_CameraLabel, label);
-      int ret = GetCoreCallback()->InsertImage(this, GetImageBuffer(), GetImageWidth(),
+      // The Core applies its overflow policy; DEVICE_BUFFER_OVERFLOW means
+      // the acquisition should stop
+      return GetCoreCallback()->InsertImage(this, GetImageBuffer(), GetImageWidth(),
          GetImageHeight(), GetImageBytesPerPixel(),
          md.Serialize().c_str());
-      if (!stopWhenCBOverflows_ && ret == DEVICE_BUFFER_OVERFLOW)
-      {
-         // do not stop on overflow - just reset the buffer
-         GetCoreCallback()->ClearImageBuffer(this);
-         return GetCoreCallback()->InsertImage(this, GetImageBuffer(), GetImageWidth(),
-            GetImageHeight(), GetImageBytesPerPixel(),
-            md.Serialize().c_str());
-      } else
-         return ret;
    }
 
    virtual double GetIntervalMs() {return thd_->GetIntervalMs();}
@@ -1799,6 +2061,20 @@ class CStageBase : public CDeviceBase<MM::Stage, U>
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation that calls AddToStageSequence() for each value
+   */
+   virtual int AddArrayToStageSequence(const double* positions, unsigned long count)
+   {
+      for (unsigned long i = 0; i < count; ++i)
+      {
+         int ret = this->AddToStageSequence(positions[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
    virtual int SendStageSequence()
    {
       return DEVICE_UNSUPPORTED_COMMAND;
@@ -1994,6 +2270,20 @@ public:
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation that calls AddToXYStageSequence() for each value
+   */
+   virtual int AddArrayToXYStageSequence(const double* positionsX, const double* positionsY, unsigned long count)
+   {
+      for (unsigned long i = 0; i < count; ++i)
+      {
+         int ret = this->AddToXYStageSequence(positionsX[i], positionsY[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
    virtual int SendXYStageSequence()
    {
       return DEVICE_UNSUPPORTED_COMMAND;
@@ -2047,6 +2337,25 @@ class CShutterBase : public CDeviceBase<MM::Shutter, U>
 template <class U>
 class CSerialBase : public CDeviceBase<MM::Serial, U>
 {
+public:
+   /**
+   * Default implementation that polls Read() every millisecond. Ports that
+   * can be notified when data arrives should override this.
+   */
+   virtual int ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs)
+   {
+      const std::chrono::steady_clock::time_point deadline =
+         std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+      for (;;)
+      {
+         int ret = this->Read(buf, bufLen, charsRead);
+         if (ret != DEVICE_OK || charsRead > 0)
+            return ret;
+         if (std::chrono::steady_clock::now() >= deadline)
+            return DEVICE_OK;
+         CDeviceUtils::SleepMs(1);
+      }
+   }
 };
 
 /**
@@ -2064,6 +2373,23 @@ class CAutoFocusBase : public CDeviceBase<MM::AutoFocus, U>
 template <class U>
 class CImageProcessorBase : public CDeviceBase<MM::ImageProcessor, U>
 {
+public:
+   virtual bool IsProcessingAsynchronous()
+   {
+      return false;
+   }
+
+   virtual int ProcessAsync(const unsigned char* /*buffer*/, unsigned /*width*/,
+         unsigned /*height*/, unsigned /*byteDepth*/, unsigned /*nComponents*/,
+         const char* /*serializedMetadata*/)
+   {
+      return DEVICE_UNSUPPORTED_COMMAND;
+   }
+
+   virtual int FinishAsyncProcessing()
+   {
+      return DEVICE_OK;
+   }
 };
 
 /**
@@ -2095,6 +2421,20 @@ class CSignalIOBase : public CDeviceBase<MM::SignalIO, U>
       return DEVICE_UNSUPPORTED_COMMAND;
    }
 
+   /**
+   * Default implementation that calls AddToDASequence() for each value
+   */
+   virtual int AddArrayToDASequence(const double* voltages, unsigned long count)
+   {
+      for (unsigned long i = 0; i < count; ++i)
+      {
+         int ret = this->AddToDASequence(voltages[i]);
+         if (ret != DEVICE_OK)
+            return ret;
+      }
+      return DEVICE_OK;
+   }
+
    virtual int SendDASequence() {
       return DEVICE_UNSUPPORTED_COMMAND;
    }
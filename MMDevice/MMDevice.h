@@ -28,7 +28,7 @@
 // Header version
 // If any of the class definitions changes, the interface version
 // must be incremented
-#define DEVICE_INTERFACE_VERSION 71
+#define DEVICE_INTERFACE_VERSION 79
 ///////////////////////////////////////////////////////////////////////////////
 
 // N.B.
@@ -69,6 +69,13 @@ namespace MM {
    // forward declaration for the MMCore callback class
    class Core;
 
+   /**
+    * Opaque identifier of a loaded device, obtained from
+    * Core::GetDeviceHandle(). Handles are never reused while the Core
+    * exists; 0 is never a valid handle.
+    */
+   typedef unsigned long DeviceHandle;
+
    /**
     * Utility class used both MMCore and devices to maintain time intervals
     * in the uniform, platform independent way.
@@ -216,6 +223,16 @@ namespace MM {
       virtual unsigned GetNumberOfProperties() const = 0;
       virtual int GetProperty(const char* name, char* value) const = 0;
       virtual int SetProperty(const char* name, const char* value) = 0;
+      /**
+       * Get or set the value of a numeric property without converting it
+       * to and from a string. Return DEVICE_INVALID_PROPERTY_TYPE if the
+       * property must be accessed as a string (string properties and, for
+       * the setters, properties with allowed values).
+       */
+      virtual int GetPropertyDouble(const char* name, double& value) const = 0;
+      virtual int SetPropertyDouble(const char* name, double value) = 0;
+      virtual int GetPropertyLong(const char* name, long& value) const = 0;
+      virtual int SetPropertyLong(const char* name, long value) = 0;
       virtual bool HasProperty(const char* name) const = 0;
       virtual bool GetPropertyName(unsigned idx, char* name) const = 0;
       virtual int GetPropertyReadOnly(const char* name, bool& readOnly) const = 0;
@@ -255,6 +272,12 @@ namespace MM {
        * Add one value to the sequence
        */
       virtual int AddToPropertySequence(const char* propertyName, const char* value) = 0;
+      /**
+       * Add count numeric values to the sequence in one call. Adapters that
+       * keep the sequence in numeric form should override the default
+       * (which adds the values one at a time as strings).
+       */
+      virtual int AddArrayToPropertySequence(const char* propertyName, const double* values, unsigned long count) = 0;
       /**
        * Signal that we are done sending sequence values so that the adapter can send the whole sequence to the device
        */
@@ -542,8 +565,68 @@ namespace MM {
       virtual int ClearExposureSequence() = 0;
       // Add one value to the sequence
       virtual int AddToExposureSequence(double exposureTime_ms) = 0;
+      // Add count values to the sequence in one call
+      virtual int AddArrayToExposureSequence(const double* exposureTimes_ms, unsigned long count) = 0;
       // Signal that we are done sending sequence values so that the adapter can send the whole sequence to the device
       virtual int SendExposureSequence() const = 0;
+
+      // Trigger API (see camera_triggering_API_v2.md)
+      // Trigger selectors, modes, sources, etc. are the MM::Trigger*
+      // constants in MMDeviceConstants.h. Cameras implementing this API
+      // report their progress through MM::Core::OnCameraEvent().
+
+      /**
+       * Returns true if the camera implements the trigger and acquisition
+       * functions below. Implemented in DeviceBase.h to return false.
+       */
+      virtual bool IsTriggerAPIImplemented() = 0;
+      /**
+       * Returns true if the camera supports the given trigger selector.
+       */
+      virtual bool HasTrigger(int triggerSelector) = 0;
+      /**
+       * Configures the trigger for the given selector. Should return an error
+       * code if the combination is not valid; should not start anything.
+       * @param triggerDelayUs - delay between trigger and its effect, in microseconds
+       */
+      virtual int SetTriggerState(int triggerSelector, int triggerMode, int triggerSource,
+            double triggerDelayUs, int triggerActivation, int triggerOverlap) = 0;
+      /**
+       * Returns the current configuration of the trigger for the given selector.
+       */
+      virtual int GetTriggerState(int triggerSelector, int& triggerMode, int& triggerSource,
+            double& triggerDelayUs, int& triggerActivation, int& triggerOverlap) = 0;
+      /**
+       * Sends a software trigger of the given type. The corresponding trigger
+       * must be on, with TriggerSourceSoftware as its source.
+       */
+      virtual int TriggerSoftware(int triggerSelector) = 0;
+      /**
+       * Validates the settings and prepares the camera for a fast
+       * AcquisitionStart().
+       * @param frameCount - 1 for a single frame, > 1 for that many frames,
+       *                     -1 for continuous acquisition
+       * @param acquisitionFrameRate - frame rate in Hz when the frame trigger
+       *                     is off; 0 to run as fast as possible
+       * @param burstFrameCount - frames per FrameBurstStart trigger; 0 if
+       *                     not used
+       */
+      virtual int AcquisitionArm(int frameCount, double acquisitionFrameRate, int burstFrameCount) = 0;
+      /**
+       * Starts the acquisition armed by AcquisitionArm(). Frames are inserted
+       * into the circular buffer as in a sequence acquisition.
+       */
+      virtual int AcquisitionStart() = 0;
+      /**
+       * Stops the acquisition at the end of the current frame. A frame waiting
+       * for its trigger is cancelled. Ignored if no acquisition is running.
+       */
+      virtual int AcquisitionStop() = 0;
+      /**
+       * Aborts the acquisition immediately, without completing the current
+       * frame. Ignored if no acquisition is running.
+       */
+      virtual int AcquisitionAbort() = 0;
    };
 
    /**
@@ -652,6 +735,10 @@ namespace MM {
        * Add one value to the sequence
        */
       virtual int AddToStageSequence(double position) = 0;
+      /**
+       * Add count values to the sequence in one call
+       */
+      virtual int AddArrayToStageSequence(const double* positions, unsigned long count) = 0;
       /**
        * Signal that we are done sending sequence values so that the adapter
        * can send the whole sequence to the device
@@ -747,6 +834,10 @@ namespace MM {
        * Add one value to the sequence
        */
       virtual int AddToXYStageSequence(double positionX, double positionY) = 0;
+      /**
+       * Add count values to the sequence in one call
+       */
+      virtual int AddArrayToXYStageSequence(const double* positionsX, const double* positionsY, unsigned long count) = 0;
       /**
        * Signal that we are done sending sequence values so that the adapter
        * can send the whole sequence to the device
@@ -800,6 +891,11 @@ namespace MM {
       virtual int GetAnswer(char* txt, unsigned maxChars, const char* term) = 0;
       virtual int Write(const unsigned char* buf, unsigned long bufLen) = 0;
       virtual int Read(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead) = 0;
+      /**
+       * Like Read(), but if no data is available, waits up to timeoutMs for
+       * data to arrive. Returns DEVICE_OK with charsRead == 0 on timeout.
+       */
+      virtual int ReadWithTimeout(unsigned char* buf, unsigned long bufLen, unsigned long& charsRead, long timeoutMs) = 0;
       virtual int Purge() = 0;
    };
 
@@ -845,6 +941,27 @@ namespace MM {
       // image processor API
       virtual int Process(unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth) = 0;
 
+      /**
+       * Returns true if images should be passed to ProcessAsync() instead of
+       * Process(). Checked by the Core for every inserted image.
+       */
+      virtual bool IsProcessingAsynchronous() = 0;
+      /**
+       * Takes a copy of an image for processing on another thread. The
+       * processor is responsible for inserting the processed image into the
+       * Core's buffer with Core::InsertProcessedImage(), in the order in
+       * which images were received. serializedMetadata already contains the
+       * camera's tags. May block to limit the number of images in flight.
+       */
+      virtual int ProcessAsync(const unsigned char* buffer, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata) = 0;
+      /**
+       * Blocks until every image taken by ProcessAsync() has been inserted.
+       * Returns the first insertion error not yet returned by
+       * ProcessAsync(). Called by the Core when a camera finishes a sequence
+       * acquisition, before the acquisition is considered finished.
+       */
+      virtual int FinishAsyncProcessing() = 0;
+
 
    };
 
@@ -922,6 +1039,11 @@ namespace MM {
        * @return errorcode (DEVICE_OK if no error)
        */
       virtual int AddToDASequence(double voltage) = 0;
+      /**
+       * Adds count data points to the sequence in one call
+       * @return errorcode (DEVICE_OK if no error)
+       */
+      virtual int AddArrayToDASequence(const double* voltages, unsigned long count) = 0;
       /**
        * Sends the complete sequence to the device
        * If the individual data points were already send to the device, there is
@@ -1292,6 +1414,22 @@ namespace MM {
       virtual Device* GetInstalledDevice(int devIdx) = 0;
    };
 
+   /**
+    * Work to be divided among the Core's worker threads; see
+    * Core::ParallelFor().
+    */
+   class ParallelWork
+   {
+   public:
+      virtual ~ParallelWork() {}
+
+      /**
+       * Processes items [begin, end). Called concurrently for disjoint
+       * ranges; must not throw.
+       */
+      virtual void Run(unsigned long begin, unsigned long end) = 0;
+   };
+
    /**
     * Callback API to the core control module.
     * Devices use this abstract interface to use Core services
@@ -1314,6 +1452,17 @@ namespace MM {
        * to the desired device.
        */
       virtual Device* GetDevice(const Device* caller, const char* label) = 0;
+      /**
+       * Resolves a device label to a handle that can be passed to
+       * GetDeviceByHandle(), avoiding the label lookup on every access.
+       * Returns 0 if there is no such device (or it is the caller).
+       */
+      virtual DeviceHandle GetDeviceHandle(const Device* caller, const char* label) = 0;
+      /**
+       * Returns the device identified by a handle from GetDeviceHandle(), or
+       * null if that device has since been unloaded.
+       */
+      virtual Device* GetDeviceByHandle(const Device* caller, DeviceHandle handle) = 0;
       virtual int GetDeviceProperty(const char* deviceName, const char* propName, char* value) = 0;
       virtual int SetDeviceProperty(const char* deviceName, const char* propName, const char* value) = 0;
 
@@ -1339,6 +1488,12 @@ namespace MM {
       virtual int GetSerialAnswer(const Device* caller, const char* portName, unsigned long ansLength, char* answer, const char* term) = 0;
       virtual int WriteToSerial(const Device* caller, const char* port, const unsigned char* buf, unsigned long length) = 0;
       virtual int ReadFromSerial(const Device* caller, const char* port, unsigned char* buf, unsigned long length, unsigned long& read) = 0;
+      /**
+       * Reads available data from the port, first waiting up to timeoutMs for
+       * data to arrive if there is none. Returns DEVICE_OK with read == 0 on
+       * timeout.
+       */
+      virtual int ReadFromSerialWithTimeout(const Device* caller, const char* port, unsigned char* buf, unsigned long length, unsigned long& read, long timeoutMs) = 0;
       virtual int PurgeSerial(const Device* caller, const char* portName) = 0;
       virtual MM::PortType GetSerialPortType(const char* portName) const = 0;
 
@@ -1371,6 +1526,19 @@ namespace MM {
        * Magnifiers can use this to signal changes in magnification
        */
       virtual int OnMagnifierChanged(const Device* caller) = 0;
+      /**
+       * Cameras implementing the trigger API call this when the configuration
+       * of one of their triggers changed.
+       */
+      virtual int OnCameraTriggerChanged(const Device* caller, int triggerSelector, int triggerMode, int triggerSource) = 0;
+      /**
+       * Cameras implementing the trigger API call this to report events
+       * (MM::CameraEvent* constants), as close as possible to when they
+       * happen. The core timestamps the event on receipt and attaches the
+       * exposure start/end times to the next frame inserted by the camera.
+       * May be called from a camera's internal thread; must return quickly.
+       */
+      virtual int OnCameraEvent(const Device* caller, int eventType) = 0;
 
       // Deprecated: Return value overflows in ~72 minutes on Windows.
       // Prefer std::chrono::steady_clock for time delta measurements.
@@ -1381,6 +1549,23 @@ namespace MM {
       // Prefer std::chrono::steady_clock::now() in new code.
       virtual MM::MMTime GetCurrentMMTime() = 0;
 
+      // shared worker threads
+      /**
+       * Calls work->Run() for disjoint ranges covering [0, count), each of
+       * at least grainSize items, on the Core's worker threads and the
+       * calling thread, and returns when all have returned. Device adapters
+       * should use this for CPU-heavy image work instead of starting their
+       * own threads, so that all such work shares one pool sized to the
+       * machine. May be called from several threads at once, and from
+       * within work->Run().
+       */
+      virtual int ParallelFor(const Device* caller, ParallelWork* work, unsigned long count, unsigned long grainSize) = 0;
+      /**
+       * Returns the number of worker threads used by ParallelFor() (not
+       * counting the calling thread).
+       */
+      virtual unsigned GetWorkerThreadCount(const Device* caller) = 0;
+
       // sequence acquisition
       virtual int AcqFinished(const Device* caller, int statusCode) = 0;
       virtual int PrepareForAcq(const Device* caller) = 0;
@@ -1393,6 +1578,12 @@ namespace MM {
       virtual bool InitializeImageBuffer(unsigned channels, unsigned slices, unsigned int w, unsigned int h, unsigned int pixDepth) = 0;
       /// \deprecated Use the other forms instead.
       virtual int InsertMultiChannel(const Device* caller, const unsigned char* buf, unsigned numChannels, unsigned width, unsigned height, unsigned byteDepth, Metadata* md = 0) = 0;
+      /**
+       * Inserts an image processed by an asynchronous image processor (see
+       * ImageProcessor::ProcessAsync()). The metadata is stored as given; no
+       * camera tags are added and no further processing is done.
+       */
+      virtual int InsertProcessedImage(const Device* caller, const unsigned char* buf, unsigned width, unsigned height, unsigned byteDepth, unsigned nComponents, const char* serializedMetadata) = 0;
 
       // Formerly intended for use by autofocus
       MM_DEPRECATED(virtual const char* GetImage()) = 0;
@@ -173,6 +173,21 @@ namespace MM {
    const char* const g_Keyword_Metadata_ROI_X       = "ROI-X-start";
    const char* const g_Keyword_Metadata_ROI_Y       = "ROI-Y-start";
    const char* const g_Keyword_Metadata_TimeInCore  = "TimeReceivedByCore";
+   // Number of frames the Core had discarded on buffer overflow (since the
+   // buffer was last cleared) when this frame was received
+   const char* const g_Keyword_Metadata_DroppedImages = "DroppedImagesInCore";
+   // Core clock time (microseconds, as returned by GetCurrentMMTime()) at
+   // which the camera reported the corresponding event for this frame
+   const char* const g_Keyword_Metadata_ExposureStartTime = "ExposureStartTime-us";
+   const char* const g_Keyword_Metadata_ExposureEndTime   = "ExposureEndTime-us";
+   // Pixel statistics of this frame computed by the Core when it was
+   // received, if enabled. The histogram is an array tag of bin counts.
+   const char* const g_Keyword_Metadata_StatisticsMin       = "Statistics-Min";
+   const char* const g_Keyword_Metadata_StatisticsMax       = "Statistics-Max";
+   const char* const g_Keyword_Metadata_StatisticsMean      = "Statistics-Mean";
+   const char* const g_Keyword_Metadata_StatisticsStdDev    = "Statistics-StdDev";
+   const char* const g_Keyword_Metadata_StatisticsSaturated = "Statistics-SaturatedCount";
+   const char* const g_Keyword_Metadata_StatisticsHistogram = "Statistics-Histogram";
 
    // configuration file format constants
    const char* const g_FieldDelimiters = ",";
@@ -221,6 +236,61 @@ namespace MM {
    const int _STOPBITS_1_5 = 3;
    const int _STOPBITS_2 = 2;
 
+   // camera trigger API constants (see camera_triggering_API_v2.md; names
+   // follow the GenICam SFNC)
+
+   // trigger selectors
+   const int TriggerSelectorAcquisitionStart = 0;
+   const int TriggerSelectorAcquisitionEnd = 1;
+   const int TriggerSelectorAcquisitionActive = 2;
+   const int TriggerSelectorFrameBurstStart = 3;
+   const int TriggerSelectorFrameBurstEnd = 4;
+   const int TriggerSelectorFrameBurstActive = 5;
+   const int TriggerSelectorFrameStart = 6;
+   const int TriggerSelectorFrameEnd = 7;
+   const int TriggerSelectorFrameActive = 8;
+   const int TriggerSelectorExposureStart = 9;
+   const int TriggerSelectorExposureEnd = 10;
+   const int TriggerSelectorExposureActive = 11;
+
+   // trigger modes
+   const int TriggerModeOn = 0;
+   const int TriggerModeOff = 1;
+
+   // trigger sources: internal timer, TTL pulse, or TriggerSoftware() call
+   const int TriggerSourceInternal = 0;
+   const int TriggerSourceExternal = 1;
+   const int TriggerSourceSoftware = 2;
+
+   // trigger activations
+   const int TriggerActivationAnyEdge = 0;
+   const int TriggerActivationRisingEdge = 1;
+   const int TriggerActivationFallingEdge = 2;
+   const int TriggerActivationLevelLow = 3;
+   const int TriggerActivationLevelHigh = 4;
+
+   // trigger overlap: when the next trigger may be accepted
+   const int TriggerOverlapOff = 0;
+   const int TriggerOverlapReadout = 1;
+   const int TriggerOverlapPreviousFrame = 2;
+
+   // camera events, reported through MM::Core::OnCameraEvent()
+   const int CameraEventAcquisitionTrigger = 0;
+   const int CameraEventAcquisitionStart = 1;
+   const int CameraEventAcquisitionEnd = 2;
+   const int CameraEventAcquisitionTransferStart = 3;
+   const int CameraEventAcquisitionTransferEnd = 4;
+   const int CameraEventAcquisitionError = 5;
+   const int CameraEventFrameTrigger = 6;
+   const int CameraEventFrameStart = 7;
+   const int CameraEventFrameEnd = 8;
+   const int CameraEventFrameBurstStart = 9;
+   const int CameraEventFrameBurstEnd = 10;
+   const int CameraEventFrameTransferStart = 11;
+   const int CameraEventFrameTransferEnd = 12;
+   const int CameraEventExposureStart = 13;
+   const int CameraEventExposureEnd = 14;
+
 
    //////////////////////////////////////////////////////////////////////////////
    // Type constants
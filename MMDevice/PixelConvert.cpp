@@ -0,0 +1,449 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvert.cpp
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of packed YUV and RGB camera formats to
+//                Micro-Manager's 32-bit color format, with SSE2 and AVX2
+//                implementations selected at run time.
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#include "PixelConvert.h"
+
+#include "CpuFeatures.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PIXELCONVERT_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+// MSVC allows intrinsics for any instruction set without special flags
+#define PIXELCONVERT_TARGET_SSE2
+#define PIXELCONVERT_TARGET_AVX2
+#else
+// GCC and Clang need the target enabled per function, since we do not
+// compile the whole file with -mavx2
+#define PIXELCONVERT_TARGET_SSE2 __attribute__((target("sse2")))
+#define PIXELCONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace PixelConvert {
+
+namespace {
+
+/*
+ * Scalar implementation. The YUV to RGB arithmetic is that of libdc1394's
+ * YUV2RGB, which the SIMD versions reproduce exactly.
+ */
+
+inline unsigned char Clamp(int v)
+{
+   return static_cast<unsigned char>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+inline void YUVToBGRA(unsigned char* dst, int y, int u, int v)
+{
+   u -= 128;
+   v -= 128;
+   dst[0] = Clamp(y + ((u * 1814) >> 10));
+   dst[1] = Clamp(y - ((u * 352 + v * 731) >> 10));
+   dst[2] = Clamp(y + ((v * 1436) >> 10));
+   dst[3] = 0;
+}
+
+void ScalarToBGRA32(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, SourceFormat format)
+{
+   switch (format)
+   {
+      case YUV444_UYV:
+         for (std::size_t i = 0; i < pixelCount; ++i, src += 3, dst += 4)
+            YUVToBGRA(dst, src[1], src[0], src[2]);
+         break;
+
+      case YUV422_UYVY:
+         for (std::size_t i = 0; i + 2 <= pixelCount; i += 2, src += 4, dst += 8)
+         {
+            YUVToBGRA(dst, src[1], src[0], src[2]);
+            YUVToBGRA(dst + 4, src[3], src[0], src[2]);
+         }
+         break;
+
+      case YUV411_UYYVYY:
+         for (std::size_t i = 0; i + 4 <= pixelCount; i += 4, src += 6, dst += 16)
+         {
+            YUVToBGRA(dst, src[1], src[0], src[3]);
+            YUVToBGRA(dst + 4, src[2], src[0], src[3]);
+            YUVToBGRA(dst + 8, src[4], src[0], src[3]);
+            YUVToBGRA(dst + 12, src[5], src[0], src[3]);
+         }
+         break;
+
+      case RGB24:
+         for (std::size_t i = 0; i < pixelCount; ++i, src += 3, dst += 4)
+         {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = 0;
+         }
+         break;
+   }
+}
+
+#ifdef PIXELCONVERT_X86
+
+/*
+ * SSE2 implementation: 8 pixels per iteration. The 3-byte-per-pixel YUV
+ * format and YUV411 are gathered into 16-bit lanes with scalar loads, since
+ * SSE2 has no byte shuffle.
+ */
+
+// Computes B, G, R from 8 (Y, U - 128, V - 128) in 16-bit lanes, in the same
+// way as YUVToBGRA(). Intermediate sums need 32 bits, which madd provides.
+PIXELCONVERT_TARGET_SSE2
+inline void YUVToBGR16_SSE2(__m128i y, __m128i u, __m128i v,
+      __m128i& b, __m128i& g, __m128i& r)
+{
+   const __m128i kB = _mm_set1_epi32(1024 | (1814 << 16));
+   const __m128i kG = _mm_set1_epi32(352 | (731 << 16));
+   const __m128i kR = _mm_set1_epi32(1024 | (1436 << 16));
+
+   // (y * 1024 + u * 1814) >> 10 == y + ((u * 1814) >> 10)
+   __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, u), kB), 10);
+   __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, u), kB), 10);
+   b = _mm_packs_epi32(lo, hi);
+
+   lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(u, v), kG), 10);
+   hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(u, v), kG), 10);
+   g = _mm_sub_epi16(y, _mm_packs_epi32(lo, hi));
+
+   lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(y, v), kR), 10);
+   hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(y, v), kR), 10);
+   r = _mm_packs_epi32(lo, hi);
+}
+
+// Saturates 8 B, G, R values in 16-bit lanes to bytes and stores 8 pixels
+PIXELCONVERT_TARGET_SSE2
+inline void StoreBGRA_SSE2(unsigned char* dst, __m128i b, __m128i g, __m128i r)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i b8 = _mm_packus_epi16(b, b);
+   const __m128i g8 = _mm_packus_epi16(g, g);
+   const __m128i r8 = _mm_packus_epi16(r, r);
+   const __m128i bg = _mm_unpacklo_epi8(b8, g8);
+   const __m128i r0 = _mm_unpacklo_epi8(r8, zero);
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(bg, r0));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(bg, r0));
+}
+
+// Returns the number of pixels converted
+PIXELCONVERT_TARGET_SSE2
+std::size_t SSE2ToBGRA32(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, SourceFormat format)
+{
+   const __m128i k128 = _mm_set1_epi16(128);
+   std::size_t i = 0;
+   __m128i y, u, v, b, g, r;
+
+   switch (format)
+   {
+      case YUV444_UYV:
+         for (; i + 8 <= pixelCount; i += 8, src += 24, dst += 32)
+         {
+            y = _mm_setr_epi16(src[1], src[4], src[7], src[10],
+                  src[13], src[16], src[19], src[22]);
+            u = _mm_setr_epi16(src[0], src[3], src[6], src[9],
+                  src[12], src[15], src[18], src[21]);
+            v = _mm_setr_epi16(src[2], src[5], src[8], src[11],
+                  src[14], src[17], src[20], src[23]);
+            YUVToBGR16_SSE2(y, _mm_sub_epi16(u, k128), _mm_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_SSE2(dst, b, g, r);
+         }
+         break;
+
+      case YUV422_UYVY:
+         for (; i + 8 <= pixelCount; i += 8, src += 16, dst += 32)
+         {
+            // As little-endian 16-bit words: Y in the high byte, U or V in
+            // the low byte
+            const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            y = _mm_srli_epi16(w, 8);
+            const __m128i uv = _mm_and_si128(w, _mm_set1_epi16(0xff));
+            // Each (U, V) pair is shared by 2 pixels
+            u = _mm_and_si128(uv, _mm_set1_epi32(0xffff));
+            u = _mm_or_si128(u, _mm_slli_epi32(u, 16));
+            v = _mm_srli_epi32(uv, 16);
+            v = _mm_or_si128(v, _mm_slli_epi32(v, 16));
+            YUVToBGR16_SSE2(y, _mm_sub_epi16(u, k128), _mm_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_SSE2(dst, b, g, r);
+         }
+         break;
+
+      case YUV411_UYYVYY:
+         for (; i + 8 <= pixelCount; i += 8, src += 12, dst += 32)
+         {
+            y = _mm_setr_epi16(src[1], src[2], src[4], src[5],
+                  src[7], src[8], src[10], src[11]);
+            u = _mm_setr_epi16(src[0], src[0], src[0], src[0],
+                  src[6], src[6], src[6], src[6]);
+            v = _mm_setr_epi16(src[3], src[3], src[3], src[3],
+                  src[9], src[9], src[9], src[9]);
+            YUVToBGR16_SSE2(y, _mm_sub_epi16(u, k128), _mm_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_SSE2(dst, b, g, r);
+         }
+         break;
+
+      case RGB24:
+         // Pure byte reordering; without a byte shuffle, gathering into
+         // vectors is slower than the scalar loop
+         break;
+   }
+   return i;
+}
+
+/*
+ * AVX2 implementation: 16 pixels per iteration, 8 in each 128-bit lane.
+ * Byte shuffles (which operate within lanes) deinterleave the source, so
+ * each lane is loaded separately for the formats that are not 2 bytes per
+ * pixel. Loops stop early enough that the 16-byte loads never read past the
+ * end of the source.
+ */
+
+PIXELCONVERT_TARGET_AVX2
+inline __m256i LoadLanes_AVX2(const unsigned char* lo, const unsigned char* hi)
+{
+   return _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+PIXELCONVERT_TARGET_AVX2
+inline void YUVToBGR16_AVX2(__m256i y, __m256i u, __m256i v,
+      __m256i& b, __m256i& g, __m256i& r)
+{
+   const __m256i kB = _mm256_set1_epi32(1024 | (1814 << 16));
+   const __m256i kG = _mm256_set1_epi32(352 | (731 << 16));
+   const __m256i kR = _mm256_set1_epi32(1024 | (1436 << 16));
+
+   __m256i lo = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, u), kB), 10);
+   __m256i hi = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, u), kB), 10);
+   b = _mm256_packs_epi32(lo, hi);
+
+   lo = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(u, v), kG), 10);
+   hi = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(u, v), kG), 10);
+   g = _mm256_sub_epi16(y, _mm256_packs_epi32(lo, hi));
+
+   lo = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, v), kR), 10);
+   hi = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, v), kR), 10);
+   r = _mm256_packs_epi32(lo, hi);
+}
+
+// Stores 16 pixels; lane 0 of the inputs holds pixels 0-7, lane 1 pixels 8-15
+PIXELCONVERT_TARGET_AVX2
+inline void StoreBGRA_AVX2(unsigned char* dst, __m256i b, __m256i g, __m256i r)
+{
+   const __m256i zero = _mm256_setzero_si256();
+   const __m256i b8 = _mm256_packus_epi16(b, b);
+   const __m256i g8 = _mm256_packus_epi16(g, g);
+   const __m256i r8 = _mm256_packus_epi16(r, r);
+   const __m256i bg = _mm256_unpacklo_epi8(b8, g8);
+   const __m256i r0 = _mm256_unpacklo_epi8(r8, zero);
+   const __m256i p0 = _mm256_unpacklo_epi16(bg, r0); // pixels 0-3, 8-11
+   const __m256i p1 = _mm256_unpackhi_epi16(bg, r0); // pixels 4-7, 12-15
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+         _mm256_permute2x128_si256(p0, p1, 0x20));
+   _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32),
+         _mm256_permute2x128_si256(p0, p1, 0x31));
+}
+
+#define PIXELCONVERT_LANE_MASK(...) \
+   _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+PIXELCONVERT_TARGET_AVX2
+std::size_t AVX2ToBGRA32(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, SourceFormat format)
+{
+   const __m256i k128 = _mm256_set1_epi16(128);
+   std::size_t i = 0;
+   __m256i y, u, v, b, g, r;
+
+   switch (format)
+   {
+      case YUV444_UYV:
+      {
+         // Each lane: 8 pixels (24 bytes) from two overlapping loads; the
+         // first supplies pixels 0-4, the second (at offset 8) pixels 5-7
+         const __m256i yA = PIXELCONVERT_LANE_MASK(1, -1, 4, -1, 7, -1, 10, -1,
+               13, -1, -1, -1, -1, -1, -1, -1);
+         const __m256i yB = PIXELCONVERT_LANE_MASK(-1, -1, -1, -1, -1, -1, -1, -1,
+               -1, -1, 8, -1, 11, -1, 14, -1);
+         const __m256i uA = PIXELCONVERT_LANE_MASK(0, -1, 3, -1, 6, -1, 9, -1,
+               12, -1, -1, -1, -1, -1, -1, -1);
+         const __m256i uB = PIXELCONVERT_LANE_MASK(-1, -1, -1, -1, -1, -1, -1, -1,
+               -1, -1, 7, -1, 10, -1, 13, -1);
+         const __m256i vA = PIXELCONVERT_LANE_MASK(2, -1, 5, -1, 8, -1, 11, -1,
+               14, -1, -1, -1, -1, -1, -1, -1);
+         const __m256i vB = PIXELCONVERT_LANE_MASK(-1, -1, -1, -1, -1, -1, -1, -1,
+               -1, -1, 9, -1, 12, -1, 15, -1);
+         for (; i + 16 <= pixelCount; i += 16, src += 48, dst += 64)
+         {
+            const __m256i a = LoadLanes_AVX2(src, src + 24);
+            const __m256i c = LoadLanes_AVX2(src + 8, src + 32);
+            y = _mm256_or_si256(_mm256_shuffle_epi8(a, yA), _mm256_shuffle_epi8(c, yB));
+            u = _mm256_or_si256(_mm256_shuffle_epi8(a, uA), _mm256_shuffle_epi8(c, uB));
+            v = _mm256_or_si256(_mm256_shuffle_epi8(a, vA), _mm256_shuffle_epi8(c, vB));
+            YUVToBGR16_AVX2(y, _mm256_sub_epi16(u, k128), _mm256_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_AVX2(dst, b, g, r);
+         }
+         break;
+      }
+
+      case YUV422_UYVY:
+         for (; i + 16 <= pixelCount; i += 16, src += 32, dst += 64)
+         {
+            const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+            y = _mm256_srli_epi16(w, 8);
+            const __m256i uv = _mm256_and_si256(w, _mm256_set1_epi16(0xff));
+            u = _mm256_and_si256(uv, _mm256_set1_epi32(0xffff));
+            u = _mm256_or_si256(u, _mm256_slli_epi32(u, 16));
+            v = _mm256_srli_epi32(uv, 16);
+            v = _mm256_or_si256(v, _mm256_slli_epi32(v, 16));
+            YUVToBGR16_AVX2(y, _mm256_sub_epi16(u, k128), _mm256_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_AVX2(dst, b, g, r);
+         }
+         break;
+
+      case YUV411_UYYVYY:
+      {
+         // Each lane: 8 pixels from 12 bytes (16-byte load)
+         const __m256i yM = PIXELCONVERT_LANE_MASK(1, -1, 2, -1, 4, -1, 5, -1,
+               7, -1, 8, -1, 10, -1, 11, -1);
+         const __m256i uM = PIXELCONVERT_LANE_MASK(0, -1, 0, -1, 0, -1, 0, -1,
+               6, -1, 6, -1, 6, -1, 6, -1);
+         const __m256i vM = PIXELCONVERT_LANE_MASK(3, -1, 3, -1, 3, -1, 3, -1,
+               9, -1, 9, -1, 9, -1, 9, -1);
+         // The last load reads 4 bytes beyond the 24 consumed
+         for (; i + 16 + 4 <= pixelCount; i += 16, src += 24, dst += 64)
+         {
+            const __m256i a = LoadLanes_AVX2(src, src + 12);
+            y = _mm256_shuffle_epi8(a, yM);
+            u = _mm256_shuffle_epi8(a, uM);
+            v = _mm256_shuffle_epi8(a, vM);
+            YUVToBGR16_AVX2(y, _mm256_sub_epi16(u, k128), _mm256_sub_epi16(v, k128), b, g, r);
+            StoreBGRA_AVX2(dst, b, g, r);
+         }
+         break;
+      }
+
+      case RGB24:
+      {
+         // Each lane: 4 pixels from 12 bytes, shuffled straight to B, G, R, 0
+         const __m256i m = PIXELCONVERT_LANE_MASK(2, 1, 0, -1, 5, 4, 3, -1,
+               8, 7, 6, -1, 11, 10, 9, -1);
+         // The last load reads 4 bytes beyond the 48 consumed
+         for (; i + 16 + 2 <= pixelCount; i += 16, src += 48, dst += 64)
+         {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),
+                  _mm256_shuffle_epi8(LoadLanes_AVX2(src, src + 12), m));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32),
+                  _mm256_shuffle_epi8(LoadLanes_AVX2(src + 24, src + 36), m));
+         }
+         break;
+      }
+   }
+   return i;
+}
+
+#undef PIXELCONVERT_LANE_MASK
+
+#endif // PIXELCONVERT_X86
+
+Implementation DetectBestImplementation()
+{
+#ifdef PIXELCONVERT_X86
+   if (CpuFeatures::HasAVX2())
+      return ImplementationAVX2;
+   if (CpuFeatures::HasSSE2())
+      return ImplementationSSE2;
+#endif
+   return ImplementationScalar;
+}
+
+} // anonymous namespace
+
+
+bool IsImplementationAvailable(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto:
+      case ImplementationScalar:
+         return true;
+#ifdef PIXELCONVERT_X86
+      case ImplementationSSE2:
+         return CpuFeatures::HasSSE2();
+      case ImplementationAVX2:
+         return CpuFeatures::HasAVX2();
+#endif
+      default:
+         return false;
+   }
+}
+
+
+Implementation GetBestImplementation()
+{
+   static const Implementation best = DetectBestImplementation();
+   return best;
+}
+
+
+std::size_t SourceBytes(SourceFormat format, std::size_t pixelCount)
+{
+   switch (format)
+   {
+      case YUV422_UYVY:
+         return pixelCount * 2;
+      case YUV411_UYYVYY:
+         return pixelCount * 3 / 2;
+      case YUV444_UYV:
+      case RGB24:
+      default:
+         return pixelCount * 3;
+   }
+}
+
+
+void ToBGRA32(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, SourceFormat format, Implementation impl)
+{
+   if (impl == ImplementationAuto)
+      impl = GetBestImplementation();
+   else if (!IsImplementationAvailable(impl))
+      impl = ImplementationScalar;
+
+   std::size_t done = 0;
+#ifdef PIXELCONVERT_X86
+   if (impl == ImplementationAVX2)
+      done = AVX2ToBGRA32(dst, src, pixelCount, format);
+   else if (impl == ImplementationSSE2)
+      done = SSE2ToBGRA32(dst, src, pixelCount, format);
+#endif
+
+   // Remaining pixels (or all, for the scalar implementation)
+   ScalarToBGRA32(dst + 4 * done, src + SourceBytes(format, done),
+         pixelCount - done, format);
+}
+
+} // namespace PixelConvert
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// FILE:          PixelConvert.h
+// PROJECT:       Micro-Manager
+// SUBSYSTEM:     MMDevice - Device adapter kit
+//-----------------------------------------------------------------------------
+// DESCRIPTION:   Conversion of packed YUV and RGB camera formats to
+//                Micro-Manager's 32-bit color format, with SSE2 and AVX2
+//                implementations selected at run time.
+// LICENSE:       This file is distributed under the BSD license.
+//                License text is included with the source distribution.
+//
+//                This file is distributed in the hope that it will be useful,
+//                but WITHOUT ANY WARRANTY; without even the implied warranty
+//                of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+//
+//                IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+//                CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+//                INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES.
+//
+
+#pragma once
+
+#include <cstddef>
+
+namespace PixelConvert {
+
+// Source formats, named by their byte order in memory (the IIDC/DCAM
+// orders).
+enum SourceFormat
+{
+   YUV444_UYV,    // 3 bytes per pixel
+   YUV422_UYVY,   // 4 bytes per 2 pixels
+   YUV411_UYYVYY, // 6 bytes per 4 pixels
+   RGB24,         // 3 bytes per pixel
+};
+
+enum Implementation
+{
+   ImplementationAuto, // Fastest one available on this CPU
+   ImplementationScalar,
+   ImplementationSSE2,
+   ImplementationAVX2,
+};
+
+bool IsImplementationAvailable(Implementation impl);
+Implementation GetBestImplementation();
+
+// Number of source bytes occupied by pixelCount pixels
+std::size_t SourceBytes(SourceFormat format, std::size_t pixelCount);
+
+// Converts pixelCount pixels to Micro-Manager's RGB32 layout (bytes B, G, R,
+// 0). YUV is converted with the same integer arithmetic as libdc1394, so all
+// implementations produce identical output. For subsampled formats,
+// pixelCount should be a multiple of the subsampling group (2 or 4 pixels);
+// a trailing partial group is left unconverted. Source and destination must
+// not overlap.
+void ToBGRA32(unsigned char* dst, const unsigned char* src,
+      std::size_t pixelCount, SourceFormat format,
+      Implementation impl = ImplementationAuto);
+
+} // namespace PixelConvert
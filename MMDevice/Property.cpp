@@ -302,6 +302,67 @@ int MM::PropertyCollection::Get(const char* pszPropName, std::string& strValue)
    return DEVICE_OK;
 }
 
+namespace {
+
+template <typename T>
+int SetNumeric(MM::Property* pProp, T value)
+{
+   if (!pProp)
+      return DEVICE_INVALID_PROPERTY; // name not found
+
+   if (pProp->GetType() == MM::String || pProp->HasAllowedValues())
+      return DEVICE_INVALID_PROPERTY_TYPE;
+
+   if (pProp->GetReadOnly())
+      return DEVICE_OK; // Same as for string values
+
+   if (!pProp->Set(value))
+      return DEVICE_INVALID_PROPERTY_VALUE;
+
+   return pProp->Apply();
+}
+
+template <typename T>
+int GetNumeric(MM::Property* pProp, T& value)
+{
+   if (!pProp)
+      return DEVICE_INVALID_PROPERTY; // name not found
+
+   if (pProp->GetType() == MM::String)
+      return DEVICE_INVALID_PROPERTY_TYPE;
+
+   if (!pProp->GetCached())
+   {
+      int nRet = pProp->Update();
+      if (nRet != DEVICE_OK)
+         return nRet;
+   }
+   pProp->Get(value);
+   return DEVICE_OK;
+}
+
+} // anonymous namespace
+
+int MM::PropertyCollection::Set(const char* pszPropName, double dValue)
+{
+   return SetNumeric(Find(pszPropName), dValue);
+}
+
+int MM::PropertyCollection::Set(const char* pszPropName, long lValue)
+{
+   return SetNumeric(Find(pszPropName), lValue);
+}
+
+int MM::PropertyCollection::Get(const char* pszPropName, double& dValue) const
+{
+   return GetNumeric(Find(pszPropName), dValue);
+}
+
+int MM::PropertyCollection::Get(const char* pszPropName, long& lValue) const
+{
+   return GetNumeric(Find(pszPropName), lValue);
+}
+
 MM::Property* MM::PropertyCollection::Find(const char* pszName) const
 {
    CPropArray::const_iterator it = properties_.find(pszName);
@@ -198,6 +198,7 @@ public:
    void AddAllowedValue(const char* value);
    void AddAllowedValue(const char* value, long data);
    bool IsAllowed(const char* value) const;
+   bool HasAllowedValues() const {return !values_.empty();}
    bool GetData(const char* value, long& data) const;
 
    bool HasLimits() const 
@@ -447,6 +448,13 @@ public:
    int GetCurrentPropertyData(const char* name, long& data);
    int Set(const char* propName, const char* Value);
    int Get(const char* propName, std::string& val) const;
+   // Numeric access without string conversion. These return
+   // DEVICE_INVALID_PROPERTY_TYPE for string properties, and the setters
+   // also for properties with allowed values (which are matched as strings).
+   int Set(const char* propName, double val);
+   int Set(const char* propName, long val);
+   int Get(const char* propName, double& val) const;
+   int Get(const char* propName, long& val) const;
    Property* Find(const char* name) const;
    std::vector<std::string> GetNames() const;
    unsigned GetSize() const;
@@ -0,0 +1,161 @@
+#include <catch2/catch_all.hpp>
+
+#include "PixelConvert.h"
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace PixelConvert;
+
+namespace {
+
+const SourceFormat allFormats[] = {
+   YUV444_UYV, YUV422_UYVY, YUV411_UYYVYY, RGB24,
+};
+
+const Implementation simdImplementations[] = {
+   ImplementationSSE2, ImplementationAVX2,
+};
+
+std::string FormatName(SourceFormat format)
+{
+   switch (format)
+   {
+      case YUV444_UYV: return "YUV444";
+      case YUV422_UYVY: return "YUV422";
+      case YUV411_UYYVYY: return "YUV411";
+      case RGB24: return "RGB24";
+   }
+   return "?";
+}
+
+std::string ImplementationName(Implementation impl)
+{
+   switch (impl)
+   {
+      case ImplementationAuto: return "auto";
+      case ImplementationScalar: return "scalar";
+      case ImplementationSSE2: return "SSE2";
+      case ImplementationAVX2: return "AVX2";
+   }
+   return "?";
+}
+
+std::vector<unsigned char> RandomSource(SourceFormat format, std::size_t pixelCount)
+{
+   std::mt19937 gen(42);
+   std::uniform_int_distribution<int> dist(0, 255);
+   std::vector<unsigned char> src(SourceBytes(format, pixelCount));
+   for (std::size_t i = 0; i < src.size(); ++i)
+      src[i] = static_cast<unsigned char>(dist(gen));
+   return src;
+}
+
+std::vector<unsigned char> Convert(const std::vector<unsigned char>& src,
+      std::size_t pixelCount, SourceFormat format, Implementation impl)
+{
+   std::vector<unsigned char> dst(4 * pixelCount, 0xcd);
+   ToBGRA32(dst.data(), src.data(), pixelCount, format, impl);
+   return dst;
+}
+
+} // anonymous namespace
+
+TEST_CASE("PixelConvert RGB24 reorders to BGRA", "[PixelConvert]")
+{
+   const unsigned char src[] = { 1, 2, 3, 4, 5, 6 };
+   unsigned char dst[8];
+   ToBGRA32(dst, src, 2, RGB24, ImplementationScalar);
+   const unsigned char expected[] = { 3, 2, 1, 0, 6, 5, 4, 0 };
+   CHECK(std::vector<unsigned char>(dst, dst + 8) ==
+         std::vector<unsigned char>(expected, expected + 8));
+}
+
+TEST_CASE("PixelConvert neutral chroma gives gray", "[PixelConvert]")
+{
+   // U Y0 V Y1
+   const unsigned char src[] = { 128, 0, 128, 255 };
+   unsigned char dst[8];
+   ToBGRA32(dst, src, 2, YUV422_UYVY, ImplementationScalar);
+   const unsigned char expected[] = { 0, 0, 0, 0, 255, 255, 255, 0 };
+   CHECK(std::vector<unsigned char>(dst, dst + 8) ==
+         std::vector<unsigned char>(expected, expected + 8));
+}
+
+TEST_CASE("PixelConvert saturates", "[PixelConvert]")
+{
+   // Strong blue chroma on a bright pixel: B clips high, R clips low
+   const unsigned char src[] = { 255, 250, 0 }; // U Y V
+   unsigned char dst[4];
+   ToBGRA32(dst, src, 1, YUV444_UYV, ImplementationScalar);
+   CHECK(dst[0] == 255);
+   CHECK(dst[2] == 70); // 250 + ((-128 * 1436) >> 10) = 250 - 180
+   CHECK(dst[3] == 0);
+}
+
+TEST_CASE("PixelConvert partial subsampling group is left alone", "[PixelConvert]")
+{
+   const std::vector<unsigned char> src = RandomSource(YUV411_UYYVYY, 8);
+   const std::vector<unsigned char> dst = Convert(src, 7, YUV411_UYYVYY,
+         ImplementationScalar);
+   CHECK(dst[15] == 0);
+   CHECK(dst[16] == 0xcd);
+}
+
+TEST_CASE("PixelConvert SIMD matches scalar", "[PixelConvert]")
+{
+   // Sizes around the SIMD block sizes exercise the scalar tail handling
+   const std::size_t sizes[] = { 0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 64,
+      100, 640 * 480 };
+
+   for (Implementation impl : simdImplementations)
+   {
+      if (!IsImplementationAvailable(impl))
+      {
+         WARN(ImplementationName(impl) << " not available on this CPU");
+         continue;
+      }
+      for (SourceFormat format : allFormats)
+      {
+         for (std::size_t n : sizes)
+         {
+            INFO(ImplementationName(impl) << ' ' << FormatName(format) <<
+                  ' ' << n << " pixels");
+            const std::vector<unsigned char> src = RandomSource(format, n);
+            CHECK(Convert(src, n, format, impl) ==
+                  Convert(src, n, format, ImplementationScalar));
+         }
+      }
+   }
+}
+
+TEST_CASE("PixelConvert auto uses an available implementation", "[PixelConvert]")
+{
+   CHECK(IsImplementationAvailable(GetBestImplementation()));
+   CHECK(GetBestImplementation() != ImplementationAuto);
+}
+
+// Not run by default; run with the tag [.benchmark] to compare throughput
+TEST_CASE("PixelConvert benchmark", "[.benchmark][PixelConvert]")
+{
+   const std::size_t n = 1920 * 1080;
+   std::vector<unsigned char> dst(4 * n);
+
+   for (SourceFormat format : allFormats)
+   {
+      const std::vector<unsigned char> src = RandomSource(format, n);
+      for (Implementation impl : { ImplementationScalar, ImplementationSSE2,
+            ImplementationAVX2 })
+      {
+         if (!IsImplementationAvailable(impl))
+            continue;
+         BENCHMARK(FormatName(format) + " 1920x1080 " + ImplementationName(impl))
+         {
+            ToBGRA32(dst.data(), src.data(), n, format, impl);
+            return dst[0];
+         };
+      }
+   }
+}
@@ -0,0 +1,164 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+const long maxSequenceLength = 100000;
+
+// Stage whose only interesting feature is a sequenceable numeric property and
+// a stage sequence that records the calls it receives
+class TestStage : public CStageBase<TestStage>
+{
+public:
+   TestStage() : addCalls_(0)
+   {
+      CreateFloatProperty("Voltage", 0.0, false,
+            new CPropertyAction(this, &TestStage::OnVoltage));
+   }
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const { CDeviceUtils::CopyLimitedString(name, "TestStage"); }
+   bool Busy() { return false; }
+
+   int SetPositionUm(double) { return DEVICE_OK; }
+   int GetPositionUm(double& pos) { pos = 0.0; return DEVICE_OK; }
+   int SetPositionSteps(long) { return DEVICE_OK; }
+   int GetPositionSteps(long& steps) { steps = 0; return DEVICE_OK; }
+   int SetOrigin() { return DEVICE_OK; }
+   int GetLimits(double& lower, double& upper) { lower = upper = 0.0; return DEVICE_OK; }
+   bool IsContinuousFocusDrive() const { return false; }
+
+   int IsStageSequenceable(bool& isSequenceable) const { isSequenceable = true; return DEVICE_OK; }
+   int GetStageSequenceMaxLength(long& nrEvents) const { nrEvents = maxSequenceLength; return DEVICE_OK; }
+   int ClearStageSequence() { positions_.clear(); return DEVICE_OK; }
+   int AddToStageSequence(double position)
+   {
+      ++addCalls_;
+      positions_.push_back(position);
+      return DEVICE_OK;
+   }
+
+   int OnVoltage(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::IsSequenceable)
+         pProp->SetSequenceable(maxSequenceLength);
+      else if (eAct == MM::AfterLoadSequence)
+         sentSequence_ = pProp->GetSequence();
+      return DEVICE_OK;
+   }
+
+   long addCalls_;
+   std::vector<double> positions_;
+   std::vector<std::string> sentSequence_;
+};
+
+// Same, but with a native array implementation
+class NativeArrayTestStage : public TestStage
+{
+public:
+   int AddArrayToStageSequence(const double* positions, unsigned long count)
+   {
+      positions_.insert(positions_.end(), positions, positions + count);
+      return DEVICE_OK;
+   }
+};
+
+std::vector<double> Ramp(size_t n)
+{
+   std::vector<double> values(n);
+   for (size_t i = 0; i < n; ++i)
+      values[i] = 0.001 * static_cast<double>(i) + 0.1;
+   return values;
+}
+
+} // anonymous namespace
+
+TEST_CASE("Default AddArrayToStageSequence adds each value", "[SequenceUpload]")
+{
+   TestStage stage;
+   MM::Stage& device = stage;
+   const std::vector<double> values = Ramp(10);
+   CHECK(device.AddArrayToStageSequence(values.data(), 10) == DEVICE_OK);
+   CHECK(stage.addCalls_ == 10);
+   CHECK(stage.positions_ == values);
+}
+
+TEST_CASE("Default AddArrayToPropertySequence round-trips values", "[SequenceUpload]")
+{
+   TestStage stage;
+   const std::vector<double> values = Ramp(50);
+   REQUIRE(stage.ClearPropertySequence("Voltage") == DEVICE_OK);
+   REQUIRE(stage.AddArrayToPropertySequence("Voltage", values.data(), 50) == DEVICE_OK);
+   REQUIRE(stage.SendPropertySequence("Voltage") == DEVICE_OK);
+
+   REQUIRE(stage.sentSequence_.size() == 50);
+   for (size_t i = 0; i < values.size(); ++i)
+      CHECK(std::atof(stage.sentSequence_[i].c_str()) == values[i]);
+}
+
+TEST_CASE("Default AddArrayToPropertySequence enforces max length", "[SequenceUpload]")
+{
+   TestStage stage;
+   const std::vector<double> values = Ramp(maxSequenceLength + 1);
+   CHECK(stage.AddArrayToPropertySequence("Voltage", values.data(),
+         static_cast<unsigned long>(values.size())) == DEVICE_SEQUENCE_TOO_LARGE);
+}
+
+TEST_CASE("AddArrayToPropertySequence rejects unknown property", "[SequenceUpload]")
+{
+   TestStage stage;
+   const double value = 1.0;
+   CHECK(stage.AddArrayToPropertySequence("NoSuchProperty", &value, 1) ==
+         DEVICE_INVALID_PROPERTY);
+}
+
+// Not run by default; run with the tag [.benchmark] to compare upload times
+TEST_CASE("Sequence upload benchmark", "[.benchmark][SequenceUpload]")
+{
+   const std::vector<double> values = Ramp(10000);
+   const unsigned long n = static_cast<unsigned long>(values.size());
+
+   TestStage stage;
+   BENCHMARK("10k property values, one at a time")
+   {
+      char buf[MM::MaxStrLength];
+      stage.ClearPropertySequence("Voltage");
+      for (unsigned long i = 0; i < n; ++i)
+      {
+         std::snprintf(buf, MM::MaxStrLength, "%.17g", values[i]);
+         stage.AddToPropertySequence("Voltage", buf);
+      }
+      return stage.SendPropertySequence("Voltage");
+   };
+   BENCHMARK("10k property values, array")
+   {
+      stage.ClearPropertySequence("Voltage");
+      stage.AddArrayToPropertySequence("Voltage", values.data(), n);
+      return stage.SendPropertySequence("Voltage");
+   };
+
+   // Called through MM::Stage, as the Core does
+   MM::Stage& device = stage;
+   BENCHMARK("10k stage positions, one at a time")
+   {
+      device.ClearStageSequence();
+      for (unsigned long i = 0; i < n; ++i)
+         device.AddToStageSequence(values[i]);
+      return stage.positions_.size();
+   };
+   NativeArrayTestStage nativeStage;
+   MM::Stage& nativeDevice = nativeStage;
+   BENCHMARK("10k stage positions, native array")
+   {
+      nativeDevice.ClearStageSequence();
+      nativeDevice.AddArrayToStageSequence(values.data(), n);
+      return nativeStage.positions_.size();
+   };
+}
@@ -0,0 +1,180 @@
+#include <catch2/catch_all.hpp>
+
+#include "DeviceBase.h"
+
+#include <string>
+
+namespace {
+
+class TestDevice : public CGenericBase<TestDevice>
+{
+public:
+   TestDevice() : handlerValue_(0.0), handlerCalls_(0)
+   {
+      CreateFloatProperty("Power", 0.0, false,
+            new CPropertyAction(this, &TestDevice::OnPower));
+      SetPropertyLimits("Power", 0.0, 100.0);
+      CreateIntegerProperty("Steps", 0, false);
+      CreateIntegerProperty("Binning", 1, false);
+      AddAllowedValue("Binning", "1");
+      AddAllowedValue("Binning", "2");
+      CreateStringProperty("Mode", "42", false);
+      CreateFloatProperty("Temperature", 21.5, true);
+   }
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const { CDeviceUtils::CopyLimitedString(name, "TestDevice"); }
+   bool Busy() { return false; }
+
+   int OnPower(MM::PropertyBase* pProp, MM::ActionType eAct)
+   {
+      if (eAct == MM::AfterSet)
+      {
+         pProp->Get(handlerValue_);
+         ++handlerCalls_;
+      }
+      return DEVICE_OK;
+   }
+
+   double handlerValue_;
+   int handlerCalls_;
+};
+
+// Reacts to property changes in SetProperty(), as some adapters do
+class OverridingDevice : public CGenericBase<OverridingDevice>
+{
+public:
+   OverridingDevice() : setCalls_(0)
+   {
+      CreateFloatProperty("Power", 0.0, false);
+   }
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const { CDeviceUtils::CopyLimitedString(name, "OverridingDevice"); }
+   bool Busy() { return false; }
+
+   int SetProperty(const char* name, const char* value)
+   {
+      ++setCalls_;
+      return CGenericBase<OverridingDevice>::SetProperty(name, value);
+   }
+
+   int setCalls_;
+};
+
+// Some adapters pass a type other than the device class as U (PyDevice
+// uses std::monostate); the base class must still compile for them
+struct NotTheDeviceClass {};
+
+class UnrelatedTagDevice : public CGenericBase<NotTheDeviceClass>
+{
+public:
+   UnrelatedTagDevice()
+   {
+      CreateFloatProperty("Power", 0.0, false);
+   }
+
+   int Initialize() { return DEVICE_OK; }
+   int Shutdown() { return DEVICE_OK; }
+   void GetName(char* name) const { CDeviceUtils::CopyLimitedString(name, "UnrelatedTagDevice"); }
+   bool Busy() { return false; }
+};
+
+} // anonymous namespace
+
+TEST_CASE("Numeric properties are set without string conversion", "[TypedProperty]")
+{
+   TestDevice dev;
+   MM::Device& d = dev;
+
+   CHECK(d.SetPropertyDouble("Power", 12.25) == DEVICE_OK);
+   CHECK(dev.handlerCalls_ == 1);
+   CHECK(dev.handlerValue_ == 12.25);
+   double power;
+   REQUIRE(d.GetPropertyDouble("Power", power) == DEVICE_OK);
+   CHECK(power == 12.25);
+   char buf[MM::MaxStrLength];
+   REQUIRE(d.GetProperty("Power", buf) == DEVICE_OK);
+   CHECK(std::string(buf) == "12.2500");
+
+   // Same limits and truncation as the string path
+   CHECK(d.SetPropertyDouble("Power", 100.5) == DEVICE_INVALID_PROPERTY_VALUE);
+   CHECK(dev.handlerCalls_ == 1);
+   CHECK(d.SetPropertyDouble("Power", 1.23456) == DEVICE_OK);
+   REQUIRE(d.GetPropertyDouble("Power", power) == DEVICE_OK);
+   CHECK(power == 1.2346);
+
+   CHECK(d.SetPropertyLong("Power", 7) == DEVICE_OK);
+   CHECK(dev.handlerValue_ == 7.0);
+
+   CHECK(d.SetPropertyLong("Steps", -3) == DEVICE_OK);
+   long steps;
+   REQUIRE(d.GetPropertyLong("Steps", steps) == DEVICE_OK);
+   CHECK(steps == -3);
+   CHECK(d.SetPropertyDouble("Steps", 4.9) == DEVICE_OK);
+   REQUIRE(d.GetPropertyLong("Steps", steps) == DEVICE_OK);
+   CHECK(steps == 4);
+
+   // Read-only properties are silently left unchanged, as with strings
+   CHECK(d.SetPropertyDouble("Temperature", 30.0) == DEVICE_OK);
+   double temperature;
+   REQUIRE(d.GetPropertyDouble("Temperature", temperature) == DEVICE_OK);
+   CHECK(temperature == 21.5);
+
+   CHECK(d.SetPropertyDouble("NoSuchProperty", 1.0) == DEVICE_INVALID_PROPERTY);
+   CHECK(d.GetPropertyDouble("NoSuchProperty", power) == DEVICE_INVALID_PROPERTY);
+}
+
+TEST_CASE("Typed property access defers to strings where needed", "[TypedProperty]")
+{
+   TestDevice dev;
+   MM::Device& d = dev;
+
+   // Allowed values are matched as strings
+   CHECK(d.SetPropertyLong("Binning", 2) == DEVICE_INVALID_PROPERTY_TYPE);
+   long binning;
+   REQUIRE(d.GetPropertyLong("Binning", binning) == DEVICE_OK);
+   CHECK(binning == 1);
+
+   CHECK(d.SetPropertyDouble("Mode", 1.0) == DEVICE_INVALID_PROPERTY_TYPE);
+   double mode;
+   CHECK(d.GetPropertyDouble("Mode", mode) == DEVICE_INVALID_PROPERTY_TYPE);
+
+   // The adapter-side helpers still parse string properties
+   REQUIRE(dev.GetProperty("Mode", mode) == DEVICE_OK);
+   CHECK(mode == 42.0);
+   long steps;
+   REQUIRE(dev.GetProperty("Steps", steps) == DEVICE_OK);
+   CHECK(steps == 0);
+}
+
+TEST_CASE("Typed setters defer to an overridden SetProperty()", "[TypedProperty]")
+{
+   OverridingDevice dev;
+   MM::Device& d = dev;
+
+   // The Core then sets the value as a string, through the override
+   CHECK(d.SetPropertyDouble("Power", 1.5) == DEVICE_INVALID_PROPERTY_TYPE);
+   CHECK(d.SetPropertyLong("Power", 2) == DEVICE_INVALID_PROPERTY_TYPE);
+   CHECK(dev.setCalls_ == 0);
+   CHECK(d.SetProperty("Power", "1.5") == DEVICE_OK);
+   CHECK(dev.setCalls_ == 1);
+
+   // Typed reads are unaffected
+   double power;
+   REQUIRE(d.GetPropertyDouble("Power", power) == DEVICE_OK);
+   CHECK(power == 1.5);
+}
+
+TEST_CASE("Typed setters work when U is not the device class", "[TypedProperty]")
+{
+   UnrelatedTagDevice dev;
+   MM::Device& d = dev;
+
+   CHECK(d.SetPropertyDouble("Power", 2.5) == DEVICE_OK);
+   double power;
+   REQUIRE(d.GetPropertyDouble("Power", power) == DEVICE_OK);
+   CHECK(power == 2.5);
+}
@@ -93,6 +93,21 @@ AC_DEFUN([MM_LIB_MSGPACK], [
 ])
 
 
+# Check for the Python 3 runtime, for embedding
+#
+# MM_LIB_PYTHON3([Python prefix], [action-if-found], [action-if-not-found])
+#
+# Defines precious variables PYTHON3_CPPFLAGS, PYTHON3_CFLAGS, PYTHON3_LDFLAGS,
+# PYTHON3_LIBS.
+#
+AC_DEFUN([MM_LIB_PYTHON3], [
+   MM_LIB_WITH_PKG_CONFIG([PYTHON3], [Python 3], [python3-embed], [],
+      [$1], [-lpython3],
+      [Python.h], [Py_InitializeEx],
+      [$2], [$3])
+])
+
+
 # Check for OpenCV video capture
 #
 # MM_LIB_OPENCV([OpenCV prefix], [action-if-found], [action-if-not-found])